@@ -98,6 +98,200 @@ declare namespace myproject {
      */
     function getDataByKey(key: string): number;
 
+    /**
+     * 一次获取全部传感器数据（保证来自同一帧），代替多次 getDataByKey
+     * @returns 以帧键名为属性的对象，例如 { Humi, Temp, CH2O, ..., Light }
+     */
+    function getAllSensorData(): {
+        Humi: number;
+        Temp: number;
+        CH2O: number;
+        TVOC: number;
+        CO_2: number;
+        SoilHumi: number;
+        SoilTemp: number;
+        EC: number;
+        pH: number;
+        N: number;
+        P: number;
+        K: number;
+        Salt: number;
+        TDS: number;
+        Light: number;
+        /** 帧序号，0 表示尚未收到任何帧 */
+        seq: number;
+        /** 帧到达至今的毫秒数，未收到帧时为 -1 */
+        ageMs: number;
+        /** 有效位掩码：第 i 位对应上面第 i 个键（Humi 为第 0 位），未置位表示该帧中缺失 */
+        validMask: number;
+        /** 固件帧序号（二进制帧），旧固件的文本帧为 0 */
+        deviceSeq: number;
+        /** 当前通道按固件帧序号缺口累计的丢帧数 */
+        lostFrames: number;
+    };
+
+    /**
+     * 列出 UDP 通道上所有在线的 ESP32 节点（按源 IP 区分，最多 64 个，静默 120s 后移除）
+     * 主节点（首个发来数据的节点）的数据即 getDataByKey/getAllSensorData 的数据源
+     */
+    function getUdpNodes(): Array<{
+        /** "ip:port" */
+        address: string;
+        primary: boolean;
+        /** 最近一次收到该节点数据至今的毫秒数 */
+        ageMs: number;
+        frames: number;
+        lostFrames: number;
+        deviceSeq: number;
+        validMask: number;
+        /** 以帧键名为属性的最新传感器值，同 getAllSensorData */
+        data: Record<string, number>;
+    }>;
+
+    /**
+     * UDP 接收路径统计（自初始化起累计），用于排查相机突发时的丢包
+     */
+    function getUdpRxStats(): {
+        datagrams: number;
+        bytes: number;
+        /** recvmmsg 调用次数，datagrams / batches 为平均批量 */
+        batches: number;
+        /** 内核接收缓冲满而丢弃的 datagram 数（SO_RXQ_OVFL） */
+        kernelDrops: number;
+        /** 解码线程跟不上、接收队列满而丢弃的 datagram 数 */
+        ringOverflows: number;
+        /** 超过 2KB 被截断的 datagram 数 */
+        truncated: number;
+        /** 实际生效的 socket 接收缓冲大小 */
+        rcvbufBytes: number;
+        /** 按分块协议完整收到（CRC 正确）的照片数 */
+        chunkImages: number;
+        /** 发出的 NACK 数（每个触发一轮选择性重传） */
+        chunkNacks: number;
+        /** 重复收到的分块数 */
+        chunkDuplicates: number;
+        /** 分块收齐但整张 CRC 不符的次数 */
+        chunkCrcErrors: number;
+        /** 未收齐即被下一张照片取代的次数 */
+        chunkAbandoned: number;
+    };
+
+    /**
+     * 串口读线程统计（自 init_uart 起累计），与当前数据通道无关
+     */
+    function getSerialRxStats(): {
+        bytes: number;
+        /** read 调用次数，bytes / reads 为平均每次读取量 */
+        reads: number;
+        sensorFrames: number;
+        imageFrames: number;
+        checksumErrors: number;
+        /** 超过 1MB 仍无帧尾而丢弃的次数 */
+        oversizeFrames: number;
+    };
+
+    /**
+     * 串口写线程统计（自 init_uart 起累计）
+     */
+    function getSerialTxStats(): {
+        /** 入队的写入次数 */
+        writes: number;
+        bytes: number;
+        /** 实际 write() 次数，writes / syscalls 反映合并程度 */
+        syscalls: number;
+        /** 队列满且等待超时而放弃的写入次数 */
+        dropped: number;
+    };
+
+    /**
+     * 开关串口读线程的十六进制调试输出（默认关闭）
+     */
+    function setSerialHexDump(enable: boolean): void;
+
+    /**
+     * 与 ESP32 协商切换串口波特率（默认 115200），失败时回到原速率
+     * @param baud 目标速率，支持非标准值（如 250000）
+     * @param rtscts 是否同时启用 RTS/CTS 硬件流控，固件未接流控引脚时协商失败
+     * @returns 协商成功返回 true
+     */
+    function setSerialBaudrate(baud: number, rtscts?: boolean): Promise<boolean>;
+
+    function getSerialBaudrate(): number;
+
+    /**
+     * 切换传感器数据通道
+     * @param channel "serial" / "udp"（默认）/ "multipath"（串口与 UDP 同时接收，同一帧去重，先到的生效）
+     * @returns 通道名无效时返回 false
+     */
+    function setDataChannel(channel: 'serial' | 'udp' | 'multipath'): boolean;
+
+    function getDataChannel(): 'serial' | 'udp' | 'multipath';
+
+    /**
+     * 设置传感器推送频率：ESP32 按该频率主动推送（例如看板打开时 10Hz、夜间 0.1Hz），随时可调
+     * @param hz 频率，限制在 0.01~20；<= 0 暂停推送
+     * @returns 实际生效的频率
+     */
+    function setTelemetryRate(hz: number): number;
+
+    function getTelemetryRate(): number;
+
+    /** 多路径模式下单条物理路径的统计 */
+    interface PathStats {
+        /** 送达合并层的帧数（含重复副本） */
+        frames: number;
+        /** 先于另一路径到达、被采用的帧数 */
+        firstArrivals: number;
+        /** 另一路径已送达、作为重复丢弃的副本数 */
+        lateCopies: number;
+        /** 只有另一路径送达的帧数 */
+        missed: number;
+        /** 送达率（指数滑动平均，0~1） */
+        deliveryRatio: number;
+        /** 落后于另一路径的平均毫秒数（先到记 0） */
+        lagMs: number;
+        /** 最近一帧到达至今的毫秒数，从未收到为 -1 */
+        ageMs: number;
+    }
+
+    /**
+     * 多路径统计（仅 multipath 通道下更新）
+     * @returns commandPath 为 sendCapture 等命令当前使用的路径
+     */
+    function getPathStats(): {
+        serial: PathStats;
+        udp: PathStats;
+        commandPath: 'serial' | 'udp';
+    };
+
+    /**
+     * 查询某个传感器最近 windowSec 秒内的统计值（来自设备侧内存环形缓冲）
+     * @param key 数据键名，例如 "SoilHumi"
+     * @param windowSec 时间窗口（秒）
+     * @returns 统计结果；窗口内无数据或键名无效时返回 null
+     */
+    function getSensorStats(key: string, windowSec: number): {
+        min: number;
+        max: number;
+        mean: number;
+        last: number;
+        count: number;
+    } | null;
+
+    /**
+     * 导出某个传感器的历史序列（按时间升序）
+     * @param key 数据键名
+     * @param windowSec 时间窗口（秒）
+     * @param tier 分辨率：0=原始帧，1=1 分钟（默认），2=15 分钟
+     * @returns timestamps 为 epoch 毫秒；键名/层级无效时返回 null
+     */
+    function getSensorHistory(key: string, windowSec: number, tier?: number): {
+        timestamps: Float64Array;
+        mean: Float32Array;
+        min: Float32Array;
+        max: Float32Array;
+    } | null;
+
     /**
      * 注册回调：当底层图片接收完成并写入文件后触发
      * @param callback 回调入参为图片文件路径（例如 filesDir/output.jpeg）
@@ -105,6 +299,12 @@ declare namespace myproject {
      */
     function onImageCaptured(callback: (path: string) => void): number;
 
+    /**
+     * 取得内存中的最新照片（JPEG 字节），与 onImageCaptured 通知的是同一张
+     * @returns 尚未收到照片时返回 null
+     */
+    function getLatestImage(): ArrayBuffer | null;
+
     /**
      * 取消注册图片回调
      * @returns 0表示成功
@@ -139,7 +339,7 @@ declare namespace myproject {
 
     /**
      * 配置MQTT连接参数
-     * @param brokerUrl 例如 tcp://host:1883
+     * @param brokerUrl 例如 tcp://host:1883；mqtts://host:8883 走 TLS（证书见 setMqttTls）
      * @param clientId 作为 deviceId 使用
      * @param username 用户名（可选）
      * @param password 密码（可选）
@@ -167,11 +367,142 @@ declare namespace myproject {
         * @param topicPrefix topic 前缀（命名空间），例如 ciallo_ohos
         * 原生侧将统一发布到 <topicPrefix>/<deviceId>/sensors，并在 connect 后发布 retained announce：
         * <topicPrefix>/announce/<deviceId>
-        * - haveImage=false: 原生侧采集传感器并按 Qt 客户端所需 JSON 格式发布
-        * - haveImage=true: 原生侧读取 PHOTO_PATH，Base64 后作为 JSON 的可选字段 image 一并发布
+        * - haveImage=false: 原生侧采集传感器并按 Qt 客户端所需 JSON 格式发布；若自上次上报后没有新帧则跳过（仍返回 true）
+        * - haveImage=true: 原生侧取内存中的最新照片（重启后尚无新照片时读取 PHOTO_PATH），JPEG 原样发布到
+        *   <topicPrefix>/<deviceId>/image，随后的 sensors JSON 带 imageMeta（size、crc32、captureMs、width、height、seq）；
+        *   setMqttImageInline(true) 时改回旧格式：Base64 后作为 JSON 的可选字段 image 一并发布。Promise 跟随 sensors 消息结算
+        * Promise 在报文完成时结算：qos=0 写入 socket 后，qos=1 收到 PUBACK 后，qos=2 收到 PUBCOMP 后 resolve(true)；
+        * 未连接、10 秒内未确认或被待发队列挤掉时 reject。多次调用的 QoS1 报文可同时在途。
+        * 断线自动重连期间消息进入待发队列，重连后按序补发，Promise 届时才结算。
      */
         function publishMqtt(topicPrefix: string, haveImage: boolean, qos?: number): Promise<boolean>;
 
+    /**
+     * 断线自动重连（默认开启，1000~60000ms）：等待从 minDelayMs 起每次失败翻倍至 maxDelayMs，
+     * 实际等待在 [d/2, d] 内随机。只在连接成功过后生效，disconnectMqtt() 会停止重连。
+     * @returns 参数无效（minDelayMs<=0 或 maxDelayMs<minDelayMs）时返回 false
+     */
+    function setMqttReconnect(enabled: boolean, minDelayMs: number, maxDelayMs: number): boolean;
+
+    /**
+     * 待发队列（默认容量 128、丢弃最旧、补发 20 条/秒）
+     * @param capacity 队列容量（条）
+     * @param dropOldest 队列满时 true 挤掉最早的消息，false 拒绝新消息
+     * @param drainPerSec 重连后积压消息的补发速率（条/秒），<=0 不限速
+     * @returns capacity<=0 时返回 false
+     */
+    function setMqttOfflineQueue(capacity: number, dropOldest: boolean, drainPerSec: number): boolean;
+
+    interface MqttQueueStats {
+        /** 待发送（含断线期间积压） */
+        queued: number;
+        /** 已发出、等待确认 */
+        inFlight: number;
+        /** 因队列满被挤掉或拒绝的消息数 */
+        dropped: number;
+        /** 自动重连成功次数 */
+        reconnects: number;
+    }
+
+    function getMqttQueueStats(): MqttQueueStats;
+
+    /**
+     * 入站报文大小上限：接收缓冲从 8KB 起按需翻倍至该值（默认 256KB，最小 8KB），超过上限的入站报文会导致断线
+     * @param maxBytes 上限字节数
+     * @returns 参数无效时返回 false
+     */
+    function setMqttMaxReceiveSize(maxBytes: number): boolean;
+
+    /**
+     * mqtts:// 连接的证书配置，下次 connectMqtt()（或自动重连）时生效，修改后丢弃已缓存的会话
+     * @param caFile broker 的 CA 证书（PEM），空串使用系统默认证书
+     * @param certFile 客户端证书（PEM），broker 要求双向认证时填写，否则传空串
+     * @param keyFile 客户端私钥（PEM），空串时从 certFile 读取
+     * @param verifyPeer 校验 broker 证书链与主机名（默认 true）
+     * @param sessionResumption 重连时复用上次的 TLS 会话，走简化握手（默认 true）
+     * @param serverName SNI 与证书校验用的主机名，省略时取 brokerUrl 中的主机
+     * @returns 参数类型不对时返回 false
+     */
+    function setMqttTls(caFile: string, certFile: string, keyFile: string, verifyPeer: boolean,
+                        sessionResumption: boolean, serverName?: string): boolean;
+
+    interface MqttTlsStats {
+        /** 完成的 TLS 握手次数 */
+        handshakes: number;
+        /** 其中复用会话的次数 */
+        resumed: number;
+        /** 最近一次握手耗时（ms，TCP 连上之后到握手完成） */
+        lastHandshakeMs: number;
+        /** 最近一次握手是否复用了会话 */
+        lastResumed: boolean;
+    }
+
+    function getMqttTlsStats(): MqttTlsStats;
+
+    /**
+     * 图片上报格式（默认 false）：false 时 JPEG 走独立的二进制 image 主题，sensors JSON 只带 imageMeta；
+     * true 时兼容旧版客户端，图片 Base64 后内嵌在 sensors JSON 的 image 字段中
+     * @returns 参数不是 boolean 时返回 false
+     */
+    function setMqttImageInline(inlineBase64: boolean): boolean;
+
+    /**
+     * 按主题选择负载编码（默认均为 'json'）。'cbor' 时发布到原主题加 /cbor 后缀，
+     * 例如 <topicPrefix>/<deviceId>/sensors/cbor；CBOR 负载不内嵌图片
+     * @param topic 'sensors' 实时上报 | 'history' 日志补传
+     * @param codec 'json' | 'cbor'
+     * @returns 参数无效时返回 false
+     */
+    function setMqttPayloadCodec(topic: string, codec: string): boolean;
+
+    /**
+     * 死区过滤（默认关闭）：开启后只上报超出死区的通道，发布到 <topicPrefix>/<deviceId>/sensors/delta；
+     * 全部通道都在死区内时跳过本次上报。首帧、每 keyframeIntervalSec 秒、带图片的上报
+     * 以及订阅方在控制主题发送 {"control":{"keyframe":1}} 时发完整帧到 sensors 主题
+     * @param keyframeIntervalSec 完整帧间隔（秒，默认 300）；不传或 0 保持当前值
+     */
+    function setMqttDeadband(enabled: boolean, keyframeIntervalSec?: number): boolean;
+
+    /**
+     * 单个通道的死区：|新值 - 上次上报值| >= max(absolute, relative * |上次上报值|) 才算变化
+     * @param key 数据键名，例如 "SoilHumi"
+     * @returns 键名未知或死区为负时返回 false
+     */
+    function setMqttDeadbandChannel(key: string, absolute: number, relative: number): boolean;
+
+    interface MqttDeadbandStats {
+        /** 完整帧数 */
+        keyframes: number;
+        /** 增量帧数 */
+        deltas: number;
+        /** 无变化而跳过的上报次数 */
+        suppressed: number;
+    }
+
+    function getMqttDeadbandStats(): MqttDeadbandStats;
+
+    /**
+     * 批量上报（默认关闭）：开启后每一帧传感器数据都攒进批次，按列发布到
+     * <topicPrefix>/<deviceId>/sensors/batch（CBOR 为 sensors/batch/cbor）；此时 publishMqtt(…, false)
+     * 不再单独上报，带图片的上报照常
+     * @param windowMs 时间桶长度：距批次首帧 windowMs 及以上的帧开始新的一批
+     * @param maxSamples 每批最多帧数（1~1000）
+     * @param maxLatencyMs 延迟上限：批次首帧到达后最多等这么久就发出
+     * @returns 参数越界时返回 false 且不改变当前配置
+     */
+    function setMqttBatch(enabled: boolean, windowMs: number, maxSamples: number, maxLatencyMs: number): boolean;
+
+    interface MqttBatchStats {
+        /** 已发布的批次数 */
+        batches: number;
+        /** 这些批次中的帧数 */
+        samples: number;
+        /** 发布跟不上时丢弃的帧数 */
+        dropped: number;
+    }
+
+    function getMqttBatchStats(): MqttBatchStats;
+
     /**
      * 自动控制：全局开关
      * @param enabled true 启用阈值控制；false 禁用阈值控制
@@ -0,0 +1,135 @@
+/*
+ * ESP32 -> 网关 相机分块传输协议（UDP）。固件（esp32_s3，通过 platformio.ini 的 -I../app/inc 引用）
+ * 与网关共用本头文件，保证布局一致。
+ *
+ * 整张 JPEG 不再作为一个大 datagram 依赖 IP 分片发送（任何一片丢失整张照片作废），而是切成
+ * 不超过 MTU 的分块，每个分块一个 datagram，不再套 FE...FF 转义帧：
+ *
+ *   offset 0  uint8   magic       0xC5（FE 帧流的首字节总是 0xFE，据此区分）
+ *   offset 1  uint8   version     1
+ *   offset 2  uint8   type        DATA / NACK / ACK
+ *   offset 3  uint8   flags       DATA：FLAG_POLL 要求网关立即回复接收状态
+ *   offset 4  uint16  frameId     照片编号，固件侧递增
+ *   offset 6  uint16  chunkIndex  DATA：分块下标；NACK/ACK：填 0
+ *   offset 8  uint16  chunkCount  分块总数
+ *   offset 10 uint16  chunkSize   除最后一块外每块的负载字节数
+ *   offset 12 uint32  frameLen    整张照片字节数
+ *   offset 16 uint32  frameCrc    整张照片的 CRC-32（crc32.h）
+ *   offset 20 负载    DATA：照片的 [chunkIndex * chunkSize, +len) 段；
+ *                     NACK：缺失分块位图，bit i（字节 i/8 的第 i%8 位）置位表示第 i 块缺失
+ *
+ * 交互：固件发完一轮分块（最后一块、重传轮的最后一块带 FLAG_POLL）后等待网关回复；
+ * 网关收到最后一块或 FLAG_POLL 时回复 ACK（已完整且 CRC 正确）或 NACK（位图），
+ * 回复发往固件的命令端口 9001。固件只重传 NACK 中的分块，若干轮后放弃。
+ * 网关侧完全由收到的分块驱动，不需要定时器。
+ */
+
+#ifndef CAMERA_CHUNK_H
+#define CAMERA_CHUNK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace camera_chunk {
+
+const uint8_t kMagic = 0xC5;
+const uint8_t kVersion = 1;
+
+const uint8_t TYPE_DATA = 1;
+const uint8_t TYPE_NACK = 2;
+const uint8_t TYPE_ACK = 3;
+
+const uint8_t FLAG_POLL = 0x01;
+
+// 1400 + 20 字节头 + UDP/IP 头 28 字节 < 1500 字节以太网/Wi-Fi MTU，不会被 IP 分片
+const uint16_t kChunkSize = 1400;
+const uint16_t kMaxChunks = 1024; // 约 1.4MB；NACK 位图最大 128 字节
+
+struct Header {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t frameId;
+    uint16_t chunkIndex;
+    uint16_t chunkCount;
+    uint16_t chunkSize;
+    uint32_t frameLen;
+    uint32_t frameCrc;
+};
+
+static_assert(sizeof(Header) == 20, "camera chunk header layout is part of the wire format");
+
+const size_t kMaxDatagram = sizeof(Header) + kChunkSize;
+
+inline size_t BitmapBytes(uint16_t chunkCount)
+{
+    return (static_cast<size_t>(chunkCount) + 7u) / 8u;
+}
+
+inline uint16_t ChunkCountFor(uint32_t frameLen, uint16_t chunkSize)
+{
+    return static_cast<uint16_t>((frameLen + chunkSize - 1u) / chunkSize);
+}
+
+// 第 index 块的负载长度（最后一块可能不足 chunkSize）
+inline size_t ChunkLen(const Header &h, uint16_t index)
+{
+    const size_t offset = static_cast<size_t>(index) * h.chunkSize;
+    const size_t rest = h.frameLen - offset;
+    return rest < h.chunkSize ? rest : h.chunkSize;
+}
+
+// 解析并校验头部；payload/payloadLen 指向头部之后的负载。
+// DATA 额外校验分块下标与长度一致，NACK 校验位图长度。
+inline bool Parse(const uint8_t *data, size_t len, Header &h, const uint8_t *&payload, size_t &payloadLen)
+{
+    if (data == nullptr || len < sizeof(Header) || data[0] != kMagic) {
+        return false;
+    }
+    memcpy(&h, data, sizeof(Header));
+    if (h.version != kVersion || h.chunkCount == 0 || h.chunkCount > kMaxChunks || h.chunkSize == 0 ||
+        h.chunkSize > kChunkSize || h.frameLen == 0 || ChunkCountFor(h.frameLen, h.chunkSize) != h.chunkCount) {
+        return false;
+    }
+    payload = data + sizeof(Header);
+    payloadLen = len - sizeof(Header);
+    switch (h.type) {
+        case TYPE_DATA:
+            return h.chunkIndex < h.chunkCount && payloadLen == ChunkLen(h, h.chunkIndex);
+        case TYPE_NACK:
+            return payloadLen == BitmapBytes(h.chunkCount);
+        case TYPE_ACK:
+            return payloadLen == 0;
+        default:
+            return false;
+    }
+}
+
+// 按 frame 的描述（frameId/chunkCount/chunkSize/frameLen/frameCrc）写出一个头部，返回头部长度
+inline size_t WriteHeader(uint8_t *out, const Header &frame, uint8_t type, uint8_t flags, uint16_t chunkIndex)
+{
+    Header h = frame;
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.type = type;
+    h.flags = flags;
+    h.chunkIndex = chunkIndex;
+    memcpy(out, &h, sizeof(h));
+    return sizeof(h);
+}
+
+inline bool BitTest(const uint8_t *bitmap, uint16_t i)
+{
+    return (bitmap[i / 8u] & (1u << (i % 8u))) != 0;
+}
+
+inline void BitSet(uint8_t *bitmap, uint16_t i)
+{
+    bitmap[i / 8u] = static_cast<uint8_t>(bitmap[i / 8u] | (1u << (i % 8u)));
+}
+
+} // namespace camera_chunk
+
+#endif // CAMERA_CHUNK_H
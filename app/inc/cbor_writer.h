@@ -0,0 +1,107 @@
+/*
+ * 最小 CBOR（RFC 8949）编码器，供 mqtt_payload_builder 生成紧凑的二进制上报负载。
+ * 只实现用到的类型：无符号/负整数、文本串、字节串、定长数组/映射、布尔、null、float32。
+ * 直接追加到调用方的 std::string，不建中间树。
+ */
+
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+#include <string>
+
+namespace cbor {
+
+class Writer {
+public:
+    explicit Writer(std::string &out) : out_(out) {}
+
+    void Uint(uint64_t v) { Head(0, v); }
+
+    void Int(int64_t v)
+    {
+        if (v >= 0) {
+            Head(0, static_cast<uint64_t>(v));
+        } else {
+            Head(1, static_cast<uint64_t>(-(v + 1)));
+        }
+    }
+
+    void Bytes(const void *data, size_t len)
+    {
+        Head(2, len);
+        out_.append(static_cast<const char *>(data), len);
+    }
+
+    void Text(const char *s, size_t len)
+    {
+        Head(3, len);
+        out_.append(s, len);
+    }
+
+    void Text(const std::string &s) { Text(s.data(), s.size()); }
+
+    void Array(size_t n) { Head(4, n); }
+    void Map(size_t n) { Head(5, n); }
+
+    void Bool(bool v) { out_.push_back(static_cast<char>(v ? 0xF5 : 0xF4)); }
+    void Null() { out_.push_back(static_cast<char>(0xF6)); }
+
+    void Float(float v)
+    {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        out_.push_back(static_cast<char>(0xFA));
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out_.push_back(static_cast<char>((bits >> shift) & 0xFF));
+        }
+    }
+
+    // 传感器数值：整数值按整数写（1~5 字节），其余写 float32（5 字节）
+    void Number(float v)
+    {
+        if (std::isfinite(v) && v == std::floor(v) && std::fabs(v) < 2147483648.0f) {
+            Int(static_cast<int64_t>(v));
+        } else {
+            Float(v);
+        }
+    }
+
+private:
+    // 首字节：高 3 位主类型，低 5 位为值本身（<24）或后随 1/2/4/8 字节大端值的长度标记
+    void Head(uint8_t major, uint64_t v)
+    {
+        const uint8_t m = static_cast<uint8_t>(major << 5);
+        if (v < 24) {
+            out_.push_back(static_cast<char>(m | v));
+            return;
+        }
+        int bytes;
+        if (v <= 0xFF) {
+            out_.push_back(static_cast<char>(m | 24));
+            bytes = 1;
+        } else if (v <= 0xFFFF) {
+            out_.push_back(static_cast<char>(m | 25));
+            bytes = 2;
+        } else if (v <= 0xFFFFFFFFull) {
+            out_.push_back(static_cast<char>(m | 26));
+            bytes = 4;
+        } else {
+            out_.push_back(static_cast<char>(m | 27));
+            bytes = 8;
+        }
+        for (int i = bytes - 1; i >= 0; i--) {
+            out_.push_back(static_cast<char>((v >> (i * 8)) & 0xFF));
+        }
+    }
+
+    std::string &out_;
+};
+
+} // namespace cbor
+
+#endif // CBOR_WRITER_H
@@ -0,0 +1,58 @@
+/*
+ * CRC-32 (IEEE 802.3, 反射多项式 0xEDB88320)，与 zlib crc32 / ESP-IDF esp_crc32_le 结果一致。
+ * 表驱动实现，供日志块校验与帧校验复用。
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace crc32 {
+
+namespace detail {
+
+struct Table {
+    uint32_t v[256];
+
+    Table()
+    {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1u) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            v[i] = c;
+        }
+    }
+};
+
+inline const Table &GetTable()
+{
+    static const Table table;
+    return table;
+}
+
+} // namespace detail
+
+// 增量计算：crc 传入上一次的返回值（首次传 0）
+inline uint32_t Update(uint32_t crc, const void *data, size_t len)
+{
+    const uint32_t *table = detail::GetTable().v;
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0xFFu] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+inline uint32_t Compute(const void *data, size_t len)
+{
+    return Update(0, data, len);
+}
+
+} // namespace crc32
+
+#endif // CRC32_H
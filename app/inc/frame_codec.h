@@ -0,0 +1,211 @@
+/*
+ * FE/7E/FF/01 帧编解码，串口（myserial）、UDP（wifi_udp_receiver）与固件（esp32_s3，通过
+ * platformio.ini 的 -I../app/inc 引用）共用，保证转义、重新同步与长度上限的行为一致。
+ *
+ * 帧格式：FE + escaped(payload + checksum) + type
+ *   - checksum：payload 各字节之和的低 8 位
+ *   - type：FF 传感器帧 / 01 相机帧，同时作为帧尾
+ *   - 转义：payload 与 checksum 中的 FE/7E/FF/01 前面插入 7E
+ *
+ * 普通字节（绝大多数 JPEG/文本字节）按段处理：一次扫描 8 字节（SWAR），找到下一个特殊字节后
+ * 整段 memcpy / insert，只在特殊字节处逐字节处理。
+ */
+
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+namespace frame_codec {
+
+const uint8_t kFrameHead = 0xFE;
+const uint8_t kFrameEnd = 0xFF; // 传感器帧帧尾
+const uint8_t kEsc = 0x7E;
+const uint8_t kCameraEnd = 0x01; // 相机帧帧尾
+
+inline bool IsSpecial(uint8_t b)
+{
+    return b == kFrameHead || b == kEsc || b == kFrameEnd || b == kCameraEnd;
+}
+
+namespace detail {
+
+const uint64_t kOnes = 0x0101010101010101ull;
+const uint64_t kHighs = 0x8080808080808080ull;
+
+// 8 字节中是否有字节等于 b（经典 haszero 技巧，可能误报但不会漏报，误报由逐字节检查兜底）
+inline uint64_t HasByte(uint64_t w, uint8_t b)
+{
+    const uint64_t x = w ^ (kOnes * b);
+    return (x - kOnes) & ~x & kHighs;
+}
+
+} // namespace detail
+
+// 返回 [p, end) 中第一个特殊字节的位置，没有则返回 end
+inline const uint8_t *FindSpecial(const uint8_t *p, const uint8_t *end)
+{
+    while (end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        if ((detail::HasByte(w, kFrameHead) | detail::HasByte(w, kEsc) | detail::HasByte(w, kFrameEnd) |
+             detail::HasByte(w, kCameraEnd)) != 0) {
+            break;
+        }
+        p += 8;
+    }
+    while (p < end && !IsSpecial(*p)) {
+        p++;
+    }
+    return p;
+}
+
+inline uint8_t Checksum(const uint8_t *data, size_t len)
+{
+    uint8_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum = static_cast<uint8_t>(sum + data[i]);
+    }
+    return sum;
+}
+
+// 编码输出的最坏长度：payload 与 checksum 每字节都需转义，再加帧头和类型字节
+inline size_t EncodedBound(size_t len)
+{
+    return (len + 1) * 2 + 2;
+}
+
+// 编码一帧到调用方提供的 out；返回写入字节数，容量不足 EncodedBound(len) 返回 0
+inline size_t Encode(const uint8_t *payload, size_t len, uint8_t type, uint8_t *out, size_t cap)
+{
+    if (out == nullptr || cap < EncodedBound(len)) {
+        return 0;
+    }
+    uint8_t *o = out;
+    *o++ = kFrameHead;
+    const uint8_t *p = payload;
+    const uint8_t *end = payload + len;
+    while (p < end) {
+        const uint8_t *special = FindSpecial(p, end);
+        memcpy(o, p, static_cast<size_t>(special - p));
+        o += special - p;
+        if (special == end) {
+            break;
+        }
+        *o++ = kEsc;
+        *o++ = *special;
+        p = special + 1;
+    }
+    const uint8_t checksum = Checksum(payload, len);
+    if (IsSpecial(checksum)) {
+        *o++ = kEsc;
+    }
+    *o++ = checksum;
+    *o++ = type;
+    return static_cast<size_t>(o - out);
+}
+
+// 增量解码：字节流可在任意位置切开分多次 Feed（串口 read、UDP datagram）。
+// 完整且校验通过的帧通过回调 onFrame(uint8_t type, std::vector<uint8_t> &payload) 交出，
+// payload 已去掉校验和；回调可以 std::move 走缓冲（例如移交照片），之后可用 Buffer() 换入新缓冲。
+class Decoder {
+public:
+    struct Stats {
+        uint64_t frames = 0;         // 校验通过交给回调的帧数
+        uint64_t checksumErrors = 0; // 校验和错误而丢弃的帧数
+        uint64_t oversize = 0;       // 超过 maxFrame 仍无帧尾而丢弃的次数
+        uint64_t resyncs = 0;        // 帧内遇到新帧头、丢弃未完成帧的次数
+    };
+
+    explicit Decoder(size_t maxFrame) : maxFrame_(maxFrame) {}
+
+    // 是否处于帧外（等待帧头）；帧内时不应把数据另作他用
+    bool Idle() const { return state_ == WAIT_HEAD; }
+
+    // 当前帧缓冲：回调移走后可赋入池化缓冲，下一帧沿用其容量
+    std::vector<uint8_t> &Buffer() { return frame_; }
+
+    const Stats &GetStats() const { return stats_; }
+
+    template <typename OnFrame>
+    void Feed(const uint8_t *data, size_t n, OnFrame &&onFrame)
+    {
+        const uint8_t *p = data;
+        const uint8_t *end = data + n;
+        while (p < end) {
+            if (state_ == WAIT_HEAD) {
+                const uint8_t *head = static_cast<const uint8_t *>(memchr(p, kFrameHead, static_cast<size_t>(end - p)));
+                if (head == nullptr) {
+                    return;
+                }
+                frame_.clear(); // 保留容量，下一帧不再分配
+                state_ = IN_FRAME;
+                p = head + 1;
+                continue;
+            }
+
+            if (state_ == ESCAPED) {
+                frame_.push_back(*p++);
+                state_ = IN_FRAME;
+            } else {
+                const uint8_t *special = FindSpecial(p, end);
+                frame_.insert(frame_.end(), p, special);
+                p = special;
+                if (p < end) {
+                    const uint8_t b = *p++;
+                    if (b == kEsc) {
+                        state_ = ESCAPED;
+                    } else if (b == kFrameHead) {
+                        // 重新同步：遇到新的帧头，丢弃旧的未完成帧
+                        stats_.resyncs++;
+                        frame_.clear();
+                    } else {
+                        state_ = WAIT_HEAD;
+                        Complete(b, onFrame);
+                        continue;
+                    }
+                }
+            }
+
+            if (frame_.size() > maxFrame_) {
+                // 防御：异常数据导致一直收不到帧尾
+                stats_.oversize++;
+                frame_.clear();
+                state_ = WAIT_HEAD;
+            }
+        }
+    }
+
+private:
+    enum State { WAIT_HEAD, IN_FRAME, ESCAPED };
+
+    template <typename OnFrame>
+    void Complete(uint8_t type, OnFrame &onFrame)
+    {
+        if (frame_.empty()) {
+            return;
+        }
+        const uint8_t recvChecksum = frame_.back();
+        frame_.pop_back();
+        if (Checksum(frame_.data(), frame_.size()) != recvChecksum) {
+            stats_.checksumErrors++;
+            frame_.clear();
+            return;
+        }
+        stats_.frames++;
+        onFrame(type, frame_);
+    }
+
+    size_t maxFrame_;
+    State state_ = WAIT_HEAD;
+    std::vector<uint8_t> frame_;
+    Stats stats_;
+};
+
+} // namespace frame_codec
+
+#endif // FRAME_CODEC_H
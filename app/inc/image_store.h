@@ -0,0 +1,34 @@
+#ifndef IMAGE_STORE_H
+#define IMAGE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace image {
+
+// Latest camera image, shared by reference. Receivers reassemble JPEG frames into
+// pooled buffers and hand them over with PublishImage; consumers (MQTT payload, NAPI)
+// take a reference with GetLatestImage instead of re-reading PHOTO_PATH. A buffer goes
+// back to the pool once the last reference to it is dropped.
+using ImageRef = std::shared_ptr<const std::vector<uint8_t>>;
+
+// Take an empty buffer from the pool, with capacity reserved for the last image size
+// (plus slack), so reassembling the next JPEG does not reallocate.
+std::vector<uint8_t> AcquireBuffer();
+
+// Return a buffer that did not end up holding an image (e.g. a sensor frame).
+void ReleaseBuffer(std::vector<uint8_t> &&buf);
+
+// Publish a complete JPEG: becomes the latest image, is written to `path` atomically
+// (temp file + rename) and NotifyImageCapturedFromNative(path) is raised.
+void PublishImage(std::vector<uint8_t> &&jpeg, const char *path);
+
+// Latest image (nullptr if none since start). `seq` (optional) counts published images;
+// `captureMs` (optional) is the wall-clock time (epoch ms) the image was published.
+ImageRef GetLatestImage(uint64_t *seq = nullptr, int64_t *captureMs = nullptr);
+
+} // namespace image
+
+#endif // IMAGE_STORE_H
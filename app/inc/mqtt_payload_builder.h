@@ -1,8 +1,15 @@
  #ifndef MQTT_PAYLOAD_BUILDER_H
 #define MQTT_PAYLOAD_BUILDER_H
 
+#include <cstdint>
 #include <string>
 
+#include "image_store.h"
+#include "sensor_batch.h"
+#include "sensor_data_provider.h"
+#include "sensor_deadband.h"
+#include "sensor_log.h"
+
 namespace mqttc {
 
 // Set deviceId used in sensor JSON payload.
@@ -16,12 +23,113 @@ std::string GetMqttPayloadDeviceId();
 void SetMqttTopicPrefix(const std::string &prefix);
 std::string GetMqttTopicPrefix();
 
+// Payload encoding, selectable per topic. JSON keeps the topic unchanged; CBOR (RFC 8949)
+// is published on "<topic>/cbor" so subscribers can tell the formats apart.
+enum class PayloadCodec {
+    JSON,
+    CBOR,
+};
+
+enum class PayloadTopic {
+    SENSORS, // <prefix>/<deviceId>/sensors
+    HISTORY, // <prefix>/<deviceId>/sensors/history
+};
+
+void SetMqttPayloadCodec(PayloadTopic topic, PayloadCodec codec);
+PayloadCodec GetMqttPayloadCodec(PayloadTopic topic);
+
+// Topic a payload encoded with `codec` is published on.
+std::string PayloadCodecTopic(const std::string &baseTopic, PayloadCodec codec);
+
+// Image transport for haveImage uploads. By default the JPEG is published raw on
+// <prefix>/<deviceId>/image and the sensors JSON only carries "imageMeta". Setting
+// inline=true restores the old format (Base64 in the "image" field of the sensors JSON)
+// for clients that do not subscribe to the image topic yet.
+void SetMqttImageInlineBase64(bool inlineBase64);
+bool GetMqttImageInlineBase64();
+
+// Latest camera image plus the metadata announced in "imageMeta".
+struct ImagePayload {
+    image::ImageRef jpeg;  // shared with image_store, published without copying;
+                           // null when the caller mapped PHOTO_PATH itself
+    size_t size = 0;       // JPEG byte count
+    uint64_t seq = 0;      // image_store sequence (0 when read from PHOTO_PATH)
+    int64_t captureMs = 0; // epoch ms the image was received (file mtime after a restart)
+    uint32_t crc32 = 0;    // CRC-32 of the JPEG bytes
+    int width = 0;         // from the JPEG SOF marker, 0 if not found
+    int height = 0;
+};
+
+// Load the latest in-memory image (image::GetLatestImage); falls back to PHOTO_PATH
+// after a restart.
+bool LoadLatestImagePayload(ImagePayload &out, std::string *errMsg = nullptr);
+
+// Fill size, crc32 and width/height from JPEG bytes the caller keeps alive (e.g. PHOTO_PATH
+// mapped with PublishPayload::FromFile). seq/captureMs are left to the caller.
+void DescribeImageBytes(const uint8_t *data, size_t size, ImagePayload &out);
+
 // Build JSON payload for sensor topic.
 // Format matches the Qt client parser:
 // {"deviceId":"...","timestamp":"...","sensors":{...}}
 bool BuildSensorPayloadJson(bool includeImage, std::string &outJson, std::string *errMsg = nullptr);
 
-// Build Base64 payload for image topic. Reads PHOTO_PATH and Base64-encodes it.
+// Same as above, but serializes a snapshot the caller already holds (e.g. to check
+// snap.seq for duplicates first). Adds "seq" (frame sequence) to the payload.
+bool BuildSensorPayloadJson(const sensor::SensorSnapshot &snap, bool includeImage,
+                            std::string &outJson, std::string *errMsg = nullptr);
+
+// Sensors JSON that accompanies a binary image publish: same fields as above plus
+// "imageMeta": {"size","crc32","captureMs","width","height","seq"} describing the JPEG
+// sent on the image topic.
+bool BuildSensorPayloadJson(const sensor::SensorSnapshot &snap, const ImagePayload &image,
+                            std::string &outJson, std::string *errMsg = nullptr);
+
+// CBOR form of the sensors payload: a map with small integer keys instead of names.
+//   0 deviceId (text)   1 timestampMs (epoch ms)   2 seq
+//   3 sensors: array in the fixed order soilMoisture, lightLevel, temperature, humidity,
+//     formaldehyde, tvoc, co2, soilTemperature, ec, ph, nitrogen, phosphorus, potassium,
+//     salt, tds; integral values as integers, others as float32
+//   4 alarm   5 recordId (history)   6 replay (history, true)
+//   7 imageMeta: {0 size, 1 crc32, 2 captureMs, 3 width, 4 height, 5 seq}
+// `image` (optional) adds imageMeta; CBOR never inlines the image itself.
+bool BuildSensorPayloadCbor(const sensor::SensorSnapshot &snap, const ImagePayload *image,
+                            std::string &outCbor, std::string *errMsg = nullptr);
+bool BuildSensorHistoryPayloadCbor(const sensor::SensorLogRecord &rec, std::string &outCbor,
+                                   std::string *errMsg = nullptr);
+
+// Encode with the given codec: JSON falls through to the Build*Json functions.
+bool BuildSensorPayload(PayloadCodec codec, const sensor::SensorSnapshot &snap, const ImagePayload *image,
+                        std::string &out, std::string *errMsg = nullptr);
+bool BuildSensorHistoryPayload(PayloadCodec codec, const sensor::SensorLogRecord &rec, std::string &out,
+                               std::string *errMsg = nullptr);
+
+// Delta payload for <prefix>/<deviceId>/sensors/delta (see sensor_deadband.h): only the
+// channels in update.changedMask, plus "alarm" when update.alarmChanged.
+// JSON: {"deviceId","timestamp","seq","delta":true,"sensors":{<changed fields>}}
+// CBOR: same keys as the sensors payload, but key 3 is a map {field index: value}
+// using the sensors array order, and key 4 is present only when the alarm changed.
+bool BuildSensorDeltaPayload(PayloadCodec codec, const sensor::SensorSnapshot &snap, const SensorUpdate &update,
+                             int alarm, std::string &out, std::string *errMsg = nullptr);
+
+// Columnar batch payload for <prefix>/<deviceId>/sensors/batch (see sensor_batch.h).
+// JSON: {"deviceId","timestamp" (first frame),"baseMs","seq","count","alarm",
+//        "offsetsMs":[ms after baseMs, one per frame],"sensors":{"<field>":[one value per frame]}}
+//   Only channels present in at least one frame get a column; a frame without the channel
+//   has null in it.
+// CBOR: 0 deviceId, 1 baseMs, 2 seq of the first frame, 3 array of columns in the sensors
+//   array order (empty for channels absent from the whole batch, null for absent frames),
+//   4 alarm, 8 offsetsMs.
+bool BuildSensorBatchPayload(PayloadCodec codec, const sensor::SensorBatch &batch, int alarm, std::string &out,
+                             std::string *errMsg = nullptr);
+
+// Build JSON payload for a replayed log record (topic <prefix>/<deviceId>/sensors/history).
+// Same "sensors" fields as the live payload, plus "recordId" (log id, for de-duplication)
+// and "timestampMs"; "timestamp" is the time the record was captured, not the send time.
+bool BuildSensorHistoryPayloadJson(const sensor::SensorLogRecord &rec, std::string &outJson,
+                                   std::string *errMsg = nullptr);
+
+// Build Base64 payload for image topic. Encodes the latest in-memory image
+// (image::GetLatestImage); falls back to reading PHOTO_PATH after a restart.
 bool BuildImagePayloadBase64(std::string &outBase64, std::string *errMsg = nullptr);
 
 } // namespace mqttc
@@ -0,0 +1,94 @@
+#ifndef MQTT_TOPIC_ROUTER_H
+#define MQTT_TOPIC_ROUTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mqttc {
+
+// 处理函数的执行位置
+enum class HandlerExecutor {
+    INLINE, // 在 MQTT I/O 线程中直接调用：没有拷贝和线程切换，但不能阻塞
+    WORKER, // 消息拷贝一份后交给分发器的工作线程按到达顺序调用，可以做耗时操作（驱动执行器等）
+};
+
+// topic 不以 '\0' 结尾，长度为 topicLen；INLINE 处理函数中 topic/data 只在调用期间有效
+using MessageHandler = std::function<void(const char *topic, size_t topicLen, const void *data, size_t size)>;
+
+// 0 表示无效（过滤器不合法）
+using HandlerId = uint64_t;
+
+// 入站消息分发：按订阅过滤器（MQTT 3.1.1 的 + 与 # 通配）把消息交给注册的处理函数，
+// 同一过滤器可以有多个处理函数。过滤器按层级存成前缀树，每条消息沿主题层级走一遍，
+// 耗时与主题层数成正比、与过滤器数量无关；主题按 (指针, 长度) 逐层比较，不构造 std::string。
+// 树本身不可变：增删处理函数时复制出新树再原子替换，分发时不加锁，处理函数里也可以增删。
+class TopicRouter {
+public:
+    TopicRouter();
+    ~TopicRouter();
+
+    TopicRouter(const TopicRouter &) = delete;
+    TopicRouter &operator=(const TopicRouter &) = delete;
+
+    // 过滤器不合法（空、# 不在最后一层、通配符与其他字符同层）时返回 0
+    HandlerId add(const std::string &filter, MessageHandler handler, HandlerExecutor executor);
+
+    // 移除处理函数；filterOut 为其过滤器，lastOut 表示该过滤器已没有其他处理函数（调用方据此退订）。
+    // 已交给工作线程的消息仍会送达。找不到 id 时返回 false
+    bool remove(HandlerId id, std::string *filterOut = nullptr, bool *lastOut = nullptr);
+
+    // 在 I/O 线程中调用，返回匹配到的处理函数个数
+    size_t dispatch(const char *topic, size_t topicLen, const void *data, size_t size);
+
+    // 工作线程队列满（kMaxWorkerTasks）时丢掉的最旧消息数
+    uint64_t droppedTasks() const;
+
+    static bool IsValidFilter(const std::string &filter);
+
+private:
+    struct Node;
+    struct Entry;
+
+    // 交给工作线程的一条消息：message 为 主题 + '\0' + 负载，同一消息的多个处理函数共用一份
+    struct Task {
+        std::shared_ptr<const MessageHandler> handler;
+        std::shared_ptr<const std::string> message;
+        size_t topicLen;
+    };
+
+    using NodePtr = std::shared_ptr<const Node>;
+
+    static NodePtr Insert(const NodePtr &node, const std::vector<std::string> &levels, size_t i, const Entry &entry);
+    static NodePtr Erase(const NodePtr &node, const std::vector<std::string> &levels, size_t i, HandlerId id,
+                         bool &found, bool &last);
+    void collect(const Node &node, const char *topic, size_t len, size_t pos, bool root,
+                 const void *data, size_t size, std::shared_ptr<const std::string> &copy, size_t &matched);
+    void run(const Entry &entry, const char *topic, size_t topicLen, const void *data, size_t size,
+             std::shared_ptr<const std::string> &copy);
+    void workerLoop();
+
+    std::mutex writeMutex_; // 串行化 add/remove（复制-替换）
+    NodePtr root_; // 用 std::atomic_load/atomic_store 访问
+    std::map<HandlerId, std::string> filters_; // id -> 过滤器（writeMutex_）
+    HandlerId nextId_ = 1;
+
+    mutable std::mutex taskMutex_;
+    std::condition_variable taskCv_;
+    std::deque<Task> tasks_;
+    uint64_t droppedTasks_ = 0;
+    bool stopping_ = false;
+    std::thread worker_; // 第一次注册 WORKER 处理函数时启动
+};
+
+} // namespace mqttc
+
+#endif // MQTT_TOPIC_ROUTER_H
@@ -0,0 +1,134 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <sys/types.h>
+
+#include "mqtt_transport_pal.h"
+
+struct ssl_st;
+struct ssl_ctx_st;
+struct ssl_session_st;
+
+namespace mqttc {
+
+// mqtts:// 连接的证书与会话配置
+struct TlsOptions {
+    std::string caFile;            // PEM 格式 CA 证书；为空时使用系统默认证书路径
+    std::string certFile;          // 客户端证书链（PEM），broker 要求双向认证时填写
+    std::string keyFile;           // 客户端私钥（PEM）；为空时从 certFile 读取
+    std::string serverName;        // SNI 与证书校验用的主机名；为空时取 brokerUrl 中的主机
+    bool verifyPeer = true;        // 校验 broker 证书链与主机名
+    bool sessionResumption = true; // 缓存会话票据/会话 ID，重连时走简化握手
+};
+
+// TLS 客户端上下文：证书配置与最近一次的会话，跨重连保留。
+// 会话按 broker 的 host:port 缓存，连接其他 broker 时不复用。
+class TlsContext {
+public:
+    static std::shared_ptr<TlsContext> Create(const TlsOptions &options, std::string *errorMsg);
+    ~TlsContext();
+
+    TlsContext(const TlsContext &) = delete;
+    TlsContext &operator=(const TlsContext &) = delete;
+
+    const TlsOptions &options() const { return options_; }
+
+private:
+    friend class Transport;
+
+    explicit TlsContext(const TlsOptions &options) : options_(options) {}
+
+    static int OnNewSession(struct ssl_st *ssl, struct ssl_session_st *session);
+    // 返回带引用的会话（调用方释放），没有可复用的会话时返回 nullptr
+    struct ssl_session_st *takeSession(const std::string &peer);
+
+    TlsOptions options_;
+    struct ssl_ctx_st *ctx_ = nullptr;
+
+    std::mutex mutex_;
+    std::string sessionPeer_;
+    struct ssl_session_st *session_ = nullptr;
+};
+
+// 一条已建立 TCP 的连接，明文或 TLS，作为 MQTT-C 的 socket 句柄（mqtt_pal_socket_handle）。
+// 只由 MqttCClient 的 I/O 线程使用；TLS 握手以非阻塞方式分步推进，由 I/O 线程的 poll 驱动。
+class Transport {
+public:
+    enum class Handshake {
+        DONE,
+        WANT_READ,  // 等 socket 可读后再调用 handshake()
+        WANT_WRITE, // 等 socket 可写后再调用 handshake()
+        FAILED,
+    };
+
+    // 接管 fd（须为已连接的非阻塞 socket，失败时也会关闭）。tls 为空时为明文 TCP；
+    // host/port 用于证书主机名校验与会话缓存
+    static std::unique_ptr<Transport> Create(int fd,
+                                             std::shared_ptr<TlsContext> tls,
+                                             const std::string &host,
+                                             int port,
+                                             std::string *errorMsg);
+    ~Transport();
+
+    Transport(const Transport &) = delete;
+    Transport &operator=(const Transport &) = delete;
+
+    int fd() const { return fd_; }
+    bool isTls() const { return ssl_ != nullptr; }
+
+    Handshake handshake(std::string *errorMsg);
+    bool handshakeDone() const { return handshakeDone_; }
+    bool sessionReused() const;
+    int64_t handshakeMs() const { return handshakeMs_; }
+
+    // >0 为写出/读到的字节数，0 表示暂时不能继续（等 poll），<0 表示出错或对端关闭（见 lastError()）
+    ssize_t send(const void *data, size_t size);
+    ssize_t recv(void *data, size_t size);
+
+    // 上一次操作在等 socket 可写（TLS 读数据时也可能需要先写）
+    bool wantsWrite() const { return wantWrite_; }
+    // TLS 层已解密、尚未读走的数据：socket 上不会再有可读事件，需要不等 poll 继续读
+    bool hasBufferedInput() const;
+
+    const std::string &lastError() const { return lastError_; }
+
+private:
+    friend class TlsContext;
+
+    explicit Transport(int fd) : fd_(fd) {}
+
+    ssize_t tlsResult(int rc, const char *op);
+
+    int fd_;
+    struct ssl_st *ssl_ = nullptr;
+    std::shared_ptr<TlsContext> tls_;
+    std::string peer_;
+
+    bool handshakeDone_ = true;
+    bool wantWrite_ = false;
+    bool fatal_ = false; // TLS 致命错误后不再发送 close_notify，会话也不再复用
+    std::chrono::steady_clock::time_point handshakeStart_;
+    int64_t handshakeMs_ = 0;
+    std::string lastError_;
+};
+
+inline mqtt_pal_socket_handle ToSocketHandle(Transport *transport)
+{
+    return reinterpret_cast<mqtt_pal_socket_handle>(transport);
+}
+
+inline Transport *FromSocketHandle(mqtt_pal_socket_handle handle)
+{
+    return reinterpret_cast<Transport *>(handle);
+}
+
+} // namespace mqttc
+
+#endif // MQTT_TRANSPORT_H
@@ -0,0 +1,16 @@
+#ifndef MQTT_TRANSPORT_PAL_H
+#define MQTT_TRANSPORT_PAL_H
+
+// MQTT-C 平台层配置（BUILD.gn 中以 MQTTC_PAL_FILE 指定）：沿用默认的 mqtt_pal.h，只把 socket
+// 句柄换成 MqttCClient 的传输层，同一份 MQTT-C 既能走明文 TCP 也能走 TLS。
+// mqtt_pal_sendall/mqtt_pal_recvall 在 mqtt_transport.cpp 中实现。
+#define MQTT_USE_CUSTOM_SOCKET_HANDLE
+
+// C 与 C++ 两侧是同一个不透明类型（mqtt_client::socketfd 跨语言共用），MQTT-C 只传递指针；
+// 与 mqttc::Transport 之间的转换见 mqtt_transport.h 的 ToSocketHandle/FromSocketHandle
+struct mqttc_transport;
+typedef struct mqttc_transport *mqtt_pal_socket_handle;
+
+#include <mqtt_pal.h>
+
+#endif // MQTT_TRANSPORT_PAL_H
@@ -3,32 +3,121 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <atomic>
 
+#include "mqtt_topic_router.h"
+#include "mqtt_transport.h"
+
 extern "C" {
 #include "mqtt.h"
 }
 
 namespace mqttc {
 
+// 发布负载：入队时只保存引用。超过 8KB 的负载由 I/O 线程从这里分块直接写入 socket，
+// 不再整份拷贝进 MQTT-C 的发送缓冲，因此不受发送缓冲大小限制。
+class PublishPayload {
+public:
+    static std::shared_ptr<const PublishPayload> FromBuffer(std::string data);
+    static std::shared_ptr<const PublishPayload> FromBytes(const void *data, size_t size);
+    // 引用调用方的缓冲（如 image::ImageRef）不拷贝；owner 保证发送完成前 data 有效
+    static std::shared_ptr<const PublishPayload> FromShared(std::shared_ptr<const void> owner,
+                                                            const void *data, size_t size);
+    // 只读 mmap 整个文件；发送完成前文件不应被截断（替换文件应写临时文件后 rename）
+    static std::shared_ptr<const PublishPayload> FromFile(const std::string &path, std::string *errorMsg = nullptr);
+
+    ~PublishPayload();
+    PublishPayload(const PublishPayload &) = delete;
+    PublishPayload &operator=(const PublishPayload &) = delete;
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    PublishPayload() = default;
+
+    std::string buffer_;
+    std::shared_ptr<const void> owner_;
+    void *map_ = nullptr;
+    size_t mapLen_ = 0;
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 客户端自带一个网络 I/O 线程：poll 等待 socket 与唤醒 eventfd，只在有数据收发、
+// 新请求入队或 keepalive/重传到期时调用 mqtt_sync。publish/subscribe 只把请求放入队列，
+// 由 I/O 线程交给 MQTT-C；可同时有多条 QoS1 报文在途，收到 PUBACK 后回调。
+// 连接成功后若断线，I/O 线程按抖动指数退避自动重连，重新订阅并补发断线期间积压的请求。
 class MqttCClient {
 public:
-    using MessageCallback = void (*)(void *ctx, const char *topic, const void *data, size_t size);
+    // 请求完成回调：QoS0 在报文写入 socket 后，QoS1 在收到 PUBACK 后，QoS2 在收到 PUBCOMP 后，
+    // 订阅在收到 SUBACK 后以 ok=true 调用；未连接、超时、连接断开时 ok=false。
+    // 在 I/O 线程中调用：不要在回调里阻塞或调用同步的 publish/subscribe。
+    using CompletionCallback = std::function<void(bool ok, const std::string &error)>;
+
+    enum class DropPolicy {
+        DROP_OLDEST, // 待发队列满时挤掉最早入队的发布（默认：保留最新数据）
+        DROP_NEWEST, // 待发队列满时拒绝新请求
+    };
+
+    struct QueueStats {
+        size_t queued = 0;       // 待发送（含断线期间积压）
+        size_t inFlight = 0;     // 已交给 MQTT-C、等待确认
+        uint64_t dropped = 0;    // 因队列满被挤掉或拒绝的请求数
+        uint64_t reconnects = 0; // 自动重连成功次数
+    };
+
+    struct TlsStats {
+        uint64_t handshakes = 0;     // 完成的 TLS 握手次数
+        uint64_t resumed = 0;        // 其中复用会话（简化握手）的次数
+        int64_t lastHandshakeMs = 0; // 最近一次握手耗时（TCP 连上之后到握手完成）
+        bool lastResumed = false;
+    };
 
     MqttCClient();
     ~MqttCClient();
 
+    // brokerUrl：[tcp://|mqtt://]host[:port]（默认 1883）或 mqtts://|ssl://host[:port]（TLS，默认 8883）
     void configure(const std::string &brokerUrl,
                    const std::string &clientId,
                    const std::string &username,
                    const std::string &password);
 
+    // mqtts:// 的证书与会话配置，下次建立连接时生效；修改后丢弃已缓存的会话
+    void setTlsOptions(const TlsOptions &options);
+    TlsStats getTlsStats() const;
+
     bool connect(std::string *errorMsg = nullptr);
     void disconnect();
 
+    // 入队后立即返回；done（可为空）在完成时调用。已连接或正在自动重连时入队，
+    // 否则返回 false 且不调用 done；DROP_NEWEST 策略下队列满也返回 false。
+    bool publishAsync(const std::string &topic,
+                      const void *data,
+                      size_t size,
+                      int qos,
+                      bool retain,
+                      CompletionCallback done,
+                      std::string *errorMsg = nullptr);
+
+    // 负载以共享引用入队，不拷贝（大负载直接从中写 socket）
+    bool publishAsync(const std::string &topic,
+                      std::shared_ptr<const PublishPayload> payload,
+                      int qos,
+                      bool retain,
+                      CompletionCallback done,
+                      std::string *errorMsg = nullptr);
+
+    // 同步版本：入队并等待完成（QoS1 即等到 PUBACK）。
     bool publish(const std::string &topic,
                  const void *data,
                  size_t size,
@@ -36,8 +125,14 @@ public:
                  bool retain,
                  std::string *errorMsg = nullptr);
 
+    bool subscribeAsync(const std::string &topic, int qos, CompletionCallback done, std::string *errorMsg = nullptr);
+
+    // 同步版本：等待 SUBACK。
     bool subscribe(const std::string &topic, int qos = 0, std::string *errorMsg = nullptr);
 
+    // 退订：done 在收到 UNSUBACK 后调用，重连后不再重新订阅该主题
+    bool unsubscribeAsync(const std::string &topic, CompletionCallback done, std::string *errorMsg = nullptr);
+
     // 发布设备发现(announce)消息：topic 为 <prefix>/announce/<deviceId>，payload 为 JSON。
     // retain=true 便于客户端(如 Qt)订阅后立即获取最近一次 announce。
     bool publishDiscoveryAnnounceRetained(const std::string &topicPrefix,
@@ -45,39 +140,165 @@ public:
                                           const std::string &deviceType,
                                           std::string *errorMsg = nullptr);
 
-    // 单次 pump：处理读写与回调分发。建议在外部循环中周期性调用。
-    bool syncOnce(std::string *errorMsg = nullptr);
+    // 注册入站消息处理函数：filter 支持 + 和 # 通配，同一过滤器可注册多个处理函数，
+    // 一条消息交给所有匹配的处理函数。INLINE 在 I/O 线程中调用，不能阻塞；
+    // WORKER 在分发器的工作线程中按到达顺序调用。只登记处理函数，订阅仍需 subscribeAsync。
+    // 过滤器不合法时返回 0
+    HandlerId addMessageHandler(const std::string &filter,
+                                MessageHandler handler,
+                                HandlerExecutor executor = HandlerExecutor::INLINE);
+
+    // 移除处理函数；它是该过滤器的最后一个处理函数且该过滤器已订阅时，顺带退订
+    void removeMessageHandler(HandlerId id);
+
+    // 自动重连（默认开启，1s 起每次失败翻倍，最长 60s，实际等待在 [d/2, d] 内随机）。
+    // 只在连接成功过之后生效；disconnect() 停止重连并清空待发队列与订阅记录。
+    void setReconnectPolicy(bool enabled, int minDelayMs, int maxDelayMs);
+
+    // 待发队列容量（默认 128）、满时的丢弃策略、重连后积压请求的补发速率（条/秒，<=0 不限速，默认 20）
+    void setOutboundQueuePolicy(size_t capacity, DropPolicy policy, double drainPerSec);
 
-    void setMessageCallback(MessageCallback cb, void *ctx);
+    QueueStats getQueueStats() const;
+
+    // 接收缓冲从 8KB 起按需翻倍，最大 maxBytes（默认 256KB），超过上限的入站报文会导致断线
+    void setMaxReceiveSize(size_t maxBytes);
 
     bool isConnected() const;
     std::string getLastError() const;
 
 private:
-    static bool ParseBrokerUrl(const std::string &brokerUrl, std::string &hostOut, int &portOut);
+    enum class State {
+        IDLE,       // 无连接
+        CONNECTING, // 已发 CONNECT，等待 CONNACK
+        CONNECTED,
+        CLOSING,    // disconnect()/connect 超时请求关闭，由 I/O 线程发送 DISCONNECT 并关闭 socket
+    };
+
+    struct Request {
+        bool subscribe = false;   // 订阅类请求（SUBSCRIBE/UNSUBSCRIBE），队列满时不被挤掉
+        bool unsubscribe = false; // subscribe 为 true 时：UNSUBSCRIBE
+        std::string topic;
+        std::shared_ptr<const PublishPayload> payload;
+        int qos = 0;
+        bool retain = false;
+        bool backlog = false; // 断线期间入队或断线时被退回：重连后按补发速率发送
+        CompletionCallback done;
+    };
+
+    // 已交给 MQTT-C、等待完成的请求（仅 I/O 线程访问）；保留请求本身，断线时退回队列重发
+    struct InFlight {
+        Request req;
+        uint16_t packetId = 0;
+        int64_t deadlineMs = 0;
+        bool streamed = false;  // 由 I/O 线程直接写 socket 的大报文
+        bool streaming = false; // 尚未写完，写完后才开始计确认超时
+    };
+
+    // 正在直接写入 socket 的大报文，同一时刻最多一条（仅 I/O 线程访问）
+    struct Stream {
+        bool active = false;
+        std::vector<uint8_t> header; // 固定头 + 主题 + 报文标识
+        std::shared_ptr<const PublishPayload> payload;
+        size_t offset = 0;           // 已写出的字节数（header 在前）
+    };
+
+    struct Announce {
+        std::string topicPrefix;
+        std::string deviceId;
+        std::string deviceType;
+    };
+
+    struct Completion {
+        CompletionCallback done;
+        bool ok;
+        std::string error;
+    };
+
+    static bool ParseBrokerUrl(const std::string &brokerUrl, std::string &hostOut, int &portOut, bool &tlsOut);
     static int OpenSocket(const std::string &host, int port, std::string *errorMsg);
 
-    bool syncForMs(int totalMs, int stepMs, std::string *errorMsg);
+    bool enqueue(Request &&req, std::string *errorMsg);
+    void wake();
+    void ensureIoThreadLocked();
+    void ioLoop();
+    bool ensureTlsContextLocked(std::string *errorMsg);
+    bool startSessionLocked(int sock, const std::string &host, int port, bool tls, std::string *errorMsg);
+    bool handshakeLocked();
+    void reconnectLocked(std::unique_lock<std::mutex> &lock);
+    void scheduleReconnectLocked();
+    void onConnectedLocked();
+    void pumpLocked(std::vector<Completion> &completions);
+    bool syncLocked();
+    bool submitQueuedLocked(std::vector<Completion> &completions);
+    bool startStreamLocked(Request &req, InFlight &f, std::string *errorMsg);
+    bool writeStreamLocked();
+    bool growRecvBufferLocked();
+    void resizeRecvBufferLocked(size_t size);
+    void resolveInFlightLocked(std::vector<Completion> &completions);
+    void closeLocked(const std::string &reason, std::vector<Completion> &completions);
+    void failQueued(const std::string &reason, std::vector<Completion> &completions);
+    bool hasUnsentLocked() const;
+    int nextTimeoutMsLocked() const;
     void setLastErrorLocked(const std::string &errorMsg);
 
-    mutable std::mutex mutex_;
+    mutable std::mutex mutex_; // 连接状态与 MQTT-C 客户端；I/O 线程每轮处理时短暂持有
+    std::condition_variable stateCv_;
+    State state_;
+    std::atomic<bool> connected_{false};
 
     std::string brokerUrl_;
     std::string clientId_;
     std::string username_;
     std::string password_;
 
-    int socketFd_;
+    std::unique_ptr<Transport> transport_; // 当前连接（明文或 TLS），MQTT-C 的 socket 句柄
     bool mqttInitialized_;
     struct mqtt_client client_;
 
     std::vector<uint8_t> sendBuf_;
     std::vector<uint8_t> recvBuf_;
+    size_t maxRecvSize_;
+    Stream stream_;
 
     std::string lastError_;
 
-    std::atomic<MessageCallback> msgCb_{nullptr};
-    std::atomic<void *> msgCbCtx_{nullptr};
+    // TLS（mutex_）：上下文含会话缓存，跨重连保留，setTlsOptions 时重建
+    TlsOptions tlsOptions_;
+    std::shared_ptr<TlsContext> tlsContext_;
+    TlsStats tlsStats_;
+
+    // 重连状态（mutex_）
+    std::atomic<bool> wantConnected_{false}; // 连接成功过且未 disconnect()
+    std::atomic<bool> autoReconnect_{true};
+    int reconnectMinMs_;
+    int reconnectMaxMs_;
+    int backoffMs_;
+    int64_t nextReconnectMs_ = 0;
+    int64_t connectDeadlineMs_ = 0;
+    bool reconnecting_ = false;
+    bool opening_ = false;      // connect() 正在不持锁地建立 TCP
+    bool openCancelled_ = false; // 建立期间调用了 disconnect()，建好后直接关闭
+    uint64_t reconnects_ = 0;
+    double drainPerSec_;
+    int64_t nextDrainMs_ = 0;
+
+    // 入队侧状态：入队不需要 mutex_，消息回调里也能 publishAsync
+    mutable std::mutex queueMutex_;
+    std::deque<Request> queue_;
+    size_t queueCapacity_;
+    DropPolicy dropPolicy_ = DropPolicy::DROP_OLDEST;
+    uint64_t dropped_ = 0;
+    std::vector<Completion> droppedDone_;     // 被挤掉请求的回调，交给 I/O 线程调用
+    std::map<std::string, int> subscriptions_; // 重连后重新订阅
+    Announce announce_;                       // 重连后重发 retained announce
+
+    std::vector<InFlight> inFlight_;
+
+    int wakeFd_;
+    std::thread ioThread_;
+    bool stopping_ = false;
+
+    TopicRouter router_; // 入站消息分发
 
     static void publish_callback_thunk(void **state, struct mqtt_response_publish *publish);
 };
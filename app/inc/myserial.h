@@ -19,7 +19,9 @@
 #include <stdint.h>
 
 // 帧定义常量
+#ifndef UART_TTL_NAME // tools/serial_pty_bench.cpp 编译时换成 /tmp 下指向 pty 的符号链接
 #define UART_TTL_NAME "/dev/ttyS1"
+#endif
 #define MAX_BUFFER_SIZE 1024
 
 #define FRAME_HEAD 0xFE  // 帧头
@@ -31,19 +33,75 @@
 #define PHOTO_PATH "/data/storage/el2/base/haps/entry/files/output.jpeg"
 
 
+// 读线程统计（自 init_uart 起累计）
+typedef struct {
+    uint64_t bytes;          // 读到的字节数
+    uint64_t reads;          // read 调用次数（bytes / reads 即平均每次读取量）
+    uint64_t sensorFrames;   // 解码成功的传感器帧数
+    uint64_t imageFrames;    // 收到的照片数
+    uint64_t checksumErrors; // 校验和错误的帧数
+    uint64_t oversizeFrames; // 超过 1MB 仍无帧尾而丢弃的次数
+} SerialRxStats;
+
+// 写线程统计（自进程启动起累计）
+typedef struct {
+    uint64_t writes;   // 入队的写入次数
+    uint64_t bytes;    // 写到串口的字节数
+    uint64_t syscalls; // write() 调用次数（writes / syscalls 反映合并程度）
+    uint64_t dropped;  // 队列满且等待超时而放弃的写入次数
+} SerialTxStats;
+
 /**
- * @brief 初始化UART设备并启动读线程
+ * @brief 初始化UART设备并启动读线程（poll 阻塞等待，每次唤醒批量读取）与写线程
  */
 void init_uart();
 
 /**
- * @brief 通过UART发送数据
+ * @brief 通过UART发送数据（放入写队列后立即返回，不等待发送完成）
  * 
  * @param buf 数据缓冲区
  * @param len 数据长度
  */
 void write_uart(const char* buf, int len);
 
+/**
+ * @brief 写入串口写队列：由唯一的写线程按入队顺序写出，排队的小写入合并为一次 write()
+ *
+ * @param buf 数据缓冲区（入队时拷贝，调用返回后即可复用）
+ * @param len 数据长度，最大 8KB
+ * @param ticket 可选，返回本次写入的票据，配合 serial_wait_drained 等待发送完成
+ * @return 0 表示已入队；-1 表示参数无效，或队列满（串口跟不上）等待 2s 仍无空位
+ */
+int serial_write(const char* buf, int len, uint64_t *ticket);
+
+/**
+ * @brief 等待 ticket 对应的写入及其之前的所有写入都已发到线路上（tcdrain）
+ *
+ * @return 0 表示已发送完成；-1 表示超时
+ */
+int serial_wait_drained(uint64_t ticket, int timeoutMs);
+
+/**
+ * @brief 与 ESP32 协商切换串口波特率（可选 RTS/CTS 硬件流控）
+ *
+ * 旧速率下发送 "SETBAUD <baud>[ RTSCTS]"，固件回复 "BAUDOK <baud>" 后双方切换，
+ * 再在新速率下 PING/PONG 确认；任一步失败都回到原速率（固件 5s 收不到 PING 也会自行回退）。
+ * 非标准速率（如 1500000、2000000）经 termios2/BOTHER 设置。调用会阻塞数秒。
+ *
+ * @return 0 表示已切换；-1 表示固件未应答/拒绝或确认失败，速率未变
+ */
+int serial_set_baudrate(int baud, bool rtscts);
+
+/**
+ * @brief 当前串口波特率
+ */
+int serial_get_baudrate(void);
+
+/**
+ * @brief 读取写线程统计
+ */
+void serial_get_tx_stats(SerialTxStats *out);
+
 /**
  * @brief 返回接收到的数据
  * 
@@ -53,5 +111,15 @@ void write_uart(const char* buf, int len);
  */
 unsigned char* return_recv(int* len);
 
+/**
+ * @brief 开关读线程的十六进制调试输出（默认关闭，按每次 read 的数据分行打印）
+ */
+void serial_set_hex_dump(bool enable);
+
+/**
+ * @brief 读取读线程统计
+ */
+void serial_get_rx_stats(SerialRxStats *out);
+
 
 #endif // MYSERIAL_H
@@ -0,0 +1,70 @@
+#ifndef SENSOR_BATCH_H
+#define SENSOR_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "sensor_data_provider.h"
+
+namespace sensor {
+
+// Time-bucketed batching of decoded frames, for high telemetry rates where one MQTT
+// publish per frame costs more than the frame itself.
+//
+// While enabled, every frame the receive threads publish is appended to the current batch.
+// The batch is handed to the batch publisher when it holds maxSamples frames, when a frame
+// arrives windowMs or more after its first frame, or when its first frame is maxLatencyMs
+// old; the batch thread enforces the latency cap even if no further frames arrive.
+// Samples are stored column-wise (one offset column, one value column per channel) so a
+// payload builder can write each column as one array.
+struct SensorBatch {
+    int64_t baseWallMs = 0;  // wall clock (epoch ms) of the first frame
+    uint64_t firstSeq = 0;   // snapshot seq of the first frame
+    uint32_t validMask = 0;  // channels present in at least one frame
+    std::vector<uint32_t> offsetsMs;         // per frame: ms after the first frame (monotonic clock)
+    std::vector<uint32_t> masks;             // per frame: validMask of that frame
+    std::vector<float> values[kSensorCount]; // per channel: one value per frame (0 if absent)
+
+    size_t size() const
+    {
+        return offsetsMs.size();
+    }
+};
+
+constexpr size_t kSensorBatchMaxSamples = 1000;
+
+struct SensorBatchPolicy {
+    bool enabled = false;
+    int windowMs = 1000;     // bucket length, measured from the first frame
+    size_t maxSamples = 100; // 1..kSensorBatchMaxSamples
+    int maxLatencyMs = 2000; // a batch is published at most this long after its first frame
+};
+
+// Apply a policy (starts the batch thread on first use). Disabling publishes the pending
+// batch. Returns false and keeps the current policy for out-of-range values.
+bool SetSensorBatchPolicy(const SensorBatchPolicy &policy);
+SensorBatchPolicy GetSensorBatchPolicy();
+bool IsSensorBatchEnabled();
+
+// Append one frame (called by the receive threads next to SensorLogAppend). Only copies
+// the values into preallocated columns; publishing happens on the batch thread.
+void SensorBatchAppend(const SensorSnapshot &snap);
+
+// Batch publisher (e.g. an MqttCClient::publishAsync wrapper), called from the batch thread.
+// The batch is only valid during the call.
+using SensorBatchPublisher = std::function<void(const SensorBatch &)>;
+void SetSensorBatchPublisher(SensorBatchPublisher publisher);
+
+struct SensorBatchStats {
+    uint64_t batches = 0; // batches handed to the publisher
+    uint64_t samples = 0; // frames in those batches
+    uint64_t dropped = 0; // frames dropped because the publisher fell behind
+};
+
+SensorBatchStats GetSensorBatchStats();
+
+} // namespace sensor
+
+#endif // SENSOR_BATCH_H
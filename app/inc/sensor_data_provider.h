@@ -1,24 +1,177 @@
 #ifndef SENSOR_DATA_PROVIDER_H
 #define SENSOR_DATA_PROVIDER_H
 
+#include <cstddef>
+#include <cstdint>
+
 namespace sensor {
 
 enum class DataChannel {
     SERIAL = 0,
     UDP = 1,
+    // Both transports feed one merged snapshot: frames are de-duplicated (firmware seq for
+    // binary frames, content hash for text frames) and the first copy to arrive wins.
+    MULTIPATH = 2,
+};
+
+// Fixed channel layout of one decoded ESP32 frame. Order matches the text frame
+// "Humi:..;Temp:..;...;Light:..;" so the decoder can index values directly.
+enum class SensorId : uint8_t {
+    HUMI = 0,
+    TEMP,
+    CH2O,
+    TVOC,
+    CO2,
+    SOIL_HUMI,
+    SOIL_TEMP,
+    EC,
+    PH,
+    N,
+    P,
+    K,
+    SALT,
+    TDS,
+    LIGHT,
+    COUNT,
+};
+
+constexpr size_t kSensorCount = static_cast<size_t>(SensorId::COUNT);
+
+// A frame older than this is treated as stale by consumers (control loop, uploader).
+constexpr int64_t kSensorStaleMs = 10000;
+
+// All channels of one decoded frame, indexed by SensorId.
+struct SensorSnapshot {
+    float values[kSensorCount] = {0};
+    // Per-channel validity: bit i set if SensorId i was present in the frame.
+    uint32_t validMask = 0;
+    // Per-backend frame sequence number, starts at 1; 0 means no frame received yet.
+    uint64_t seq = 0;
+    // Arrival time of the frame on the monotonic clock (see MonotonicMs()).
+    int64_t timestampMs = 0;
+    // Firmware-side sequence number and capture time (ESP32 millis()) carried by binary
+    // frames; both 0 for legacy text frames.
+    uint32_t deviceSeq = 0;
+    uint32_t deviceMs = 0;
+
+    float Get(SensorId id) const
+    {
+        return values[static_cast<size_t>(id)];
+    }
+
+    bool IsValid(SensorId id) const
+    {
+        return (validMask & (1u << static_cast<size_t>(id))) != 0;
+    }
 };
 
-// Switch sensor value source between serial and UDP backends.
+// Monotonic milliseconds (steady clock), the time base of SensorSnapshot::timestampMs.
+int64_t MonotonicMs();
+
+// True if the snapshot holds a frame that arrived within maxAgeMs.
+bool IsFresh(const SensorSnapshot &snap, int64_t maxAgeMs = kSensorStaleMs);
+
+// Frame key ("SoilHumi", "CO_2", ...) of a sensor id; nullptr for out-of-range ids.
+const char *SensorKeyName(SensorId id);
+
+// Map a frame key to its sensor id. Returns false for unknown keys.
+bool FindSensorId(const char *key, SensorId *out);
+
+// Switch sensor value source between serial, UDP and the merged multipath backend.
 void SetDataChannel(DataChannel channel);
 
 DataChannel GetDataChannel();
 
+// Push-mode telemetry rate. The query thread sends "SUBSCRIBE <periodMs> <leaseMs>" and renews
+// the lease while the gateway runs; the ESP32 streams frames on its own and stops when the lease
+// runs out. Takes effect immediately (e.g. 10 Hz while a dashboard is open, 0.1 Hz at night).
+// Clamped to [0.01, 20] Hz; hz <= 0 sends UNSUBSCRIBE and pauses telemetry. Default 1 Hz.
+// Returns the rate actually applied. Falls back to GET_DATA polling if no frames arrive
+// (firmware without SUBSCRIBE support).
+double SetTelemetryRate(double hz);
+
+double GetTelemetryRate();
+
 // Read sensor value by key from current selected backend.
 float GetDataByKey(const char *key);
 
-// Send one command using current selected backend.
+// Same as GetDataByKey but without the key lookup (O(1), lock-free).
+float GetData(SensorId id);
+
+// Like GetData, but distinguishes "missing" from a real 0: returns false if the
+// channel was absent in the latest frame or no frame was received yet.
+bool TryGetData(SensorId id, float *out);
+
+// Copy every channel of the current backend's latest frame in one go.
+// Values always come from the same frame (unlike repeated GetDataByKey calls).
+void GetSnapshot(SensorSnapshot &out);
+
+// Block until the current backend publishes a frame with seq > afterSeq, or timeoutMs
+// elapses. Returns true if such a frame is available; `out` (optional) receives it.
+bool WaitForFrame(uint64_t afterSeq, int timeoutMs, SensorSnapshot *out = nullptr);
+
+// Send one command using current selected backend (MULTIPATH: over GetCommandPath()).
 int SendCommand(const char *command);
 
+enum class FrameFormat {
+    INVALID = 0,
+    TEXT,    // legacy "Key:value;..." payload
+    BINARY,  // sensor_frame.h payload
+};
+
+// Per-channel receive counters.
+struct FrameStats {
+    uint64_t textFrames = 0;
+    uint64_t binaryFrames = 0;
+    uint64_t lostFrames = 0;      // gaps in the firmware sequence numbers
+    uint64_t duplicateFrames = 0; // same firmware seq seen twice (dropped)
+    uint64_t invalidFrames = 0;   // binary frames with a bad header/length
+};
+
+// Decode one sensor frame payload (binary or text, auto-detected) without publishing it.
+// out.seq is left 0; out.timestampMs is set to the decode time.
+FrameFormat DecodeFrame(const uint8_t *data, size_t len, SensorSnapshot &out);
+
+// Firmware sequence bookkeeping for one sender: returns false for a duplicate (same seq
+// as the previous frame); otherwise updates lastSeq and sets `lost` to the gap size.
+// A seq lower than lastSeq is taken as a firmware restart.
+bool TrackDeviceSeq(uint32_t seq, uint32_t &lastSeq, uint64_t &lost);
+
+// Forget the last firmware seq of a channel (its sender changed), so the next frame
+// is neither counted as a gap nor dropped as a duplicate.
+void ResetDeviceSeq(DataChannel channel);
+
+// Decode one sensor frame payload (binary or text, auto-detected) and publish it as the
+// latest snapshot of `source`. Called by the receive threads (one writer per channel);
+// readers never block it. `decoded` (optional) receives the decoded frame.
+FrameFormat PublishFrame(DataChannel source, const uint8_t *data, size_t len, SensorSnapshot *decoded = nullptr);
+
+// Render the valid channels of a snapshot as a legacy text frame ("Humi:..;Temp:..;"),
+// for the raw-text getters kept for old callers. Returns the length written.
+size_t FormatFrameText(const SensorSnapshot &snap, char *buf, size_t cap);
+
+// MULTIPATH: binary/text counts are frames published to the merged snapshot, duplicateFrames
+// the late copies dropped by the dedupe, lostFrames the gaps left after merging both paths.
+FrameStats GetFrameStats(DataChannel channel);
+
+// Health of one physical path (SERIAL or UDP) as seen by the multipath merge.
+// Only updated while the data channel is MULTIPATH.
+struct PathStats {
+    uint64_t frames = 0;        // frames this path handed to the merge (including late copies)
+    uint64_t firstArrivals = 0; // frames this path delivered first (published)
+    uint64_t lateCopies = 0;    // frames the other path had already delivered (dropped)
+    uint64_t missed = 0;        // frames only the other path delivered within the match window
+    double deliveryRatio = 0.0; // EWMA of delivered (1) / missed (0), 0..1
+    double lagMs = 0.0;         // EWMA of how far this path trails the other one (0 when first)
+    int64_t lastArrivalMs = 0;  // MonotonicMs() of the last frame, 0 if none yet
+};
+
+PathStats GetPathStats(DataChannel path);
+
+// Path SendCommand uses: the healthier of SERIAL/UDP in MULTIPATH mode, otherwise the
+// selected channel itself.
+DataChannel GetCommandPath();
+
 } // namespace sensor
 
 #endif // SENSOR_DATA_PROVIDER_H
@@ -0,0 +1,67 @@
+#ifndef SENSOR_DEADBAND_H
+#define SENSOR_DEADBAND_H
+
+#include <cstdint>
+#include <functional>
+
+#include "sensor_data_provider.h"
+
+namespace mqttc {
+
+// Change detection in front of the sensors payload builder.
+//
+// When enabled, each upload is compared with the values last published per channel.
+// A channel counts as changed when |v - last| >= max(absolute, relative * |last|) > 0;
+// only changed channels are sent, as a delta on <prefix>/<deviceId>/sensors/delta.
+// A full keyframe goes to the normal sensors topic when there is no baseline yet,
+// every keyframe interval, or when a subscriber asks for one
+// ({"control":{"keyframe":1}} on the control topic). Unchanged uploads are skipped.
+// Disabled (the default), every upload is a keyframe, as before.
+//
+// Default deadbands follow the resolution the Qt client displays: 1 for the integer
+// fields (soil moisture, light, humidity, CO2), 0.1 for temperatures and N/P/K/salt/TDS,
+// 0.01 for CH2O, TVOC, EC and pH.
+
+enum class SensorUpdateKind {
+    NONE,     // nothing changed beyond the deadband: skip this upload
+    DELTA,    // publish only the channels in changedMask
+    KEYFRAME, // publish the full snapshot
+};
+
+struct SensorUpdate {
+    SensorUpdateKind kind = SensorUpdateKind::KEYFRAME;
+    uint32_t changedMask = 0; // bit i = SensorId i (DELTA only)
+    bool alarmChanged = false;
+};
+
+struct SensorDeadbandStats {
+    uint64_t keyframes = 0;
+    uint64_t deltas = 0;
+    uint64_t suppressed = 0; // uploads skipped because nothing changed
+};
+
+// keyframeIntervalSec <= 0 keeps the current interval (default 300 s).
+void SetSensorDeadbandEnabled(bool enabled, int keyframeIntervalSec);
+bool IsSensorDeadbandEnabled();
+
+// Per-channel deadband; negative values are rejected.
+bool SetSensorDeadband(sensor::SensorId id, float absolute, float relative);
+
+// Decide what to publish for `snap` and record it as published (the caller hands the
+// result to the MQTT queue). nowMs is a monotonic clock.
+SensorUpdate NextSensorUpdate(const sensor::SensorSnapshot &snap, int alarm, int64_t nowMs);
+
+// Force the next NextSensorUpdate to be a keyframe, e.g. after a failed publish.
+void ForceSensorKeyframe();
+
+// Subscriber keyframe request: forces a keyframe and, if installed, calls the publisher
+// to send it right away instead of at the next upload.
+using SensorKeyframePublisher = std::function<void()>;
+void SetSensorKeyframePublisher(SensorKeyframePublisher publisher);
+void RequestSensorKeyframe();
+
+SensorDeadbandStats GetSensorDeadbandStats();
+
+} // namespace mqttc
+
+#endif // SENSOR_DEADBAND_H
@@ -0,0 +1,98 @@
+/*
+ * ESP32 -> 网关 传感器二进制帧（放在 FE ... FF 帧的负载里，外层转义/校验不变）。
+ * 固件（esp32_s3，通过 platformio.ini 的 -I../app/inc 引用）与网关共用本头文件，保证布局一致。
+ *
+ * 布局（小端，ESP32-S3 与网关 ARM 均为小端，直接 memcpy）：
+ *   offset 0  uint8   magic       0xA5（文本帧首字节是键名字母，据此区分新旧格式）
+ *   offset 1  uint8   version     1
+ *   offset 2  uint8   valueCount  后续 float 个数（按 sensor::SensorId 顺序）
+ *   offset 3  uint8   flags       保留，填 0
+ *   offset 4  uint32  seq         固件侧帧序号，从 1 递增，网关据此统计丢帧
+ *   offset 8  uint32  captureMs   采集时刻（固件 millis()）
+ *   offset 12 uint32  presentMask bit i 置位表示第 i 个值有效
+ *   offset 16 float   values[valueCount]
+ *
+ * 兼容规则：新增字段只能追加到 values 末尾（valueCount 变大），旧网关忽略多出的值；
+ * 布局不兼容的改动必须提升 version，旧网关会拒收并回退到文本帧。
+ */
+
+#ifndef SENSOR_FRAME_H
+#define SENSOR_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace sensor_frame {
+
+const uint8_t kMagic = 0xA5;
+const uint8_t kVersion = 1;
+const size_t kMaxValues = 32; // presentMask 位数
+
+struct Header {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t valueCount;
+    uint8_t flags;
+    uint32_t seq;
+    uint32_t captureMs;
+    uint32_t presentMask;
+};
+
+static_assert(sizeof(Header) == 16, "sensor frame header layout is part of the wire format");
+static_assert(sizeof(float) == 4, "sensor frame values are IEEE-754 binary32");
+
+inline size_t EncodedSize(size_t valueCount)
+{
+    return sizeof(Header) + valueCount * sizeof(float);
+}
+
+// 编码到 out；返回写入字节数，容量不足或 valueCount 超限返回 0
+inline size_t Encode(uint8_t *out, size_t cap, uint32_t seq, uint32_t captureMs, uint32_t presentMask,
+                     const float *values, size_t valueCount)
+{
+    if (out == nullptr || valueCount > kMaxValues || cap < EncodedSize(valueCount)) {
+        return 0;
+    }
+    Header h;
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.valueCount = static_cast<uint8_t>(valueCount);
+    h.flags = 0;
+    h.seq = seq;
+    h.captureMs = captureMs;
+    h.presentMask = presentMask;
+    memcpy(out, &h, sizeof(h));
+    memcpy(out + sizeof(h), values, valueCount * sizeof(float));
+    return EncodedSize(valueCount);
+}
+
+// 负载是否为二进制帧（只看首字节，用于在文本/二进制之间分流）
+inline bool IsBinary(const uint8_t *data, size_t len)
+{
+    return data != nullptr && len > 0 && data[0] == kMagic;
+}
+
+// 定长解码：校验头部与长度后 memcpy；values 只取前 maxValues 个，多出的忽略，
+// 不足的不写（调用方按 presentMask 判断有效性）
+inline bool Decode(const uint8_t *data, size_t len, Header &header, float *values, size_t maxValues)
+{
+    if (data == nullptr || len < sizeof(Header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(Header));
+    if (header.magic != kMagic || header.version != kVersion || header.valueCount > kMaxValues ||
+        len < EncodedSize(header.valueCount)) {
+        return false;
+    }
+    const size_t n = header.valueCount < maxValues ? header.valueCount : maxValues;
+    memcpy(values, data + sizeof(Header), n * sizeof(float));
+    if (n < 32) {
+        header.presentMask &= (1u << n) - 1u;
+    }
+    return true;
+}
+
+} // namespace sensor_frame
+
+#endif // SENSOR_FRAME_H
@@ -0,0 +1,60 @@
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sensor_data_provider.h"
+
+namespace sensor {
+
+// In-memory sensor history: fixed-capacity, per-channel (columnar) ring buffers in
+// three resolutions. Memory is allocated once and never grows, so it is safe for
+// months of uptime; older data simply falls off the end of each ring.
+//   RAW          : every decoded frame, last kHistoryRawCapacity frames
+//   MINUTE       : 1-minute buckets, last 24 hours
+//   QUARTER_HOUR : 15-minute buckets, last 30 days
+enum class HistoryTier {
+    RAW = 0,
+    MINUTE = 1,
+    QUARTER_HOUR = 2,
+};
+
+constexpr size_t kHistoryTierCount = 3;
+constexpr size_t kHistoryRawCapacity = 1024;
+constexpr size_t kHistoryMinuteCapacity = 24 * 60;
+constexpr size_t kHistoryQuarterCapacity = 30 * 24 * 4;
+
+// Aggregate of one channel over a time window.
+struct HistoryStats {
+    float min = 0.0f;
+    float max = 0.0f;
+    float mean = 0.0f;
+    float last = 0.0f;
+    uint32_t count = 0;          // number of valid samples aggregated; 0 => no data in window
+    int64_t lastTimestampMs = 0; // MonotonicMs() time of `last`
+};
+
+// One bucket of an exported series (oldest first).
+struct HistoryPoint {
+    int64_t timestampMs = 0; // bucket start on the MonotonicMs() clock
+    float min = 0.0f;
+    float max = 0.0f;
+    float mean = 0.0f;
+};
+
+// Feed one decoded frame (called by sensor_data_provider for the active channel).
+void HistoryAppend(const SensorSnapshot &snap);
+
+// min/max/mean/last of `id` over the last windowMs. The finest tier that still covers
+// the window within a bounded number of buckets is used, so the cost of a query does
+// not depend on how long the device has been running. Returns false if no data.
+bool QueryHistory(SensorId id, int64_t windowMs, HistoryStats &out);
+
+// Export the buckets of one tier that fall into the last windowMs (oldest first).
+size_t ReadHistorySeries(SensorId id, HistoryTier tier, int64_t windowMs, std::vector<HistoryPoint> &out);
+
+} // namespace sensor
+
+#endif // SENSOR_HISTORY_H
@@ -0,0 +1,77 @@
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "sensor_data_provider.h"
+
+// 日志目录（网关数据分区），可在编译时通过 -DSENSOR_LOG_DIR=... 覆盖
+#ifndef SENSOR_LOG_DIR
+#define SENSOR_LOG_DIR "/data/storage/el2/base/haps/entry/files/sensor_log"
+#endif
+
+// 保留的最大段数（每段 1MB，约 3.6 小时 @1Hz），超出后删除最旧的段
+#ifndef SENSOR_LOG_MAX_SEGMENTS
+#define SENSOR_LOG_MAX_SEGMENTS 64
+#endif
+
+namespace sensor {
+
+// Persistent, append-only sensor log.
+//
+// Layout: SENSOR_LOG_DIR/seg_<firstId hex>.log, each segment is a fixed-size file of
+// 4KB blocks; every block holds up to kSensorLogRecordsPerBlock fixed-size records and
+// a CRC32 over its contents. Record ids are contiguous across segments, so a record is
+// located by arithmetic alone. Only the tail block is ever rewritten; a torn write
+// can lose at most that block, never older data.
+struct SensorLogRecord {
+    uint64_t id;       // log-wide record id, contiguous, survives reboots
+    int64_t wallMs;    // wall clock (epoch ms) when the frame was decoded
+    uint32_t validMask;
+    float values[kSensorCount];
+};
+
+constexpr size_t kSensorLogBlockSize = 4096;
+constexpr size_t kSensorLogRecordsPerBlock = 50;
+constexpr size_t kSensorLogBlocksPerSegment = 256;
+constexpr uint64_t kSensorLogRecordsPerSegment = kSensorLogRecordsPerBlock * kSensorLogBlocksPerSegment;
+
+// Open/recover the log and start the writer and replay threads (idempotent).
+bool SensorLogStart(const char *dir = SENSOR_LOG_DIR);
+
+// Queue one frame for writing. Never blocks on I/O: the receive thread only copies
+// the record into a bounded in-memory queue (oldest queued records are dropped if
+// the writer falls behind).
+void SensorLogAppend(const SensorSnapshot &snap);
+
+// Zero-copy range scan: records with id >= fromId are passed (pointing into the
+// mmapped segment) to fn until it returns false or maxRecords were visited. Only
+// blocks that pass their CRC are visited. Returns the number of records visited.
+size_t SensorLogScan(uint64_t fromId, size_t maxRecords, const std::function<bool(const SensorLogRecord &)> &fn);
+
+// Upload bookkeeping, reported by the live uploader after each publish attempt.
+// Records written between a failed upload and the next successful one form an
+// "un-sent" range that is replayed through the replay publisher.
+void SensorLogNoteUpload(bool ok);
+
+// Replay publisher (e.g. MqttCClient::publish wrapper). Called from the replay thread
+// for each un-sent record in id order; return false to retry later (e.g. offline).
+using SensorLogPublisher = std::function<bool(const SensorLogRecord &)>;
+void SetSensorLogReplayPublisher(SensorLogPublisher publisher);
+
+struct SensorLogStats {
+    uint64_t nextId = 0;        // id the next record will get
+    uint64_t flushedId = 0;     // records with id < flushedId are on disk
+    uint64_t replayFrom = 0;    // pending replay range [replayFrom, replayTo]
+    uint64_t replayTo = 0;
+    uint64_t dropped = 0;       // records dropped because the writer fell behind
+    size_t segments = 0;
+};
+
+SensorLogStats GetSensorLogStats();
+
+} // namespace sensor
+
+#endif // SENSOR_LOG_H
@@ -1,19 +1,38 @@
 /*
  * 简单的 UDP 广播接收模块
- * 监听端口 9000，保存最近一帧文本数据，供 sensor_data_provider 统一解析使用。
+ * 监听端口 9000，按发送方（源 IP）分别拼帧；主节点的数据供 sensor_data_provider 统一解析使用，
+ * 所有节点的最新快照保存在节点表中。
  */
 
 #ifndef WIFI_UDP_RECEIVER_H
 #define WIFI_UDP_RECEIVER_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* 接收路径统计（自 init_wifi_udp_receiver 起累计） */
+typedef struct {
+    uint64_t datagrams;     /* 收到的 datagram 数 */
+    uint64_t bytes;         /* 收到的字节数 */
+    uint64_t batches;       /* recvmmsg 调用次数（datagrams / batches 即平均批量） */
+    uint64_t kernelDrops;   /* 内核因接收缓冲满丢弃的 datagram 数（SO_RXQ_OVFL） */
+    uint64_t ringOverflows; /* 解码线程跟不上、环形队列满而丢弃的 datagram 数 */
+    uint64_t truncated;     /* 超过槽位大小被截断的 datagram 数 */
+    int rcvbufBytes;        /* 实际生效的 SO_RCVBUF */
+    uint64_t chunkImages;     /* 按分块协议完整收到（CRC 正确）的照片数 */
+    uint64_t chunkNacks;      /* 发出的 NACK 数（每个 NACK 触发一轮选择性重传） */
+    uint64_t chunkDuplicates; /* 重复收到的分块数 */
+    uint64_t chunkCrcErrors;  /* 分块收齐但整张 CRC 不符的次数 */
+    uint64_t chunkAbandoned;  /* 未收齐即被下一张照片取代的次数 */
+} wifi_udp_rx_stats_t;
+
 /**
- * @brief 初始化 UDP 接收线程（监听 0.0.0.0:9000）
+ * @brief 初始化 UDP 接收（监听 0.0.0.0:9000）：收包线程 recvmmsg 批量收包，
+ *        经预分配的环形队列交给解码线程拼帧/解析
  */
 void init_wifi_udp_receiver(void);
 
@@ -26,6 +45,13 @@ void init_wifi_udp_receiver(void);
  */
 int wifi_get_latest_data(char *outBuf, size_t bufLen);
 
+/**
+ * @brief 读取接收路径统计
+ *
+ * @return 0 表示成功；-1 表示参数为空
+ */
+int wifi_get_rx_stats(wifi_udp_rx_stats_t *out);
+
 /**
  * @brief 通过 UDP 广播发送数据
  *
@@ -37,6 +63,29 @@ int wifi_send_broadcast(const char *buf, int len);
 
 #ifdef __cplusplus
 }
+
+#include <string>
+#include <vector>
+
+#include "sensor_data_provider.h"
+
+// 节点表中的一个 ESP32 节点
+struct WifiUdpNode {
+    std::string address;          // "ip:port"（端口为最近一次的源端口）
+    bool primary = false;         // 是否为发布到 UDP 通道的主节点
+    int64_t lastSeenMs = 0;       // 最近收到数据的时刻（sensor::MonotonicMs 时基）
+    uint64_t frames = 0;          // 已接受的传感器帧数
+    uint64_t lostFrames = 0;      // 按固件帧序号缺口累计的丢帧数
+    uint64_t duplicateFrames = 0;
+    sensor::SensorSnapshot latest; // 该节点的最新一帧（seq 为节点内帧计数）
+};
+
+/**
+ * @brief 复制当前节点表（最多 64 个节点，超过 120s 未发数据的节点会被回收）
+ *
+ * @return 节点个数
+ */
+size_t wifi_get_nodes(std::vector<WifiUdpNode> &out);
 #endif
 
 #endif // WIFI_UDP_RECEIVER_H
@@ -0,0 +1,153 @@
+#include "image_store.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+extern "C" void NotifyImageCapturedFromNative(const char *path);
+
+namespace image {
+
+namespace {
+
+// 池中最多保留的空闲缓冲个数：接收中 + 最新图片 + 正在上传的引用，够用即可
+constexpr size_t kPoolMax = 4;
+
+struct Pool {
+    std::mutex mutex;
+    std::vector<std::vector<uint8_t>> free;
+    size_t lastImageSize = 0;
+
+    ImageRef latest;
+    uint64_t seq = 0;
+    int64_t captureMs = 0;
+};
+
+// 故意不析构：图片引用可能在静态析构阶段才释放，归还时池必须仍然有效
+Pool &GetPool()
+{
+    static Pool *pool = new Pool();
+    return *pool;
+}
+
+void ReturnToPool(std::vector<uint8_t> &&buf)
+{
+    Pool &pool = GetPool();
+    buf.clear();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.free.size() < kPoolMax) {
+        pool.free.push_back(std::move(buf));
+    }
+}
+
+bool WriteAll(int fd, const uint8_t *data, size_t len)
+{
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, data + off, len - off);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 写临时文件再 rename：读者（ETS 预览、旧版上传）永远看不到写了一半的图片
+bool WriteFileAtomic(const char *path, const std::vector<uint8_t> &bytes)
+{
+    const std::string tmp = std::string(path) + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::printf("image_store: open %s failed: %s\n", tmp.c_str(), std::strerror(errno));
+        return false;
+    }
+    const bool ok = WriteAll(fd, bytes.data(), bytes.size());
+    close(fd);
+    if (!ok || rename(tmp.c_str(), path) != 0) {
+        std::printf("image_store: write %s failed: %s\n", path, std::strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<uint8_t> AcquireBuffer()
+{
+    Pool &pool = GetPool();
+    std::vector<uint8_t> buf;
+    size_t want = 0;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (!pool.free.empty()) {
+            buf = std::move(pool.free.back());
+            pool.free.pop_back();
+        }
+        want = pool.lastImageSize + pool.lastImageSize / 8;
+    }
+    if (buf.capacity() < want) {
+        buf.reserve(want);
+    }
+    return buf;
+}
+
+void ReleaseBuffer(std::vector<uint8_t> &&buf)
+{
+    ReturnToPool(std::move(buf));
+}
+
+void PublishImage(std::vector<uint8_t> &&jpeg, const char *path)
+{
+    Pool &pool = GetPool();
+    // 最后一个引用释放时把缓冲归还池中，而不是释放内存
+    auto *owned = new std::vector<uint8_t>(std::move(jpeg));
+    ImageRef ref(owned, [](const std::vector<uint8_t> *buf) {
+        auto *mutableBuf = const_cast<std::vector<uint8_t> *>(buf);
+        ReturnToPool(std::move(*mutableBuf));
+        delete mutableBuf;
+    });
+
+    const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    ImageRef previous;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.lastImageSize = ref->size();
+        previous = std::move(pool.latest);
+        pool.latest = ref;
+        pool.seq++;
+        pool.captureMs = nowMs;
+    }
+    previous.reset(); // 在锁外归还旧图（ReturnToPool 会再次加锁）
+
+    if (path != nullptr) {
+        (void)WriteFileAtomic(path, *ref);
+        NotifyImageCapturedFromNative(path);
+    }
+}
+
+ImageRef GetLatestImage(uint64_t *seq, int64_t *captureMs)
+{
+    Pool &pool = GetPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (seq != nullptr) {
+        *seq = pool.seq;
+    }
+    if (captureMs != nullptr) {
+        *captureMs = pool.captureMs;
+    }
+    return pool.latest;
+}
+
+} // namespace image
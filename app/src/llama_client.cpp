@@ -14,6 +14,7 @@
 
 #include "cJSON.h"
 #include "sensor_data_provider.h"
+#include "sensor_history.h"
 // #include "hilog/log.h"
 
 // #define LOG_TAG "LlamaClient"
@@ -26,27 +27,30 @@ namespace llama {
 // 独立实现：返回包含单位的传感器 JSON（结构：sensors->{key: {value:..., unit:"..."}}）
 static bool BuildSensorPayloadJsonLocal(bool /*includeImage*/, std::string &outJson, std::string *errMsg)
 {
-    // 以与 mqtt_payload_builder 相同的 key 读取缓存数据，但将每项封装为 {value, unit}
-    float soilMoistureF = sensor::GetDataByKey("SoilHumi");
+    // 与 mqtt_payload_builder 相同：一次取整帧快照，再将每项封装为 {value, unit}
+    sensor::SensorSnapshot snap;
+    sensor::GetSnapshot(snap);
+
+    float soilMoistureF = snap.Get(sensor::SensorId::SOIL_HUMI);
     int soilMoisture = static_cast<int>(soilMoistureF + (soilMoistureF >= 0 ? 0.5f : -0.5f));
 
-    float lightF = sensor::GetDataByKey("Light");
+    float lightF = snap.Get(sensor::SensorId::LIGHT);
     int lightLevel = static_cast<int>(lightF + (lightF >= 0 ? 0.5f : -0.5f));
 
-    float temperature = sensor::GetDataByKey("Temp");
-    float humidityF = sensor::GetDataByKey("Humi");
-    float formaldehyde = sensor::GetDataByKey("CH2O");
-    float tvoc = sensor::GetDataByKey("TVOC");
-    float co2F = sensor::GetDataByKey("CO_2");
-
-    float soilTemp = sensor::GetDataByKey("SoilTemp");
-    float ec = sensor::GetDataByKey("EC");
-    float ph = sensor::GetDataByKey("pH");
-    float n = sensor::GetDataByKey("N");
-    float p = sensor::GetDataByKey("P");
-    float k = sensor::GetDataByKey("K");
-    float salt = sensor::GetDataByKey("Salt");
-    float tds = sensor::GetDataByKey("TDS");
+    float temperature = snap.Get(sensor::SensorId::TEMP);
+    float humidityF = snap.Get(sensor::SensorId::HUMI);
+    float formaldehyde = snap.Get(sensor::SensorId::CH2O);
+    float tvoc = snap.Get(sensor::SensorId::TVOC);
+    float co2F = snap.Get(sensor::SensorId::CO2);
+
+    float soilTemp = snap.Get(sensor::SensorId::SOIL_TEMP);
+    float ec = snap.Get(sensor::SensorId::EC);
+    float ph = snap.Get(sensor::SensorId::PH);
+    float n = snap.Get(sensor::SensorId::N);
+    float p = snap.Get(sensor::SensorId::P);
+    float k = snap.Get(sensor::SensorId::K);
+    float salt = snap.Get(sensor::SensorId::SALT);
+    float tds = snap.Get(sensor::SensorId::TDS);
 
     cJSON *root = cJSON_CreateObject();
     if (root == nullptr) {
@@ -61,7 +65,9 @@ static bool BuildSensorPayloadJsonLocal(bool /*includeImage*/, std::string &outJ
         return false;
     }
 
-    auto add_measure = [&](const char *name, double value, const char *unit) {
+    // 附带最近 10 分钟的均值/最小/最大值（来自 sensor_history），便于模型判断趋势
+    constexpr int64_t kEnvHistoryWindowMs = 10 * 60 * 1000;
+    auto add_measure = [&](const char *name, double value, const char *unit, sensor::SensorId id) {
         cJSON *obj = cJSON_CreateObject();
         if (obj == nullptr) return false;
         if (cJSON_AddNumberToObject(obj, "value", static_cast<double>(value)) == nullptr) {
@@ -72,26 +78,35 @@ static bool BuildSensorPayloadJsonLocal(bool /*includeImage*/, std::string &outJ
             cJSON_Delete(obj);
             return false;
         }
+        sensor::HistoryStats stats;
+        if (sensor::QueryHistory(id, kEnvHistoryWindowMs, stats)) {
+            if (cJSON_AddNumberToObject(obj, "avg10m", stats.mean) == nullptr ||
+                cJSON_AddNumberToObject(obj, "min10m", stats.min) == nullptr ||
+                cJSON_AddNumberToObject(obj, "max10m", stats.max) == nullptr) {
+                cJSON_Delete(obj);
+                return false;
+            }
+        }
         cJSON_AddItemToObject(sensors, name, obj);
         return true;
     };
 
-    if (!add_measure("soilMoisture", soilMoisture, "%")) { cJSON_Delete(root); if (errMsg) *errMsg = "add soilMoisture failed"; return false; }
-    if (!add_measure("lightLevel", lightLevel, "%")) { cJSON_Delete(root); if (errMsg) *errMsg = "add lightLevel failed"; return false; }
-    if (!add_measure("temperature", temperature, "°C")) { cJSON_Delete(root); if (errMsg) *errMsg = "add temperature failed"; return false; }
-    if (!add_measure("humidity", humidityF, "%")) { cJSON_Delete(root); if (errMsg) *errMsg = "add humidity failed"; return false; }
-    if (!add_measure("formaldehyde", formaldehyde, "mg/m3")) { cJSON_Delete(root); if (errMsg) *errMsg = "add formaldehyde failed"; return false; }
-    if (!add_measure("tvoc", tvoc, "ppb")) { cJSON_Delete(root); if (errMsg) *errMsg = "add tvoc failed"; return false; }
-    if (!add_measure("co2", co2F, "ppm")) { cJSON_Delete(root); if (errMsg) *errMsg = "add co2 failed"; return false; }
-
-    if (!add_measure("soilTemperature", soilTemp, "°C")) { cJSON_Delete(root); if (errMsg) *errMsg = "add soilTemperature failed"; return false; }
-    if (!add_measure("ec", ec, "mS/cm")) { cJSON_Delete(root); if (errMsg) *errMsg = "add ec failed"; return false; }
-    if (!add_measure("ph", ph, "")) { cJSON_Delete(root); if (errMsg) *errMsg = "add ph failed"; return false; }
-    if (!add_measure("nitrogen", n, "mg/L")) { cJSON_Delete(root); if (errMsg) *errMsg = "add nitrogen failed"; return false; }
-    if (!add_measure("phosphorus", p, "mg/L")) { cJSON_Delete(root); if (errMsg) *errMsg = "add phosphorus failed"; return false; }
-    if (!add_measure("potassium", k, "mg/L")) { cJSON_Delete(root); if (errMsg) *errMsg = "add potassium failed"; return false; }
-    if (!add_measure("salt", salt, "mg/L")) { cJSON_Delete(root); if (errMsg) *errMsg = "add salt failed"; return false; }
-    if (!add_measure("tds", tds, "ppm")) { cJSON_Delete(root); if (errMsg) *errMsg = "add tds failed"; return false; }
+    if (!add_measure("soilMoisture", soilMoisture, "%", sensor::SensorId::SOIL_HUMI)) { cJSON_Delete(root); if (errMsg) *errMsg = "add soilMoisture failed"; return false; }
+    if (!add_measure("lightLevel", lightLevel, "%", sensor::SensorId::LIGHT)) { cJSON_Delete(root); if (errMsg) *errMsg = "add lightLevel failed"; return false; }
+    if (!add_measure("temperature", temperature, "°C", sensor::SensorId::TEMP)) { cJSON_Delete(root); if (errMsg) *errMsg = "add temperature failed"; return false; }
+    if (!add_measure("humidity", humidityF, "%", sensor::SensorId::HUMI)) { cJSON_Delete(root); if (errMsg) *errMsg = "add humidity failed"; return false; }
+    if (!add_measure("formaldehyde", formaldehyde, "mg/m3", sensor::SensorId::CH2O)) { cJSON_Delete(root); if (errMsg) *errMsg = "add formaldehyde failed"; return false; }
+    if (!add_measure("tvoc", tvoc, "ppb", sensor::SensorId::TVOC)) { cJSON_Delete(root); if (errMsg) *errMsg = "add tvoc failed"; return false; }
+    if (!add_measure("co2", co2F, "ppm", sensor::SensorId::CO2)) { cJSON_Delete(root); if (errMsg) *errMsg = "add co2 failed"; return false; }
+
+    if (!add_measure("soilTemperature", soilTemp, "°C", sensor::SensorId::SOIL_TEMP)) { cJSON_Delete(root); if (errMsg) *errMsg = "add soilTemperature failed"; return false; }
+    if (!add_measure("ec", ec, "mS/cm", sensor::SensorId::EC)) { cJSON_Delete(root); if (errMsg) *errMsg = "add ec failed"; return false; }
+    if (!add_measure("ph", ph, "", sensor::SensorId::PH)) { cJSON_Delete(root); if (errMsg) *errMsg = "add ph failed"; return false; }
+    if (!add_measure("nitrogen", n, "mg/L", sensor::SensorId::N)) { cJSON_Delete(root); if (errMsg) *errMsg = "add nitrogen failed"; return false; }
+    if (!add_measure("phosphorus", p, "mg/L", sensor::SensorId::P)) { cJSON_Delete(root); if (errMsg) *errMsg = "add phosphorus failed"; return false; }
+    if (!add_measure("potassium", k, "mg/L", sensor::SensorId::K)) { cJSON_Delete(root); if (errMsg) *errMsg = "add potassium failed"; return false; }
+    if (!add_measure("salt", salt, "mg/L", sensor::SensorId::SALT)) { cJSON_Delete(root); if (errMsg) *errMsg = "add salt failed"; return false; }
+    if (!add_measure("tds", tds, "ppm", sensor::SensorId::TDS)) { cJSON_Delete(root); if (errMsg) *errMsg = "add tds failed"; return false; }
 
     char *printed = cJSON_PrintUnformatted(root);
     if (printed == nullptr) {
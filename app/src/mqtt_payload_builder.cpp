@@ -1,10 +1,14 @@
 #include "mqtt_payload_builder.h"
 
+#include <atomic>
 #include <cerrno>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,14 +18,21 @@
 
 #include "cJSON.h"
 
+#include "cbor_writer.h"
+#include "crc32.h"
+#include "image_store.h"
 #include "myserial.h" // PHOTO_PATH
 #include "sensor_data_provider.h"
+#include "sensor_log.h"
 #include "auto_control.h" // control::AutoControlThresholds / GetThresholds
 
 namespace mqttc {
 
 static std::string g_deviceId;
 static std::string g_topicPrefix = "ciallo_ohos";
+static std::atomic<bool> g_imageInlineBase64{false};
+static std::atomic<PayloadCodec> g_sensorsCodec{PayloadCodec::JSON};
+static std::atomic<PayloadCodec> g_historyCodec{PayloadCodec::JSON};
 
 void SetMqttPayloadDeviceId(const std::string &deviceId)
 {
@@ -46,6 +57,31 @@ std::string GetMqttTopicPrefix()
     return g_topicPrefix;
 }
 
+void SetMqttPayloadCodec(PayloadTopic topic, PayloadCodec codec)
+{
+    (topic == PayloadTopic::HISTORY ? g_historyCodec : g_sensorsCodec).store(codec);
+}
+
+PayloadCodec GetMqttPayloadCodec(PayloadTopic topic)
+{
+    return (topic == PayloadTopic::HISTORY ? g_historyCodec : g_sensorsCodec).load();
+}
+
+std::string PayloadCodecTopic(const std::string &baseTopic, PayloadCodec codec)
+{
+    return codec == PayloadCodec::CBOR ? baseTopic + "/cbor" : baseTopic;
+}
+
+void SetMqttImageInlineBase64(bool inlineBase64)
+{
+    g_imageInlineBase64.store(inlineBase64);
+}
+
+bool GetMqttImageInlineBase64()
+{
+    return g_imageInlineBase64.load();
+}
+
 static std::string IsoTimestampUtc()
 {
     // Qt::ISODate can parse "YYYY-MM-DDTHH:mm:ssZ".
@@ -122,12 +158,17 @@ static bool ReadFileAll(const char *path, std::vector<uint8_t> &out, std::string
 
 bool BuildImagePayloadBase64(std::string &outBase64, std::string *errMsg)
 {
-    std::vector<uint8_t> bytes;
-    std::string err;
-    if (!ReadFileAll(PHOTO_PATH, bytes, err)) {
-        if (errMsg) *errMsg = err;
-        return false;
+    // 优先用内存中的最新图片（接收线程直接移交的缓冲），重启后尚未收到新图时才读文件
+    image::ImageRef latest = image::GetLatestImage();
+    std::vector<uint8_t> fileBytes;
+    if (!latest) {
+        std::string err;
+        if (!ReadFileAll(PHOTO_PATH, fileBytes, err)) {
+            if (errMsg) *errMsg = err;
+            return false;
+        }
     }
+    const std::vector<uint8_t> &bytes = latest ? *latest : fileBytes;
 
     outBase64 = Base64Encode(bytes.data(), bytes.size());
     if (outBase64.empty() && !bytes.empty()) {
@@ -138,7 +179,194 @@ bool BuildImagePayloadBase64(std::string &outBase64, std::string *errMsg)
     return true;
 }
 
+// 从 JPEG 的 SOFn 段读出宽高：只跳过各标记段，不解码图像
+static bool ParseJpegSize(const uint8_t *p, size_t len, int &width, int &height)
+{
+    if (len < 4 || p[0] != 0xFF || p[1] != 0xD8) {
+        return false;
+    }
+    size_t i = 2;
+    while (i + 4 <= len) {
+        if (p[i] != 0xFF) {
+            return false;
+        }
+        const uint8_t marker = p[i + 1];
+        if (marker == 0xFF) { // 填充字节
+            i++;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) { // EOI / SOS 之前没有 SOF
+            return false;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) { // 无长度字段的标记
+            i += 2;
+            continue;
+        }
+        const size_t segLen = (static_cast<size_t>(p[i + 2]) << 8) | p[i + 3];
+        if (segLen < 2) {
+            return false;
+        }
+        // SOF0~SOF15，排除 DHT(C4)、JPG(C8)、DAC(CC)
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (i + 9 > len) {
+                return false;
+            }
+            height = (p[i + 5] << 8) | p[i + 6];
+            width = (p[i + 7] << 8) | p[i + 8];
+            return true;
+        }
+        i += 2 + segLen;
+    }
+    return false;
+}
+
+bool LoadLatestImagePayload(ImagePayload &out, std::string *errMsg)
+{
+    out = ImagePayload();
+    out.jpeg = image::GetLatestImage(&out.seq, &out.captureMs);
+    if (!out.jpeg) {
+        // 重启后尚未收到新图：读 PHOTO_PATH，拍摄时间取文件修改时间
+        auto bytes = std::make_shared<std::vector<uint8_t>>();
+        std::string err;
+        if (!ReadFileAll(PHOTO_PATH, *bytes, err)) {
+            if (errMsg) *errMsg = err;
+            return false;
+        }
+        struct stat st;
+        if (stat(PHOTO_PATH, &st) == 0) {
+            out.captureMs = static_cast<int64_t>(st.st_mtime) * 1000;
+        }
+        out.seq = 0;
+        out.jpeg = std::move(bytes);
+    }
+
+    DescribeImageBytes(out.jpeg->data(), out.jpeg->size(), out);
+    return true;
+}
+
+void DescribeImageBytes(const uint8_t *data, size_t size, ImagePayload &out)
+{
+    out.size = size;
+    out.crc32 = crc32::Compute(data, size);
+    if (!ParseJpegSize(data, size, out.width, out.height)) {
+        out.width = 0;
+        out.height = 0;
+    }
+}
+
 bool BuildSensorPayloadJson(bool includeImage, std::string &outJson, std::string *errMsg)
+{
+    sensor::SensorSnapshot snap;
+    sensor::GetSnapshot(snap);
+    return BuildSensorPayloadJson(snap, includeImage, outJson, errMsg);
+}
+
+static int RoundToInt(float v)
+{
+    return static_cast<int>(v + (v >= 0 ? 0.5f : -0.5f));
+}
+
+static std::string IsoTimestampUtcMs(int64_t epochMs)
+{
+    std::time_t sec = static_cast<std::time_t>(epochMs / 1000);
+    struct tm t;
+    std::memset(&t, 0, sizeof(t));
+    gmtime_r(&sec, &t);
+
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &t);
+    return std::string(buf);
+}
+
+struct SensorField {
+    const char *name;
+    sensor::SensorId id;
+    bool rounded; // 以整数上报
+};
+
+// "sensors" 的字段：实时上报与历史补传共用，Qt 端解析逻辑无需区分。
+// 顺序即 CBOR sensors 数组的下标，只能在末尾追加（Qt 端 kSensorFieldNames 与之一致）
+static const SensorField kSensorFields[] = {
+    {"soilMoisture", sensor::SensorId::SOIL_HUMI, true},
+    {"lightLevel", sensor::SensorId::LIGHT, true},
+    {"temperature", sensor::SensorId::TEMP, false},
+    {"humidity", sensor::SensorId::HUMI, true},
+    {"formaldehyde", sensor::SensorId::CH2O, false},
+    {"tvoc", sensor::SensorId::TVOC, false},
+    {"co2", sensor::SensorId::CO2, true},
+    // 土壤多参数（由 ESP 返回的扩展字段）
+    {"soilTemperature", sensor::SensorId::SOIL_TEMP, false},
+    {"ec", sensor::SensorId::EC, false},
+    {"ph", sensor::SensorId::PH, false},
+    {"nitrogen", sensor::SensorId::N, false},
+    {"phosphorus", sensor::SensorId::P, false},
+    {"potassium", sensor::SensorId::K, false},
+    {"salt", sensor::SensorId::SALT, false},
+    {"tds", sensor::SensorId::TDS, false},
+};
+
+static bool AddSensorFields(cJSON *sensors, const float *values)
+{
+    bool ok = true;
+    for (const SensorField &f : kSensorFields) {
+        const float v = values[static_cast<size_t>(f.id)];
+        const double num = f.rounded ? RoundToInt(v) : static_cast<double>(v);
+        ok = ok && (cJSON_AddNumberToObject(sensors, f.name, num) != nullptr);
+    }
+    return ok;
+}
+
+static bool PrintAndFree(cJSON *root, bool ok, std::string &outJson, std::string *errMsg)
+{
+    if (!ok) {
+        if (errMsg) *errMsg = "cJSON add field failed";
+        cJSON_Delete(root);
+        return false;
+    }
+
+    char *printed = cJSON_PrintUnformatted(root);
+    if (printed == nullptr) {
+        if (errMsg) *errMsg = "cJSON_PrintUnformatted failed";
+        cJSON_Delete(root);
+        return false;
+    }
+
+    outJson.assign(printed);
+    cJSON_free(printed);
+    cJSON_Delete(root);
+    return true;
+}
+
+// 实时上报的公共部分：deviceId / timestamp / seq / sensors
+static cJSON *CreateSensorRoot(const sensor::SensorSnapshot &snap, bool &ok, std::string *errMsg)
+{
+    // alarm 统一由 auto_control 提供，作为设备执行逻辑与上报显示的单一来源
+    int alarm = control::GetAutoControlAlarm();
+
+    const std::string deviceId = g_deviceId.empty() ? "unknown" : g_deviceId;
+    const std::string ts = IsoTimestampUtc();
+
+    cJSON *root = cJSON_CreateObject();
+    if (root == nullptr) {
+        if (errMsg) *errMsg = "cJSON_CreateObject failed";
+        return nullptr;
+    }
+
+    ok = true;
+    ok = ok && (cJSON_AddStringToObject(root, "deviceId", deviceId.c_str()) != nullptr);
+    ok = ok && (cJSON_AddStringToObject(root, "timestamp", ts.c_str()) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(root, "seq", static_cast<double>(snap.seq)) != nullptr);
+
+    // One snapshot => all fields from the same frame.
+    cJSON *sensors = cJSON_AddObjectToObject(root, "sensors");
+    ok = ok && (sensors != nullptr);
+    ok = ok && AddSensorFields(sensors, snap.values);
+    ok = ok && (cJSON_AddNumberToObject(sensors, "alarm", alarm) != nullptr);
+    return root;
+}
+
+bool BuildSensorPayloadJson(const sensor::SensorSnapshot &snap, bool includeImage,
+                            std::string &outJson, std::string *errMsg)
 {
     std::string imageBase64;
     if (includeImage) {
@@ -149,37 +377,50 @@ bool BuildSensorPayloadJson(bool includeImage, std::string &outJson, std::string
         }
     }
 
-    // Read sensors (best-effort; keep 0 if failed)
-    float soilMoistureF = sensor::GetDataByKey("SoilHumi");
-    int soilMoisture = static_cast<int>(soilMoistureF + (soilMoistureF >= 0 ? 0.5f : -0.5f));
-
-    float lightF = sensor::GetDataByKey("Light");
-    int lightLevel = static_cast<int>(lightF + (lightF >= 0 ? 0.5f : -0.5f));
+    bool ok = false;
+    cJSON *root = CreateSensorRoot(snap, ok, errMsg);
+    if (root == nullptr) {
+        return false;
+    }
 
-    float temperature = sensor::GetDataByKey("Temp");
-    float humidityF = sensor::GetDataByKey("Humi");
-    float formaldehyde = sensor::GetDataByKey("CH2O");
-    float tvoc = sensor::GetDataByKey("TVOC");
-    float co2F = sensor::GetDataByKey("CO_2");
+    if (includeImage) {
+        ok = ok && (cJSON_AddStringToObject(root, "image", imageBase64.c_str()) != nullptr);
+    }
 
-    // 新增土壤多参数（由 ESP 返回的扩展字段）
-    float soilTemp = sensor::GetDataByKey("SoilTemp");
-    float ec = sensor::GetDataByKey("EC");
-    float ph = sensor::GetDataByKey("pH");
-    float n = sensor::GetDataByKey("N");
-    float p = sensor::GetDataByKey("P");
-    float k = sensor::GetDataByKey("K");
-    float salt = sensor::GetDataByKey("Salt");
-    float tds = sensor::GetDataByKey("TDS");
+    return PrintAndFree(root, ok, outJson, errMsg);
+}
 
-    // alarm 统一由 auto_control 提供，作为设备执行逻辑与上报显示的单一来源
-    int alarm = control::GetAutoControlAlarm();
+bool BuildSensorPayloadJson(const sensor::SensorSnapshot &snap, const ImagePayload &image,
+                            std::string &outJson, std::string *errMsg)
+{
+    bool ok = false;
+    cJSON *root = CreateSensorRoot(snap, ok, errMsg);
+    if (root == nullptr) {
+        return false;
+    }
 
-    int humidity = static_cast<int>(humidityF + (humidityF >= 0 ? 0.5f : -0.5f));
-    int co2 = static_cast<int>(co2F + (co2F >= 0 ? 0.5f : -0.5f));
+    // CRC-32 以 8 位十六进制字符串表示，避免 double 精度与有符号问题
+    char crcHex[9];
+    std::snprintf(crcHex, sizeof(crcHex), "%08x", image.crc32);
+    const size_t size = image.size;
+
+    cJSON *meta = cJSON_AddObjectToObject(root, "imageMeta");
+    ok = ok && (meta != nullptr);
+    ok = ok && (cJSON_AddStringToObject(meta, "format", "jpeg") != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(meta, "size", static_cast<double>(size)) != nullptr);
+    ok = ok && (cJSON_AddStringToObject(meta, "crc32", crcHex) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(meta, "captureMs", static_cast<double>(image.captureMs)) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(meta, "width", image.width) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(meta, "height", image.height) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(meta, "seq", static_cast<double>(image.seq)) != nullptr);
+
+    return PrintAndFree(root, ok, outJson, errMsg);
+}
 
+bool BuildSensorHistoryPayloadJson(const sensor::SensorLogRecord &rec, std::string &outJson, std::string *errMsg)
+{
     const std::string deviceId = g_deviceId.empty() ? "unknown" : g_deviceId;
-    const std::string ts = IsoTimestampUtc();
+    const std::string ts = IsoTimestampUtcMs(rec.wallMs);
 
     cJSON *root = cJSON_CreateObject();
     if (root == nullptr) {
@@ -190,50 +431,306 @@ bool BuildSensorPayloadJson(bool includeImage, std::string &outJson, std::string
     bool ok = true;
     ok = ok && (cJSON_AddStringToObject(root, "deviceId", deviceId.c_str()) != nullptr);
     ok = ok && (cJSON_AddStringToObject(root, "timestamp", ts.c_str()) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(root, "timestampMs", static_cast<double>(rec.wallMs)) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(root, "recordId", static_cast<double>(rec.id)) != nullptr);
+    ok = ok && (cJSON_AddBoolToObject(root, "replay", true) != nullptr);
 
     cJSON *sensors = cJSON_AddObjectToObject(root, "sensors");
     ok = ok && (sensors != nullptr);
-    if (ok) {
-        ok = ok && (cJSON_AddNumberToObject(sensors, "soilMoisture", soilMoisture) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "lightLevel", lightLevel) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "temperature", static_cast<double>(temperature)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "humidity", humidity) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "formaldehyde", static_cast<double>(formaldehyde)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "tvoc", static_cast<double>(tvoc)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "co2", co2) != nullptr);
-
-        ok = ok && (cJSON_AddNumberToObject(sensors, "soilTemperature", static_cast<double>(soilTemp)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "ec", static_cast<double>(ec)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "ph", static_cast<double>(ph)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "nitrogen", static_cast<double>(n)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "phosphorus", static_cast<double>(p)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "potassium", static_cast<double>(k)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "salt", static_cast<double>(salt)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "tds", static_cast<double>(tds)) != nullptr);
-        ok = ok && (cJSON_AddNumberToObject(sensors, "alarm", alarm) != nullptr);
+    ok = ok && AddSensorFields(sensors, rec.values);
+
+    return PrintAndFree(root, ok, outJson, errMsg);
+}
+
+// CBOR 映射的键，见 mqtt_payload_builder.h
+enum CborKey : uint8_t {
+    CBOR_DEVICE_ID = 0,
+    CBOR_TIMESTAMP_MS = 1,
+    CBOR_SEQ = 2,
+    CBOR_SENSORS = 3,
+    CBOR_ALARM = 4,
+    CBOR_RECORD_ID = 5,
+    CBOR_REPLAY = 6,
+    CBOR_IMAGE_META = 7,
+    CBOR_OFFSETS_MS = 8,
+};
+
+static void WriteCborSensors(cbor::Writer &w, const float *values)
+{
+    w.Uint(CBOR_SENSORS);
+    w.Array(sizeof(kSensorFields) / sizeof(kSensorFields[0]));
+    for (const SensorField &f : kSensorFields) {
+        const float v = values[static_cast<size_t>(f.id)];
+        w.Number(f.rounded ? static_cast<float>(RoundToInt(v)) : v);
     }
+}
 
-    if (includeImage) {
-        ok = ok && (cJSON_AddStringToObject(root, "image", imageBase64.c_str()) != nullptr);
+bool BuildSensorPayloadCbor(const sensor::SensorSnapshot &snap, const ImagePayload *image,
+                            std::string &outCbor, std::string *errMsg)
+{
+    (void)errMsg;
+    const std::string deviceId = g_deviceId.empty() ? "unknown" : g_deviceId;
+    const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    outCbor.clear();
+    cbor::Writer w(outCbor);
+    w.Map(image != nullptr ? 6 : 5);
+    w.Uint(CBOR_DEVICE_ID);
+    w.Text(deviceId);
+    w.Uint(CBOR_TIMESTAMP_MS);
+    w.Int(nowMs);
+    w.Uint(CBOR_SEQ);
+    w.Uint(snap.seq);
+    WriteCborSensors(w, snap.values);
+    w.Uint(CBOR_ALARM);
+    w.Int(control::GetAutoControlAlarm());
+    if (image != nullptr) {
+        w.Uint(CBOR_IMAGE_META);
+        w.Map(6);
+        w.Uint(0);
+        w.Uint(image->size);
+        w.Uint(1);
+        w.Uint(image->crc32);
+        w.Uint(2);
+        w.Int(image->captureMs);
+        w.Uint(3);
+        w.Int(image->width);
+        w.Uint(4);
+        w.Int(image->height);
+        w.Uint(5);
+        w.Uint(image->seq);
     }
+    return true;
+}
 
-    if (!ok) {
-        if (errMsg) *errMsg = "cJSON add field failed";
-        cJSON_Delete(root);
+bool BuildSensorHistoryPayloadCbor(const sensor::SensorLogRecord &rec, std::string &outCbor, std::string *errMsg)
+{
+    (void)errMsg;
+    const std::string deviceId = g_deviceId.empty() ? "unknown" : g_deviceId;
+
+    outCbor.clear();
+    cbor::Writer w(outCbor);
+    w.Map(5);
+    w.Uint(CBOR_DEVICE_ID);
+    w.Text(deviceId);
+    w.Uint(CBOR_TIMESTAMP_MS);
+    w.Int(rec.wallMs);
+    WriteCborSensors(w, rec.values);
+    w.Uint(CBOR_RECORD_ID);
+    w.Uint(rec.id);
+    w.Uint(CBOR_REPLAY);
+    w.Bool(true);
+    return true;
+}
+
+bool BuildSensorPayload(PayloadCodec codec, const sensor::SensorSnapshot &snap, const ImagePayload *image,
+                        std::string &out, std::string *errMsg)
+{
+    if (codec == PayloadCodec::CBOR) {
+        return BuildSensorPayloadCbor(snap, image, out, errMsg);
+    }
+    if (image != nullptr) {
+        return BuildSensorPayloadJson(snap, *image, out, errMsg);
+    }
+    return BuildSensorPayloadJson(snap, false, out, errMsg);
+}
+
+bool BuildSensorHistoryPayload(PayloadCodec codec, const sensor::SensorLogRecord &rec, std::string &out,
+                               std::string *errMsg)
+{
+    if (codec == PayloadCodec::CBOR) {
+        return BuildSensorHistoryPayloadCbor(rec, out, errMsg);
+    }
+    return BuildSensorHistoryPayloadJson(rec, out, errMsg);
+}
+
+bool BuildSensorDeltaPayload(PayloadCodec codec, const sensor::SensorSnapshot &snap, const SensorUpdate &update,
+                             int alarm, std::string &out, std::string *errMsg)
+{
+    const std::string deviceId = g_deviceId.empty() ? "unknown" : g_deviceId;
+    const size_t fieldCount = sizeof(kSensorFields) / sizeof(kSensorFields[0]);
+    auto changed = [&update](const SensorField &f) {
+        return (update.changedMask & (1u << static_cast<uint32_t>(f.id))) != 0;
+    };
+    auto value = [&snap](const SensorField &f) {
+        const float v = snap.values[static_cast<size_t>(f.id)];
+        return f.rounded ? static_cast<float>(RoundToInt(v)) : v;
+    };
+
+    if (codec == PayloadCodec::CBOR) {
+        const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        size_t changedCount = 0;
+        for (const SensorField &f : kSensorFields) {
+            changedCount += changed(f) ? 1 : 0;
+        }
+
+        out.clear();
+        cbor::Writer w(out);
+        w.Map(update.alarmChanged ? 5 : 4);
+        w.Uint(CBOR_DEVICE_ID);
+        w.Text(deviceId);
+        w.Uint(CBOR_TIMESTAMP_MS);
+        w.Int(nowMs);
+        w.Uint(CBOR_SEQ);
+        w.Uint(snap.seq);
+        w.Uint(CBOR_SENSORS);
+        w.Map(changedCount);
+        for (size_t i = 0; i < fieldCount; i++) {
+            if (changed(kSensorFields[i])) {
+                w.Uint(i);
+                w.Number(value(kSensorFields[i]));
+            }
+        }
+        if (update.alarmChanged) {
+            w.Uint(CBOR_ALARM);
+            w.Int(alarm);
+        }
+        return true;
+    }
+
+    const std::string ts = IsoTimestampUtc();
+    cJSON *root = cJSON_CreateObject();
+    if (root == nullptr) {
+        if (errMsg) *errMsg = "cJSON_CreateObject failed";
         return false;
     }
 
-    char *printed = cJSON_PrintUnformatted(root);
-    if (printed == nullptr) {
-        if (errMsg) *errMsg = "cJSON_PrintUnformatted failed";
-        cJSON_Delete(root);
+    bool ok = true;
+    ok = ok && (cJSON_AddStringToObject(root, "deviceId", deviceId.c_str()) != nullptr);
+    ok = ok && (cJSON_AddStringToObject(root, "timestamp", ts.c_str()) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(root, "seq", static_cast<double>(snap.seq)) != nullptr);
+    ok = ok && (cJSON_AddBoolToObject(root, "delta", true) != nullptr);
+
+    cJSON *sensors = cJSON_AddObjectToObject(root, "sensors");
+    ok = ok && (sensors != nullptr);
+    for (const SensorField &f : kSensorFields) {
+        if (ok && changed(f)) {
+            ok = cJSON_AddNumberToObject(sensors, f.name, static_cast<double>(value(f))) != nullptr;
+        }
+    }
+    if (update.alarmChanged) {
+        ok = ok && (cJSON_AddNumberToObject(sensors, "alarm", alarm) != nullptr);
+    }
+    return PrintAndFree(root, ok, out, errMsg);
+}
+
+// 批量负载里的数值按 float 的 7 位有效数字写出：cJSON 按 double 打印 float 会得到
+// 23.700000762939453 这样的长串，列数组里每个值都要付这份体积
+static double ShortestDecimal(float v)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.7g", static_cast<double>(v));
+    return std::strtod(buf, nullptr);
+}
+
+static bool BuildSensorBatchPayloadJson(const sensor::SensorBatch &batch, int alarm, std::string &out,
+                                        std::string *errMsg)
+{
+    const std::string deviceId = g_deviceId.empty() ? "unknown" : g_deviceId;
+    const std::string ts = IsoTimestampUtcMs(batch.baseWallMs);
+    const size_t n = batch.size();
+
+    cJSON *root = cJSON_CreateObject();
+    if (root == nullptr) {
+        if (errMsg) *errMsg = "cJSON_CreateObject failed";
         return false;
     }
 
-    outJson.assign(printed);
-    cJSON_free(printed);
-    cJSON_Delete(root);
-    return true;
+    bool ok = true;
+    ok = ok && (cJSON_AddStringToObject(root, "deviceId", deviceId.c_str()) != nullptr);
+    ok = ok && (cJSON_AddStringToObject(root, "timestamp", ts.c_str()) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(root, "baseMs", static_cast<double>(batch.baseWallMs)) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(root, "seq", static_cast<double>(batch.firstSeq)) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(root, "count", static_cast<double>(n)) != nullptr);
+    ok = ok && (cJSON_AddNumberToObject(root, "alarm", alarm) != nullptr);
+
+    cJSON *offsets = cJSON_AddArrayToObject(root, "offsetsMs");
+    ok = ok && (offsets != nullptr);
+    for (size_t i = 0; ok && i < n; i++) {
+        ok = cJSON_AddItemToArray(offsets, cJSON_CreateNumber(batch.offsetsMs[i]));
+    }
+
+    cJSON *sensors = cJSON_AddObjectToObject(root, "sensors");
+    ok = ok && (sensors != nullptr);
+    for (const SensorField &f : kSensorFields) {
+        const uint32_t bit = 1u << static_cast<uint32_t>(f.id);
+        if (!ok || (batch.validMask & bit) == 0) {
+            continue;
+        }
+        const std::vector<float> &column = batch.values[static_cast<size_t>(f.id)];
+        cJSON *arr = cJSON_AddArrayToObject(sensors, f.name);
+        ok = arr != nullptr;
+        for (size_t i = 0; ok && i < n; i++) {
+            cJSON *item;
+            if ((batch.masks[i] & bit) == 0) {
+                item = cJSON_CreateNull();
+            } else if (f.rounded) {
+                item = cJSON_CreateNumber(RoundToInt(column[i]));
+            } else {
+                item = cJSON_CreateNumber(ShortestDecimal(column[i]));
+            }
+            ok = cJSON_AddItemToArray(arr, item);
+        }
+    }
+    return PrintAndFree(root, ok, out, errMsg);
+}
+
+static void BuildSensorBatchPayloadCbor(const sensor::SensorBatch &batch, int alarm, std::string &out)
+{
+    const std::string deviceId = g_deviceId.empty() ? "unknown" : g_deviceId;
+    const size_t n = batch.size();
+
+    out.clear();
+    out.reserve(64 + n * (3 + 5 * sensor::kSensorCount));
+    cbor::Writer w(out);
+    w.Map(6);
+    w.Uint(CBOR_DEVICE_ID);
+    w.Text(deviceId);
+    w.Uint(CBOR_TIMESTAMP_MS);
+    w.Int(batch.baseWallMs);
+    w.Uint(CBOR_SEQ);
+    w.Uint(batch.firstSeq);
+    w.Uint(CBOR_SENSORS);
+    w.Array(sizeof(kSensorFields) / sizeof(kSensorFields[0]));
+    for (const SensorField &f : kSensorFields) {
+        const uint32_t bit = 1u << static_cast<uint32_t>(f.id);
+        if ((batch.validMask & bit) == 0) {
+            w.Array(0);
+            continue;
+        }
+        const std::vector<float> &column = batch.values[static_cast<size_t>(f.id)];
+        w.Array(n);
+        for (size_t i = 0; i < n; i++) {
+            if ((batch.masks[i] & bit) == 0) {
+                w.Null();
+            } else {
+                w.Number(f.rounded ? static_cast<float>(RoundToInt(column[i])) : column[i]);
+            }
+        }
+    }
+    w.Uint(CBOR_ALARM);
+    w.Int(alarm);
+    w.Uint(CBOR_OFFSETS_MS);
+    w.Array(n);
+    for (size_t i = 0; i < n; i++) {
+        w.Uint(batch.offsetsMs[i]);
+    }
+}
+
+bool BuildSensorBatchPayload(PayloadCodec codec, const sensor::SensorBatch &batch, int alarm, std::string &out,
+                             std::string *errMsg)
+{
+    if (batch.size() == 0) {
+        if (errMsg) *errMsg = "empty batch";
+        return false;
+    }
+    if (codec == PayloadCodec::CBOR) {
+        BuildSensorBatchPayloadCbor(batch, alarm, out);
+        return true;
+    }
+    return BuildSensorBatchPayloadJson(batch, alarm, out, errMsg);
 }
 
 } // namespace mqttc
@@ -0,0 +1,313 @@
+#include "mqtt_topic_router.h"
+
+#include <cstring>
+#include <vector>
+
+namespace mqttc {
+
+namespace {
+
+// 工作线程积压上限，超出后丢最旧的消息
+constexpr size_t kMaxWorkerTasks = 256;
+
+// 主题的一层：指向原始缓冲，不拷贝
+struct Segment {
+    const char *data;
+    size_t size;
+};
+
+int CompareSegment(const char *a, size_t an, const char *b, size_t bn)
+{
+    const int c = std::memcmp(a, b, an < bn ? an : bn);
+    if (c != 0) {
+        return c;
+    }
+    return an < bn ? -1 : (an > bn ? 1 : 0);
+}
+
+// 透明比较器：子节点表以 std::string 为键，查找时直接用 Segment，不构造临时字符串
+struct SegmentLess {
+    using is_transparent = void;
+
+    bool operator()(const std::string &a, const std::string &b) const
+    {
+        return a < b;
+    }
+    bool operator()(const std::string &a, const Segment &b) const
+    {
+        return CompareSegment(a.data(), a.size(), b.data, b.size) < 0;
+    }
+    bool operator()(const Segment &a, const std::string &b) const
+    {
+        return CompareSegment(a.data, a.size, b.data(), b.size()) < 0;
+    }
+};
+
+std::vector<std::string> SplitLevels(const std::string &filter)
+{
+    std::vector<std::string> levels;
+    size_t start = 0;
+    for (;;) {
+        const size_t slash = filter.find('/', start);
+        if (slash == std::string::npos) {
+            levels.push_back(filter.substr(start));
+            return levels;
+        }
+        levels.push_back(filter.substr(start, slash - start));
+        start = slash + 1;
+    }
+}
+
+} // namespace
+
+struct TopicRouter::Entry {
+    HandlerId id;
+    std::shared_ptr<const MessageHandler> handler;
+    HandlerExecutor executor;
+};
+
+// 树节点。节点一旦发布就不再修改：增删时只复制从根到目标的一条路径，其余子树共享
+struct TopicRouter::Node {
+    std::map<std::string, std::shared_ptr<const Node>, SegmentLess> children;
+    std::shared_ptr<const Node> plus; // 本层为 '+'
+    std::vector<Entry> exact;         // 过滤器在本层结束
+    std::vector<Entry> hash;          // 过滤器为 "<到本层为止>/#"，也匹配本层本身
+
+    bool empty() const
+    {
+        return children.empty() && !plus && exact.empty() && hash.empty();
+    }
+};
+
+TopicRouter::TopicRouter() : root_(std::make_shared<const Node>()) {}
+
+TopicRouter::~TopicRouter()
+{
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        stopping_ = true;
+    }
+    taskCv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool TopicRouter::IsValidFilter(const std::string &filter)
+{
+    if (filter.empty() || filter.size() > 65535) {
+        return false;
+    }
+    const std::vector<std::string> levels = SplitLevels(filter);
+    for (size_t i = 0; i < levels.size(); i++) {
+        const std::string &level = levels[i];
+        if (level.find('#') != std::string::npos && (level != "#" || i + 1 != levels.size())) {
+            return false;
+        }
+        if (level.find('+') != std::string::npos && level != "+") {
+            return false;
+        }
+    }
+    return true;
+}
+
+HandlerId TopicRouter::add(const std::string &filter, MessageHandler handler, HandlerExecutor executor)
+{
+    if (!handler || !IsValidFilter(filter)) {
+        return 0;
+    }
+
+    if (executor == HandlerExecutor::WORKER) {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (!worker_.joinable()) {
+            worker_ = std::thread(&TopicRouter::workerLoop, this);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    Entry entry;
+    entry.id = nextId_++;
+    entry.handler = std::make_shared<const MessageHandler>(std::move(handler));
+    entry.executor = executor;
+    std::atomic_store(&root_, Insert(std::atomic_load(&root_), SplitLevels(filter), 0, entry));
+    filters_[entry.id] = filter;
+    return entry.id;
+}
+
+bool TopicRouter::remove(HandlerId id, std::string *filterOut, bool *lastOut)
+{
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    auto it = filters_.find(id);
+    if (it == filters_.end()) {
+        return false;
+    }
+    bool found = false;
+    bool last = false;
+    NodePtr root = Erase(std::atomic_load(&root_), SplitLevels(it->second), 0, id, found, last);
+    std::atomic_store(&root_, root ? root : std::make_shared<const Node>());
+    if (filterOut) {
+        *filterOut = it->second;
+    }
+    if (lastOut) {
+        *lastOut = last;
+    }
+    filters_.erase(it);
+    return found;
+}
+
+size_t TopicRouter::dispatch(const char *topic, size_t topicLen, const void *data, size_t size)
+{
+    if (topic == nullptr) {
+        topic = "";
+        topicLen = 0;
+    }
+    // 持有当前树的引用：分发期间即使处理函数增删，本条消息仍按旧树走完
+    const NodePtr root = std::atomic_load(&root_);
+    std::shared_ptr<const std::string> copy; // 第一个 WORKER 处理函数匹配时才拷贝消息
+    size_t matched = 0;
+    collect(*root, topic, topicLen, 0, true, data, size, copy, matched);
+    return matched;
+}
+
+uint64_t TopicRouter::droppedTasks() const
+{
+    std::lock_guard<std::mutex> lock(taskMutex_);
+    return droppedTasks_;
+}
+
+// pos 为当前层在 topic 中的起点；pos > len 表示所有层都已匹配完
+void TopicRouter::collect(const Node &node, const char *topic, size_t len, size_t pos, bool root,
+                          const void *data, size_t size, std::shared_ptr<const std::string> &copy, size_t &matched)
+{
+    // 以 '$' 开头的主题（如 $SYS/...）不匹配首层的 + 和 #
+    const bool wildcards = !(root && len > 0 && topic[0] == '$');
+    if (wildcards) {
+        for (const Entry &entry : node.hash) {
+            run(entry, topic, len, data, size, copy);
+            matched++;
+        }
+    }
+    if (pos > len) {
+        for (const Entry &entry : node.exact) {
+            run(entry, topic, len, data, size, copy);
+            matched++;
+        }
+        return;
+    }
+
+    const void *slash = std::memchr(topic + pos, '/', len - pos);
+    const size_t end = slash ? static_cast<size_t>(static_cast<const char *>(slash) - topic) : len;
+    const Segment segment{topic + pos, end - pos};
+    auto it = node.children.find(segment);
+    if (it != node.children.end()) {
+        collect(*it->second, topic, len, end + 1, false, data, size, copy, matched);
+    }
+    if (node.plus && wildcards) {
+        collect(*node.plus, topic, len, end + 1, false, data, size, copy, matched);
+    }
+}
+
+void TopicRouter::run(const Entry &entry, const char *topic, size_t topicLen, const void *data, size_t size,
+                      std::shared_ptr<const std::string> &copy)
+{
+    if (entry.executor == HandlerExecutor::INLINE) {
+        (*entry.handler)(topic, topicLen, data, size);
+        return;
+    }
+
+    if (!copy) {
+        auto message = std::make_shared<std::string>();
+        message->reserve(topicLen + 1 + size);
+        message->append(topic, topicLen);
+        message->push_back('\0');
+        message->append(static_cast<const char *>(data), size);
+        copy = std::move(message);
+    }
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (tasks_.size() >= kMaxWorkerTasks) {
+            tasks_.pop_front();
+            droppedTasks_++;
+        }
+        tasks_.push_back(Task{entry.handler, copy, topicLen});
+    }
+    taskCv_.notify_one();
+}
+
+void TopicRouter::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(taskMutex_);
+    for (;;) {
+        taskCv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (stopping_) {
+            return;
+        }
+        Task task = std::move(tasks_.front());
+        tasks_.pop_front();
+        lock.unlock();
+        const char *message = task.message->data();
+        (*task.handler)(message, task.topicLen, message + task.topicLen + 1,
+                        task.message->size() - task.topicLen - 1);
+        lock.lock();
+    }
+}
+
+TopicRouter::NodePtr TopicRouter::Insert(const NodePtr &node, const std::vector<std::string> &levels, size_t i,
+                                         const Entry &entry)
+{
+    auto copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+    if (i == levels.size()) {
+        copy->exact.push_back(entry);
+    } else if (levels[i] == "#") {
+        copy->hash.push_back(entry);
+    } else if (levels[i] == "+") {
+        copy->plus = Insert(copy->plus, levels, i + 1, entry);
+    } else {
+        NodePtr &child = copy->children[levels[i]];
+        child = Insert(child, levels, i + 1, entry);
+    }
+    return copy;
+}
+
+// 返回删除后的节点；节点变空时返回 nullptr，由上层把它从树上摘掉
+TopicRouter::NodePtr TopicRouter::Erase(const NodePtr &node, const std::vector<std::string> &levels, size_t i,
+                                        HandlerId id, bool &found, bool &last)
+{
+    if (!node) {
+        return node;
+    }
+    auto EraseEntry = [id, &found, &last](std::vector<Entry> &entries) {
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->id == id) {
+                entries.erase(it);
+                found = true;
+                last = entries.empty();
+                return;
+            }
+        }
+    };
+    auto copy = std::make_shared<Node>(*node);
+    if (i == levels.size()) {
+        EraseEntry(copy->exact);
+    } else if (levels[i] == "#") {
+        EraseEntry(copy->hash);
+    } else if (levels[i] == "+") {
+        copy->plus = Erase(copy->plus, levels, i + 1, id, found, last);
+    } else {
+        auto it = copy->children.find(levels[i]);
+        if (it != copy->children.end()) {
+            NodePtr child = Erase(it->second, levels, i + 1, id, found, last);
+            if (child) {
+                it->second = child;
+            } else {
+                copy->children.erase(it);
+            }
+        }
+    }
+    if (copy->empty()) {
+        return nullptr;
+    }
+    return copy;
+}
+
+} // namespace mqttc
@@ -0,0 +1,447 @@
+#include "mqtt_transport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include "mqtt.h"
+
+namespace mqttc {
+
+namespace {
+
+std::string OpenSslErrors()
+{
+    std::string out;
+    unsigned long e;
+    while ((e = ERR_get_error()) != 0) {
+        char buf[256];
+        ERR_error_string_n(e, buf, sizeof(buf));
+        if (!out.empty()) {
+            out += "; ";
+        }
+        out += buf;
+    }
+    return out;
+}
+
+std::string ErrnoString(int err)
+{
+    char buf[128];
+    buf[0] = '\0';
+    strerror_r(err, buf, sizeof(buf));
+    return "errno=" + std::to_string(err) + ": " + buf;
+}
+
+bool IsIpAddress(const std::string &host)
+{
+    unsigned char addr[16];
+    return inet_pton(AF_INET, host.c_str(), addr) == 1 || inet_pton(AF_INET6, host.c_str(), addr) == 1;
+}
+
+// OpenSSL 自带的 socket BIO 用 write() 发送，对端已关闭时会触发 SIGPIPE 终止进程；
+// 这里换成 send(MSG_NOSIGNAL)，与明文连接的发送方式一致
+int BioWrite(BIO *bio, const char *data, int size)
+{
+    const int fd = static_cast<int>(reinterpret_cast<intptr_t>(BIO_get_data(bio)));
+    BIO_clear_retry_flags(bio);
+    const ssize_t n = ::send(fd, data, static_cast<size_t>(size), MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        BIO_set_retry_write(bio);
+    }
+    return static_cast<int>(n);
+}
+
+int BioRead(BIO *bio, char *data, int size)
+{
+    const int fd = static_cast<int>(reinterpret_cast<intptr_t>(BIO_get_data(bio)));
+    BIO_clear_retry_flags(bio);
+    const ssize_t n = ::recv(fd, data, static_cast<size_t>(size), 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        BIO_set_retry_read(bio);
+    }
+    return static_cast<int>(n);
+}
+
+long BioCtrl(BIO *bio, int cmd, long num, void *ptr)
+{
+    (void)bio;
+    (void)num;
+    (void)ptr;
+    return cmd == BIO_CTRL_FLUSH ? 1 : 0;
+}
+
+int BioCreate(BIO *bio)
+{
+    BIO_set_init(bio, 1);
+    return 1;
+}
+
+BIO_METHOD *SocketBioMethod()
+{
+    static BIO_METHOD *method = [] {
+        BIO_METHOD *m = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "mqttc socket");
+        if (m != nullptr) {
+            BIO_meth_set_write(m, BioWrite);
+            BIO_meth_set_read(m, BioRead);
+            BIO_meth_set_ctrl(m, BioCtrl);
+            BIO_meth_set_create(m, BioCreate);
+        }
+        return m;
+    }();
+    return method;
+}
+
+} // namespace
+
+std::shared_ptr<TlsContext> TlsContext::Create(const TlsOptions &options, std::string *errorMsg)
+{
+    auto fail = [errorMsg](const std::string &msg) {
+        if (errorMsg) {
+            *errorMsg = msg;
+        }
+        return std::shared_ptr<TlsContext>();
+    };
+
+    ERR_clear_error();
+    std::shared_ptr<TlsContext> tls(new TlsContext(options));
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (ctx == nullptr) {
+        return fail("SSL_CTX_new failed: " + OpenSslErrors());
+    }
+    tls->ctx_ = ctx;
+
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    // MQTT-C 与大报文直写都按“写出多少算多少、下次从剩余处继续”的方式重试
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    // 对端不发 close_notify 直接断开时按正常关闭处理：OpenSSL 3 默认记为致命错误并作废会话，重连就复用不了
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+
+    if (options.verifyPeer) {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+        const int ok = options.caFile.empty() ? SSL_CTX_set_default_verify_paths(ctx)
+                                              : SSL_CTX_load_verify_locations(ctx, options.caFile.c_str(), nullptr);
+        if (ok != 1) {
+            return fail("load CA " + (options.caFile.empty() ? std::string("(default paths)") : options.caFile) +
+                        " failed: " + OpenSslErrors());
+        }
+    } else {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    }
+
+    if (!options.certFile.empty()) {
+        const std::string &keyFile = options.keyFile.empty() ? options.certFile : options.keyFile;
+        if (SSL_CTX_use_certificate_chain_file(ctx, options.certFile.c_str()) != 1) {
+            return fail("load client certificate " + options.certFile + " failed: " + OpenSslErrors());
+        }
+        if (SSL_CTX_use_PrivateKey_file(ctx, keyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+            SSL_CTX_check_private_key(ctx) != 1) {
+            return fail("load client key " + keyFile + " failed: " + OpenSslErrors());
+        }
+    }
+
+    if (options.sessionResumption) {
+        // 客户端缓存由这里自己保存（OnNewSession），不用 OpenSSL 的内部表。
+        // TLS1.3 的票据在握手之后才到达，所以在回调里取，而不是握手完成时 SSL_get1_session
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx, &TlsContext::OnNewSession);
+    } else {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+    return tls;
+}
+
+TlsContext::~TlsContext()
+{
+    if (session_ != nullptr) {
+        SSL_SESSION_free(session_);
+    }
+    if (ctx_ != nullptr) {
+        SSL_CTX_free(ctx_);
+    }
+}
+
+int TlsContext::OnNewSession(SSL *ssl, SSL_SESSION *session)
+{
+    auto *transport = static_cast<Transport *>(SSL_get_app_data(ssl));
+    if (transport == nullptr || !transport->tls_) {
+        return 0;
+    }
+    TlsContext &tls = *transport->tls_;
+    std::lock_guard<std::mutex> lock(tls.mutex_);
+    if (tls.session_ != nullptr) {
+        SSL_SESSION_free(tls.session_);
+    }
+    // 返回 1 表示接管这份引用
+    tls.session_ = session;
+    tls.sessionPeer_ = transport->peer_;
+    return 1;
+}
+
+SSL_SESSION *TlsContext::takeSession(const std::string &peer)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (session_ == nullptr || sessionPeer_ != peer || SSL_SESSION_is_resumable(session_) != 1) {
+        return nullptr;
+    }
+    SSL_SESSION_up_ref(session_);
+    return session_;
+}
+
+std::unique_ptr<Transport> Transport::Create(int fd,
+                                             std::shared_ptr<TlsContext> tls,
+                                             const std::string &host,
+                                             int port,
+                                             std::string *errorMsg)
+{
+    std::unique_ptr<Transport> t(new Transport(fd));
+    if (!tls) {
+        return t;
+    }
+
+    auto fail = [errorMsg](const std::string &msg) {
+        if (errorMsg) {
+            *errorMsg = msg;
+        }
+        return std::unique_ptr<Transport>();
+    };
+
+    ERR_clear_error();
+    BIO_METHOD *method = SocketBioMethod();
+    SSL *ssl = method != nullptr ? SSL_new(tls->ctx_) : nullptr;
+    if (ssl == nullptr) {
+        return fail("SSL_new failed: " + OpenSslErrors());
+    }
+    t->ssl_ = ssl;
+    t->tls_ = tls;
+    t->handshakeDone_ = false;
+    t->peer_ = host + ":" + std::to_string(port);
+
+    BIO *bio = BIO_new(method);
+    if (bio == nullptr) {
+        return fail("BIO_new failed: " + OpenSslErrors());
+    }
+    BIO_set_data(bio, reinterpret_cast<void *>(static_cast<intptr_t>(fd)));
+    SSL_set_bio(ssl, bio, bio);
+    SSL_set_app_data(ssl, t.get());
+    SSL_set_connect_state(ssl);
+
+    const TlsOptions &options = tls->options();
+    const std::string &name = options.serverName.empty() ? host : options.serverName;
+    if (IsIpAddress(name)) {
+        // 按 IP 连接：不发 SNI，校验证书的 IP SAN
+        if (options.verifyPeer && X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), name.c_str()) != 1) {
+            return fail("invalid broker address " + name);
+        }
+    } else {
+        if (SSL_set_tlsext_host_name(ssl, name.c_str()) != 1) {
+            return fail("set SNI " + name + " failed: " + OpenSslErrors());
+        }
+        if (options.verifyPeer && SSL_set1_host(ssl, name.c_str()) != 1) {
+            return fail("set verify host " + name + " failed: " + OpenSslErrors());
+        }
+    }
+
+    if (options.sessionResumption) {
+        SSL_SESSION *session = tls->takeSession(t->peer_);
+        if (session != nullptr) {
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
+    }
+    t->handshakeStart_ = std::chrono::steady_clock::now();
+    return t;
+}
+
+Transport::~Transport()
+{
+    if (ssl_ != nullptr) {
+        if (handshakeDone_ && !fatal_) {
+            // 尽力发出 close_notify（非阻塞，不等对端回应）；异常断线时也标记为已关闭，
+            // 否则 SSL_free 会把会话标成不可复用，断线重连正是最需要简化握手的时候
+            ERR_clear_error();
+            (void)SSL_shutdown(ssl_);
+            SSL_set_shutdown(ssl_, SSL_get_shutdown(ssl_) | SSL_SENT_SHUTDOWN);
+        }
+        SSL_free(ssl_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+Transport::Handshake Transport::handshake(std::string *errorMsg)
+{
+    if (handshakeDone_) {
+        return Handshake::DONE;
+    }
+    ERR_clear_error();
+    const int rc = SSL_do_handshake(ssl_);
+    if (rc == 1) {
+        handshakeDone_ = true;
+        wantWrite_ = false;
+        handshakeMs_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - handshakeStart_).count();
+        return Handshake::DONE;
+    }
+
+    const int err = SSL_get_error(ssl_, rc);
+    if (err == SSL_ERROR_WANT_READ) {
+        wantWrite_ = false;
+        return Handshake::WANT_READ;
+    }
+    if (err == SSL_ERROR_WANT_WRITE) {
+        wantWrite_ = true;
+        return Handshake::WANT_WRITE;
+    }
+
+    fatal_ = true;
+    std::string msg = "TLS handshake failed";
+    const long verify = SSL_get_verify_result(ssl_);
+    if (verify != X509_V_OK) {
+        msg += ": certificate verify failed (" + std::string(X509_verify_cert_error_string(verify)) + ")";
+    } else if (err == SSL_ERROR_SYSCALL) {
+        const int e = errno;
+        const std::string ssl = OpenSslErrors();
+        msg += ": " + (!ssl.empty() ? ssl : e != 0 ? ErrnoString(e) : std::string("connection closed by peer"));
+    } else {
+        msg += ": " + OpenSslErrors();
+    }
+    lastError_ = msg;
+    if (errorMsg) {
+        *errorMsg = msg;
+    }
+    return Handshake::FAILED;
+}
+
+bool Transport::sessionReused() const
+{
+    return ssl_ != nullptr && SSL_session_reused(ssl_) == 1;
+}
+
+bool Transport::hasBufferedInput() const
+{
+    return ssl_ != nullptr && handshakeDone_ && SSL_pending(ssl_) > 0;
+}
+
+ssize_t Transport::tlsResult(int rc, const char *op)
+{
+    if (rc > 0) {
+        wantWrite_ = false;
+        return rc;
+    }
+    const int err = SSL_get_error(ssl_, rc);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+        wantWrite_ = err == SSL_ERROR_WANT_WRITE;
+        return 0;
+    }
+    if (err == SSL_ERROR_ZERO_RETURN) {
+        lastError_ = "TLS connection closed by peer";
+    } else if (err == SSL_ERROR_SYSCALL) {
+        const int e = errno;
+        const std::string ssl = OpenSslErrors();
+        lastError_ = std::string(op) + " failed: " +
+                     (!ssl.empty() ? ssl : e != 0 ? ErrnoString(e) : std::string("connection closed by peer"));
+    } else {
+        fatal_ = err == SSL_ERROR_SSL;
+        lastError_ = std::string(op) + " failed: " + OpenSslErrors();
+    }
+    return -1;
+}
+
+ssize_t Transport::send(const void *data, size_t size)
+{
+    if (ssl_ == nullptr) {
+        const ssize_t n = ::send(fd_, data, size, MSG_NOSIGNAL);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+        lastError_ = "send failed: " + ErrnoString(errno);
+        return -1;
+    }
+    if (!handshakeDone_ || size == 0) {
+        return 0;
+    }
+    ERR_clear_error();
+    return tlsResult(SSL_write(ssl_, data, static_cast<int>(std::min<size_t>(size, INT_MAX))), "SSL_write");
+}
+
+ssize_t Transport::recv(void *data, size_t size)
+{
+    if (ssl_ == nullptr) {
+        const ssize_t n = ::recv(fd_, data, size, 0);
+        if (n > 0) {
+            return n;
+        }
+        if (n == 0) {
+            lastError_ = "connection closed by peer";
+            return -1;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+        lastError_ = "recv failed: " + ErrnoString(errno);
+        return -1;
+    }
+    if (!handshakeDone_ || size == 0) {
+        return 0;
+    }
+    ERR_clear_error();
+    return tlsResult(SSL_read(ssl_, data, static_cast<int>(std::min<size_t>(size, INT_MAX))), "SSL_read");
+}
+
+} // namespace mqttc
+
+// MQTT-C 平台层：按 mqtt_pal.h 的约定，部分成功返回已处理的字节数，暂时不能继续返回 0，
+// 其余错误返回 MQTT_ERROR_SOCKET_ERROR（具体原因留在 Transport::lastError()）
+extern "C" ssize_t mqtt_pal_sendall(mqtt_pal_socket_handle fd, const void *buf, size_t len, int flags)
+{
+    (void)flags;
+    mqttc::Transport *transport = mqttc::FromSocketHandle(fd);
+    size_t sent = 0;
+    while (sent < len) {
+        const ssize_t n = transport->send(static_cast<const char *>(buf) + sent, len - sent);
+        if (n < 0) {
+            return sent > 0 ? static_cast<ssize_t>(sent) : static_cast<ssize_t>(MQTT_ERROR_SOCKET_ERROR);
+        }
+        if (n == 0) {
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(sent);
+}
+
+extern "C" ssize_t mqtt_pal_recvall(mqtt_pal_socket_handle fd, void *buf, size_t bufsz, int flags)
+{
+    (void)flags;
+    mqttc::Transport *transport = mqttc::FromSocketHandle(fd);
+    size_t received = 0;
+    while (received < bufsz) {
+        const ssize_t n = transport->recv(static_cast<char *>(buf) + received, bufsz - received);
+        if (n < 0) {
+            return received > 0 ? static_cast<ssize_t>(received) : static_cast<ssize_t>(MQTT_ERROR_SOCKET_ERROR);
+        }
+        if (n == 0) {
+            break;
+        }
+        received += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(received);
+}
@@ -1,14 +1,26 @@
 #include "mqttc_client.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <cstdlib>
 #include <ctime>
+#include <future>
+#include <memory>
+#include <random>
+#include <utility>
 
 #include <fcntl.h>
 
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -18,14 +30,40 @@ namespace mqttc {
 
 namespace {
 constexpr int kDefaultPort = 1883;
+constexpr int kDefaultTlsPort = 8883;
 constexpr int kKeepAliveSeconds = 600;
-constexpr int kSyncStepMs = 50;
 constexpr int kConnectWaitMs = 5000;
-
-// 发送缓冲区需要能够容纳最大一条 MQTT 报文（含主题、头部和 payload）。
-// 传感器 JSON + Base64 图片的 payload 会明显大于 8KB，这里提升到 64KB。
-constexpr size_t kSendBufSize = 64 * 1024;
+// TLS 连接的等待上限：包含握手，板子上一次完整握手（证书链校验 + 密钥交换）可能要几秒
+constexpr int kTlsConnectWaitMs = 15000;
+constexpr int kDisconnectWaitMs = 2000;
+
+// 请求交给 MQTT-C 后等待 PUBACK/SUBACK 的上限：超时只向调用方报失败，
+// 报文仍留在 MQTT-C 队列里按 response_timeout 重发。
+constexpr int64_t kAckTimeoutMs = 10000;
+// 同时在途的请求数上限（QoS1 可多条并行），其余留在队列里
+constexpr size_t kMaxInFlight = 16;
+
+// 自动重连与待发队列的默认值，可通过 setReconnectPolicy/setOutboundQueuePolicy 调整
+constexpr int kReconnectMinMs = 1000;
+constexpr int kReconnectMaxMs = 60000;
+constexpr size_t kDefaultQueueCapacity = 128;
+constexpr double kDefaultDrainPerSec = 20.0;
+
+// 发送缓冲只存放小报文（订阅、确认、不超过 kStreamThreshold 的发布）；
+// 带 Base64 图片的传感器 JSON 等大报文由 I/O 线程直接写 socket，不经过这里。
+constexpr size_t kSendBufSize = 32 * 1024;
+constexpr size_t kStreamThreshold = 8 * 1024;
+constexpr size_t kStreamChunkBytes = 16 * 1024;  // 单次 send 的字节数
+constexpr size_t kStreamBurstBytes = 256 * 1024; // 每轮最多写这么多就回到 poll，期间照常收包
+// 大报文的 PUBACK/PUBREC 要在 MQTT-C 队列里找到对应 PUBLISH，否则按未知确认断线：
+// 登记一个 2 字节占位报文，time_sent 推到远期使 MQTT-C 永不重发它
+constexpr time_t kPlaceholderHoldSec = 24 * 3600;
+
+// 接收缓冲按需从 8KB 翻倍到上限，大报文处理完后缩回
 constexpr size_t kRecvBufSize = 8 * 1024;
+constexpr size_t kDefaultMaxRecvSize = 256 * 1024;
+// MQTT 剩余长度字段最大可表示的值
+constexpr uint64_t kMaxRemainingLength = 268435455;
 
 static uint8_t PublishFlagsForQos(int qos, bool retain)
 {
@@ -93,6 +131,12 @@ static bool SetNonBlocking(int fd, std::string *errorMsg)
     return true;
 }
 
+static int64_t NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 static std::string IsoTimestampUtc()
 {
     std::time_t now = std::time(nullptr);
@@ -105,13 +149,128 @@ static std::string IsoTimestampUtc()
     return std::string(buf);
 }
 
+// 设备发现 announce 的 JSON 负载：首次发布与自动重连后重发共用
+static bool BuildAnnouncePayload(const std::string &deviceId, const std::string &deviceType,
+                                 std::string &payload, std::string *errorMsg)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (root == nullptr) {
+        if (errorMsg) *errorMsg = "cJSON_CreateObject failed";
+        return false;
+    }
+
+    const std::string ts = IsoTimestampUtc();
+    bool ok = true;
+    ok = ok && (cJSON_AddStringToObject(root, "deviceId", deviceId.c_str()) != nullptr);
+    ok = ok && (cJSON_AddStringToObject(root, "chipId", deviceId.c_str()) != nullptr);
+    ok = ok && (cJSON_AddStringToObject(root, "deviceType", deviceType.c_str()) != nullptr);
+    ok = ok && (cJSON_AddStringToObject(root, "timestamp", ts.c_str()) != nullptr);
+
+    if (!ok) {
+        cJSON_Delete(root);
+        if (errorMsg) *errorMsg = "cJSON add field failed";
+        return false;
+    }
+
+    char *printed = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (printed == nullptr) {
+        if (errorMsg) *errorMsg = "cJSON_PrintUnformatted failed";
+        return false;
+    }
+    payload = printed;
+    cJSON_free(printed);
+    return true;
+}
+
 } // namespace
 
-MqttCClient::MqttCClient() : socketFd_(-1), mqttInitialized_(false)
+std::shared_ptr<const PublishPayload> PublishPayload::FromBuffer(std::string data)
+{
+    std::shared_ptr<PublishPayload> payload(new PublishPayload());
+    payload->buffer_ = std::move(data);
+    payload->data_ = reinterpret_cast<const uint8_t *>(payload->buffer_.data());
+    payload->size_ = payload->buffer_.size();
+    return payload;
+}
+
+std::shared_ptr<const PublishPayload> PublishPayload::FromBytes(const void *data, size_t size)
+{
+    if (data == nullptr || size == 0) {
+        return FromBuffer(std::string());
+    }
+    return FromBuffer(std::string(static_cast<const char *>(data), size));
+}
+
+std::shared_ptr<const PublishPayload> PublishPayload::FromShared(std::shared_ptr<const void> owner,
+                                                                const void *data, size_t size)
+{
+    std::shared_ptr<PublishPayload> payload(new PublishPayload());
+    payload->owner_ = std::move(owner);
+    payload->data_ = static_cast<const uint8_t *>(data);
+    payload->size_ = data != nullptr ? size : 0;
+    return payload;
+}
+
+std::shared_ptr<const PublishPayload> PublishPayload::FromFile(const std::string &path, std::string *errorMsg)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errorMsg) {
+            *errorMsg = "open " + path + " failed" + SocketErrnoSuffix();
+        }
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        if (errorMsg) {
+            *errorMsg = "fstat " + path + " failed" + SocketErrnoSuffix();
+        }
+        ::close(fd);
+        return nullptr;
+    }
+    std::shared_ptr<PublishPayload> payload(new PublishPayload());
+    if (st.st_size > 0) {
+        const size_t len = static_cast<size_t>(st.st_size);
+        void *map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            if (errorMsg) {
+                *errorMsg = "mmap " + path + " failed" + SocketErrnoSuffix();
+            }
+            ::close(fd);
+            return nullptr;
+        }
+        payload->map_ = map;
+        payload->mapLen_ = len;
+        payload->data_ = static_cast<const uint8_t *>(map);
+        payload->size_ = len;
+    }
+    ::close(fd);
+    return payload;
+}
+
+PublishPayload::~PublishPayload()
+{
+    if (map_ != nullptr) {
+        munmap(map_, mapLen_);
+    }
+}
+
+MqttCClient::MqttCClient()
+    : state_(State::IDLE),
+      mqttInitialized_(false),
+      maxRecvSize_(kDefaultMaxRecvSize),
+      reconnectMinMs_(kReconnectMinMs),
+      reconnectMaxMs_(kReconnectMaxMs),
+      backoffMs_(kReconnectMinMs),
+      drainPerSec_(kDefaultDrainPerSec),
+      queueCapacity_(kDefaultQueueCapacity),
+      wakeFd_(-1)
 {
     std::memset(&client_, 0, sizeof(client_));
     sendBuf_.resize(kSendBufSize);
     recvBuf_.resize(kRecvBufSize);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 }
 
 void MqttCClient::publish_callback_thunk(void **state, struct mqtt_response_publish *publish)
@@ -120,26 +279,27 @@ void MqttCClient::publish_callback_thunk(void **state, struct mqtt_response_publ
         return;
     }
     auto *self = static_cast<MqttCClient *>(*state);
-    auto cb = self->msgCb_.load();
-    if (!cb) {
-        return;
-    }
-
-    // MQTT-C: topic_name is a non-null-terminated buffer (const void* + size).
-    std::string topicStr;
-    if (publish->topic_name && publish->topic_name_size > 0) {
-        topicStr.assign(static_cast<const char *>(publish->topic_name),
-                        static_cast<size_t>(publish->topic_name_size));
-    }
-    const char *topic = topicStr.empty() ? "" : topicStr.c_str();
-    const void *data = publish->application_message;
-    const size_t size = publish->application_message_size;
-    cb(self->msgCbCtx_.load(), topic, data, size);
+    // MQTT-C: topic_name is a non-null-terminated buffer (const void* + size)，直接按长度分发，不拷贝
+    self->router_.dispatch(static_cast<const char *>(publish->topic_name),
+                           static_cast<size_t>(publish->topic_name_size),
+                           publish->application_message, publish->application_message_size);
 }
 
 MqttCClient::~MqttCClient()
 {
     disconnect();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake();
+    if (ioThread_.joinable()) {
+        ioThread_.join();
+    }
+    if (wakeFd_ >= 0) {
+        ::close(wakeFd_);
+        wakeFd_ = -1;
+    }
 }
 
 void MqttCClient::configure(const std::string &brokerUrl,
@@ -154,17 +314,40 @@ void MqttCClient::configure(const std::string &brokerUrl,
     password_ = password;
 }
 
-bool MqttCClient::ParseBrokerUrl(const std::string &brokerUrl, std::string &hostOut, int &portOut)
+void MqttCClient::setTlsOptions(const TlsOptions &options)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    tlsOptions_ = options;
+    tlsContext_.reset(); // 当前连接持有旧上下文的引用，不受影响
+}
+
+MqttCClient::TlsStats MqttCClient::getTlsStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tlsStats_;
+}
+
+bool MqttCClient::ParseBrokerUrl(const std::string &brokerUrl, std::string &hostOut, int &portOut, bool &tlsOut)
 {
     std::string url = brokerUrl;
 
     // Accept formats:
-    //  - tcp://host:port
+    //  - tcp://host:port, mqtt://host:port
+    //  - mqtts://host:port, ssl://host:port (TLS)
     //  - host:port
     //  - host
-    const std::string tcpPrefix = "tcp://";
-    if (url.rfind(tcpPrefix, 0) == 0) {
-        url = url.substr(tcpPrefix.size());
+    bool tls = false;
+    static const struct {
+        const char *prefix;
+        bool tls;
+    } kSchemes[] = {{"tcp://", false}, {"mqtt://", false}, {"mqtts://", true}, {"ssl://", true}};
+    for (const auto &scheme : kSchemes) {
+        const std::string prefix = scheme.prefix;
+        if (url.rfind(prefix, 0) == 0) {
+            url = url.substr(prefix.size());
+            tls = scheme.tls;
+            break;
+        }
     }
 
     // Strip any path part (e.g., tcp://host:port/xxx)
@@ -177,8 +360,9 @@ bool MqttCClient::ParseBrokerUrl(const std::string &brokerUrl, std::string &host
         return false;
     }
 
+    const int defaultPort = tls ? kDefaultTlsPort : kDefaultPort;
     std::string host = url;
-    int port = kDefaultPort;
+    int port = defaultPort;
 
     auto colonPos = url.rfind(':');
     if (colonPos != std::string::npos && colonPos + 1 < url.size()) {
@@ -189,7 +373,7 @@ bool MqttCClient::ParseBrokerUrl(const std::string &brokerUrl, std::string &host
         if (endp != nullptr && *endp == '\0' && p > 0 && p <= 65535) {
             port = static_cast<int>(p);
         } else {
-            port = kDefaultPort;
+            port = defaultPort;
         }
     }
 
@@ -199,6 +383,7 @@ bool MqttCClient::ParseBrokerUrl(const std::string &brokerUrl, std::string &host
 
     hostOut = host;
     portOut = port;
+    tlsOut = tls;
     return true;
 }
 
@@ -260,38 +445,7 @@ std::string MqttCClient::getLastError() const
 
 bool MqttCClient::isConnected() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return socketFd_ >= 0 && client_.error == MQTT_OK;
-}
-
-bool MqttCClient::syncForMs(int totalMs, int stepMs, std::string *errorMsg)
-{
-    const int loops = (stepMs > 0) ? (totalMs / stepMs) : 0;
-    for (int i = 0; i < loops; i++) {
-        enum MQTTErrors e = mqtt_sync(&client_);
-        if (e != MQTT_OK) {
-            if (errorMsg) {
-                *errorMsg = "mqtt_sync error: " + MqttErrToString(e);
-                if (e == MQTT_ERROR_SOCKET_ERROR) {
-                    *errorMsg += SocketErrnoSuffix();
-                }
-            }
-            setLastErrorLocked(errorMsg ? *errorMsg : "mqtt_sync error");
-            return false;
-        }
-        if (client_.error != MQTT_OK) {
-            if (errorMsg) {
-                *errorMsg = "mqtt client error: " + MqttErrToString(client_.error);
-                if (client_.error == MQTT_ERROR_SOCKET_ERROR) {
-                    *errorMsg += SocketErrnoSuffix();
-                }
-            }
-            setLastErrorLocked(errorMsg ? *errorMsg : "mqtt client error");
-            return false;
-        }
-        usleep(stepMs * 1000);
-    }
-    return true;
+    return connected_.load();
 }
 
 static bool IsConnectAcked(struct mqtt_client &client)
@@ -304,69 +458,101 @@ static bool IsConnectAcked(struct mqtt_client &client)
     return msg->state == MQTT_QUEUED_COMPLETE;
 }
 
-bool MqttCClient::connect(std::string *errorMsg)
+static bool IsQueuedComplete(struct mqtt_client &client, enum MQTTControlPacketType type, uint16_t packetId)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    struct mqtt_queued_message *msg = mqtt_mq_find(&client.mq, type, &packetId);
+    // 找不到说明已被 mqtt_mq_clean 清理，只有完成的报文才会被清理
+    return msg == NULL || msg->state == MQTT_QUEUED_COMPLETE;
+}
 
-    if (socketFd_ >= 0 && client_.error == MQTT_OK) {
-        return true;
+// MQTT-C 同一时刻只发送一条 QoS2 PUBLISH，其余会停在 UNSENT；这里提前挡住，免得 poll 一直等 POLLOUT
+static bool HasPendingQos2(struct mqtt_client &client)
+{
+    const ssize_t n = mqtt_mq_length(&client.mq);
+    for (ssize_t i = 0; i < n; i++) {
+        const struct mqtt_queued_message *msg = mqtt_mq_get(&client.mq, i);
+        if (msg->control_type == MQTT_CONTROL_PUBLISH && msg->state != MQTT_QUEUED_COMPLETE &&
+            (msg->start[0] & MQTT_PUBLISH_QOS_MASK) == MQTT_PUBLISH_QOS_2) {
+            return true;
+        }
     }
+    return false;
+}
 
-    std::string host;
-    int port = kDefaultPort;
-    if (!ParseBrokerUrl(brokerUrl_, host, port)) {
-        const std::string msg = "invalid brokerUrl: " + brokerUrl_;
-        setLastErrorLocked(msg);
-        if (errorMsg) {
-            *errorMsg = msg;
-        }
-        return false;
+void MqttCClient::wake()
+{
+    if (wakeFd_ < 0) {
+        return;
     }
+    const uint64_t one = 1;
+    (void)::write(wakeFd_, &one, sizeof(one));
+}
 
-    std::string sockErr;
-    int sock = OpenSocket(host, port, &sockErr);
-    if (sock < 0) {
-        const std::string msg = sockErr.empty() ? "open socket failed" : sockErr;
-        setLastErrorLocked(msg);
+void MqttCClient::ensureIoThreadLocked()
+{
+    if (!ioThread_.joinable()) {
+        ioThread_ = std::thread(&MqttCClient::ioLoop, this);
+    }
+}
+
+bool MqttCClient::ensureTlsContextLocked(std::string *errorMsg)
+{
+    if (tlsContext_) {
+        return true;
+    }
+    tlsContext_ = TlsContext::Create(tlsOptions_, errorMsg);
+    return tlsContext_ != nullptr;
+}
+
+bool MqttCClient::startSessionLocked(int sock, const std::string &host, int port, bool tls, std::string *errorMsg)
+{
+    // MQTT-C 的默认 PAL 实现按“非阻塞 socket”设计；若保持阻塞，mqtt_sync() 可能会在 recv() 上卡住很久。
+    // TLS 握手同样要求非阻塞：由 I/O 线程按 poll 结果分步推进
+    std::string nbErr;
+    if (!SetNonBlocking(sock, &nbErr)) {
         if (errorMsg) {
-            *errorMsg = msg;
+            *errorMsg = "set non-blocking failed: " + nbErr;
         }
+        ::close(sock);
         return false;
     }
 
-    socketFd_ = sock;
+    if (tls) {
+        // 握手最后一轮与 CONNECT 是前后两次小写入，开着 Nagle 时 CONNECT 要等对端的延迟 ACK（约 40ms）
+        const int one = 1;
+        (void)setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
 
-    // MQTT-C 的默认 PAL 实现按“非阻塞 socket”设计；若保持阻塞，mqtt_sync() 可能会在 recv() 上卡住很久。
-    std::string nbErr;
-    if (!SetNonBlocking(socketFd_, &nbErr)) {
-        const std::string msg = "set non-blocking failed: " + nbErr;
-        setLastErrorLocked(msg);
+    std::string transportErr;
+    if (tls && !ensureTlsContextLocked(&transportErr)) {
+        ::close(sock);
+    } else {
+        transport_ = Transport::Create(sock, tls ? tlsContext_ : nullptr, host, port, &transportErr);
+    }
+    if (!transport_) {
         if (errorMsg) {
-            *errorMsg = msg;
+            *errorMsg = transportErr;
         }
-        ::close(socketFd_);
-        socketFd_ = -1;
         return false;
     }
 
     if (!mqttInitialized_) {
-        enum MQTTErrors initErr = mqtt_init(&client_, socketFd_,
+        enum MQTTErrors initErr = mqtt_init(&client_, ToSocketHandle(transport_.get()),
             sendBuf_.data(), sendBuf_.size(),
             recvBuf_.data(), recvBuf_.size(),
             publish_callback_thunk);
         if (initErr != MQTT_OK) {
-            const std::string msg = "mqtt_init failed: " + std::to_string(static_cast<int>(initErr));
-            setLastErrorLocked(msg);
             if (errorMsg) {
-                *errorMsg = msg;
+                *errorMsg = "mqtt_init failed: " + std::to_string(static_cast<int>(initErr));
             }
-            ::close(socketFd_);
-            socketFd_ = -1;
+            transport_.reset();
             return false;
         }
         mqttInitialized_ = true;
     } else {
-        mqtt_reinit(&client_, socketFd_,
+        // mqtt_reinit 按 MQTT-C 重连回调的约定要求已持有 client 互斥量，mqtt_connect 会释放它
+        MQTT_PAL_MUTEX_LOCK(&client_.mutex);
+        mqtt_reinit(&client_, ToSocketHandle(transport_.get()),
             sendBuf_.data(), sendBuf_.size(),
             recvBuf_.data(), recvBuf_.size());
     }
@@ -385,72 +571,89 @@ bool MqttCClient::connect(std::string *errorMsg)
         kKeepAliveSeconds);
 
     if (connErr != MQTT_OK) {
-        const std::string msg = "mqtt_connect failed: " + MqttErrToString(connErr);
-        setLastErrorLocked(msg);
         if (errorMsg) {
-            *errorMsg = msg;
+            *errorMsg = "mqtt_connect failed: " + MqttErrToString(connErr);
         }
-        ::close(socketFd_);
-        socketFd_ = -1;
+        transport_.reset();
         return false;
     }
 
-    // 等待 broker 的 CONNACK（带超时）。
-    const int loops = kConnectWaitMs / kSyncStepMs;
-    for (int i = 0; i < loops; i++) {
-        std::string syncErr;
-        if (!syncForMs(kSyncStepMs, kSyncStepMs, &syncErr)) {
-            if (errorMsg) {
-                *errorMsg = syncErr;
-            }
-            ::close(socketFd_);
-            socketFd_ = -1;
-            return false;
-        }
-        if (IsConnectAcked(client_)) {
-            break;
-        }
+    // 之后连接归 I/O 线程：由它完成 TLS 握手、发出 CONNECT、等待 CONNACK（超时由它判定），失败时关闭连接
+    state_ = State::CONNECTING;
+    connectDeadlineMs_ = NowMs() + (tls ? kTlsConnectWaitMs : kConnectWaitMs);
+    ensureIoThreadLocked();
+    wake();
+    return true;
+}
+
+bool MqttCClient::connect(std::string *errorMsg)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // 其他线程的 connect/disconnect 或自动重连尚未结束时先等它完成
+    stateCv_.wait_for(lock, std::chrono::milliseconds(kConnectWaitMs),
+                      [this] { return (state_ == State::IDLE && !opening_) || state_ == State::CONNECTED; });
+    if (state_ == State::CONNECTED) {
+        return true;
     }
-    if (!IsConnectAcked(client_)) {
-        const std::string msg = "CONNACK timeout (" + std::to_string(kConnectWaitMs) + "ms)";
+    if (state_ != State::IDLE || opening_ || wakeFd_ < 0) {
+        const std::string msg = wakeFd_ < 0 ? "eventfd unavailable" : "connect busy";
         setLastErrorLocked(msg);
         if (errorMsg) {
             *errorMsg = msg;
         }
-        ::close(socketFd_);
-        socketFd_ = -1;
         return false;
     }
 
-    setLastErrorLocked("");
-    return socketFd_ >= 0 && client_.error == MQTT_OK;
-}
-
-void MqttCClient::setMessageCallback(MessageCallback cb, void *ctx)
-{
-    msgCb_.store(cb);
-    msgCbCtx_.store(ctx);
-}
-
-bool MqttCClient::subscribe(const std::string &topic, int qos, std::string *errorMsg)
-{
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    if (socketFd_ < 0 || client_.error != MQTT_OK) {
-        const std::string msg = "not connected";
+    std::string host;
+    int port = kDefaultPort;
+    bool tls = false;
+    if (!ParseBrokerUrl(brokerUrl_, host, port, tls)) {
+        const std::string msg = "invalid brokerUrl: " + brokerUrl_;
         setLastErrorLocked(msg);
         if (errorMsg) {
             *errorMsg = msg;
         }
         return false;
     }
+    // 证书配置有误时不必先连 TCP
+    std::string tlsErr;
+    if (tls && !ensureTlsContextLocked(&tlsErr)) {
+        setLastErrorLocked(tlsErr);
+        if (errorMsg) {
+            *errorMsg = tlsErr;
+        }
+        return false;
+    }
 
-    if (qos < 0) qos = 0;
-    if (qos > 2) qos = 2;
+    // DNS 与 TCP 握手可能阻塞较久，期间不持锁：I/O 线程、发布方与 disconnect() 不受影响
+    opening_ = true;
+    openCancelled_ = false;
+    lock.unlock();
+    std::string sockErr;
+    int sock = OpenSocket(host, port, &sockErr);
+    lock.lock();
+    opening_ = false;
+    stateCv_.notify_all();
 
-    enum MQTTErrors subErr = mqtt_subscribe(&client_, topic.c_str(), static_cast<uint8_t>(qos));
-    if (subErr != MQTT_OK) {
-        const std::string msg = "mqtt_subscribe failed: " + std::to_string(static_cast<int>(subErr));
+    if (openCancelled_ || stopping_) {
+        if (sock >= 0) {
+            ::close(sock);
+        }
+        const std::string msg = "connect cancelled";
+        setLastErrorLocked(msg);
+        if (errorMsg) {
+            *errorMsg = msg;
+        }
+        return false;
+    }
+    if (state_ != State::IDLE) {
+        // 期间自动重连已建立了连接：不再另起一条，等它的结果
+        if (sock >= 0) {
+            ::close(sock);
+        }
+    } else if (sock < 0) {
+        const std::string msg = sockErr.empty() ? "open socket failed" : sockErr;
         setLastErrorLocked(msg);
         if (errorMsg) {
             *errorMsg = msg;
@@ -458,63 +661,245 @@ bool MqttCClient::subscribe(const std::string &topic, int qos, std::string *erro
         return false;
     }
 
-    std::string syncErr;
-    if (!syncForMs(500, kSyncStepMs, &syncErr)) {
+    std::string sessionErr;
+    if (state_ == State::IDLE && !startSessionLocked(sock, host, port, tls, &sessionErr)) {
+        setLastErrorLocked(sessionErr);
         if (errorMsg) {
-            *errorMsg = syncErr;
+            *errorMsg = sessionErr;
         }
         return false;
     }
 
-    setLastErrorLocked("");
-    return true;
+    // 握手与 CONNACK 超时由 I/O 线程按 connectDeadlineMs_ 判定，这里多等一点只是兜底
+    stateCv_.wait_for(lock, std::chrono::milliseconds((tls ? kTlsConnectWaitMs : kConnectWaitMs) + 1000),
+                      [this] { return state_ != State::CONNECTING; });
+    if (state_ == State::CONNECTED) {
+        setLastErrorLocked("");
+        return true;
+    }
+
+    const std::string msg = (state_ == State::CONNECTING || lastError_.empty()) ? "connect failed" : lastError_;
+    if (errorMsg) {
+        *errorMsg = msg;
+    }
+    return false;
 }
 
-bool MqttCClient::syncOnce(std::string *errorMsg)
+HandlerId MqttCClient::addMessageHandler(const std::string &filter, MessageHandler handler, HandlerExecutor executor)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return router_.add(filter, std::move(handler), executor);
+}
 
-    if (socketFd_ < 0) {
-        const std::string msg = "not connected";
-        setLastErrorLocked(msg);
-        if (errorMsg) {
-            *errorMsg = msg;
+void MqttCClient::removeMessageHandler(HandlerId id)
+{
+    std::string filter;
+    bool last = false;
+    if (!router_.remove(id, &filter, &last) || !last) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (subscriptions_.find(filter) == subscriptions_.end()) {
+            return;
         }
-        return false;
     }
+    unsubscribeAsync(filter, nullptr);
+}
+
+void MqttCClient::setReconnectPolicy(bool enabled, int minDelayMs, int maxDelayMs)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reconnectMinMs_ = std::max(minDelayMs, 100);
+        reconnectMaxMs_ = std::max(maxDelayMs, reconnectMinMs_);
+        backoffMs_ = std::min(std::max(backoffMs_, reconnectMinMs_), reconnectMaxMs_);
+        autoReconnect_.store(enabled);
+    }
+    wake();
+}
+
+void MqttCClient::setOutboundQueuePolicy(size_t capacity, DropPolicy policy, double drainPerSec)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drainPerSec_ = drainPerSec > 0 ? drainPerSec : 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        queueCapacity_ = std::max<size_t>(capacity, 1);
+        dropPolicy_ = policy;
+    }
+    wake();
+}
+
+void MqttCClient::setMaxReceiveSize(size_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxRecvSize_ = std::max(maxBytes, kRecvBufSize);
+}
+
+MqttCClient::QueueStats MqttCClient::getQueueStats() const
+{
+    QueueStats stats;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.inFlight = inFlight_.size();
+    stats.reconnects = reconnects_;
+    std::lock_guard<std::mutex> queueLock(queueMutex_);
+    stats.queued = queue_.size();
+    stats.dropped = dropped_;
+    return stats;
+}
+
+void MqttCClient::disconnect()
+{
+    // 主动断开：停止自动重连，积压请求以失败完成，订阅与 announce 不再恢复
+    wantConnected_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        subscriptions_.clear();
+        announce_ = Announce();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (state_ == State::IDLE) {
+        openCancelled_ = opening_;
+        wake();
+        return;
+    }
+
+    if (state_ == State::CONNECTED) {
+        (void)mqtt_disconnect(&client_);
+    }
+    state_ = State::CLOSING;
+    connected_.store(false);
+    wake();
+
+    // 在 I/O 线程里（消息回调中）调用时等不到，超时后由 I/O 线程回到循环时关闭
+    stateCv_.wait_for(lock, std::chrono::milliseconds(kDisconnectWaitMs),
+                      [this] { return state_ == State::IDLE; });
+}
 
-    enum MQTTErrors e = mqtt_sync(&client_);
-    if (e != MQTT_OK || client_.error != MQTT_OK) {
-        std::string msg = "mqtt_sync error: " + MqttErrToString(e) +
-            ", client=" + MqttErrToString(client_.error);
-        if (e == MQTT_ERROR_SOCKET_ERROR || client_.error == MQTT_ERROR_SOCKET_ERROR) {
-            msg += SocketErrnoSuffix();
+bool MqttCClient::enqueue(Request &&req, std::string *errorMsg)
+{
+    std::string msg;
+    const bool connected = connected_.load();
+    if (!connected && !(wantConnected_.load() && autoReconnect_.load())) {
+        msg = "not connected";
+    } else {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        req.backlog = !connected;
+        if (queue_.size() >= queueCapacity_) {
+            dropped_++;
+            if (dropPolicy_ == DropPolicy::DROP_NEWEST) {
+                msg = "outbound queue full (" + std::to_string(queueCapacity_) + ")";
+            } else {
+                // 挤掉最早的发布；订阅请求保留，否则重连后收不到控制命令
+                while (queue_.size() >= queueCapacity_) {
+                    auto victim = std::find_if(queue_.begin(), queue_.end(),
+                                               [](const Request &r) { return !r.subscribe; });
+                    if (victim == queue_.end()) {
+                        break;
+                    }
+                    droppedDone_.push_back({std::move(victim->done), false, "dropped: outbound queue full"});
+                    queue_.erase(victim);
+                }
+            }
         }
-        setLastErrorLocked(msg);
+        if (msg.empty()) {
+            queue_.push_back(std::move(req));
+        }
+    }
+    if (!msg.empty()) {
         if (errorMsg) {
             *errorMsg = msg;
         }
         return false;
     }
-
+    wake();
     return true;
 }
 
-void MqttCClient::disconnect()
+bool MqttCClient::publishAsync(const std::string &topic,
+                               const void *data,
+                               size_t size,
+                               int qos,
+                               bool retain,
+                               CompletionCallback done,
+                               std::string *errorMsg)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return publishAsync(topic, PublishPayload::FromBytes(data, size), qos, retain, std::move(done), errorMsg);
+}
 
-    if (socketFd_ < 0) {
-        return;
+bool MqttCClient::publishAsync(const std::string &topic,
+                               std::shared_ptr<const PublishPayload> payload,
+                               int qos,
+                               bool retain,
+                               CompletionCallback done,
+                               std::string *errorMsg)
+{
+    Request req;
+    req.topic = topic;
+    req.payload = payload ? std::move(payload) : PublishPayload::FromBuffer(std::string());
+    req.qos = std::min(std::max(qos, 0), 2);
+    req.retain = retain;
+    req.done = std::move(done);
+    return enqueue(std::move(req), errorMsg);
+}
+
+bool MqttCClient::subscribeAsync(const std::string &topic, int qos, CompletionCallback done, std::string *errorMsg)
+{
+    Request req;
+    req.subscribe = true;
+    req.topic = topic;
+    req.qos = std::min(std::max(qos, 0), 2);
+    req.done = std::move(done);
+    if (!enqueue(std::move(req), errorMsg)) {
+        return false;
     }
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    subscriptions_[topic] = std::min(std::max(qos, 0), 2);
+    return true;
+}
 
-    (void)mqtt_disconnect(&client_);
-    (void)mqtt_sync(&client_);
+bool MqttCClient::unsubscribeAsync(const std::string &topic, CompletionCallback done, std::string *errorMsg)
+{
+    {
+        // 先删记录：即使未连接也不再在重连后订阅
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        subscriptions_.erase(topic);
+    }
+    Request req;
+    req.subscribe = true;
+    req.unsubscribe = true;
+    req.topic = topic;
+    req.done = std::move(done);
+    return enqueue(std::move(req), errorMsg);
+}
 
-    ::close(socketFd_);
-    socketFd_ = -1;
+namespace {
+
+using SyncResult = std::pair<bool, std::string>;
+
+// 同步接口共用：完成回调总会在 kAckTimeoutMs 内到来，这里多等一段只是兜底。
+// 断线积压期间可能等到兜底超时，此时请求仍在队列里，之后的结果不再通知调用方。
+bool WaitCompletion(std::future<SyncResult> &future, std::string *errorMsg)
+{
+    if (future.wait_for(std::chrono::milliseconds(kAckTimeoutMs + kConnectWaitMs)) != std::future_status::ready) {
+        if (errorMsg) {
+            *errorMsg = "completion timeout";
+        }
+        return false;
+    }
+    const SyncResult result = future.get();
+    if (!result.first && errorMsg) {
+        *errorMsg = result.second;
+    }
+    return result.first;
 }
 
+} // namespace
+
 bool MqttCClient::publish(const std::string &topic,
                           const void *data,
                           size_t size,
@@ -522,92 +907,672 @@ bool MqttCClient::publish(const std::string &topic,
                           bool retain,
                           std::string *errorMsg)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    auto promise = std::make_shared<std::promise<SyncResult>>();
+    std::future<SyncResult> future = promise->get_future();
+    if (!publishAsync(topic, data, size, qos, retain,
+                      [promise](bool ok, const std::string &error) { promise->set_value(SyncResult(ok, error)); },
+                      errorMsg)) {
+        return false;
+    }
+    return WaitCompletion(future, errorMsg);
+}
 
-    if (socketFd_ < 0 || client_.error != MQTT_OK) {
-        const std::string msg = "not connected";
-        setLastErrorLocked(msg);
-        if (errorMsg) {
-            *errorMsg = msg;
-        }
+bool MqttCClient::subscribe(const std::string &topic, int qos, std::string *errorMsg)
+{
+    auto promise = std::make_shared<std::promise<SyncResult>>();
+    std::future<SyncResult> future = promise->get_future();
+    if (!subscribeAsync(topic, qos,
+                        [promise](bool ok, const std::string &error) { promise->set_value(SyncResult(ok, error)); },
+                        errorMsg)) {
         return false;
     }
+    return WaitCompletion(future, errorMsg);
+}
 
-    uint8_t flags = PublishFlagsForQos(qos, retain);
-    enum MQTTErrors pubErr = mqtt_publish(&client_, topic.c_str(), data, size, flags);
+void MqttCClient::ioLoop()
+{
+    std::vector<Completion> completions;
+    for (;;) {
+        struct pollfd fds[2];
+        nfds_t nfds = 1;
+        int timeoutMs = -1;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stopping_) {
+                if (state_ != State::IDLE) {
+                    closeLocked("client destroyed", completions);
+                }
+                failQueued("client destroyed", completions);
+                break;
+            }
+            if (state_ == State::IDLE && !opening_ && wantConnected_.load() && autoReconnect_.load() &&
+                NowMs() >= nextReconnectMs_) {
+                reconnectLocked(lock);
+            }
+            pumpLocked(completions);
+
+            fds[0].fd = wakeFd_;
+            fds[0].events = POLLIN;
+            fds[0].revents = 0;
+            if (state_ != State::IDLE && transport_) {
+                // TLS 握手期间只等握手需要的方向；之后有待发报文时等可写
+                const bool wantWrite = transport_->wantsWrite() || (transport_->handshakeDone() && hasUnsentLocked());
+                fds[1].fd = transport_->fd();
+                fds[1].events = static_cast<short>(POLLIN | (wantWrite ? POLLOUT : 0));
+                fds[1].revents = 0;
+                nfds = 2;
+            }
+            timeoutMs = nextTimeoutMsLocked();
+            if (transport_ && transport_->hasBufferedInput()) {
+                timeoutMs = 0; // TLS 层已解密、还没读走的数据不会再让 socket 变为可读
+            }
+        }
 
-    if (pubErr != MQTT_OK) {
-        const std::string msg = "mqtt_publish failed: " + std::to_string(static_cast<int>(pubErr));
-        setLastErrorLocked(msg);
-        if (errorMsg) {
-            *errorMsg = msg;
+        // 回调在锁外执行，回调里可以再次 publishAsync
+        for (Completion &c : completions) {
+            if (c.done) {
+                c.done(c.ok, c.error);
+            }
+        }
+        completions.clear();
+
+        if (poll(fds, nfds, timeoutMs) > 0 && (fds[0].revents & POLLIN) != 0) {
+            uint64_t count = 0;
+            (void)::read(wakeFd_, &count, sizeof(count));
+        }
+    }
+
+    for (Completion &c : completions) {
+        if (c.done) {
+            c.done(c.ok, c.error);
+        }
+    }
+}
+
+void MqttCClient::reconnectLocked(std::unique_lock<std::mutex> &lock)
+{
+    std::string host;
+    int port = kDefaultPort;
+    bool tls = false;
+    if (!ParseBrokerUrl(brokerUrl_, host, port, tls)) {
+        setLastErrorLocked("invalid brokerUrl: " + brokerUrl_);
+        scheduleReconnectLocked();
+        return;
+    }
+    std::string tlsErr;
+    if (tls && !ensureTlsContextLocked(&tlsErr)) {
+        setLastErrorLocked("reconnect failed: " + tlsErr);
+        scheduleReconnectLocked();
+        return;
+    }
+
+    // DNS 与 TCP 握手可能阻塞较久，期间不持锁：connect()/disconnect()/getLastError() 不受影响
+    lock.unlock();
+    std::string err;
+    const int sock = OpenSocket(host, port, &err);
+    lock.lock();
+
+    if (stopping_ || state_ != State::IDLE || opening_ || !wantConnected_.load() || !autoReconnect_.load()) {
+        if (sock >= 0) {
+            ::close(sock);
+        }
+        return;
+    }
+    if (sock < 0 || !startSessionLocked(sock, host, port, tls, &err)) {
+        setLastErrorLocked("reconnect failed: " + (err.empty() ? std::string("open socket failed") : err));
+        scheduleReconnectLocked();
+        return;
+    }
+    reconnecting_ = true;
+}
+
+void MqttCClient::scheduleReconnectLocked()
+{
+    // 抖动指数退避：等待 [d/2, d]，d 每次失败翻倍；多台设备同时掉线时不会同一时刻涌向 broker
+    static thread_local std::minstd_rand rng(static_cast<uint32_t>(NowMs()));
+    const int half = backoffMs_ / 2;
+    const int delay = half + static_cast<int>(rng() % static_cast<uint32_t>(backoffMs_ - half + 1));
+    nextReconnectMs_ = NowMs() + delay;
+    backoffMs_ = std::min(backoffMs_ * 2, reconnectMaxMs_);
+}
+
+void MqttCClient::onConnectedLocked()
+{
+    state_ = State::CONNECTED;
+    connected_.store(true);
+    wantConnected_.store(true);
+    backoffMs_ = reconnectMinMs_;
+    nextDrainMs_ = NowMs();
+
+    // clean session：broker 不保留订阅，先于积压请求重新订阅；自动重连时再补发 announce
+    std::string announcePayload;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (reconnecting_ && !announce_.topicPrefix.empty()) {
+            std::string err;
+            if (BuildAnnouncePayload(announce_.deviceId, announce_.deviceType, announcePayload, &err)) {
+                Request req;
+                req.topic = announce_.topicPrefix + "/announce";
+                req.payload = PublishPayload::FromBuffer(std::move(announcePayload));
+                req.qos = 1;
+                req.retain = true;
+                queue_.push_front(std::move(req));
+            }
+        }
+        for (auto it = subscriptions_.rbegin(); it != subscriptions_.rend(); ++it) {
+            Request req;
+            req.subscribe = true;
+            req.topic = it->first;
+            req.qos = it->second;
+            queue_.push_front(std::move(req));
+        }
+    }
+    if (reconnecting_) {
+        reconnecting_ = false;
+        reconnects_++;
+    }
+    stateCv_.notify_all();
+}
+
+void MqttCClient::pumpLocked(std::vector<Completion> &completions)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        for (Completion &c : droppedDone_) {
+            completions.push_back(std::move(c));
+        }
+        droppedDone_.clear();
+    }
+
+    if (state_ == State::IDLE) {
+        if (!(wantConnected_.load() && autoReconnect_.load())) {
+            failQueued("not connected", completions);
+        }
+        return;
+    }
+    if (state_ == State::CLOSING) {
+        if (!stream_.active) {
+            (void)syncLocked(); // 尽量把 DISCONNECT 发出去；大报文写到一半时不能再插入报文
+        }
+        closeLocked("disconnected", completions);
+        return;
+    }
+
+    if (state_ == State::CONNECTING && !transport_->handshakeDone()) {
+        // TLS 握手未完成：CONNECT 还在 MQTT-C 队列里，握手完成后由下面的 mqtt_sync 发出
+        if (!handshakeLocked()) {
+            closeLocked(lastError_, completions);
+            return;
+        }
+        if (!transport_->handshakeDone()) {
+            if (NowMs() >= connectDeadlineMs_) {
+                setLastErrorLocked("TLS handshake timeout (" + std::to_string(kTlsConnectWaitMs) + "ms)");
+                closeLocked(lastError_, completions);
+            }
+            return;
+        }
+    }
+    if (!syncLocked()) {
+        closeLocked(lastError_, completions);
+        return;
+    }
+    if (state_ == State::CONNECTING) {
+        if (!IsConnectAcked(client_)) {
+            if (NowMs() >= connectDeadlineMs_) {
+                setLastErrorLocked("CONNACK timeout (" +
+                                   std::to_string(transport_->isTls() ? kTlsConnectWaitMs : kConnectWaitMs) + "ms)");
+                closeLocked(lastError_, completions);
+            }
+            return;
+        }
+        onConnectedLocked();
+    }
+
+    resolveInFlightLocked(completions);
+    if (stream_.active && !writeStreamLocked()) {
+        closeLocked(lastError_, completions);
+        return;
+    }
+    // 新报文立即写出；QoS0 写出即完成。前面的报文写完后，等在队首的大报文可以接着开始
+    while (submitQueuedLocked(completions)) {
+        if (!syncLocked() || (stream_.active && !writeStreamLocked())) {
+            closeLocked(lastError_, completions);
+            return;
+        }
+        resolveInFlightLocked(completions);
+    }
+}
+
+bool MqttCClient::handshakeLocked()
+{
+    std::string err;
+    const Transport::Handshake result = transport_->handshake(&err);
+    if (result == Transport::Handshake::FAILED) {
+        setLastErrorLocked(err);
+        return false;
+    }
+    if (result == Transport::Handshake::DONE) {
+        tlsStats_.handshakes++;
+        tlsStats_.lastResumed = transport_->sessionReused();
+        tlsStats_.lastHandshakeMs = transport_->handshakeMs();
+        if (tlsStats_.lastResumed) {
+            tlsStats_.resumed++;
+        }
+    }
+    return true;
+}
+
+bool MqttCClient::syncLocked()
+{
+    enum MQTTErrors e;
+    for (;;) {
+        // 大报文写到一半时只收不发：MQTT-C 的报文不能插进正在写出的 PUBLISH 中间
+        e = stream_.active ? static_cast<enum MQTTErrors>(__mqtt_recv(&client_)) : mqtt_sync(&client_);
+        // 入站报文大于接收缓冲：扩大缓冲（已收到的部分保留）后继续收
+        if (client_.error == MQTT_ERROR_RECV_BUFFER_TOO_SMALL && growRecvBufferLocked()) {
+            client_.error = MQTT_OK;
+            continue;
+        }
+        break;
+    }
+    // 发送缓冲满是暂时状态（等在途报文完成后清理），MQTT-C 会把它记成粘滞错误，这里复位
+    if (client_.error == MQTT_ERROR_SEND_BUFFER_IS_FULL) {
+        client_.error = MQTT_OK;
+    }
+    if (e == MQTT_ERROR_SEND_BUFFER_IS_FULL) {
+        e = MQTT_OK;
+    }
+    if (e == MQTT_OK && client_.error == MQTT_OK) {
+        // 大报文处理完、缓冲已空时缩回初始大小
+        if (recvBuf_.size() > kRecvBufSize && client_.recv_buffer.curr == client_.recv_buffer.mem_start) {
+            resizeRecvBufferLocked(kRecvBufSize);
         }
+        return true;
+    }
+
+    std::string msg = "mqtt_sync error: " + MqttErrToString(e) +
+        ", client=" + MqttErrToString(client_.error);
+    if (e == MQTT_ERROR_SOCKET_ERROR || client_.error == MQTT_ERROR_SOCKET_ERROR) {
+        msg += transport_ && !transport_->lastError().empty() ? ", " + transport_->lastError() : SocketErrnoSuffix();
+    }
+    if (client_.error == MQTT_ERROR_RECV_BUFFER_TOO_SMALL) {
+        msg += ", inbound message exceeds " + std::to_string(maxRecvSize_) + " bytes";
+    }
+    setLastErrorLocked(msg);
+    return false;
+}
+
+bool MqttCClient::growRecvBufferLocked()
+{
+    if (recvBuf_.size() >= maxRecvSize_) {
         return false;
     }
+    resizeRecvBufferLocked(std::min(recvBuf_.size() * 2, maxRecvSize_));
+    return true;
+}
 
-    std::string syncErr;
-    if (!syncForMs(500, kSyncStepMs, &syncErr)) {
+void MqttCClient::resizeRecvBufferLocked(size_t size)
+{
+    const size_t used = static_cast<size_t>(client_.recv_buffer.curr - client_.recv_buffer.mem_start);
+    std::vector<uint8_t> buf(size);
+    if (used > 0) {
+        std::memcpy(buf.data(), recvBuf_.data(), used);
+    }
+    recvBuf_.swap(buf);
+    client_.recv_buffer.mem_start = recvBuf_.data();
+    client_.recv_buffer.mem_size = recvBuf_.size();
+    client_.recv_buffer.curr = recvBuf_.data() + used;
+    client_.recv_buffer.curr_sz = recvBuf_.size() - used;
+}
+
+bool MqttCClient::startStreamLocked(Request &req, InFlight &f, std::string *errorMsg)
+{
+    const size_t payloadSize = req.payload->size();
+    const uint64_t remaining = 2 + req.topic.size() + (req.qos > 0 ? 2 : 0) + static_cast<uint64_t>(payloadSize);
+    if (req.topic.size() > 0xFFFF || remaining > kMaxRemainingLength) {
         if (errorMsg) {
-            *errorMsg = syncErr;
+            *errorMsg = "message exceeds MQTT packet limit (" + std::to_string(payloadSize) + " bytes)";
         }
         return false;
     }
 
-    setLastErrorLocked("");
+    const uint8_t byte0 = static_cast<uint8_t>((MQTT_CONTROL_PUBLISH << 4) | PublishFlagsForQos(req.qos, req.retain));
+    uint16_t packetId = 0;
+    if (req.qos > 0) {
+        packetId = __mqtt_next_pid(&client_);
+        uint8_t *placeholder = client_.mq.curr;
+        // 首字节与真实 PUBLISH 一致（QoS 位供 HasPendingQos2 判断），剩余长度 0，从不发出
+        placeholder[0] = byte0;
+        placeholder[1] = 0;
+        struct mqtt_queued_message *msg = mqtt_mq_register(&client_.mq, 2);
+        msg->control_type = MQTT_CONTROL_PUBLISH;
+        msg->packet_id = packetId;
+        msg->state = MQTT_QUEUED_AWAITING_ACK;
+        msg->time_sent = MQTT_PAL_TIME() + kPlaceholderHoldSec;
+    }
+
+    std::vector<uint8_t> &h = stream_.header;
+    h.clear();
+    h.push_back(byte0);
+    uint64_t rest = remaining;
+    do {
+        uint8_t b = static_cast<uint8_t>(rest % 128);
+        rest /= 128;
+        h.push_back(rest > 0 ? static_cast<uint8_t>(b | 0x80) : b);
+    } while (rest > 0);
+    h.push_back(static_cast<uint8_t>(req.topic.size() >> 8));
+    h.push_back(static_cast<uint8_t>(req.topic.size() & 0xFF));
+    h.insert(h.end(), req.topic.begin(), req.topic.end());
+    if (req.qos > 0) {
+        h.push_back(static_cast<uint8_t>(packetId >> 8));
+        h.push_back(static_cast<uint8_t>(packetId & 0xFF));
+    }
+    stream_.payload = req.payload;
+    stream_.offset = 0;
+    stream_.active = true;
+
+    f.packetId = packetId;
+    f.streamed = true;
+    f.streaming = true;
     return true;
 }
 
-bool MqttCClient::publishDiscoveryAnnounceRetained(const std::string &topicPrefix,
-                                                   const std::string &deviceId,
-                                                   const std::string &deviceType,
-                                                   std::string *errorMsg)
+bool MqttCClient::writeStreamLocked()
 {
-    if (topicPrefix.empty() || deviceId.empty() || deviceType.empty()) {
-        const std::string msg = "invalid args for publishDiscoveryAnnounceRetained";
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            setLastErrorLocked(msg);
+    const size_t headerSize = stream_.header.size();
+    const size_t total = headerSize + stream_.payload->size();
+    size_t budget = kStreamBurstBytes;
+    while (stream_.offset < total && budget > 0) {
+        const uint8_t *p;
+        size_t n;
+        if (stream_.offset < headerSize) {
+            p = stream_.header.data() + stream_.offset;
+            n = headerSize - stream_.offset;
+        } else {
+            p = stream_.payload->data() + (stream_.offset - headerSize);
+            n = total - stream_.offset;
         }
-        if (errorMsg) *errorMsg = msg;
-        return false;
+        n = std::min(std::min(n, kStreamChunkBytes), budget);
+        // TLS 连接时一次写出一个记录；未写出的部分下次从同一位置重试
+        const ssize_t sent = transport_->send(p, n);
+        if (sent < 0) {
+            setLastErrorLocked("stream publish send failed: " + transport_->lastError());
+            return false;
+        }
+        if (sent == 0) {
+            break; // 等 POLLOUT
+        }
+        stream_.offset += static_cast<size_t>(sent);
+        budget -= static_cast<size_t>(sent);
+        client_.time_of_last_send = MQTT_PAL_TIME();
+    }
+    if (stream_.offset < total) {
+        return true;
     }
 
-    // const std::string discoveryTopic = topicPrefix + "/announce/" + deviceId;
-    const std::string discoveryTopic = topicPrefix + "/announce";
-    const std::string ts = IsoTimestampUtc();
+    // 写完：释放负载引用，从此刻开始计确认超时
+    stream_.active = false;
+    stream_.payload.reset();
+    for (InFlight &f : inFlight_) {
+        if (f.streaming) {
+            f.streaming = false;
+            f.deadlineMs = NowMs() + kAckTimeoutMs;
+        }
+    }
+    return true;
+}
 
-    cJSON *root = cJSON_CreateObject();
-    if (root == nullptr) {
-        const std::string msg = "cJSON_CreateObject failed";
+bool MqttCClient::submitQueuedLocked(std::vector<Completion> &completions)
+{
+    bool submitted = false;
+    while (state_ == State::CONNECTED && inFlight_.size() < kMaxInFlight) {
+        Request req;
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            setLastErrorLocked(msg);
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            if (queue_.empty()) {
+                break;
+            }
+            const Request &front = queue_.front();
+            // 积压请求按补发速率发出，后面的请求按序排在它们之后
+            if (front.backlog && drainPerSec_ > 0 && NowMs() < nextDrainMs_) {
+                break;
+            }
+            // QoS2 按顺序排队等前一条完成，不越过它发送后面的报文
+            if (!front.subscribe && front.qos == 2 && HasPendingQos2(client_)) {
+                break;
+            }
+            req = std::move(queue_.front());
+            queue_.pop_front();
         }
-        if (errorMsg) *errorMsg = msg;
-        return false;
+
+        // 报文长度上限：固定头 5 + 主题长度 2 + 主题 + 报文标识 2 + 负载（订阅再加 1 字节 QoS）
+        const size_t payloadSize = req.payload ? req.payload->size() : 0;
+        const size_t packetSize = 10 + req.topic.size() + payloadSize;
+        const bool stream = !req.subscribe && packetSize > kStreamThreshold;
+        if (stream) {
+            // 大报文直接写 socket：等上一条写完、MQTT-C 已排队的报文全部发出后再开始，保持顺序
+            mqtt_mq_clean(&client_.mq);
+            if (hasUnsentLocked() || static_cast<size_t>(mqtt_mq_currsz(&client_.mq)) < 2) {
+                std::lock_guard<std::mutex> lock(queueMutex_);
+                queue_.push_front(std::move(req));
+                break;
+            }
+            InFlight f;
+            std::string err;
+            if (!startStreamLocked(req, f, &err)) {
+                completions.push_back({std::move(req.done), false, err});
+                continue;
+            }
+            if (req.backlog && drainPerSec_ > 0) {
+                nextDrainMs_ = std::max(nextDrainMs_, NowMs()) + static_cast<int64_t>(1000.0 / drainPerSec_);
+            }
+            f.deadlineMs = INT64_MAX;
+            f.req = std::move(req);
+            inFlight_.push_back(std::move(f));
+            submitted = true;
+            continue;
+        }
+        if (packetSize + 2 * sizeof(struct mqtt_queued_message) > sendBuf_.size()) {
+            completions.push_back({std::move(req.done), false,
+                                   "message too large for send buffer (" + std::to_string(packetSize) + " bytes)"});
+            continue;
+        }
+        mqtt_mq_clean(&client_.mq);
+        if (static_cast<size_t>(mqtt_mq_currsz(&client_.mq)) < packetSize) {
+            // 发送缓冲被在途报文占满：等它们完成后再交
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            queue_.push_front(std::move(req));
+            break;
+        }
+
+        enum MQTTErrors err;
+        if (req.unsubscribe) {
+            err = mqtt_unsubscribe(&client_, req.topic.c_str());
+        } else if (req.subscribe) {
+            err = mqtt_subscribe(&client_, req.topic.c_str(), req.qos);
+        } else {
+            err = mqtt_publish(&client_, req.topic.c_str(), req.payload->data(), payloadSize,
+                               PublishFlagsForQos(req.qos, req.retain));
+        }
+        if (err == MQTT_ERROR_SEND_BUFFER_IS_FULL) {
+            client_.error = MQTT_OK;
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            queue_.push_front(std::move(req));
+            break;
+        }
+        if (err != MQTT_OK) {
+            // 其他错误会记到 client_.error，下一次 mqtt_sync 时关闭连接
+            completions.push_back({std::move(req.done), false,
+                                   std::string(req.unsubscribe ? "mqtt_unsubscribe"
+                                               : req.subscribe ? "mqtt_subscribe" : "mqtt_publish") +
+                                       " failed: " + MqttErrToString(err)});
+            break;
+        }
+        if (req.backlog && drainPerSec_ > 0) {
+            nextDrainMs_ = std::max(nextDrainMs_, NowMs()) + static_cast<int64_t>(1000.0 / drainPerSec_);
+        }
+
+        // 刚打包的报文位于队尾，从中取报文标识用于匹配 PUBACK/SUBACK
+        // （mqtt_mq_get 宏不给下标加括号，下标须先算好）
+        const ssize_t last = mqtt_mq_length(&client_.mq) - 1;
+        const struct mqtt_queued_message *msg = mqtt_mq_get(&client_.mq, last);
+        InFlight f;
+        f.packetId = msg->packet_id;
+        f.deadlineMs = NowMs() + kAckTimeoutMs;
+        f.req = std::move(req);
+        inFlight_.push_back(std::move(f));
+        submitted = true;
     }
+    return submitted;
+}
 
-    bool ok = true;
-    ok = ok && (cJSON_AddStringToObject(root, "deviceId", deviceId.c_str()) != nullptr);
-    ok = ok && (cJSON_AddStringToObject(root, "chipId", deviceId.c_str()) != nullptr);
-    ok = ok && (cJSON_AddStringToObject(root, "deviceType", deviceType.c_str()) != nullptr);
-    ok = ok && (cJSON_AddStringToObject(root, "timestamp", ts.c_str()) != nullptr);
+void MqttCClient::resolveInFlightLocked(std::vector<Completion> &completions)
+{
+    const int64_t now = NowMs();
+    for (auto it = inFlight_.begin(); it != inFlight_.end();) {
+        const Request &req = it->req;
+        if (it->streaming) {
+            ++it;
+            continue;
+        }
+        bool done;
+        if (it->streamed && req.qos == 0) {
+            done = true; // 写完即完成
+        } else if (req.subscribe) {
+            done = IsQueuedComplete(client_, req.unsubscribe ? MQTT_CONTROL_UNSUBSCRIBE : MQTT_CONTROL_SUBSCRIBE,
+                                    it->packetId);
+        } else {
+            // QoS0 写出即完成，QoS1 收到 PUBACK，QoS2 收到 PUBREC 后还要等 PUBREL 被 PUBCOMP 确认
+            done = IsQueuedComplete(client_, MQTT_CONTROL_PUBLISH, it->packetId);
+            if (done && req.qos == 2) {
+                done = IsQueuedComplete(client_, MQTT_CONTROL_PUBREL, it->packetId);
+            }
+        }
+        if (!done && now < it->deadlineMs) {
+            ++it;
+            continue;
+        }
+        if (!done && it->streamed) {
+            // 放弃等待：占位报文标记完成，好让 MQTT-C 回收
+            struct mqtt_queued_message *msg = mqtt_mq_find(&client_.mq, MQTT_CONTROL_PUBLISH, &it->packetId);
+            if (msg != NULL) {
+                msg->state = MQTT_QUEUED_COMPLETE;
+            }
+        }
+        completions.push_back({std::move(it->req.done), done,
+                               done ? std::string()
+                                    : std::string(req.unsubscribe ? "UNSUBACK" : req.subscribe ? "SUBACK" : "PUBACK") +
+                                          " timeout"});
+        it = inFlight_.erase(it);
+    }
+}
 
-    if (!ok) {
-        cJSON_Delete(root);
-        const std::string msg = "cJSON add field failed";
+void MqttCClient::closeLocked(const std::string &reason, std::vector<Completion> &completions)
+{
+    transport_.reset();
+    const bool wasConnecting = state_ == State::CONNECTING;
+    state_ = State::IDLE;
+    connected_.store(false);
+    stream_.active = false;
+    stream_.payload.reset();
+
+    if (!stopping_ && wantConnected_.load() && autoReconnect_.load()) {
+        // 等待重连：未确认的请求按原顺序退回队首，重连后重发（QoS1 可能重复，至少一次语义）
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            setLastErrorLocked(msg);
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            for (auto it = inFlight_.rbegin(); it != inFlight_.rend(); ++it) {
+                it->req.backlog = true;
+                queue_.push_front(std::move(it->req));
+            }
         }
-        if (errorMsg) *errorMsg = msg;
-        return false;
+        inFlight_.clear();
+        if (!wasConnecting) {
+            backoffMs_ = reconnectMinMs_; // 刚掉线：首次重连只等 [min/2, min]
+        }
+        scheduleReconnectLocked();
+    } else {
+        for (InFlight &f : inFlight_) {
+            completions.push_back({std::move(f.req.done), false, reason});
+        }
+        inFlight_.clear();
+        failQueued(reason, completions);
     }
+    stateCv_.notify_all();
+}
 
-    char *printed = cJSON_PrintUnformatted(root);
-    if (printed == nullptr) {
-        cJSON_Delete(root);
-        const std::string msg = "cJSON_PrintUnformatted failed";
+void MqttCClient::failQueued(const std::string &reason, std::vector<Completion> &completions)
+{
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    for (Request &req : queue_) {
+        completions.push_back({std::move(req.done), false, reason});
+    }
+    queue_.clear();
+}
+
+bool MqttCClient::hasUnsentLocked() const
+{
+    if (stream_.active || client_.send_offset != 0) {
+        return true;
+    }
+    const ssize_t n = mqtt_mq_length(&client_.mq);
+    for (ssize_t i = 0; i < n; i++) {
+        if (mqtt_mq_get(&client_.mq, i)->state == MQTT_QUEUED_UNSENT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int MqttCClient::nextTimeoutMsLocked() const
+{
+    const int64_t now = NowMs();
+    if (state_ == State::IDLE) {
+        if (!(wantConnected_.load() && autoReconnect_.load())) {
+            return -1;
+        }
+        return static_cast<int>(std::max<int64_t>(nextReconnectMs_ - now, 1));
+    }
+
+    // MQTT-C 以秒计时：now > 上次发送 + keep_alive 时发 PINGREQ，
+    // 等待确认的报文在 now > time_sent + response_timeout 时重发
+    time_t dueSec = client_.time_of_last_send + client_.keep_alive + 1;
+    const ssize_t n = mqtt_mq_length(&client_.mq);
+    for (ssize_t i = 0; i < n; i++) {
+        const struct mqtt_queued_message *msg = mqtt_mq_get(&client_.mq, i);
+        if (msg->state == MQTT_QUEUED_AWAITING_ACK) {
+            dueSec = std::min<time_t>(dueSec, msg->time_sent + client_.response_timeout + 1);
+        }
+    }
+    // 至少等 1 秒：刚到期的定时在本轮 mqtt_sync 已处理，还未发出说明 socket 写满，由 POLLOUT 唤醒
+    int64_t waitMs = std::max<int64_t>(static_cast<int64_t>(dueSec - MQTT_PAL_TIME()), 1) * 1000;
+
+    for (const InFlight &f : inFlight_) {
+        waitMs = std::min(waitMs, f.deadlineMs - now);
+    }
+    if (state_ == State::CONNECTING) {
+        waitMs = std::min(waitMs, connectDeadlineMs_ - now);
+    } else if (drainPerSec_ > 0 && nextDrainMs_ > now && inFlight_.size() < kMaxInFlight) {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (!queue_.empty() && queue_.front().backlog) {
+            waitMs = std::min(waitMs, nextDrainMs_ - now);
+        }
+    }
+    return static_cast<int>(std::max<int64_t>(waitMs, 1));
+}
+
+bool MqttCClient::publishDiscoveryAnnounceRetained(const std::string &topicPrefix,
+                                                   const std::string &deviceId,
+                                                   const std::string &deviceType,
+                                                   std::string *errorMsg)
+{
+    std::string msg;
+    std::string payload;
+    if (topicPrefix.empty() || deviceId.empty() || deviceType.empty()) {
+        msg = "invalid args for publishDiscoveryAnnounceRetained";
+    } else {
+        (void)BuildAnnouncePayload(deviceId, deviceType, payload, &msg);
+    }
+    if (!msg.empty()) {
         {
             std::lock_guard<std::mutex> lock(mutex_);
             setLastErrorLocked(msg);
@@ -616,11 +1581,19 @@ bool MqttCClient::publishDiscoveryAnnounceRetained(const std::string &topicPrefi
         return false;
     }
 
-    std::string payload(printed);
-    cJSON_free(printed);
-    cJSON_Delete(root);
+    // const std::string discoveryTopic = topicPrefix + "/announce/" + deviceId;
+    const std::string discoveryTopic = topicPrefix + "/announce";
+
+    // 记下参数：自动重连后以新的时间戳重发
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        announce_.topicPrefix = topicPrefix;
+        announce_.deviceId = deviceId;
+        announce_.deviceType = deviceType;
+    }
 
-    return publish(discoveryTopic, payload.data(), payload.size(), 1, true, errorMsg);
+    // announce 只需尽力送达，不等 PUBACK：调用方（JS 线程）不会被 broker 往返阻塞
+    return publishAsync(discoveryTopic, PublishPayload::FromBuffer(std::move(payload)), 1, true, nullptr, errorMsg);
 }
 
 } // namespace mqttc
@@ -15,13 +15,17 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstring>
 #include <iterator>
 #include <map>
 #include <vector>
-#include <fstream>
 #include "serial_uart.h"
 #include "myserial.h"
+#include "frame_codec.h"
+#include "image_store.h"
+#include "sensor_data_provider.h"
 
 extern "C" {
 #include <semaphore.h>
@@ -32,12 +36,12 @@ extern "C" {
 #include <unistd.h>
 #include <poll.h>
 #include <errno.h>
+#include <sched.h>
+#include <termios.h>
+#include <time.h>
 }
 using namespace std;
 
-extern "C" void NotifyImageCapturedFromNative(const char* path);
-
-#define UART_TTL_NAME "/dev/ttyS1"
 #define MAX_BUFFER_SIZE 1024
 
 #define FRAME_HEAD 0xFE //帧头
@@ -56,104 +60,208 @@ static bool g_uartInited = false;
 //int recv[MAX_BUFFER_SIZE];
 pthread_mutex_t recv_mutex = PTHREAD_MUTEX_INITIALIZER;  // 初始化互斥锁
 
-typedef struct {
-    char* buf;  // 数据缓冲区
-    int len;                   // 数据长度
-} SerialOutputParams;
+// 写队列：多生产者（任意线程调用 write_uart）单消费者（写线程），槽位预分配。
+// 生产者先取空闲槽令牌（g_txFree，队列满时在此阻塞，即背压），再用 fetch_add 领取连续位置，
+// 填好数据后写 seq 发布；写线程按位置顺序取出，把排队的小写入合并成一次 write()。
+static const uint32_t SERIAL_TX_SLOTS = 64; // 2 的幂
+static const size_t SERIAL_TX_SLOT_SIZE = 256;
+static const size_t SERIAL_TX_MAX_WRITE = SERIAL_TX_SLOTS / 2 * SERIAL_TX_SLOT_SIZE; // 单次写入上限 8KB
+static const size_t SERIAL_TX_COALESCE = 1024; // 单次 write() 合并的字节数上限
+static const int SERIAL_TX_BLOCK_MS = 2000;    // 队列满时生产者最多等待的时间
+
+struct TxSlot {
+    std::atomic<uint64_t> seq{0}; // == pos + 1 表示位置 pos 的数据已就绪
+    uint32_t len = 0;
+    uint8_t data[SERIAL_TX_SLOT_SIZE];
+};
+
+static TxSlot g_txSlots[SERIAL_TX_SLOTS];
+static std::atomic<uint64_t> g_txEnqueuePos{0};
+static uint64_t g_txDequeuePos = 0; // 仅写线程访问
+static sem_t g_txFree;              // 空闲槽数
+static sem_t g_txUsed;              // 已发布、待写出的槽数
+static pthread_once_t g_txOnce = PTHREAD_ONCE_INIT;
+// 占用多个槽的写入彼此串行：避免多个生产者各持一部分令牌互相等待
+static pthread_mutex_t g_txLargeMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// 已经发到线路上（tcdrain 返回）的位置，serial_wait_drained 在此等待
+static pthread_mutex_t g_txDrainMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_txDrainCond = PTHREAD_COND_INITIALIZER;
+static uint64_t g_txDrainedPos = 0;
+
+static struct {
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> syscalls{0};
+    std::atomic<uint64_t> dropped{0};
+} g_txStats;
+
+// 单次 read 最多取的字节数：115200 波特率下约 0.35s 的数据，一次 poll 唤醒基本能取完
+static const size_t SERIAL_READ_CHUNK = 4096;
+static const size_t SERIAL_MAX_FRAME_SIZE = 1024 * 1024; // 1MB，避免异常数据撑爆内存
+
+// 读线程统计：仅读线程写，读者用 relaxed 原子读（校验/超长计数来自 frame_codec::Decoder）
+static struct {
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> sensorFrames{0};
+    std::atomic<uint64_t> imageFrames{0};
+    std::atomic<uint64_t> checksumErrors{0};
+    std::atomic<uint64_t> oversizeFrames{0};
+} g_rxStats;
+
+static std::atomic<bool> g_hexDump{false};
 
-static uint8_t CalcChecksum(const vector<unsigned char>& data, size_t n)
+// 波特率协商：固件的控制应答（BAUDOK/BAUDERR/PONG）由读线程放到这里，协商方等待
+static const int SERIAL_DEFAULT_BAUD = 115200;
+static pthread_mutex_t g_ctrlMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_ctrlCond = PTHREAD_COND_INITIALIZER;
+static std::string g_ctrlReply;
+static uint64_t g_ctrlSeq = 0;
+static pthread_mutex_t g_baudMutex = PTHREAD_MUTEX_INITIALIZER; // 同一时刻只进行一次协商
+static std::atomic<int> g_baud{SERIAL_DEFAULT_BAUD};
+static std::atomic<bool> g_rtscts{false};
+
+static void DeadlineAfterMs(struct timespec &ts, int ms);
+
+// 调试用：每次 read 的数据按 16 字节一行输出，默认关闭
+static void HexDump(const uint8_t *buf, size_t n)
+{
+    char line[16 * 3 + 1];
+    for (size_t off = 0; off < n; off += 16) {
+        const size_t cnt = std::min<size_t>(16, n - off);
+        for (size_t k = 0; k < cnt; k++) {
+            snprintf(line + k * 3, 4, "%02X ", buf[off + k]);
+        }
+        printf("%s\n", line);
+    }
+}
+
+// 固件对 SETBAUD/PING 的应答不是传感器数据：交给等待中的协商方
+static bool HandleControlReply(const vector<unsigned char> &frame)
 {
-    uint8_t sum = 0;
-    for (size_t i = 0; i < n; ++i) {
-        sum = static_cast<uint8_t>(sum + data[i]);
+    static const char *const kPrefixes[] = {"BAUDOK ", "BAUDERR ", "PONG"};
+    for (const char *prefix : kPrefixes) {
+        const size_t n = strlen(prefix);
+        if (frame.size() >= n && memcmp(frame.data(), prefix, n) == 0) {
+            pthread_mutex_lock(&g_ctrlMutex);
+            g_ctrlReply.assign(frame.begin(), frame.end());
+            g_ctrlSeq++;
+            pthread_cond_broadcast(&g_ctrlCond);
+            pthread_mutex_unlock(&g_ctrlMutex);
+            return true;
+        }
     }
-    return sum;
+    return false;
 }
 
-void WriteFrameToFile(const vector<uint8_t>& frameData, const char* fileName)
+// 完整且校验通过的帧（payload 已去掉校验和）：发布传感器数据或照片
+static void HandleFrame(frame_codec::Decoder &dec, uint8_t frameType, vector<unsigned char> &frame)
 {
-    ofstream file(fileName, ios::binary | ios::trunc);
-    if (!file) {
-        cerr << "Failed to open file" << endl;
+    if (frameType == CAMERA_END) {
+        // 整体移交给图片存储（内存最新图片 + 原子写文件 + 通知），不再拷贝
+        image::PublishImage(std::move(frame), PHOTO_PATH);
+        g_rxStats.imageFrames.fetch_add(1, std::memory_order_relaxed);
+        // 下一帧大概率仍是照片：按本次大小取池化缓冲
+        dec.Buffer() = image::AcquireBuffer();
         return;
     }
-    
-    if (!file.write(reinterpret_cast<const char*>(frameData.data()), frameData.size())) {
-        cerr << "Write failed" << endl;
+    if (frameType != FRAME_END) {
+        return;
+    }
+    if (HandleControlReply(frame)) {
+        return;
+    }
+
+    // 接收线程内一次性解码为结构化快照（二进制/文本自动识别）
+    sensor::SensorSnapshot snap;
+    const sensor::FrameFormat format = sensor::PublishFrame(sensor::DataChannel::SERIAL,
+        frame.data(), frame.size(), &snap);
+    if (format == sensor::FrameFormat::BINARY) {
+        // return_recv 的调用方期望文本帧：转成等价文本
+        char text[MAX_BUFFER_SIZE];
+        const size_t textLen = sensor::FormatFrameText(snap, text, sizeof(text));
+        frame_len = static_cast<int>(textLen);
+        pthread_mutex_lock(&recv_mutex);  // 加锁
+        data_buffer.assign(text, text + textLen);
+        pthread_mutex_unlock(&recv_mutex);  // 解锁
+    } else if (format == sensor::FrameFormat::TEXT) {
+        frame_len = static_cast<int>(frame.size());
+        pthread_mutex_lock(&recv_mutex);  // 加锁
+        data_buffer.assign(frame.begin(), frame.end());
+        pthread_mutex_unlock(&recv_mutex);  // 解锁
+    }
+    if (format != sensor::FrameFormat::INVALID) {
+        g_rxStats.sensorFrames.fetch_add(1, std::memory_order_relaxed);
     }
 }
 
 void *_serial_input_task(void* arg)// 串口读线程
 {
-    int count = 0;
-    int status = 0;
-    int ret = ERR;
-    //int recv_temp[MAX_BUFFER_SIZE];
-    unsigned char buf = 0;
-    vector<unsigned char> data_buffer_temp;
+    (void)arg;
+    static uint8_t buf[SERIAL_READ_CHUNK];
+    frame_codec::Decoder dec(SERIAL_MAX_FRAME_SIZE);
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
 
     while (1) {
-        ret = read(fd, &buf, 1);
-        printf("%02X\n", buf);
-        if (ret == ERR) {
-            perror("read error");
-            break;  // 读取失败，退出循环
-        }
-        if(status==0){ //等待帧头
-            if(buf==FRAME_HEAD){
-                status = 1; //切换-接收数据
-                count = 0;
-                data_buffer_temp.clear(); // 清空临时缓冲区
+        // 无数据时阻塞在 poll，不再空转
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, -1);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
             }
+            perror("poll error");
+            break;
         }
-        else if(status==1){ //接收数据
-            if (buf == ESC) {
-                status=2;  //切换-处理转义
-            }
-            else if(buf==FRAME_END){ //结束接收
-                status = 0; //切换-等待帧头
-                if (!data_buffer_temp.empty()) {
-                    const size_t payloadLen = data_buffer_temp.size() - 1;
-                    const uint8_t recvChecksum = data_buffer_temp.back();
-                    const uint8_t calcChecksum = CalcChecksum(data_buffer_temp, payloadLen);
-                    if (recvChecksum == calcChecksum) {
-                        frame_len = static_cast<int>(payloadLen);
-                        pthread_mutex_lock(&recv_mutex);  // 加锁
-                        data_buffer.assign(data_buffer_temp.begin(), data_buffer_temp.begin() + payloadLen); // 去除校验和字节
-                        pthread_mutex_unlock(&recv_mutex);  // 解锁
-                    }
-                }
-            }
-            else if(buf==CAMERA_END){
-                status = 0; //切换-等待帧头
-                if (!data_buffer_temp.empty()) {
-                    const size_t payloadLen = data_buffer_temp.size() - 1;
-                    const uint8_t recvChecksum = data_buffer_temp.back();
-                    const uint8_t calcChecksum = CalcChecksum(data_buffer_temp, payloadLen);
-                    if (recvChecksum == calcChecksum) {
-                        vector<uint8_t> imageData(data_buffer_temp.begin(), data_buffer_temp.begin() + payloadLen);
-                        WriteFrameToFile(imageData,PHOTO_PATH);
-                        cout<< "Frame received and written to file." <<endl;
-                        NotifyImageCapturedFromNative(PHOTO_PATH);
-                    }
-                }
-            }
-            else {
-                data_buffer_temp.push_back(buf); // 将数据存入临时缓冲区
-                //recv_temp[count] = buf;
-                count++;
+        if ((pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0 && (pfd.revents & POLLIN) == 0) {
+            perror("serial poll hangup");
+            break;
+        }
+
+        // fd 为非阻塞：一次唤醒把驱动缓冲读空
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0) {
+            g_rxStats.reads.fetch_add(1, std::memory_order_relaxed);
+            g_rxStats.bytes.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+            if (g_hexDump.load(std::memory_order_relaxed)) {
+                HexDump(buf, static_cast<size_t>(n));
             }
+            dec.Feed(buf, static_cast<size_t>(n), [&dec](uint8_t type, vector<unsigned char> &frame) {
+                HandleFrame(dec, type, frame);
+            });
+            const frame_codec::Decoder::Stats &codecStats = dec.GetStats();
+            g_rxStats.checksumErrors.store(codecStats.checksumErrors, std::memory_order_relaxed);
+            g_rxStats.oversizeFrames.store(codecStats.oversize, std::memory_order_relaxed);
         }
-        else if(status==2){ //处理转义
-            data_buffer_temp.push_back(buf); // 将数据存入临时缓冲区
-            //recv_temp[count] = buf;
-            count++;
-            status = 1; //切换-接收数据
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            perror("read error");
+            break;  // 读取失败，退出循环
         }
     }
     return NULL;
 }
 
+void serial_set_hex_dump(bool enable)
+{
+    g_hexDump.store(enable, std::memory_order_relaxed);
+}
+
+void serial_get_rx_stats(SerialRxStats *out)
+{
+    if (out == nullptr) {
+        return;
+    }
+    out->bytes = g_rxStats.bytes.load(std::memory_order_relaxed);
+    out->reads = g_rxStats.reads.load(std::memory_order_relaxed);
+    out->sensorFrames = g_rxStats.sensorFrames.load(std::memory_order_relaxed);
+    out->imageFrames = g_rxStats.imageFrames.load(std::memory_order_relaxed);
+    out->checksumErrors = g_rxStats.checksumErrors.load(std::memory_order_relaxed);
+    out->oversizeFrames = g_rxStats.oversizeFrames.load(std::memory_order_relaxed);
+}
+
 unsigned char* return_recv(int *len)
 {
     *len = frame_len;
@@ -168,38 +276,277 @@ unsigned char* return_recv(int *len)
     return temp;
 }
 
-// 串口写线程
-void *_serial_output_task(void *arg)
+static void InitTxQueue()
+{
+    sem_init(&g_txFree, 0, SERIAL_TX_SLOTS);
+    sem_init(&g_txUsed, 0, 0);
+}
+
+static void DeadlineAfterMs(struct timespec &ts, int ms)
+{
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += static_cast<long>(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+}
+
+// fd 为非阻塞：驱动缓冲满时等 POLLOUT 再写，直到全部写出
+static bool WriteAll(const uint8_t *buf, size_t len)
 {
-    SerialOutputParams *params = (SerialOutputParams *)arg;  // 将参数转换为结构体指针
-    const char* buf = params->buf;                 // 获取 buf
-    int len = params->len;                                 // 获取 len
+    while (len > 0) {
+        const ssize_t n = write(fd, buf, len);
+        if (n > 0) {
+            g_txStats.syscalls.fetch_add(1, std::memory_order_relaxed);
+            g_txStats.bytes.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+            buf += n;
+            len -= static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror("uart write error");
+            return false;
+        }
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        (void)poll(&pfd, 1, 1000);
+    }
+    return true;
+}
+
+// 串口写线程：唯一写 fd 的线程，不同调用方的命令不会在线路上交错
+static void *_serial_output_task(void *arg)
+{
+    (void)arg;
+    static uint8_t out[SERIAL_TX_COALESCE + SERIAL_TX_SLOT_SIZE];
+    while (1) {
+        if (sem_wait(&g_txUsed) != 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("uart tx sem_wait error");
+            break;
+        }
+
+        // 取出当前已排队的写入，合并成一次 write()
+        size_t len = 0;
+        do {
+            TxSlot &slot = g_txSlots[g_txDequeuePos & (SERIAL_TX_SLOTS - 1)];
+            // 计数可能来自更靠后的位置：本位置已被领取，等它的生产者写完（很短）
+            while (slot.seq.load(std::memory_order_acquire) != g_txDequeuePos + 1) {
+                sched_yield();
+            }
+            memcpy(out + len, slot.data, slot.len);
+            len += slot.len;
+            g_txDequeuePos++;
+            sem_post(&g_txFree);
+        } while (len < SERIAL_TX_COALESCE && sem_trywait(&g_txUsed) == 0);
 
-    write(fd, buf, len);
+        (void)WriteAll(out, len);
+        // 等本批真正发到线路上；期间新的写入在队列里积累，下一批合并得更多
+        (void)tcdrain(fd);
 
-    delete[] params->buf;  // 释放动态分配的内存
-    delete params;  // 释放动态分配的内存
+        pthread_mutex_lock(&g_txDrainMutex);
+        g_txDrainedPos = g_txDequeuePos;
+        pthread_cond_broadcast(&g_txDrainCond);
+        pthread_mutex_unlock(&g_txDrainMutex);
+    }
     return NULL;
 }
 
+int serial_write(const char* buf, int len, uint64_t *ticket)
+{
+    if (buf == NULL || len <= 0 || static_cast<size_t>(len) > SERIAL_TX_MAX_WRITE) {
+        return -1;
+    }
+    pthread_once(&g_txOnce, InitTxQueue);
 
-void write_uart(const char* buf, int len)
+    const uint32_t slots = static_cast<uint32_t>((static_cast<size_t>(len) + SERIAL_TX_SLOT_SIZE - 1) /
+                                                 SERIAL_TX_SLOT_SIZE);
+    if (slots > 1) {
+        pthread_mutex_lock(&g_txLargeMutex);
+    }
+
+    // 背压：队列满（串口跟不上）时阻塞等待空闲槽，超时放弃
+    struct timespec deadline;
+    DeadlineAfterMs(deadline, SERIAL_TX_BLOCK_MS);
+    uint32_t got = 0;
+    while (got < slots) {
+        if (sem_timedwait(&g_txFree, &deadline) == 0) {
+            got++;
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    if (got < slots) {
+        for (uint32_t i = 0; i < got; i++) {
+            sem_post(&g_txFree);
+        }
+        if (slots > 1) {
+            pthread_mutex_unlock(&g_txLargeMutex);
+        }
+        g_txStats.dropped.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    const uint64_t pos = g_txEnqueuePos.fetch_add(slots, std::memory_order_relaxed);
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(buf);
+    size_t remaining = static_cast<size_t>(len);
+    for (uint32_t i = 0; i < slots; i++) {
+        TxSlot &slot = g_txSlots[(pos + i) & (SERIAL_TX_SLOTS - 1)];
+        slot.len = static_cast<uint32_t>(std::min(remaining, SERIAL_TX_SLOT_SIZE));
+        memcpy(slot.data, src, slot.len);
+        src += slot.len;
+        remaining -= slot.len;
+        slot.seq.store(pos + i + 1, std::memory_order_release);
+        sem_post(&g_txUsed);
+    }
+    if (slots > 1) {
+        pthread_mutex_unlock(&g_txLargeMutex);
+    }
+
+    g_txStats.writes.fetch_add(1, std::memory_order_relaxed);
+    if (ticket != NULL) {
+        *ticket = pos + slots;
+    }
+    return 0;
+}
+
+int serial_wait_drained(uint64_t ticket, int timeoutMs)
 {
-    pthread_t pid_write;
+    struct timespec deadline;
+    DeadlineAfterMs(deadline, timeoutMs);
+    int rc = 0;
+    pthread_mutex_lock(&g_txDrainMutex);
+    while (g_txDrainedPos < ticket && rc != ETIMEDOUT) {
+        rc = pthread_cond_timedwait(&g_txDrainCond, &g_txDrainMutex, &deadline);
+    }
+    const bool drained = g_txDrainedPos >= ticket;
+    pthread_mutex_unlock(&g_txDrainMutex);
+    return drained ? 0 : -1;
+}
 
-    // 动态分配结构体并填充参数
-    SerialOutputParams *params = new SerialOutputParams;
-    if (params == NULL) {
-        perror("malloc failed");
+// 等待 seq 之后到达、以 prefix 开头的控制应答；超时返回 false
+static bool WaitControlReply(uint64_t seq, const char *prefix, int timeoutMs, std::string &reply)
+{
+    struct timespec deadline;
+    DeadlineAfterMs(deadline, timeoutMs);
+    const size_t n = strlen(prefix);
+    bool found = false;
+    int rc = 0;
+    pthread_mutex_lock(&g_ctrlMutex);
+    while (!found && rc != ETIMEDOUT) {
+        if (g_ctrlSeq != seq) {
+            seq = g_ctrlSeq;
+            found = g_ctrlReply.compare(0, n, prefix) == 0;
+            if (found) {
+                reply = g_ctrlReply;
+                break;
+            }
+        }
+        rc = pthread_cond_timedwait(&g_ctrlCond, &g_ctrlMutex, &deadline);
+    }
+    pthread_mutex_unlock(&g_ctrlMutex);
+    return found;
+}
+
+static uint64_t CurrentControlSeq()
+{
+    pthread_mutex_lock(&g_ctrlMutex);
+    const uint64_t seq = g_ctrlSeq;
+    pthread_mutex_unlock(&g_ctrlMutex);
+    return seq;
+}
+
+static bool ApplyLineSettings(int baud, bool rtscts)
+{
+    if (uart_set_flow_control(fd, rtscts ? 1 : 0) != OK || uart_set_baudrate(fd, baud) != OK) {
+        return false;
+    }
+    g_baud.store(baud);
+    g_rtscts.store(rtscts);
+    return true;
+}
+
+// 发送命令并等到发上线路
+static bool SendControl(const char *cmd, int timeoutMs)
+{
+    uint64_t ticket = 0;
+    return serial_write(cmd, static_cast<int>(strlen(cmd)), &ticket) == 0 &&
+           serial_wait_drained(ticket, timeoutMs) == 0;
+}
+
+int serial_set_baudrate(int baud, bool rtscts)
+{
+    if (baud <= 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&g_uartInitMutex);
+    const bool inited = g_uartInited;
+    pthread_mutex_unlock(&g_uartInitMutex);
+    if (!inited) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_baudMutex);
+    const int oldBaud = g_baud.load();
+    const bool oldRtscts = g_rtscts.load();
+
+    // 1) 旧速率下请求切换；固件应答后才切换（应答本身仍按旧速率发出）
+    char cmd[48];
+    snprintf(cmd, sizeof(cmd), "SETBAUD %d%s", baud, rtscts ? " RTSCTS" : "");
+    char expect[32];
+    snprintf(expect, sizeof(expect), "BAUDOK %d", baud);
+    std::string reply;
+    uint64_t seq = CurrentControlSeq();
+    if (!SendControl(cmd, 1000) || !WaitControlReply(seq, "BAUD", 3000, reply) || reply != expect) {
+        // 固件未应答或拒绝（如没有接流控引脚）：保持原速率
+        pthread_mutex_unlock(&g_baudMutex);
+        return -1;
+    }
+
+    // 2) 切到新速率后 PING 确认双向都通；失败则退回原速率（固件收不到 PING 也会自行退回）
+    bool ok = ApplyLineSettings(baud, rtscts);
+    if (ok) {
+        ok = false;
+        for (int attempt = 0; attempt < 3 && !ok; attempt++) {
+            seq = CurrentControlSeq();
+            ok = SendControl("PING", 1000) && WaitControlReply(seq, "PONG", 1500, reply);
+        }
+    }
+    if (!ok) {
+        (void)ApplyLineSettings(oldBaud, oldRtscts);
+    }
+    pthread_mutex_unlock(&g_baudMutex);
+    return ok ? 0 : -1;
+}
+
+int serial_get_baudrate(void)
+{
+    return g_baud.load();
+}
+
+void serial_get_tx_stats(SerialTxStats *out)
+{
+    if (out == NULL) {
         return;
     }
-    
-    params->buf = new char[len];
-    std::memcpy(params->buf, buf, len);
-    params->len = len;
+    out->writes = g_txStats.writes.load(std::memory_order_relaxed);
+    out->bytes = g_txStats.bytes.load(std::memory_order_relaxed);
+    out->syscalls = g_txStats.syscalls.load(std::memory_order_relaxed);
+    out->dropped = g_txStats.dropped.load(std::memory_order_relaxed);
+}
 
-    // 创建线程并传递参数
-    pthread_create(&pid_write, NULL, _serial_output_task, (void *)params);
+void write_uart(const char* buf, int len)
+{
+    (void)serial_write(buf, len, NULL);
 }
 
 void init_uart(){
@@ -216,7 +563,7 @@ void init_uart(){
         perror("open file fail\n");
         exit(-1);
     }
-    ret = uart_init(fd, 115200L);
+    ret = uart_init(fd, SERIAL_DEFAULT_BAUD);
     if (ret == ERR) {
         perror("uart init error\n");
         exit(-1);
@@ -224,6 +571,10 @@ void init_uart(){
 
     pthread_create(&pid_read, NULL, _serial_input_task, NULL);
 
+    pthread_once(&g_txOnce, InitTxQueue);
+    pthread_t pid_write;
+    pthread_create(&pid_write, NULL, _serial_output_task, NULL);
+
     g_uartInited = true;
     pthread_mutex_unlock(&g_uartInitMutex);
 }
\ No newline at end of file
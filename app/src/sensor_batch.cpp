@@ -0,0 +1,204 @@
+#include "sensor_batch.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace sensor {
+
+namespace {
+
+// 发布跟不上时最多积压的批次，超出后丢最旧的
+constexpr size_t kMaxReadyBatches = 8;
+
+using BatchPtr = std::unique_ptr<SensorBatch>;
+
+std::mutex g_mutex;
+std::condition_variable g_cv;
+std::atomic<bool> g_enabled{false}; // 接收线程先无锁判断，关闭时不进锁
+SensorBatchPolicy g_policy;
+bool g_threadStarted = false;
+BatchPtr g_current;           // 正在累积的批次
+int64_t g_firstMonoMs = 0;    // g_current 首帧的到达时刻（MonotonicMs）
+std::deque<BatchPtr> g_ready; // 待发布
+std::vector<BatchPtr> g_free; // 发布完的批次：保留各列容量，下一批直接复用，不再分配
+SensorBatchPublisher g_publisher;
+SensorBatchStats g_stats;
+
+int64_t WallMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void ClearBatch(SensorBatch &b)
+{
+    b.baseWallMs = 0;
+    b.firstSeq = 0;
+    b.validMask = 0;
+    b.offsetsMs.clear();
+    b.masks.clear();
+    for (std::vector<float> &column : b.values) {
+        column.clear();
+    }
+}
+
+BatchPtr TakeFreeLocked()
+{
+    if (!g_free.empty()) {
+        BatchPtr b = std::move(g_free.back());
+        g_free.pop_back();
+        return b;
+    }
+    BatchPtr b(new SensorBatch());
+    const size_t n = g_policy.maxSamples;
+    b->offsetsMs.reserve(n);
+    b->masks.reserve(n);
+    for (std::vector<float> &column : b->values) {
+        column.reserve(n);
+    }
+    return b;
+}
+
+void RecycleLocked(BatchPtr b)
+{
+    ClearBatch(*b);
+    g_free.push_back(std::move(b));
+}
+
+// 当前批次封口，交给批次线程
+void SealLocked()
+{
+    if (!g_current || g_current->size() == 0) {
+        return;
+    }
+    if (g_ready.size() >= kMaxReadyBatches) {
+        g_stats.dropped += g_ready.front()->size();
+        RecycleLocked(std::move(g_ready.front()));
+        g_ready.pop_front();
+    }
+    g_ready.push_back(std::move(g_current));
+    g_cv.notify_one();
+}
+
+void BatchLoop()
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    for (;;) {
+        if (!g_ready.empty()) {
+            BatchPtr batch = std::move(g_ready.front());
+            g_ready.pop_front();
+            SensorBatchPublisher publisher = g_publisher;
+            if (publisher) {
+                g_stats.batches++;
+                g_stats.samples += batch->size();
+                lock.unlock();
+                publisher(*batch); // 组包与入队在锁外，不阻塞接收线程追加
+                lock.lock();
+            } else {
+                g_stats.dropped += batch->size();
+            }
+            RecycleLocked(std::move(batch));
+            continue;
+        }
+
+        // 延迟上限：即使之后再没有新帧，首帧到达 maxLatencyMs 后也要发出
+        if (g_current && g_current->size() > 0) {
+            const int64_t waitMs = g_firstMonoMs + g_policy.maxLatencyMs - MonotonicMs();
+            if (waitMs <= 0) {
+                SealLocked();
+                continue;
+            }
+            g_cv.wait_for(lock, std::chrono::milliseconds(waitMs));
+            continue;
+        }
+        g_cv.wait(lock);
+    }
+}
+
+} // namespace
+
+bool SetSensorBatchPolicy(const SensorBatchPolicy &policy)
+{
+    if (policy.windowMs <= 0 || policy.maxLatencyMs <= 0 || policy.maxSamples == 0 ||
+        policy.maxSamples > kSensorBatchMaxSamples) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    // 按旧策略攒的批次先发出去，新策略从下一帧开始
+    SealLocked();
+    g_policy = policy;
+    g_enabled.store(policy.enabled);
+    if (policy.enabled && !g_threadStarted) {
+        std::thread(BatchLoop).detach();
+        g_threadStarted = true;
+    }
+    return true;
+}
+
+SensorBatchPolicy GetSensorBatchPolicy()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_policy;
+}
+
+bool IsSensorBatchEnabled()
+{
+    return g_enabled.load();
+}
+
+void SensorBatchAppend(const SensorSnapshot &snap)
+{
+    if (!g_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_policy.enabled) {
+        return;
+    }
+    // 时间桶：超出首帧起 windowMs 的帧开始新的一批
+    if (g_current && g_current->size() > 0 && snap.timestampMs - g_firstMonoMs >= g_policy.windowMs) {
+        SealLocked();
+    }
+    if (!g_current) {
+        g_current = TakeFreeLocked();
+    }
+
+    SensorBatch &b = *g_current;
+    if (b.size() == 0) {
+        b.baseWallMs = WallMs() - (MonotonicMs() - snap.timestampMs);
+        b.firstSeq = snap.seq;
+        g_firstMonoMs = snap.timestampMs;
+        g_cv.notify_one(); // 批次线程据此开始计延迟上限
+    }
+    b.offsetsMs.push_back(static_cast<uint32_t>(snap.timestampMs - g_firstMonoMs));
+    b.masks.push_back(snap.validMask);
+    b.validMask |= snap.validMask;
+    for (size_t i = 0; i < kSensorCount; i++) {
+        b.values[i].push_back(snap.values[i]);
+    }
+
+    if (b.size() >= g_policy.maxSamples) {
+        SealLocked();
+    }
+}
+
+void SetSensorBatchPublisher(SensorBatchPublisher publisher)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_publisher = std::move(publisher);
+}
+
+SensorBatchStats GetSensorBatchStats()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_stats;
+}
+
+} // namespace sensor
@@ -1,12 +1,20 @@
 #include "sensor_data_provider.h"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <thread>
 
 #include "myserial.h"
+#include "sensor_batch.h"
+#include "sensor_frame.h"
+#include "sensor_history.h"
+#include "sensor_log.h"
 #include "wifi_udp_receiver.h"
 
 namespace sensor {
@@ -15,65 +23,387 @@ int SendCommand(const char *command);
 
 namespace {
 
-sensor::DataChannel g_dataChannel = sensor::DataChannel::UDP;
+// 由 NAPI 线程切换，接收线程与各读取方并发读取：每次调用只读一次，避免同一调用内前后不一致
+std::atomic<sensor::DataChannel> g_dataChannel{sensor::DataChannel::UDP};
 constexpr const char *kGetDataCmd = "GET_DATA";
-constexpr auto kQueryInterval = std::chrono::seconds(1);
 std::atomic<bool> g_queryThreadStarted(false);
 
-float ParseValueFromText(const char *text, const char *key)
+// 推送订阅：查询线程以 "SUBSCRIBE <periodMs> <leaseMs>" 让 ESP32 按周期自主发帧，并在租约内续订；
+// 网关停止续订（退出、崩溃）后固件在租约到期时自行停发
+constexpr int64_t kTelemetryLeaseMs = 10000;
+constexpr int64_t kTelemetryRenewMs = kTelemetryLeaseMs / 3; // 丢一两次续订也不会断流
+// 旧固件不认识 SUBSCRIBE：这么久没有新帧就退回 GET_DATA 轮询（间隔不小于 1s）
+constexpr int64_t kTelemetryFallbackMinMs = 3000;
+constexpr int64_t kTelemetryPollMinMs = 1000;
+constexpr double kTelemetryMinHz = 0.01;
+constexpr double kTelemetryMaxHz = 20.0;
+
+std::mutex g_telemetryMutex;
+std::condition_variable g_telemetryCv;
+double g_telemetryHz = 1.0; // 与原先每秒一次 GET_DATA 相同
+bool g_telemetryChanged = true;
+
+// 与 sensor::SensorId 一一对应
+constexpr const char *kSensorKeys[sensor::kSensorCount] = {
+    "Humi", "Temp", "CH2O", "TVOC", "CO_2",
+    "SoilHumi", "SoilTemp", "EC", "pH", "N",
+    "P", "K", "Salt", "TDS", "Light",
+};
+
+constexpr size_t kChannelCount = 3; // SERIAL、UDP、MULTIPATH（合并结果）
+constexpr size_t kPathCount = 2;    // 物理路径：SERIAL、UDP
+constexpr size_t kFrameTextMax = 1024;
+
+// 每个通道一份最新快照，用 seqlock 发布：接收线程单写，读者无锁重试。
+// version 为奇数表示写入中；字段用 relaxed 原子读写，避免数据竞争。
+struct SnapshotSlot {
+    std::atomic<uint32_t> version{0};
+    std::atomic<float> values[sensor::kSensorCount];
+    std::atomic<uint32_t> validMask{0};
+    std::atomic<uint64_t> frameSeq{0};
+    std::atomic<int64_t> timestampMs{0};
+    std::atomic<uint32_t> deviceSeq{0};
+    std::atomic<uint32_t> deviceMs{0};
+};
+
+// 接收统计：仅由该通道的接收线程写
+struct ChannelStats {
+    std::atomic<uint64_t> textFrames{0};
+    std::atomic<uint64_t> binaryFrames{0};
+    std::atomic<uint64_t> lostFrames{0};
+    std::atomic<uint64_t> duplicateFrames{0};
+    std::atomic<uint64_t> invalidFrames{0};
+    uint32_t lastDeviceSeq = 0;
+};
+
+ChannelStats g_stats[kChannelCount];
+
+SnapshotSlot g_slots[kChannelCount];
+
+// 新帧通知：仅用于 WaitForFrame，发布方只在写完快照后短暂加锁唤醒
+std::mutex g_frameMutex;
+std::condition_variable g_frameCv;
+
+size_t ChannelIndex(sensor::DataChannel channel)
 {
-    if (text == nullptr || key == nullptr) {
-        return 0.0f;
+    switch (channel) {
+        case sensor::DataChannel::SERIAL:
+            return 0;
+        case sensor::DataChannel::MULTIPATH:
+            return 2;
+        default:
+            return 1;
     }
+}
 
-    char searchKey[32] = {0};
-    std::snprintf(searchKey, sizeof(searchKey), "%s:", key);
+SnapshotSlot &SlotOf(sensor::DataChannel channel)
+{
+    return g_slots[ChannelIndex(channel)];
+}
 
-    const char *position = std::strstr(text, searchKey);
-    if (position == nullptr) {
-        return 0.0f;
+// 写入一帧并分配帧序号（seq 从 1 开始递增），返回分配的序号
+uint64_t StoreSnapshot(SnapshotSlot &slot, const sensor::SensorSnapshot &snap)
+{
+    const uint32_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < sensor::kSensorCount; i++) {
+        slot.values[i].store(snap.values[i], std::memory_order_relaxed);
     }
+    slot.validMask.store(snap.validMask, std::memory_order_relaxed);
+    slot.timestampMs.store(snap.timestampMs, std::memory_order_relaxed);
+    slot.deviceSeq.store(snap.deviceSeq, std::memory_order_relaxed);
+    slot.deviceMs.store(snap.deviceMs, std::memory_order_relaxed);
+    const uint64_t seq = slot.frameSeq.load(std::memory_order_relaxed) + 1;
+    slot.frameSeq.store(seq, std::memory_order_relaxed);
+    slot.version.store(version + 2, std::memory_order_release);
+    return seq;
+}
 
-    float value = 0.0f;
-    std::sscanf(position, "%*[^:]:%f", &value);
-    return value;
+void LoadSnapshot(const SnapshotSlot &slot, sensor::SensorSnapshot &out)
+{
+    while (true) {
+        const uint32_t before = slot.version.load(std::memory_order_acquire);
+        if ((before & 1u) != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < sensor::kSensorCount; i++) {
+            out.values[i] = slot.values[i].load(std::memory_order_relaxed);
+        }
+        out.validMask = slot.validMask.load(std::memory_order_relaxed);
+        out.timestampMs = slot.timestampMs.load(std::memory_order_relaxed);
+        out.deviceSeq = slot.deviceSeq.load(std::memory_order_relaxed);
+        out.deviceMs = slot.deviceMs.load(std::memory_order_relaxed);
+        out.seq = slot.frameSeq.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) == before) {
+            return;
+        }
+    }
 }
 
-float GetDataByKeyFromUdp(const char *key)
+int FindKeyIndex(const char *key, size_t keyLen)
 {
-    constexpr size_t kUdpDataBufSize = 1024;
-    char dataStr[kUdpDataBufSize] = {0};
-    if (wifi_get_latest_data(dataStr, sizeof(dataStr)) != 0) {
-        return 0.0f;
+    for (size_t i = 0; i < sensor::kSensorCount; i++) {
+        if (std::strlen(kSensorKeys[i]) == keyLen && std::memcmp(kSensorKeys[i], key, keyLen) == 0) {
+            return static_cast<int>(i);
+        }
     }
-    return ParseValueFromText(dataStr, key);
+    return -1;
 }
 
-float GetDataByKeyFromSerial(const char *key)
+// 解析 "Key:value;Key:value;..."，未出现或无法解析的键保持 0 且不置有效位
+void DecodeFrameText(const char *text, size_t len, sensor::SensorSnapshot &out)
 {
-    if (key == nullptr || key[0] == '\0') {
-        return 0.0f;
+    char buf[kFrameTextMax];
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
     }
+    std::memcpy(buf, text, len);
+    buf[len] = '\0';
 
-    constexpr size_t kSerialDataBufSize = 1024;
-    char dataStr[kSerialDataBufSize] = {0};
+    char *cursor = buf;
+    while (*cursor != '\0') {
+        char *end = std::strchr(cursor, ';');
+        if (end != nullptr) {
+            *end = '\0';
+        }
 
-    int dataLen = 0;
-    unsigned char *data = return_recv(&dataLen);
-    if (data == nullptr || dataLen <= 0) {
-        delete[] data;
-        return 0.0f;
+        char *colon = std::strchr(cursor, ':');
+        if (colon != nullptr) {
+            const int index = FindKeyIndex(cursor, static_cast<size_t>(colon - cursor));
+            if (index >= 0) {
+                char *valueEnd = nullptr;
+                const float value = std::strtof(colon + 1, &valueEnd);
+                if (valueEnd != colon + 1) {
+                    out.values[index] = value;
+                    out.validMask |= (1u << index);
+                }
+            }
+        }
+
+        if (end == nullptr) {
+            break;
+        }
+        cursor = end + 1;
+    }
+}
+
+// 二进制帧：定长 memcpy 解码
+bool DecodeFrameBinary(const uint8_t *data, size_t len, sensor::SensorSnapshot &out)
+{
+    sensor_frame::Header header;
+    if (!sensor_frame::Decode(data, len, header, out.values, sensor::kSensorCount)) {
+        return false;
+    }
+
+    out.validMask = header.presentMask;
+    out.deviceSeq = header.seq;
+    out.deviceMs = header.captureMs;
+    // 无效通道保持 0，与文本帧缺键时的语义一致
+    for (size_t i = 0; i < sensor::kSensorCount; i++) {
+        if ((out.validMask & (1u << i)) == 0) {
+            out.values[i] = 0.0f;
+        }
+    }
+    return true;
+}
+
+// ---- 多路径合并 ----
+// 串口与 UDP 的接收线程都把帧交给合并层：按 key 去重，先到的副本发布到 MULTIPATH 槽，
+// 另一路径随后到达的副本丢弃，两者的到达时间差计入落后路径的延迟。
+// 条目在匹配窗口内没等到另一路径的副本，则记为另一路径丢失。
+constexpr size_t kDedupWindow = 32;
+constexpr int64_t kDedupMatchMs = 2000;
+constexpr double kPathEwmaAlpha = 0.1;
+// 命令路径切换的迟滞：送达率需高出这么多，或延迟低这么多毫秒，避免两条路径质量相近时来回切换
+constexpr double kRouteDeliveryMargin = 0.1;
+constexpr double kRouteLagMarginMs = 20.0;
+
+struct DedupEntry {
+    uint64_t key = 0;
+    int64_t firstMs = 0;
+    size_t firstPath = 0;
+    bool used = false;
+    bool resolved = false; // 已匹配到另一路径的副本，或已按丢失结算
+};
+
+struct PathHealth {
+    uint64_t frames = 0;
+    uint64_t firstArrivals = 0;
+    uint64_t lateCopies = 0;
+    uint64_t missed = 0;
+    double deliveryRatio = 0.0;
+    double lagMs = 0.0;
+    int64_t lastArrivalMs = 0;
+};
+
+std::mutex g_mergeMutex; // 两个接收线程都会写 MULTIPATH 槽，由它串行化（读者仍走 seqlock 无锁）
+DedupEntry g_dedup[kDedupWindow];
+size_t g_dedupNext = 0;
+PathHealth g_paths[kPathCount];
+std::atomic<size_t> g_commandPath{1}; // 默认 UDP，与 g_dataChannel 的默认一致
+
+sensor::DataChannel PathChannel(size_t path)
+{
+    return path == 0 ? sensor::DataChannel::SERIAL : sensor::DataChannel::UDP;
+}
+
+// 二进制帧以 (captureMs, seq) 为 key，固件重启后序号重来也不会误判；
+// 文本帧没有序号，用内容的 FNV-1a 哈希
+uint64_t FrameKey(sensor::FrameFormat format, const sensor::SensorSnapshot &snap, const uint8_t *data, size_t len)
+{
+    if (format == sensor::FrameFormat::BINARY) {
+        return (static_cast<uint64_t>(snap.deviceMs) << 32) | snap.deviceSeq;
+    }
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void RecordDeliveryLocked(size_t path, bool delivered, double lagMs)
+{
+    PathHealth &health = g_paths[path];
+    health.deliveryRatio += kPathEwmaAlpha * ((delivered ? 1.0 : 0.0) - health.deliveryRatio);
+    if (delivered) {
+        health.lagMs += kPathEwmaAlpha * (lagMs - health.lagMs);
+    } else {
+        health.missed++;
+    }
+}
+
+// 只有先到路径送达的条目：先到路径记一次送达，另一路径记一次丢失
+void ResolveMissLocked(DedupEntry &entry)
+{
+    if (!entry.used || entry.resolved) {
+        return;
+    }
+    entry.resolved = true;
+    RecordDeliveryLocked(entry.firstPath, true, 0.0);
+    RecordDeliveryLocked(1 - entry.firstPath, false, 0.0);
+}
+
+void ExpireDedupLocked(int64_t now)
+{
+    for (DedupEntry &entry : g_dedup) {
+        if (entry.used && !entry.resolved && now - entry.firstMs > kDedupMatchMs) {
+            ResolveMissLocked(entry);
+        }
+    }
+}
+
+bool PathAliveLocked(size_t path, int64_t now)
+{
+    const int64_t last = g_paths[path].lastArrivalMs;
+    return last != 0 && now - last <= sensor::kSensorStaleMs;
+}
+
+// 选出命令路径：当前路径失联而另一路径在线则切换；否则另一路径送达率明显更高，
+// 或送达率相近但延迟明显更低时才切换
+void UpdateRouteLocked(int64_t now)
+{
+    const size_t current = g_commandPath.load(std::memory_order_relaxed);
+    const size_t other = 1 - current;
+    if (!PathAliveLocked(other, now)) {
+        return;
+    }
+    const PathHealth &cur = g_paths[current];
+    const PathHealth &alt = g_paths[other];
+    bool better = !PathAliveLocked(current, now);
+    if (!better) {
+        better = alt.deliveryRatio > cur.deliveryRatio + kRouteDeliveryMargin;
+    }
+    if (!better && alt.deliveryRatio >= cur.deliveryRatio - kRouteDeliveryMargin) {
+        better = alt.lagMs + kRouteLagMarginMs < cur.lagMs;
+    }
+    if (better) {
+        g_commandPath.store(other, std::memory_order_relaxed);
     }
+}
 
-    size_t copyLen = static_cast<size_t>(dataLen);
-    if (copyLen >= kSerialDataBufSize) {
-        copyLen = kSerialDataBufSize - 1;
+void ResetMultipathLocked()
+{
+    for (DedupEntry &entry : g_dedup) {
+        entry = DedupEntry();
     }
-    std::memcpy(dataStr, data, copyLen);
-    dataStr[copyLen] = '\0';
-    delete[] data;
+    g_dedupNext = 0;
+    g_stats[ChannelIndex(sensor::DataChannel::MULTIPATH)].lastDeviceSeq = 0;
+}
+
+// 合并一帧（snap 为该路径已解码的快照）。先到的副本发布到 MULTIPATH 槽并写历史/日志，
+// 重复副本只更新统计。
+void MergeFrame(sensor::DataChannel source, sensor::FrameFormat format, const uint8_t *data, size_t len,
+                const sensor::SensorSnapshot &snap)
+{
+    const size_t path = ChannelIndex(source);
+    const uint64_t key = FrameKey(format, snap, data, len);
+    const int64_t now = snap.timestampMs;
+    ChannelStats &stats = g_stats[ChannelIndex(sensor::DataChannel::MULTIPATH)];
+    SnapshotSlot &slot = SlotOf(sensor::DataChannel::MULTIPATH);
+
+    std::lock_guard<std::mutex> lock(g_mergeMutex);
+    PathHealth &health = g_paths[path];
+    health.frames++;
+    health.lastArrivalMs = now;
+    ExpireDedupLocked(now);
 
-    return ParseValueFromText(dataStr, key);
+    // 另一路径先送达、尚未匹配的同 key 条目；文本帧内容可能连续相同，取最近的一条
+    DedupEntry *match = nullptr;
+    for (DedupEntry &entry : g_dedup) {
+        if (entry.used && !entry.resolved && entry.key == key && entry.firstPath != path &&
+            (match == nullptr || entry.firstMs > match->firstMs)) {
+            match = &entry;
+        }
+    }
+    if (match != nullptr) {
+        match->resolved = true;
+        health.lateCopies++;
+        stats.duplicateFrames.fetch_add(1, std::memory_order_relaxed);
+        RecordDeliveryLocked(match->firstPath, true, 0.0);
+        RecordDeliveryLocked(path, true, static_cast<double>(now - match->firstMs));
+        UpdateRouteLocked(now);
+        return;
+    }
+
+    DedupEntry &entry = g_dedup[g_dedupNext];
+    g_dedupNext = (g_dedupNext + 1) % kDedupWindow;
+    ResolveMissLocked(entry); // 窗口写满时覆盖的旧条目按丢失结算
+    entry.key = key;
+    entry.firstMs = now;
+    entry.firstPath = path;
+    entry.used = true;
+    entry.resolved = false;
+    health.firstArrivals++;
+    UpdateRouteLocked(now);
+
+    if (format == sensor::FrameFormat::TEXT) {
+        stats.textFrames.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        const uint32_t last = stats.lastDeviceSeq;
+        const uint32_t lastMs = slot.deviceMs.load(std::memory_order_relaxed);
+        if (last != 0 && snap.deviceSeq < last && snap.deviceMs <= lastMs &&
+            lastMs - snap.deviceMs <= static_cast<uint32_t>(kDedupMatchMs)) {
+            // 快路径丢了这一帧、慢路径补到时已有更新的帧发布：不再回退最新快照，
+            // 之前按缺口记的丢帧扣回（序号与采集时刻都回退很多才视为固件重启）
+            if (stats.lostFrames.load(std::memory_order_relaxed) > 0) {
+                stats.lostFrames.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+        uint64_t lost = 0;
+        (void)sensor::TrackDeviceSeq(snap.deviceSeq, stats.lastDeviceSeq, lost);
+        stats.lostFrames.fetch_add(lost, std::memory_order_relaxed);
+        stats.binaryFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    sensor::SensorSnapshot merged = snap;
+    merged.seq = StoreSnapshot(slot, merged);
+    sensor::HistoryAppend(merged);
+    sensor::SensorLogAppend(merged);
+    sensor::SensorBatchAppend(merged);
 }
 
 int SendCaptureFromSerial(const char *command)
@@ -81,8 +411,8 @@ int SendCaptureFromSerial(const char *command)
     if (command == nullptr || command[0] == '\0') {
         return -1;
     }
-    write_uart(command, static_cast<int>(std::strlen(command)));
-    return 0;
+    // 入写队列即返回；队列满（串口跟不上）时 serial_write 会阻塞一段时间后返回 -1
+    return serial_write(command, static_cast<int>(std::strlen(command)), nullptr);
 }
 
 int SendCaptureFromUdp(const char *command)
@@ -93,11 +423,67 @@ int SendCaptureFromUdp(const char *command)
     return wifi_send_broadcast(command, static_cast<int>(std::strlen(command)));
 }
 
+int SendSubscribe(double hz)
+{
+    char cmd[48];
+    if (hz <= 0.0) {
+        std::snprintf(cmd, sizeof(cmd), "UNSUBSCRIBE");
+    } else {
+        std::snprintf(cmd, sizeof(cmd), "SUBSCRIBE %lld %lld", static_cast<long long>(1000.0 / hz + 0.5),
+                      static_cast<long long>(kTelemetryLeaseMs));
+    }
+    return sensor::SendCommand(cmd);
+}
+
 void QueryLoop()
 {
+    int64_t nextRenewMs = 0;
+    int64_t lastPollMs = 0;
+    bool polling = false;
+    uint64_t seqAtPoll = 0;
+    std::unique_lock<std::mutex> lock(g_telemetryMutex);
     while (true) {
-        (void)sensor::SendCommand(kGetDataCmd);
-        std::this_thread::sleep_for(kQueryInterval);
+        const double hz = g_telemetryHz;
+        const bool changed = g_telemetryChanged;
+        g_telemetryChanged = false;
+        lock.unlock();
+
+        const int64_t now = sensor::MonotonicMs();
+        int64_t waitMs = kTelemetryRenewMs;
+        if (hz > 0.0) {
+            const int64_t periodMs = static_cast<int64_t>(1000.0 / hz + 0.5);
+            if (changed || now >= nextRenewMs) {
+                (void)SendSubscribe(hz);
+                nextRenewMs = now + kTelemetryRenewMs;
+            }
+            // 流没有按期到达（旧固件、订阅丢失、链路切换）：改为按周期 GET_DATA 轮询，数据不会断档；
+            // 两次轮询之间多出帧说明推送已恢复，停止轮询
+            const int64_t fallbackMs = std::max(periodMs * 2 + kTelemetryPollMinMs, kTelemetryFallbackMinMs);
+            const int64_t pollMs = std::max(periodMs, kTelemetryPollMinMs);
+            sensor::SensorSnapshot snap;
+            sensor::GetSnapshot(snap);
+            const int64_t frameAt = snap.seq != 0 ? snap.timestampMs : 0;
+            if (polling && snap.seq >= seqAtPoll + 2) {
+                polling = false;
+            } else if (!polling && now - frameAt > fallbackMs) {
+                polling = true;
+            }
+            if (polling && now - lastPollMs >= pollMs) {
+                (void)sensor::SendCommand(kGetDataCmd);
+                lastPollMs = now;
+                seqAtPoll = snap.seq;
+            }
+            waitMs = nextRenewMs - now;
+            if (polling) {
+                waitMs = std::min(waitMs, pollMs - (now - lastPollMs));
+            }
+            waitMs = std::max<int64_t>(waitMs, 100);
+        } else if (changed) {
+            (void)SendSubscribe(0.0);
+        }
+
+        lock.lock();
+        g_telemetryCv.wait_for(lock, std::chrono::milliseconds(waitMs), []() { return g_telemetryChanged; });
     }
 }
 
@@ -113,31 +499,286 @@ void EnsureQueryThreadStarted()
 
 namespace sensor {
 
+int64_t MonotonicMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool IsFresh(const SensorSnapshot &snap, int64_t maxAgeMs)
+{
+    return snap.seq != 0 && (MonotonicMs() - snap.timestampMs) <= maxAgeMs;
+}
+
+const char *SensorKeyName(SensorId id)
+{
+    const size_t index = static_cast<size_t>(id);
+    return index < kSensorCount ? kSensorKeys[index] : nullptr;
+}
+
+bool FindSensorId(const char *key, SensorId *out)
+{
+    if (key == nullptr || out == nullptr) {
+        return false;
+    }
+    const int index = FindKeyIndex(key, std::strlen(key));
+    if (index < 0) {
+        return false;
+    }
+    *out = static_cast<SensorId>(index);
+    return true;
+}
+
 void SetDataChannel(DataChannel channel)
 {
-    g_dataChannel = channel;
+    if (channel == DataChannel::MULTIPATH && g_dataChannel.load(std::memory_order_acquire) != DataChannel::MULTIPATH) {
+        std::lock_guard<std::mutex> lock(g_mergeMutex);
+        ResetMultipathLocked();
+    }
+    g_dataChannel.store(channel, std::memory_order_release);
     EnsureQueryThreadStarted();
 }
 
 DataChannel GetDataChannel()
 {
-    return g_dataChannel;
+    return g_dataChannel.load(std::memory_order_acquire);
+}
+
+double SetTelemetryRate(double hz)
+{
+    if (hz > 0.0) {
+        hz = std::min(std::max(hz, kTelemetryMinHz), kTelemetryMaxHz);
+    } else {
+        hz = 0.0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_telemetryMutex);
+        g_telemetryHz = hz;
+        g_telemetryChanged = true;
+    }
+    g_telemetryCv.notify_all();
+    EnsureQueryThreadStarted();
+    return hz;
+}
+
+double GetTelemetryRate()
+{
+    std::lock_guard<std::mutex> lock(g_telemetryMutex);
+    return g_telemetryHz;
 }
 
 float GetDataByKey(const char *key)
 {
-    if (g_dataChannel == DataChannel::SERIAL) {
-        return GetDataByKeyFromSerial(key);
+    SensorId id;
+    if (!FindSensorId(key, &id)) {
+        return 0.0f;
+    }
+    return GetData(id);
+}
+
+float GetData(SensorId id)
+{
+    const size_t index = static_cast<size_t>(id);
+    if (index >= kSensorCount) {
+        return 0.0f;
+    }
+    // 单个值是原子读取，无需走 seqlock 重试
+    return SlotOf(g_dataChannel.load(std::memory_order_acquire)).values[index].load(std::memory_order_relaxed);
+}
+
+bool TryGetData(SensorId id, float *out)
+{
+    const size_t index = static_cast<size_t>(id);
+    if (out == nullptr || index >= kSensorCount) {
+        return false;
+    }
+    SensorSnapshot snap;
+    LoadSnapshot(SlotOf(g_dataChannel.load(std::memory_order_acquire)), snap);
+    if (!snap.IsValid(id)) {
+        return false;
+    }
+    *out = snap.values[index];
+    return true;
+}
+
+void GetSnapshot(SensorSnapshot &out)
+{
+    LoadSnapshot(SlotOf(g_dataChannel.load(std::memory_order_acquire)), out);
+}
+
+bool WaitForFrame(uint64_t afterSeq, int timeoutMs, SensorSnapshot *out)
+{
+    const DataChannel channel = g_dataChannel.load(std::memory_order_acquire);
+    auto hasNewer = [afterSeq, channel]() {
+        return SlotOf(channel).frameSeq.load(std::memory_order_acquire) > afterSeq;
+    };
+
+    {
+        std::unique_lock<std::mutex> lock(g_frameMutex);
+        if (!g_frameCv.wait_for(lock, std::chrono::milliseconds(timeoutMs > 0 ? timeoutMs : 0), hasNewer)) {
+            return false;
+        }
+    }
+
+    if (out != nullptr) {
+        LoadSnapshot(SlotOf(channel), *out);
     }
-    return GetDataByKeyFromUdp(key);
+    return true;
 }
 
 int SendCommand(const char *command)
 {
-    if (g_dataChannel == DataChannel::SERIAL) {
+    if (GetCommandPath() == DataChannel::SERIAL) {
         return SendCaptureFromSerial(command);
     }
     return SendCaptureFromUdp(command);
 }
 
+DataChannel GetCommandPath()
+{
+    const DataChannel channel = g_dataChannel.load(std::memory_order_acquire);
+    if (channel != DataChannel::MULTIPATH) {
+        return channel;
+    }
+    std::lock_guard<std::mutex> lock(g_mergeMutex);
+    const int64_t now = MonotonicMs();
+    const size_t current = g_commandPath.load(std::memory_order_relaxed);
+    if (!PathAliveLocked(0, now) && !PathAliveLocked(1, now)) {
+        // 两条路径都收不到帧：无从比较，轮流试探（查询线程每秒一次），哪条先恢复就用哪条
+        g_commandPath.store(1 - current, std::memory_order_relaxed);
+        return PathChannel(current);
+    }
+    UpdateRouteLocked(now);
+    return PathChannel(g_commandPath.load(std::memory_order_relaxed));
+}
+
+FrameFormat DecodeFrame(const uint8_t *data, size_t len, SensorSnapshot &out)
+{
+    if (data == nullptr || len == 0) {
+        return FrameFormat::INVALID;
+    }
+    out.timestampMs = MonotonicMs();
+    if (sensor_frame::IsBinary(data, len)) {
+        return DecodeFrameBinary(data, len, out) ? FrameFormat::BINARY : FrameFormat::INVALID;
+    }
+    // 旧固件的文本帧
+    DecodeFrameText(reinterpret_cast<const char *>(data), len, out);
+    return FrameFormat::TEXT;
+}
+
+bool TrackDeviceSeq(uint32_t seq, uint32_t &lastSeq, uint64_t &lost)
+{
+    lost = 0;
+    if (lastSeq != 0 && seq == lastSeq) {
+        return false;
+    }
+    // seq 回退视为固件重启，从新序号重新计数
+    if (lastSeq != 0 && seq > lastSeq) {
+        lost = seq - lastSeq - 1;
+    }
+    lastSeq = seq;
+    return true;
+}
+
+void ResetDeviceSeq(DataChannel channel)
+{
+    g_stats[ChannelIndex(channel)].lastDeviceSeq = 0;
+}
+
+FrameFormat PublishFrame(DataChannel source, const uint8_t *data, size_t len, SensorSnapshot *decoded)
+{
+    if (data == nullptr || len == 0) {
+        return FrameFormat::INVALID;
+    }
+    ChannelStats &stats = g_stats[ChannelIndex(source)];
+    SensorSnapshot snap;
+    const FrameFormat format = DecodeFrame(data, len, snap);
+    if (format == FrameFormat::INVALID) {
+        stats.invalidFrames.fetch_add(1, std::memory_order_relaxed);
+        return format;
+    }
+    if (format == FrameFormat::TEXT) {
+        stats.textFrames.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        uint64_t lost = 0;
+        if (!TrackDeviceSeq(snap.deviceSeq, stats.lastDeviceSeq, lost)) {
+            stats.duplicateFrames.fetch_add(1, std::memory_order_relaxed);
+            return FrameFormat::INVALID;
+        }
+        stats.lostFrames.fetch_add(lost, std::memory_order_relaxed);
+        stats.binaryFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+    snap.seq = StoreSnapshot(SlotOf(source), snap);
+    const DataChannel current = g_dataChannel.load(std::memory_order_acquire);
+    if (source == current) {
+        HistoryAppend(snap);
+        SensorLogAppend(snap);
+        SensorBatchAppend(snap);
+    } else if (current == DataChannel::MULTIPATH) {
+        MergeFrame(source, format, data, len, snap);
+    }
+
+    {
+        // 空临界区：保证与 WaitForFrame 的谓词检查不丢失唤醒
+        std::lock_guard<std::mutex> lock(g_frameMutex);
+    }
+    g_frameCv.notify_all();
+
+    if (decoded != nullptr) {
+        *decoded = snap;
+    }
+    return format;
+}
+
+size_t FormatFrameText(const SensorSnapshot &snap, char *buf, size_t cap)
+{
+    if (buf == nullptr || cap == 0) {
+        return 0;
+    }
+    size_t len = 0;
+    buf[0] = '\0';
+    for (size_t i = 0; i < kSensorCount; i++) {
+        if ((snap.validMask & (1u << i)) == 0) {
+            continue;
+        }
+        const int n = std::snprintf(buf + len, cap - len, "%s:%.3f;", kSensorKeys[i], snap.values[i]);
+        if (n < 0 || static_cast<size_t>(n) >= cap - len) {
+            buf[len] = '\0';
+            break;
+        }
+        len += static_cast<size_t>(n);
+    }
+    return len;
+}
+
+FrameStats GetFrameStats(DataChannel channel)
+{
+    const ChannelStats &stats = g_stats[ChannelIndex(channel)];
+    FrameStats out;
+    out.textFrames = stats.textFrames.load(std::memory_order_relaxed);
+    out.binaryFrames = stats.binaryFrames.load(std::memory_order_relaxed);
+    out.lostFrames = stats.lostFrames.load(std::memory_order_relaxed);
+    out.duplicateFrames = stats.duplicateFrames.load(std::memory_order_relaxed);
+    out.invalidFrames = stats.invalidFrames.load(std::memory_order_relaxed);
+    return out;
+}
+
+PathStats GetPathStats(DataChannel path)
+{
+    PathStats out;
+    if (path == DataChannel::MULTIPATH) {
+        return out;
+    }
+    std::lock_guard<std::mutex> lock(g_mergeMutex);
+    const PathHealth &health = g_paths[ChannelIndex(path)];
+    out.frames = health.frames;
+    out.firstArrivals = health.firstArrivals;
+    out.lateCopies = health.lateCopies;
+    out.missed = health.missed;
+    out.deliveryRatio = health.deliveryRatio;
+    out.lagMs = health.lagMs;
+    out.lastArrivalMs = health.lastArrivalMs;
+    return out;
+}
+
 } // namespace sensor
@@ -0,0 +1,183 @@
+#include "sensor_deadband.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace mqttc {
+
+namespace {
+
+constexpr int64_t kDefaultKeyframeIntervalMs = 300 * 1000;
+
+struct Band {
+    float absolute;
+    float relative;
+};
+
+struct State {
+    std::mutex mutex;
+    bool enabled = false;
+    int64_t keyframeIntervalMs = kDefaultKeyframeIntervalMs;
+    Band bands[sensor::kSensorCount];
+
+    // 最近一次发布的值（keyframe 全部更新，delta 只更新变化的通道）
+    bool haveBaseline = false;
+    bool forceKeyframe = false;
+    float last[sensor::kSensorCount] = {0};
+    int lastAlarm = 0;
+    int64_t lastKeyframeMs = 0;
+
+    SensorDeadbandStats stats;
+    SensorKeyframePublisher publisher;
+
+    State()
+    {
+        // 默认死区取 Qt 端的显示精度：小于它的变化在界面上看不出来
+        auto set = [this](sensor::SensorId id, float absolute) {
+            bands[static_cast<size_t>(id)] = Band{absolute, 0.0f};
+        };
+        set(sensor::SensorId::HUMI, 1.0f);
+        set(sensor::SensorId::TEMP, 0.1f);
+        set(sensor::SensorId::CH2O, 0.01f);
+        set(sensor::SensorId::TVOC, 0.01f);
+        set(sensor::SensorId::CO2, 1.0f);
+        set(sensor::SensorId::SOIL_HUMI, 1.0f);
+        set(sensor::SensorId::SOIL_TEMP, 0.1f);
+        set(sensor::SensorId::EC, 0.01f);
+        set(sensor::SensorId::PH, 0.01f);
+        set(sensor::SensorId::N, 0.1f);
+        set(sensor::SensorId::P, 0.1f);
+        set(sensor::SensorId::K, 0.1f);
+        set(sensor::SensorId::SALT, 0.1f);
+        set(sensor::SensorId::TDS, 0.1f);
+        set(sensor::SensorId::LIGHT, 1.0f);
+    }
+};
+
+State &GetState()
+{
+    static State state;
+    return state;
+}
+
+bool Changed(float v, float last, const Band &band)
+{
+    const float d = std::fabs(v - last);
+    const float threshold = std::max(band.absolute, band.relative * std::fabs(last));
+    // 死区为 0 时任何变化都算；否则达到死区即算（整数通道变化 1 也要上报）
+    return d > 0.0f && d >= threshold;
+}
+
+} // namespace
+
+void SetSensorDeadbandEnabled(bool enabled, int keyframeIntervalSec)
+{
+    State &s = GetState();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (enabled != s.enabled) {
+        s.forceKeyframe = true; // 切换后从一帧完整数据开始
+    }
+    s.enabled = enabled;
+    if (keyframeIntervalSec > 0) {
+        s.keyframeIntervalMs = static_cast<int64_t>(keyframeIntervalSec) * 1000;
+    }
+}
+
+bool IsSensorDeadbandEnabled()
+{
+    State &s = GetState();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.enabled;
+}
+
+bool SetSensorDeadband(sensor::SensorId id, float absolute, float relative)
+{
+    const size_t idx = static_cast<size_t>(id);
+    if (idx >= sensor::kSensorCount || !(absolute >= 0.0f) || !(relative >= 0.0f)) {
+        return false;
+    }
+    State &s = GetState();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.bands[idx] = Band{absolute, relative};
+    return true;
+}
+
+SensorUpdate NextSensorUpdate(const sensor::SensorSnapshot &snap, int alarm, int64_t nowMs)
+{
+    State &s = GetState();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    SensorUpdate update;
+    const bool keyframe = !s.enabled || !s.haveBaseline || s.forceKeyframe ||
+                          nowMs - s.lastKeyframeMs >= s.keyframeIntervalMs;
+    if (keyframe) {
+        update.kind = SensorUpdateKind::KEYFRAME;
+        std::copy(snap.values, snap.values + sensor::kSensorCount, s.last);
+        s.lastAlarm = alarm;
+        s.lastKeyframeMs = nowMs;
+        s.haveBaseline = true;
+        s.forceKeyframe = false;
+        s.stats.keyframes++;
+        return update;
+    }
+
+    for (size_t i = 0; i < sensor::kSensorCount; i++) {
+        if ((snap.validMask & (1u << i)) == 0) {
+            continue; // 本帧没有该通道
+        }
+        if (Changed(snap.values[i], s.last[i], s.bands[i])) {
+            update.changedMask |= 1u << i;
+            s.last[i] = snap.values[i];
+        }
+    }
+    update.alarmChanged = alarm != s.lastAlarm;
+    s.lastAlarm = alarm;
+
+    if (update.changedMask == 0 && !update.alarmChanged) {
+        update.kind = SensorUpdateKind::NONE;
+        s.stats.suppressed++;
+    } else {
+        update.kind = SensorUpdateKind::DELTA;
+        s.stats.deltas++;
+    }
+    return update;
+}
+
+void ForceSensorKeyframe()
+{
+    State &s = GetState();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.forceKeyframe = true;
+}
+
+void SetSensorKeyframePublisher(SensorKeyframePublisher publisher)
+{
+    State &s = GetState();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.publisher = std::move(publisher);
+}
+
+void RequestSensorKeyframe()
+{
+    SensorKeyframePublisher publisher;
+    {
+        State &s = GetState();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.forceKeyframe = true;
+        publisher = s.publisher;
+    }
+    // 在锁外发布：发布路径会再次调用 NextSensorUpdate
+    if (publisher) {
+        publisher();
+    }
+}
+
+SensorDeadbandStats GetSensorDeadbandStats()
+{
+    State &s = GetState();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.stats;
+}
+
+} // namespace mqttc
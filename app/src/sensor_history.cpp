@@ -0,0 +1,214 @@
+#include "sensor_history.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+namespace {
+
+// 单次查询最多扫描的桶数：超过则换更粗的层级，保证查询开销与运行时长无关
+constexpr size_t kMaxScanBuckets = 256;
+
+// 一个分辨率层级：按通道分列存储（columnar），环形覆盖最旧的桶
+struct Tier {
+    int64_t widthMs;   // 桶宽；0 表示原始层（每帧一个桶）
+    size_t capacity;
+    size_t head = 0;   // 最新桶下标
+    size_t size = 0;
+    bool wrapped = false; // 是否已覆盖过旧数据
+
+    std::vector<int64_t> startMs;
+    std::vector<float> minV[sensor::kSensorCount];
+    std::vector<float> maxV[sensor::kSensorCount];
+    std::vector<float> sum[sensor::kSensorCount];
+    std::vector<uint16_t> count[sensor::kSensorCount];
+    std::vector<float> last[sensor::kSensorCount];
+
+    Tier(int64_t width, size_t cap) : widthMs(width), capacity(cap), startMs(cap, 0)
+    {
+        for (size_t c = 0; c < sensor::kSensorCount; c++) {
+            minV[c].assign(cap, 0.0f);
+            maxV[c].assign(cap, 0.0f);
+            sum[c].assign(cap, 0.0f);
+            count[c].assign(cap, 0);
+            last[c].assign(cap, 0.0f);
+        }
+    }
+
+    // 第 age 个桶（0 = 最新）
+    size_t IndexAt(size_t age) const
+    {
+        return (head + capacity - age) % capacity;
+    }
+
+    void OpenBucket(int64_t bucketStart)
+    {
+        if (size > 0) {
+            head = (head + 1) % capacity;
+        }
+        if (size < capacity) {
+            size++;
+        } else {
+            wrapped = true;
+        }
+        startMs[head] = bucketStart;
+        for (size_t c = 0; c < sensor::kSensorCount; c++) {
+            count[c][head] = 0;
+            sum[c][head] = 0.0f;
+        }
+    }
+
+    void Append(const sensor::SensorSnapshot &snap)
+    {
+        const int64_t bucketStart = widthMs > 0 ? (snap.timestampMs / widthMs) * widthMs : snap.timestampMs;
+        if (widthMs == 0 || size == 0 || startMs[head] != bucketStart) {
+            OpenBucket(bucketStart);
+        }
+
+        for (size_t c = 0; c < sensor::kSensorCount; c++) {
+            if (!snap.IsValid(static_cast<sensor::SensorId>(c))) {
+                continue;
+            }
+            const float v = snap.values[c];
+            uint16_t &n = count[c][head];
+            if (n == 0) {
+                minV[c][head] = v;
+                maxV[c][head] = v;
+            } else {
+                minV[c][head] = std::min(minV[c][head], v);
+                maxV[c][head] = std::max(maxV[c][head], v);
+            }
+            sum[c][head] += v;
+            last[c][head] = v;
+            if (n < std::numeric_limits<uint16_t>::max()) {
+                n++;
+            }
+        }
+    }
+
+    // 桶 [start, start+width) 是否与窗口 [fromMs, +inf) 有交集
+    bool Overlaps(size_t idx, int64_t fromMs) const
+    {
+        const int64_t end = startMs[idx] + (widthMs > 0 ? widthMs : 1);
+        return end > fromMs;
+    }
+};
+
+std::mutex g_historyMutex;
+Tier g_tiers[sensor::kHistoryTierCount] = {
+    Tier(0, sensor::kHistoryRawCapacity),
+    Tier(60 * 1000, sensor::kHistoryMinuteCapacity),
+    Tier(15 * 60 * 1000, sensor::kHistoryQuarterCapacity),
+};
+
+// 在某一层上聚合窗口内的数据；scanLimit 内未覆盖整个窗口则返回 false（需换更粗层级）
+bool AggregateTier(const Tier &tier, size_t channel, int64_t fromMs, size_t scanLimit, sensor::HistoryStats &out)
+{
+    out = sensor::HistoryStats();
+    double total = 0.0;
+    bool reachedWindowStart = false;
+
+    size_t age = 0;
+    for (; age < tier.size; age++) {
+        const size_t idx = tier.IndexAt(age);
+        if (!tier.Overlaps(idx, fromMs)) {
+            reachedWindowStart = true;
+            break;
+        }
+        if (age >= scanLimit) {
+            return false;
+        }
+
+        const uint16_t n = tier.count[channel][idx];
+        if (n == 0) {
+            continue;
+        }
+        if (out.count == 0) {
+            out.min = tier.minV[channel][idx];
+            out.max = tier.maxV[channel][idx];
+            out.last = tier.last[channel][idx];
+            out.lastTimestampMs = tier.startMs[idx];
+        } else {
+            out.min = std::min(out.min, tier.minV[channel][idx]);
+            out.max = std::max(out.max, tier.maxV[channel][idx]);
+        }
+        total += tier.sum[channel][idx];
+        out.count += n;
+    }
+
+    // 扫完整个环仍未越过窗口起点：只有从未覆盖过旧数据时才算完整覆盖
+    if (!reachedWindowStart && tier.wrapped) {
+        return false;
+    }
+    if (out.count > 0) {
+        out.mean = static_cast<float>(total / out.count);
+    }
+    return true;
+}
+
+} // namespace
+
+namespace sensor {
+
+void HistoryAppend(const SensorSnapshot &snap)
+{
+    std::lock_guard<std::mutex> lock(g_historyMutex);
+    for (Tier &tier : g_tiers) {
+        tier.Append(snap);
+    }
+}
+
+bool QueryHistory(SensorId id, int64_t windowMs, HistoryStats &out)
+{
+    const size_t channel = static_cast<size_t>(id);
+    if (channel >= kSensorCount || windowMs <= 0) {
+        return false;
+    }
+    const int64_t fromMs = MonotonicMs() - windowMs;
+
+    std::lock_guard<std::mutex> lock(g_historyMutex);
+    for (size_t t = 0; t < kHistoryTierCount; t++) {
+        // 最粗一层不再受扫描上限约束（其容量本身有界）
+        const size_t limit = (t + 1 == kHistoryTierCount) ? g_tiers[t].capacity : kMaxScanBuckets;
+        if (AggregateTier(g_tiers[t], channel, fromMs, limit, out)) {
+            return out.count > 0;
+        }
+    }
+    return false;
+}
+
+size_t ReadHistorySeries(SensorId id, HistoryTier tier, int64_t windowMs, std::vector<HistoryPoint> &out)
+{
+    out.clear();
+    const size_t channel = static_cast<size_t>(id);
+    const size_t t = static_cast<size_t>(tier);
+    if (channel >= kSensorCount || t >= kHistoryTierCount || windowMs <= 0) {
+        return 0;
+    }
+    const int64_t fromMs = MonotonicMs() - windowMs;
+
+    std::lock_guard<std::mutex> lock(g_historyMutex);
+    const Tier &ring = g_tiers[t];
+    size_t inWindow = 0;
+    while (inWindow < ring.size && ring.Overlaps(ring.IndexAt(inWindow), fromMs)) {
+        inWindow++;
+    }
+
+    out.reserve(inWindow);
+    for (size_t age = inWindow; age-- > 0;) {
+        const size_t idx = ring.IndexAt(age);
+        const uint16_t n = ring.count[channel][idx];
+        if (n == 0) {
+            continue;
+        }
+        HistoryPoint pt;
+        pt.timestampMs = ring.startMs[idx];
+        pt.min = ring.minV[channel][idx];
+        pt.max = ring.maxV[channel][idx];
+        pt.mean = ring.sum[channel][idx] / n;
+        out.push_back(pt);
+    }
+    return out.size();
+}
+
+} // namespace sensor
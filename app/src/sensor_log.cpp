@@ -0,0 +1,691 @@
+#include "sensor_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "crc32.h"
+
+namespace sensor {
+
+namespace {
+
+constexpr uint32_t kBlockMagic = 0x534C4F47u; // "SLOG"
+constexpr uint16_t kBlockVersion = 1;
+constexpr size_t kSegmentBytes = kSensorLogBlockSize * kSensorLogBlocksPerSegment;
+
+// 写线程：最长 2s 把未满的尾块写出一次，5s 做一次 fdatasync
+constexpr int kFlushIntervalMs = 2000;
+constexpr int kSyncIntervalMs = 5000;
+// 待写队列上限：写线程停顿超过约 1 小时（1Hz）才会丢数据
+constexpr size_t kMaxPendingRecords = 4096;
+
+// 补传线程：每秒最多补传的记录数，发布失败后的退避时间
+constexpr size_t kReplayRecordsPerSecond = 20;
+constexpr int kReplayRetryMs = 5000;
+
+struct BlockHeader {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t version;
+    uint64_t firstId;
+    uint32_t crc;      // CRC32(header with crc=0 + count records)
+    uint32_t reserved;
+};
+
+struct Block {
+    BlockHeader header;
+    SensorLogRecord records[kSensorLogRecordsPerBlock];
+};
+
+static_assert(sizeof(SensorLogRecord) == 80, "SensorLogRecord layout is part of the on-disk format");
+static_assert(sizeof(BlockHeader) == 24, "BlockHeader layout is part of the on-disk format");
+static_assert(sizeof(Block) <= kSensorLogBlockSize, "block does not fit in kSensorLogBlockSize");
+
+uint32_t BlockCrc(const Block &block)
+{
+    BlockHeader h = block.header;
+    h.crc = 0;
+    uint32_t crc = crc32::Compute(&h, sizeof(h));
+    return crc32::Update(crc, block.records, sizeof(SensorLogRecord) * h.count);
+}
+
+bool BlockValid(const Block &block, uint64_t expectFirstId)
+{
+    const BlockHeader &h = block.header;
+    return h.magic == kBlockMagic && h.version == kBlockVersion && h.firstId == expectFirstId &&
+           h.count > 0 && h.count <= kSensorLogRecordsPerBlock && h.crc == BlockCrc(block);
+}
+
+// 一个段文件：固定大小、预分配，只读 mmap 供扫描；写入走 pwrite（同一页缓存，映射可见）
+struct Segment {
+    uint64_t baseId = 0;
+    int fd = -1;
+    const uint8_t *map = nullptr;
+
+    ~Segment()
+    {
+        if (map != nullptr) {
+            munmap(const_cast<uint8_t *>(map), kSegmentBytes);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    const Block &BlockAt(size_t index) const
+    {
+        return *reinterpret_cast<const Block *>(map + index * kSensorLogBlockSize);
+    }
+};
+
+using SegmentPtr = std::shared_ptr<Segment>;
+
+std::string g_dir;
+std::atomic<bool> g_started{false};
+
+// 段表（按 baseId 排序）；扫描方复制 shared_ptr 后在锁外读取，删段不会让映射失效
+std::mutex g_segMutex;
+std::map<uint64_t, SegmentPtr> g_segments;
+
+// 待写队列
+std::mutex g_queueMutex;
+std::condition_variable g_queueCv;
+std::deque<SensorLogRecord> g_pending;
+
+std::atomic<uint64_t> g_nextId{0};    // 下一条记录的 id（入队时分配）
+std::atomic<uint64_t> g_flushedId{0}; // id < g_flushedId 的记录已写入文件
+std::atomic<uint64_t> g_dropped{0};
+
+// 补传状态（持久化到 replay.state）
+std::mutex g_replayMutex;
+std::condition_variable g_replayCv;
+bool g_gapOpen = false;      // 实时上报失败中
+uint64_t g_gapFrom = 0;      // 失败开始时的第一条未上报记录
+bool g_replayPending = false;
+uint64_t g_replayFrom = 0;   // 待补传区间 [g_replayFrom, g_replayTo]
+uint64_t g_replayTo = 0;
+SensorLogPublisher g_publisher;
+
+uint64_t SegmentBase(uint64_t id)
+{
+    return id - id % kSensorLogRecordsPerSegment;
+}
+
+std::string SegmentPath(uint64_t baseId)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "/seg_%016llx.log", static_cast<unsigned long long>(baseId));
+    return g_dir + name;
+}
+
+int64_t WallMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool MakeDirs(const std::string &path)
+{
+    for (size_t pos = 1; pos <= path.size(); pos++) {
+        if (pos == path.size() || path[pos] == '/') {
+            const std::string sub = path.substr(0, pos);
+            if (mkdir(sub.c_str(), 0755) != 0 && errno != EEXIST) {
+                std::printf("sensor_log: mkdir %s failed: %s\n", sub.c_str(), std::strerror(errno));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+SegmentPtr OpenSegment(uint64_t baseId, bool create)
+{
+    const std::string path = SegmentPath(baseId);
+    int fd = open(path.c_str(), create ? (O_RDWR | O_CREAT) : O_RDWR, 0644);
+    if (fd < 0) {
+        std::printf("sensor_log: open %s failed: %s\n", path.c_str(), std::strerror(errno));
+        return nullptr;
+    }
+
+    // 预分配整段：后续写入不再改变文件大小（元数据），fdatasync 只需刷数据块。
+    // 已有的段也可能不足整段（创建后、ftruncate 前断电，或分区写满时 ftruncate 失败），
+    // 按整段 mmap 后访问文件末尾之外会 SIGBUS，因此先补齐；补出的部分全零，恢复时校验不通过
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::printf("sensor_log: fstat %s failed: %s\n", path.c_str(), std::strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    if (st.st_size < static_cast<off_t>(kSegmentBytes) && ftruncate(fd, static_cast<off_t>(kSegmentBytes)) != 0) {
+        std::printf("sensor_log: ftruncate %s failed: %s\n", path.c_str(), std::strerror(errno));
+        close(fd);
+        if (st.st_size == 0) {
+            unlink(path.c_str()); // 空文件不含数据，删掉免得每次启动都重试
+        }
+        return nullptr;
+    }
+
+    void *map = mmap(nullptr, kSegmentBytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        std::printf("sensor_log: mmap %s failed: %s\n", path.c_str(), std::strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+
+    auto seg = std::make_shared<Segment>();
+    seg->baseId = baseId;
+    seg->fd = fd;
+    seg->map = static_cast<const uint8_t *>(map);
+    return seg;
+}
+
+// 超出保留段数时删除最旧的段（调用方持有 g_segMutex）
+void EnforceRetentionLocked()
+{
+    while (g_segments.size() > static_cast<size_t>(SENSOR_LOG_MAX_SEGMENTS)) {
+        auto oldest = g_segments.begin();
+        unlink(SegmentPath(oldest->first).c_str());
+        g_segments.erase(oldest);
+    }
+}
+
+SegmentPtr FindSegment(uint64_t baseId)
+{
+    std::lock_guard<std::mutex> lock(g_segMutex);
+    auto it = g_segments.find(baseId);
+    return it == g_segments.end() ? nullptr : it->second;
+}
+
+// ---------------- 补传状态持久化 ----------------
+
+std::string StatePath()
+{
+    return g_dir + "/replay.state";
+}
+
+// 调用方持有 g_replayMutex。写临时文件再 rename，断电时要么是旧状态要么是新状态
+void SaveReplayStateLocked()
+{
+    const std::string path = StatePath();
+    const std::string tmp = path + ".tmp";
+    FILE *fp = std::fopen(tmp.c_str(), "w");
+    if (fp == nullptr) {
+        return;
+    }
+    std::fprintf(fp, "%d %llu %d %llu %llu\n",
+                 g_gapOpen ? 1 : 0, static_cast<unsigned long long>(g_gapFrom),
+                 g_replayPending ? 1 : 0, static_cast<unsigned long long>(g_replayFrom),
+                 static_cast<unsigned long long>(g_replayTo));
+    std::fflush(fp);
+    fsync(fileno(fp));
+    std::fclose(fp);
+    rename(tmp.c_str(), path.c_str());
+}
+
+void LoadReplayState()
+{
+    FILE *fp = std::fopen(StatePath().c_str(), "r");
+    if (fp == nullptr) {
+        return;
+    }
+    int gapOpen = 0;
+    int pending = 0;
+    unsigned long long gapFrom = 0;
+    unsigned long long from = 0;
+    unsigned long long to = 0;
+    if (std::fscanf(fp, "%d %llu %d %llu %llu", &gapOpen, &gapFrom, &pending, &from, &to) == 5) {
+        std::lock_guard<std::mutex> lock(g_replayMutex);
+        g_gapOpen = gapOpen != 0;
+        g_gapFrom = gapFrom;
+        g_replayPending = pending != 0 && from <= to;
+        g_replayFrom = from;
+        g_replayTo = to;
+    }
+    std::fclose(fp);
+}
+
+// ---------------- 启动恢复 ----------------
+
+// 扫描目录中的段文件，找到最后一个校验通过的块，确定下一条记录的 id 与尾块内容
+bool Recover(Block &tail, uint64_t &nextId)
+{
+    DIR *dir = opendir(g_dir.c_str());
+    if (dir == nullptr) {
+        return false;
+    }
+    std::vector<uint64_t> bases;
+    while (struct dirent *ent = readdir(dir)) {
+        unsigned long long base = 0;
+        char tailChar = 0;
+        if (std::sscanf(ent->d_name, "seg_%16llx.lo%c", &base, &tailChar) == 2 && tailChar == 'g') {
+            bases.push_back(base);
+        }
+    }
+    closedir(dir);
+    std::sort(bases.begin(), bases.end());
+
+    std::memset(&tail, 0, sizeof(tail));
+    nextId = 0;
+
+    std::lock_guard<std::mutex> lock(g_segMutex);
+    for (uint64_t base : bases) {
+        if (base % kSensorLogRecordsPerSegment != 0) {
+            continue;
+        }
+        SegmentPtr seg = OpenSegment(base, false);
+        if (seg) {
+            g_segments[base] = seg;
+        }
+    }
+    EnforceRetentionLocked();
+
+    // 从最新段往前找：新段只在上一段写满后创建，因此最新段为空时 nextId 就是它的 baseId
+    for (auto it = g_segments.rbegin(); it != g_segments.rend(); ++it) {
+        const Segment &seg = *it->second;
+        for (size_t b = kSensorLogBlocksPerSegment; b-- > 0;) {
+            const Block &block = seg.BlockAt(b);
+            const uint64_t firstId = seg.baseId + b * kSensorLogRecordsPerBlock;
+            if (!BlockValid(block, firstId)) {
+                continue;
+            }
+            nextId = firstId + block.header.count;
+            if (block.header.count < kSensorLogRecordsPerBlock) {
+                std::memcpy(&tail, &block, sizeof(Block));
+            }
+            return true;
+        }
+        nextId = seg.baseId;
+        return true;
+    }
+    return true;
+}
+
+// ---------------- 写线程 ----------------
+
+class Writer {
+public:
+    Writer(const Block &tail, uint64_t nextId) : block_(tail)
+    {
+        if (block_.header.count == 0) {
+            ResetBlock(nextId);
+        }
+        lastSync_ = std::chrono::steady_clock::now();
+    }
+
+    void Run()
+    {
+        std::vector<SensorLogRecord> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(g_queueMutex);
+                g_queueCv.wait_for(lock, std::chrono::milliseconds(kFlushIntervalMs),
+                                   [] { return g_pending.size() >= kSensorLogRecordsPerBlock; });
+                batch.assign(g_pending.begin(), g_pending.end());
+                g_pending.clear();
+            }
+
+            for (const SensorLogRecord &rec : batch) {
+                Add(rec);
+            }
+            // 周期性地把未满的尾块也写出去（同一位置覆盖写），最多丢失 kFlushIntervalMs 内的数据
+            if (dirty_) {
+                WriteBlock();
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (seg_ && synced_ != g_flushedId.load() &&
+                now - lastSync_ >= std::chrono::milliseconds(kSyncIntervalMs)) {
+                fdatasync(seg_->fd);
+                synced_ = g_flushedId.load();
+                lastSync_ = now;
+            }
+        }
+    }
+
+private:
+    void ResetBlock(uint64_t firstId)
+    {
+        std::memset(&block_, 0, sizeof(block_));
+        block_.header.magic = kBlockMagic;
+        block_.header.version = kBlockVersion;
+        block_.header.firstId = firstId;
+    }
+
+    void Add(const SensorLogRecord &rec)
+    {
+        // 队列溢出丢弃的记录留空位（wallMs=0），保持块内 id 连续、可按下标定位
+        while (block_.header.firstId + block_.header.count < rec.id) {
+            SensorLogRecord hole;
+            std::memset(&hole, 0, sizeof(hole));
+            hole.id = block_.header.firstId + block_.header.count;
+            Put(hole);
+        }
+        Put(rec);
+    }
+
+    void Put(const SensorLogRecord &rec)
+    {
+        block_.records[block_.header.count++] = rec;
+        dirty_ = true;
+        if (block_.header.count == kSensorLogRecordsPerBlock) {
+            WriteBlock();
+            ResetBlock(block_.header.firstId + kSensorLogRecordsPerBlock);
+        }
+    }
+
+    bool EnsureSegment(uint64_t baseId)
+    {
+        if (seg_ && seg_->baseId == baseId) {
+            return true;
+        }
+        if (seg_) {
+            // 切段前把旧段刷盘，之后旧段不会再被写
+            fdatasync(seg_->fd);
+        }
+        SegmentPtr seg = FindSegment(baseId);
+        if (!seg) {
+            seg = OpenSegment(baseId, true);
+            if (!seg) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(g_segMutex);
+            g_segments[baseId] = seg;
+            EnforceRetentionLocked();
+        }
+        seg_ = seg;
+        return true;
+    }
+
+    void WriteBlock()
+    {
+        dirty_ = false;
+        const uint64_t firstId = block_.header.firstId;
+        if (!EnsureSegment(SegmentBase(firstId))) {
+            return;
+        }
+        block_.header.crc = BlockCrc(block_);
+
+        const size_t index = static_cast<size_t>((firstId - seg_->baseId) / kSensorLogRecordsPerBlock);
+        const off_t offset = static_cast<off_t>(index * kSensorLogBlockSize);
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(&block_);
+        size_t done = 0;
+        while (done < sizeof(Block)) {
+            ssize_t n = pwrite(seg_->fd, p + done, sizeof(Block) - done, offset + static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                std::printf("sensor_log: pwrite failed: %s\n", std::strerror(errno));
+                return;
+            }
+            done += static_cast<size_t>(n);
+        }
+        g_flushedId.store(firstId + block_.header.count);
+    }
+
+    Block block_;
+    SegmentPtr seg_;
+    bool dirty_ = false;
+    uint64_t synced_ = 0;
+    std::chrono::steady_clock::time_point lastSync_;
+};
+
+// ---------------- 补传线程 ----------------
+
+void ReplayLoop()
+{
+    for (;;) {
+        SensorLogPublisher publisher;
+        uint64_t from = 0;
+        uint64_t to = 0;
+        {
+            std::unique_lock<std::mutex> lock(g_replayMutex);
+            g_replayCv.wait(lock, [] { return g_replayPending && g_publisher; });
+            publisher = g_publisher;
+            from = g_replayFrom;
+            to = g_replayTo;
+        }
+
+        // 只补传已落盘的记录；区间尾部尚在写队列中时等写线程刷出
+        const uint64_t flushed = g_flushedId.load();
+        uint64_t lastSent = 0;
+        bool sentAny = false;
+        bool failed = false;
+        SensorLogScan(from, kReplayRecordsPerSecond, [&](const SensorLogRecord &rec) {
+            if (rec.id > to) {
+                return false;
+            }
+            if (!publisher(rec)) {
+                failed = true;
+                return false;
+            }
+            lastSent = rec.id;
+            sentAny = true;
+            return true;
+        });
+
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(g_replayMutex);
+            // 期间可能合并了新区间：只推进起点，不覆盖 g_replayTo
+            if (sentAny && g_replayFrom <= lastSent) {
+                g_replayFrom = lastSent + 1;
+            } else if (!sentAny && !failed && to + kSensorLogRecordsPerBlock < flushed && g_replayFrom == from) {
+                // 区间整体早于尾块（不会再被覆盖写）却一条也读不到：记录已被保留策略删除或块损坏，放弃这段
+                g_replayFrom = to + 1;
+            }
+            if (g_replayFrom > g_replayTo) {
+                g_replayPending = false;
+                done = true;
+            }
+            if (sentAny || done) {
+                SaveReplayStateLocked();
+            }
+        }
+
+        if (done) {
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(failed ? kReplayRetryMs : 1000));
+    }
+}
+
+} // namespace
+
+bool SensorLogStart(const char *dir)
+{
+    static std::mutex startMutex;
+    std::lock_guard<std::mutex> lock(startMutex);
+    if (g_started) {
+        return true;
+    }
+
+    g_dir = (dir != nullptr && dir[0] != '\0') ? dir : SENSOR_LOG_DIR;
+    if (!MakeDirs(g_dir)) {
+        return false;
+    }
+
+    Block tail;
+    uint64_t nextId = 0;
+    if (!Recover(tail, nextId)) {
+        return false;
+    }
+    g_nextId.store(nextId);
+    g_flushedId.store(nextId);
+    LoadReplayState();
+    std::printf("sensor_log: %s, next id %llu, %zu segment(s)\n", g_dir.c_str(),
+                static_cast<unsigned long long>(nextId), g_segments.size());
+
+    auto writer = std::make_shared<Writer>(tail, nextId);
+    std::thread([writer] { writer->Run(); }).detach();
+    std::thread(ReplayLoop).detach();
+    g_started = true;
+    return true;
+}
+
+void SensorLogAppend(const SensorSnapshot &snap)
+{
+    if (!g_started) {
+        return;
+    }
+
+    SensorLogRecord rec;
+    rec.wallMs = WallMs();
+    rec.validMask = snap.validMask;
+    std::memcpy(rec.values, snap.values, sizeof(rec.values));
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(g_queueMutex);
+        // id 在队列锁内分配，保证队列内 id 连续递增
+        rec.id = g_nextId.fetch_add(1);
+        if (g_pending.size() >= kMaxPendingRecords) {
+            g_pending.pop_front();
+            g_dropped.fetch_add(1);
+        }
+        g_pending.push_back(rec);
+        wake = g_pending.size() >= kSensorLogRecordsPerBlock;
+    }
+    if (wake) {
+        g_queueCv.notify_one();
+    }
+}
+
+size_t SensorLogScan(uint64_t fromId, size_t maxRecords, const std::function<bool(const SensorLogRecord &)> &fn)
+{
+    const uint64_t end = g_flushedId.load();
+    size_t visited = 0;
+    uint64_t id = fromId;
+    SegmentPtr seg;
+
+    while (id < end && visited < maxRecords) {
+        const uint64_t base = SegmentBase(id);
+        if (!seg || seg->baseId != base) {
+            seg = FindSegment(base);
+            if (!seg) {
+                // 该段已被删除：跳到仍存在的下一个段
+                std::lock_guard<std::mutex> lock(g_segMutex);
+                auto it = g_segments.upper_bound(base);
+                if (it == g_segments.end()) {
+                    break;
+                }
+                id = it->first;
+                continue;
+            }
+        }
+
+        const size_t index = static_cast<size_t>((id - base) / kSensorLogRecordsPerBlock);
+        const uint64_t blockFirst = base + index * kSensorLogRecordsPerBlock;
+        const Block &block = seg->BlockAt(index);
+        if (!BlockValid(block, blockFirst)) {
+            // 损坏（或正在覆盖写）的块整体跳过
+            id = blockFirst + kSensorLogRecordsPerBlock;
+            continue;
+        }
+
+        const uint64_t blockEnd = std::min<uint64_t>(blockFirst + block.header.count, end);
+        for (; id < blockEnd && visited < maxRecords; id++) {
+            const SensorLogRecord &rec = block.records[id - blockFirst];
+            if (rec.wallMs == 0) {
+                continue; // 写队列溢出留下的空位
+            }
+            visited++;
+            if (!fn(rec)) {
+                return visited;
+            }
+        }
+        if (block.header.count < kSensorLogRecordsPerBlock) {
+            break; // 未满的块就是尾块
+        }
+    }
+    return visited;
+}
+
+void SensorLogNoteUpload(bool ok)
+{
+    if (!g_started) {
+        return;
+    }
+    // 最近一条已分配 id 的记录即本次上报对应的帧
+    const uint64_t latest = g_nextId.load();
+    if (latest == 0) {
+        return;
+    }
+    const uint64_t current = latest - 1;
+
+    std::lock_guard<std::mutex> lock(g_replayMutex);
+    if (!ok) {
+        if (!g_gapOpen) {
+            g_gapOpen = true;
+            g_gapFrom = current;
+            SaveReplayStateLocked();
+        }
+        return;
+    }
+    if (!g_gapOpen) {
+        return;
+    }
+
+    // 断线期间的记录 [g_gapFrom, current) 进入补传区间；与未补完的区间合并（可能重复，接收端按 recordId 去重）
+    g_gapOpen = false;
+    if (current > g_gapFrom) {
+        const uint64_t to = current - 1;
+        if (g_replayPending) {
+            g_replayFrom = std::min(g_replayFrom, g_gapFrom);
+            g_replayTo = std::max(g_replayTo, to);
+        } else {
+            g_replayFrom = g_gapFrom;
+            g_replayTo = to;
+            g_replayPending = true;
+        }
+    }
+    SaveReplayStateLocked();
+    g_replayCv.notify_all();
+}
+
+void SetSensorLogReplayPublisher(SensorLogPublisher publisher)
+{
+    std::lock_guard<std::mutex> lock(g_replayMutex);
+    g_publisher = std::move(publisher);
+    g_replayCv.notify_all();
+}
+
+SensorLogStats GetSensorLogStats()
+{
+    SensorLogStats stats;
+    stats.nextId = g_nextId.load();
+    stats.flushedId = g_flushedId.load();
+    stats.dropped = g_dropped.load();
+    {
+        std::lock_guard<std::mutex> lock(g_replayMutex);
+        if (g_replayPending) {
+            stats.replayFrom = g_replayFrom;
+            stats.replayTo = g_replayTo;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_segMutex);
+        stats.segments = g_segments.size();
+    }
+    return stats;
+}
+
+} // namespace sensor
@@ -5,8 +5,15 @@
  *   1) 纯文本 UDP：每个 datagram 视为一条文本记录，保存为最新内容
  *   2) 帧式二进制流（可跨 datagram“分包”）：
  *      帧头 0xFE，转义 0x7E，帧尾类型：
- *        - 0xFF：文本帧（传感器字符串），保存为最新内容
- *        - 0x01：相机帧（JPEG bytes），写入 PHOTO_PATH 并通知上层
+ *        - 0xFF：传感器帧，负载为二进制（sensor_frame.h）或旧固件的文本，保存为最新内容
+ *        - 0x01：相机帧（JPEG bytes），交给 image_store（内存中的最新图片 + 原子写入 PHOTO_PATH）并通知上层
+ *   3) 相机分块（camera_chunk.h）：每个 datagram 一个分块，按分块下标写入整张照片的缓冲，
+ *      收到最后一块或 FLAG_POLL 时向节点的 9001 端口回复 ACK / NACK 位图，固件据此选择性重传；
+ *      整张照片 CRC-32 校验通过后交给 image_store
+ *
+ * 线程：收包线程 recvmmsg 批量收进预分配环形队列，解码线程消费队列完成拼帧/解析/写图片。
+ * 多节点：按源 IPv4 地址区分发送方，每个节点独立拼帧并保存最新快照（节点表有上限，静默节点被回收）；
+ * 只有主节点的传感器帧发布到 sensor_data_provider 的 UDP 通道。
  *
  * 说明：UDP 本身不会“拆包”应用层消息；你看到的 1460 字节分段通常来自发送端主动分块
  * 或 TCP 流式读取的分段行为。接收端需要把收到的字节当作连续流来解析，而不能按“包边界”解码。
@@ -20,53 +27,115 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include <algorithm>
-#include <fstream>
+#include <atomic>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "camera_chunk.h"
+#include "crc32.h"
+#include "frame_codec.h"
+#include "image_store.h"
 #include "myserial.h" // FRAME_HEAD/FRAME_END/ESC/CAMERA_END + PHOTO_PATH
-
-extern "C" void NotifyImageCapturedFromNative(const char *path);
+#include "sensor_data_provider.h"
 
 // 与串口通道保持一致的最大长度，避免 JSON 过长
 static const size_t WIFI_UDP_BUF_SIZE = 1024;
 static const size_t WIFI_MAX_FRAME_SIZE = 1024 * 1024; // 1MB，避免异常数据撑爆内存
 
+// 节点表：每个发送方（按源 IPv4 地址区分）一份帧解析状态与最新快照
+static const size_t WIFI_MAX_NODES = 64;
+static const int64_t WIFI_NODE_IDLE_MS = 120 * 1000;  // 超过该时间未收到数据的节点被回收
+static const int64_t WIFI_NODE_SWEEP_MS = 5 * 1000;
+static const size_t WIFI_FRAME_BUF_KEEP = 4 * 1024;   // 大帧（相机）结束后释放多余容量
+static const uint16_t WIFI_CMD_PORT = 9001;           // ESP32 命令端口，分块回复也发到这里
+
 static int g_udpSock = -1;
 static pthread_t g_udpThread;
 static pthread_mutex_t g_udpMutex = PTHREAD_MUTEX_INITIALIZER;
 static bool g_udpInited = false;
 static char g_udpData[WIFI_UDP_BUF_SIZE] = {0};
 
-// 帧式解析状态：跨 UDP datagram 保持
-static int g_frameStatus = 0; // 0=等待帧头, 1=接收数据, 2=转义中
-static std::vector<uint8_t> g_frameBuf;
-
-static uint8_t CalcChecksum(const uint8_t *buf, size_t n)
-{
-    uint8_t sum = 0;
-    for (size_t i = 0; i < n; i++) {
-        sum = static_cast<uint8_t>(sum + buf[i]);
-    }
-    return sum;
-}
-
-static void WriteBytesToFile(const std::vector<uint8_t> &bytes, const char *fileName)
+struct UdpNode {
+    uint32_t ip = 0;      // 网络字节序
+    uint16_t port = 0;    // 最近一次的源端口（节点重启后可能变化，不参与区分）
+
+    // 帧式解析状态：跨 UDP datagram 保持，仅解码线程访问
+    frame_codec::Decoder decoder{WIFI_MAX_FRAME_SIZE};
+
+    // 相机分块重组状态：同一时刻只重组一张照片，仅解码线程访问
+    bool chunkActive = false;
+    camera_chunk::Header chunkFrame = {};  // 正在重组的照片（frameId/chunkCount/frameLen/frameCrc）
+    std::vector<uint8_t> chunkData;        // 整张照片，分块按下标直接写到最终位置
+    std::vector<uint8_t> chunkMissing;     // 缺失位图，格式与 NACK 负载相同
+    uint16_t chunkRemaining = 0;
+    bool chunkDoneValid = false;
+    camera_chunk::Header chunkDone = {};   // 最近完成的照片：迟到的重传只回复 ACK
+
+    // 以下字段由 g_nodesMutex 保护
+    int64_t lastSeenMs = 0;
+    uint64_t frames = 0;
+    uint64_t lostFrames = 0;
+    uint64_t duplicateFrames = 0;
+    uint32_t lastDeviceSeq = 0;
+    sensor::SensorSnapshot latest;
+};
+
+// 节点只由接收线程插入/删除（unordered_map 节点地址稳定），读者持锁遍历
+static pthread_mutex_t g_nodesMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::unordered_map<uint32_t, UdpNode> g_nodes;
+// 主节点：其传感器帧发布到 sensor_data_provider 的 UDP 通道（控制、上报使用），
+// 其余节点只保存在节点表。首个发来传感器帧的节点成为主节点，被回收后由下一个节点接替。
+static uint32_t g_primaryIp = 0;
+static bool g_hasPrimary = false;
+static int64_t g_lastSweepMs = 0;
+
+// 收包线程 -> 解码线程的单生产者单消费者环形队列（预分配，槽位大小覆盖 ESP32 的
+// 1460 字节分块）。head/tail 单调递增，槽位下标取低位。
+static const uint32_t WIFI_RX_RING_SLOTS = 512; // 2 的幂；约 1MB，可容纳一张完整照片的全部分块
+static const unsigned int WIFI_RX_BATCH = 32;   // 每次 recvmmsg 最多取的 datagram 数
+static const int WIFI_RX_SOCKET_BUF = 4 * 1024 * 1024;
+
+struct RxSlot {
+    uint32_t ip;
+    uint16_t port;
+    uint32_t len;
+    uint8_t data[2048];
+};
+
+static RxSlot g_rxRing[WIFI_RX_RING_SLOTS];
+static std::atomic<uint32_t> g_rxHead{0};
+static std::atomic<uint32_t> g_rxTail{0};
+static int g_rxEventFd = -1;
+static pthread_t g_decodeThread;
+
+static struct {
+    std::atomic<uint64_t> datagrams{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> kernelDrops{0};
+    std::atomic<uint64_t> ringOverflows{0};
+    std::atomic<uint64_t> truncated{0};
+    std::atomic<int> rcvbufBytes{0};
+    std::atomic<uint64_t> chunkImages{0};
+    std::atomic<uint64_t> chunkNacks{0};
+    std::atomic<uint64_t> chunkDuplicates{0};
+    std::atomic<uint64_t> chunkCrcErrors{0};
+    std::atomic<uint64_t> chunkAbandoned{0};
+} g_rxStats;
+
+static std::string FormatAddress(uint32_t ip, uint16_t port)
 {
-    if (!fileName) {
-        return;
-    }
-    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
-    if (!file) {
-        perror("open file failed");
-        return;
-    }
-    if (!bytes.empty()) {
-        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
-    }
+    char text[INET_ADDRSTRLEN] = {0};
+    struct in_addr addr;
+    addr.s_addr = ip;
+    inet_ntop(AF_INET, &addr, text, sizeof(text));
+    return std::string(text) + ":" + std::to_string(ntohs(port));
 }
 
 static void SaveLatestTextLocked(const uint8_t *buf, size_t n)
@@ -77,32 +146,123 @@ static void SaveLatestTextLocked(const uint8_t *buf, size_t n)
     g_udpData[copyLen] = '\0';
 }
 
-static void HandleCompleteFrame(uint8_t frameType)
+// 回收长时间静默的节点（调用方持有 g_nodesMutex）
+static void SweepIdleNodesLocked(int64_t now)
+{
+    for (auto it = g_nodes.begin(); it != g_nodes.end();) {
+        if (now - it->second.lastSeenMs > WIFI_NODE_IDLE_MS) {
+            if (g_hasPrimary && it->first == g_primaryIp) {
+                g_hasPrimary = false;
+            }
+            it = g_nodes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// 取得（必要时创建）发送方对应的节点；表满时淘汰最久未活动的节点
+static UdpNode &AcquireNode(uint32_t ip, uint16_t port, int64_t now)
+{
+    pthread_mutex_lock(&g_nodesMutex);
+    if (now - g_lastSweepMs >= WIFI_NODE_SWEEP_MS) {
+        SweepIdleNodesLocked(now);
+        g_lastSweepMs = now;
+    }
+
+    auto it = g_nodes.find(ip);
+    if (it == g_nodes.end()) {
+        if (g_nodes.size() >= WIFI_MAX_NODES) {
+            auto oldest = g_nodes.begin();
+            for (auto cur = g_nodes.begin(); cur != g_nodes.end(); ++cur) {
+                if (cur->second.lastSeenMs < oldest->second.lastSeenMs) {
+                    oldest = cur;
+                }
+            }
+            if (g_hasPrimary && oldest->first == g_primaryIp) {
+                g_hasPrimary = false;
+            }
+            g_nodes.erase(oldest);
+        }
+        it = g_nodes.emplace(ip, UdpNode()).first;
+        it->second.ip = ip;
+    }
+    it->second.port = port;
+    it->second.lastSeenMs = now;
+    UdpNode &node = it->second;
+    pthread_mutex_unlock(&g_nodesMutex);
+    return node;
+}
+
+// 解码传感器帧：主节点发布到 UDP 通道，所有节点更新各自的最新快照
+static void PublishSensorFrame(UdpNode &node, const uint8_t *buf, size_t n)
 {
-    if (g_frameBuf.empty()) {
-        g_frameBuf.clear();
+    pthread_mutex_lock(&g_nodesMutex);
+    if (!g_hasPrimary) {
+        g_primaryIp = node.ip;
+        g_hasPrimary = true;
+        // 换了发送方，通道级的固件序号不再连续
+        sensor::ResetDeviceSeq(sensor::DataChannel::UDP);
+    }
+    const bool primary = g_primaryIp == node.ip;
+    pthread_mutex_unlock(&g_nodesMutex);
+
+    sensor::SensorSnapshot snap;
+    sensor::FrameFormat format = primary ? sensor::PublishFrame(sensor::DataChannel::UDP, buf, n, &snap)
+                                         : sensor::DecodeFrame(buf, n, snap);
+    if (format == sensor::FrameFormat::INVALID) {
         return;
     }
 
-    const uint8_t recvChecksum = g_frameBuf.back();
-    const size_t payloadLen = g_frameBuf.size() - 1;
-    const uint8_t calcChecksum = CalcChecksum(g_frameBuf.data(), payloadLen);
-    if (recvChecksum != calcChecksum) {
-        // 校验失败：丢弃当前帧，等待后续重传/下一帧
-        g_frameBuf.clear();
+    pthread_mutex_lock(&g_nodesMutex);
+    bool accepted = true;
+    if (format == sensor::FrameFormat::BINARY) {
+        uint64_t lost = 0;
+        accepted = sensor::TrackDeviceSeq(snap.deviceSeq, node.lastDeviceSeq, lost);
+        node.lostFrames += lost;
+        node.duplicateFrames += accepted ? 0 : 1;
+    }
+    if (accepted) {
+        node.frames++;
+        snap.seq = node.frames;
+        node.latest = snap;
+    }
+    pthread_mutex_unlock(&g_nodesMutex);
+
+    if (!primary || !accepted) {
+        return;
+    }
+    // wifi_get_latest_data 仍返回主节点的文本，二进制帧转成等价的文本保存
+    pthread_mutex_lock(&g_udpMutex);
+    if (format == sensor::FrameFormat::BINARY) {
+        char text[WIFI_UDP_BUF_SIZE];
+        const size_t len = sensor::FormatFrameText(snap, text, sizeof(text));
+        SaveLatestTextLocked(reinterpret_cast<const uint8_t *>(text), len);
+    } else {
+        SaveLatestTextLocked(buf, n);
+    }
+    pthread_mutex_unlock(&g_udpMutex);
+}
+
+// 完整且校验通过的帧（payload 已去掉校验和）
+static void HandleFrame(UdpNode &node, uint8_t frameType, std::vector<uint8_t> &frame)
+{
+    if (frameType == CAMERA_END) {
+        // 缓冲整体移交给图片存储（不再拷贝），下一帧大概率仍是照片：按本次大小从池中取缓冲
+        image::PublishImage(std::move(frame), PHOTO_PATH);
+        node.decoder.Buffer() = image::AcquireBuffer();
         return;
     }
 
     if (frameType == FRAME_END) {
-        pthread_mutex_lock(&g_udpMutex);
-        SaveLatestTextLocked(g_frameBuf.data(), payloadLen);
-        pthread_mutex_unlock(&g_udpMutex);
-    } else if (frameType == CAMERA_END) {
-        std::vector<uint8_t> image(g_frameBuf.begin(), g_frameBuf.end() - 1);
-        WriteBytesToFile(image, PHOTO_PATH);
-        NotifyImageCapturedFromNative(PHOTO_PATH);
+        // 在接收线程内一次性解码，读者直接取结构化快照
+        PublishSensorFrame(node, frame.data(), frame.size());
+    }
+    if (frame.capacity() > WIFI_FRAME_BUF_KEEP) {
+        // 节点数多时不长期占用相机帧大小的缓冲：还给图片缓冲池
+        image::ReleaseBuffer(std::move(frame));
+        node.decoder.Buffer() = std::vector<uint8_t>();
     }
-    g_frameBuf.clear();
 }
 
 static inline bool LooksLikeText(const uint8_t *buf, size_t n)
@@ -124,79 +284,238 @@ static inline bool LooksLikeText(const uint8_t *buf, size_t n)
     return printable * 100 / n >= 90; // 90% 以上可打印
 }
 
-static void ProcessIncomingBytes(const uint8_t *buf, size_t n)
+// 向节点的命令端口回复分块接收状态：ACK，或带缺失位图的 NACK
+static void SendChunkReply(const UdpNode &node, const camera_chunk::Header &frame, uint8_t type)
 {
-    for (size_t i = 0; i < n; i++) {
-        const uint8_t b = buf[i];
+    uint8_t reply[sizeof(camera_chunk::Header) + camera_chunk::kMaxChunks / 8];
+    size_t len = camera_chunk::WriteHeader(reply, frame, type, 0, 0);
+    if (type == camera_chunk::TYPE_NACK) {
+        memcpy(reply + len, node.chunkMissing.data(), node.chunkMissing.size());
+        len += node.chunkMissing.size();
+        g_rxStats.chunkNacks.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        if (g_frameStatus == 0) {
-            // 等待帧头
-            if (b == FRAME_HEAD) {
-                g_frameStatus = 1;
-                g_frameBuf.clear();
-            }
-            continue;
-        }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(WIFI_CMD_PORT);
+    addr.sin_addr.s_addr = node.ip;
+    // 与收包线程共用 socket：UDP 的 sendto 与 recvmmsg 可以并发
+    (void)sendto(g_udpSock, reply, len, 0, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+}
 
-        if (g_frameStatus == 2) {
-            // 转义：原样收入
-            g_frameBuf.push_back(b);
-            g_frameStatus = 1;
-        } else if (g_frameStatus == 1) {
-            if (b == ESC) {
-                g_frameStatus = 2;
-            } else if (b == FRAME_HEAD) {
-                // 重新同步：遇到新的帧头，丢弃旧的未完成帧
-                g_frameBuf.clear();
-                g_frameStatus = 1;
-            } else if (b == FRAME_END || b == CAMERA_END) {
-                HandleCompleteFrame(b);
-                g_frameStatus = 0;
-            } else {
-                g_frameBuf.push_back(b);
-            }
+// 开始重组一张新照片：缺失位图全部置位，缓冲从图片池取
+static void BeginChunkFrame(UdpNode &node, const camera_chunk::Header &h)
+{
+    if (node.chunkActive) {
+        // 上一张没收齐就来了新照片（固件已放弃重传）
+        g_rxStats.chunkAbandoned.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (node.chunkData.capacity() == 0) {
+        node.chunkData = image::AcquireBuffer();
+    }
+    node.chunkData.resize(h.frameLen);
+    node.chunkMissing.assign(camera_chunk::BitmapBytes(h.chunkCount), 0);
+    for (uint16_t i = 0; i < h.chunkCount; i++) {
+        camera_chunk::BitSet(node.chunkMissing.data(), i);
+    }
+    node.chunkRemaining = h.chunkCount;
+    node.chunkFrame = h;
+    node.chunkActive = true;
+}
+
+// 处理相机分块 datagram；不是分块协议的数据返回 false，交给帧式流解析
+static bool HandleChunkDatagram(UdpNode &node, const uint8_t *buf, size_t n)
+{
+    camera_chunk::Header h;
+    const uint8_t *payload = nullptr;
+    size_t payloadLen = 0;
+    if (!camera_chunk::Parse(buf, n, h, payload, payloadLen)) {
+        return false;
+    }
+    if (h.type != camera_chunk::TYPE_DATA || h.frameLen > WIFI_MAX_FRAME_SIZE) {
+        return true;
+    }
+    const bool wantsReply = (h.flags & camera_chunk::FLAG_POLL) != 0 || h.chunkIndex == h.chunkCount - 1;
+
+    if (node.chunkDoneValid && h.frameId == node.chunkDone.frameId && h.frameCrc == node.chunkDone.frameCrc) {
+        // 已完成照片的迟到重传（ACK 丢失），重新确认即可
+        g_rxStats.chunkDuplicates.fetch_add(1, std::memory_order_relaxed);
+        if (wantsReply) {
+            SendChunkReply(node, node.chunkDone, camera_chunk::TYPE_ACK);
         }
+        return true;
+    }
+
+    const camera_chunk::Header &cur = node.chunkFrame;
+    if (!node.chunkActive || h.frameId != cur.frameId || h.frameLen != cur.frameLen ||
+        h.frameCrc != cur.frameCrc || h.chunkSize != cur.chunkSize) {
+        BeginChunkFrame(node, h);
+    }
+
+    if (camera_chunk::BitTest(node.chunkMissing.data(), h.chunkIndex)) {
+        memcpy(node.chunkData.data() + static_cast<size_t>(h.chunkIndex) * h.chunkSize, payload, payloadLen);
+        node.chunkMissing[h.chunkIndex / 8u] &= static_cast<uint8_t>(~(1u << (h.chunkIndex % 8u)));
+        node.chunkRemaining--;
+    } else {
+        g_rxStats.chunkDuplicates.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        if (g_frameBuf.size() > WIFI_MAX_FRAME_SIZE) {
-            // 防御：异常数据导致一直收不到帧尾
-            g_frameBuf.clear();
-            g_frameStatus = 0;
+    if (node.chunkRemaining == 0) {
+        if (crc32::Compute(node.chunkData.data(), node.chunkData.size()) == node.chunkFrame.frameCrc) {
+            node.chunkActive = false;
+            node.chunkDone = node.chunkFrame;
+            node.chunkDoneValid = true;
+            g_rxStats.chunkImages.fetch_add(1, std::memory_order_relaxed);
+            SendChunkReply(node, node.chunkDone, camera_chunk::TYPE_ACK);
+            // 缓冲整体移交给图片存储，下一张重新从池中取
+            image::PublishImage(std::move(node.chunkData), PHOTO_PATH);
+            node.chunkData = std::vector<uint8_t>();
+            return true;
         }
+        // 整张 CRC 不符：无法定位坏块，要求全部重传
+        g_rxStats.chunkCrcErrors.fetch_add(1, std::memory_order_relaxed);
+        node.chunkActive = false;
+        BeginChunkFrame(node, h);
+        SendChunkReply(node, node.chunkFrame, camera_chunk::TYPE_NACK);
+        return true;
+    }
+
+    if (wantsReply) {
+        SendChunkReply(node, node.chunkFrame, camera_chunk::TYPE_NACK);
+    }
+    return true;
+}
+
+// 取出一个 datagram 交给对应节点解析（仅解码线程调用）
+static void HandleDatagram(uint32_t ip, uint16_t port, const uint8_t *buf, size_t n)
+{
+    // 按发送方分流：不同节点的字节流各自拼帧，互不干扰
+    UdpNode &node = AcquireNode(ip, port, sensor::MonotonicMs());
+
+    // 0) 相机分块自成一个 datagram；只在节点不处于帧式接收中时识别，避免误判帧流的续包
+    if (node.decoder.Idle() && HandleChunkDatagram(node, buf, n)) {
+        return;
+    }
+
+    // 1) 优先走“帧式流”解析（可跨 datagram 拼接）
+    node.decoder.Feed(buf, n, [&node](uint8_t type, std::vector<uint8_t> &frame) {
+        HandleFrame(node, type, frame);
+    });
+
+    // 2) 兼容旧的“纯文本 UDP”模式：仅当该节点不在帧式接收中时，才按一条文本记录处理
+    if (node.decoder.Idle() && LooksLikeText(buf, n)) {
+        PublishSensorFrame(node, buf, n);
     }
 }
 
+// 收包线程：recvmmsg 一次取多个 datagram，直接收进环形队列的空闲槽位；
+// 只做收包与计数，不解析、不写文件，避免相机突发时内核缓冲溢出
 static void *udp_recv_task(void *arg)
 {
     (void)arg;
+    static struct mmsghdr msgs[WIFI_RX_BATCH];
+    static struct iovec iovs[WIFI_RX_BATCH];
+    static struct sockaddr_in froms[WIFI_RX_BATCH];
+    static uint8_t controls[WIFI_RX_BATCH][CMSG_SPACE(sizeof(uint32_t))];
+    static RxSlot overflow[WIFI_RX_BATCH]; // 队列满时的丢弃区：照常收包以免内核缓冲堆积
+
     while (1) {
-        // UDP datagram 最大可远超 1024，这里取 2KB 以容纳常见分块（如 1460）
-        uint8_t buf[2048];
-        ssize_t n = recvfrom(g_udpSock, buf, sizeof(buf), 0, nullptr, nullptr);
+        const uint32_t head = g_rxHead.load(std::memory_order_relaxed);
+        const uint32_t tail = g_rxTail.load(std::memory_order_acquire);
+        const uint32_t space = WIFI_RX_RING_SLOTS - (head - tail);
+        const bool ringFull = space == 0;
+        const unsigned int batch = ringFull ? WIFI_RX_BATCH : std::min<uint32_t>(space, WIFI_RX_BATCH);
+
+        for (unsigned int k = 0; k < batch; k++) {
+            RxSlot &slot = ringFull ? overflow[k] : g_rxRing[(head + k) & (WIFI_RX_RING_SLOTS - 1)];
+            iovs[k].iov_base = slot.data;
+            iovs[k].iov_len = sizeof(slot.data);
+            memset(&msgs[k].msg_hdr, 0, sizeof(msgs[k].msg_hdr));
+            msgs[k].msg_hdr.msg_name = &froms[k];
+            msgs[k].msg_hdr.msg_namelen = sizeof(froms[k]);
+            msgs[k].msg_hdr.msg_iov = &iovs[k];
+            msgs[k].msg_hdr.msg_iovlen = 1;
+            msgs[k].msg_hdr.msg_control = controls[k];
+            msgs[k].msg_hdr.msg_controllen = sizeof(controls[k]);
+        }
+
+        // MSG_WAITFORONE：阻塞等到第一个 datagram，之后把已到达的尽量一次取完
+        const int n = recvmmsg(g_udpSock, msgs, batch, MSG_WAITFORONE, nullptr);
         if (n <= 0) {
             if (n < 0 && (errno == EINTR)) {
                 continue;
             }
             // 其它错误简单打印后退出线程，避免复杂恢复逻辑
-            perror("udp recvfrom error");
+            perror("udp recvmmsg error");
             break;
         }
 
-        const size_t nn = static_cast<size_t>(n);
-
-        // 1) 优先走“帧式流”解析（可跨 datagram 拼接）
-        ProcessIncomingBytes(buf, nn);
+        g_rxStats.batches.fetch_add(1, std::memory_order_relaxed);
+        g_rxStats.datagrams.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        uint64_t bytes = 0;
+        for (int k = 0; k < n; k++) {
+            bytes += msgs[k].msg_len;
+            if ((msgs[k].msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+                g_rxStats.truncated.fetch_add(1, std::memory_order_relaxed);
+            }
+            // SO_RXQ_OVFL：内核累计的丢包数（接收缓冲满），取最新值
+            for (struct cmsghdr *c = CMSG_FIRSTHDR(&msgs[k].msg_hdr); c != nullptr;
+                 c = CMSG_NXTHDR(&msgs[k].msg_hdr, c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t drops = 0;
+                    memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+                    g_rxStats.kernelDrops.store(drops, std::memory_order_relaxed);
+                }
+            }
+            if (!ringFull) {
+                RxSlot &slot = g_rxRing[(head + static_cast<uint32_t>(k)) & (WIFI_RX_RING_SLOTS - 1)];
+                slot.len = msgs[k].msg_len;
+                slot.ip = froms[k].sin_addr.s_addr;
+                slot.port = froms[k].sin_port;
+            }
+        }
+        g_rxStats.bytes.fetch_add(bytes, std::memory_order_relaxed);
 
-        // 2) 兼容旧的“纯文本 UDP”模式：仅当当前不在帧式接收中时，才用该包覆盖最新文本
-        if (g_frameStatus == 0 && LooksLikeText(buf, nn)) {
-            pthread_mutex_lock(&g_udpMutex);
-            SaveLatestTextLocked(buf, nn);
-            pthread_mutex_unlock(&g_udpMutex);
+        if (ringFull) {
+            g_rxStats.ringOverflows.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+            continue;
         }
+        g_rxHead.store(head + static_cast<uint32_t>(n), std::memory_order_release);
+        // 每批唤醒一次解码线程
+        const uint64_t one = 1;
+        (void)write(g_rxEventFd, &one, sizeof(one));
     }
 
     return nullptr;
 }
 
+// 解码线程：按顺序消费环形队列，拼帧/解析/写图片都在这里完成
+static void *udp_decode_task(void *arg)
+{
+    (void)arg;
+    while (1) {
+        uint32_t tail = g_rxTail.load(std::memory_order_relaxed);
+        const uint32_t head = g_rxHead.load(std::memory_order_acquire);
+        if (tail == head) {
+            // 队列空：阻塞到收包线程提交下一批（eventfd 计数不会丢失唤醒）
+            uint64_t value = 0;
+            if (read(g_rxEventFd, &value, sizeof(value)) < 0 && errno != EINTR) {
+                perror("udp eventfd read error");
+                break;
+            }
+            continue;
+        }
+        for (; tail != head; tail++) {
+            const RxSlot &slot = g_rxRing[tail & (WIFI_RX_RING_SLOTS - 1)];
+            HandleDatagram(slot.ip, slot.port, slot.data, slot.len);
+            // 及时归还槽位，收包线程可以继续填充
+            g_rxTail.store(tail + 1, std::memory_order_release);
+        }
+    }
+    return nullptr;
+}
+
 void init_wifi_udp_receiver(void)
 {
     pthread_mutex_lock(&g_udpMutex);
@@ -215,6 +534,19 @@ void init_wifi_udp_receiver(void)
     int reuse = 1;
     (void)setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
 
+    // 加大内核接收缓冲以吸收相机突发；FORCE 需要 CAP_NET_ADMIN，失败时退回受 rmem_max 限制的普通设置
+    int rcvbuf = WIFI_RX_SOCKET_BUF;
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) != 0) {
+        (void)setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    socklen_t optLen = sizeof(rcvbuf);
+    if (getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &optLen) == 0) {
+        g_rxStats.rcvbufBytes.store(rcvbuf);
+    }
+    // 每个 datagram 附带内核累计丢包数
+    int ovfl = 1;
+    (void)setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &ovfl, sizeof(ovfl));
+
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -228,9 +560,29 @@ void init_wifi_udp_receiver(void)
         return;
     }
 
+    g_rxEventFd = eventfd(0, 0);
+    if (g_rxEventFd < 0) {
+        perror("udp eventfd create fail");
+        close(sock);
+        pthread_mutex_unlock(&g_udpMutex);
+        return;
+    }
+
     g_udpSock = sock;
+    g_nodes.reserve(WIFI_MAX_NODES);
+
+    if (pthread_create(&g_decodeThread, nullptr, udp_decode_task, nullptr) != 0) {
+        perror("udp pthread_create fail");
+        close(sock);
+        close(g_rxEventFd);
+        g_rxEventFd = -1;
+        g_udpSock = -1;
+        pthread_mutex_unlock(&g_udpMutex);
+        return;
+    }
 
     if (pthread_create(&g_udpThread, nullptr, udp_recv_task, nullptr) != 0) {
+        // 解码线程已在 eventfd 上等待，保留即可；没有收包线程就不会有数据
         perror("udp pthread_create fail");
         close(sock);
         g_udpSock = -1;
@@ -293,3 +645,44 @@ int wifi_send_broadcast(const char *buf, int len)
 
     return (sent == len) ? 0 : -1;
 }
+
+int wifi_get_rx_stats(wifi_udp_rx_stats_t *out)
+{
+    if (out == nullptr) {
+        return -1;
+    }
+    out->datagrams = g_rxStats.datagrams.load(std::memory_order_relaxed);
+    out->bytes = g_rxStats.bytes.load(std::memory_order_relaxed);
+    out->batches = g_rxStats.batches.load(std::memory_order_relaxed);
+    out->kernelDrops = g_rxStats.kernelDrops.load(std::memory_order_relaxed);
+    out->ringOverflows = g_rxStats.ringOverflows.load(std::memory_order_relaxed);
+    out->truncated = g_rxStats.truncated.load(std::memory_order_relaxed);
+    out->rcvbufBytes = g_rxStats.rcvbufBytes.load(std::memory_order_relaxed);
+    out->chunkImages = g_rxStats.chunkImages.load(std::memory_order_relaxed);
+    out->chunkNacks = g_rxStats.chunkNacks.load(std::memory_order_relaxed);
+    out->chunkDuplicates = g_rxStats.chunkDuplicates.load(std::memory_order_relaxed);
+    out->chunkCrcErrors = g_rxStats.chunkCrcErrors.load(std::memory_order_relaxed);
+    out->chunkAbandoned = g_rxStats.chunkAbandoned.load(std::memory_order_relaxed);
+    return 0;
+}
+
+size_t wifi_get_nodes(std::vector<WifiUdpNode> &out)
+{
+    out.clear();
+    pthread_mutex_lock(&g_nodesMutex);
+    out.reserve(g_nodes.size());
+    for (const auto &kv : g_nodes) {
+        const UdpNode &node = kv.second;
+        WifiUdpNode info;
+        info.address = FormatAddress(node.ip, node.port);
+        info.primary = g_hasPrimary && node.ip == g_primaryIp;
+        info.lastSeenMs = node.lastSeenMs;
+        info.frames = node.frames;
+        info.lostFrames = node.lostFrames;
+        info.duplicateFrames = node.duplicateFrames;
+        info.latest = node.latest;
+        out.push_back(info);
+    }
+    pthread_mutex_unlock(&g_nodesMutex);
+    return out.size();
+}
@@ -20,6 +20,8 @@
 #include "mqtt_payload_builder.h"
 #include "pump_control.h"
 #include "sensor_data_provider.h"
+#include "sensor_deadband.h"
+#include "sensor_history.h"
 #include "sg90.h"
 
 namespace control {
@@ -43,6 +45,7 @@ std::chrono::steady_clock::time_point g_lastAlarmBeepTime = std::chrono::steady_
 
 static constexpr int kAlarmBeepMs = 120;
 static constexpr int kAlarmBeepCooldownMs = 30000;
+static constexpr int64_t kLightSmoothWindowMs = 60 * 1000;
 
 // 使用静态阈值控制光照（已移除在线自适应逻辑）
 
@@ -243,7 +246,7 @@ void ApplyCommandJson(const std::string &jsonRaw)
         return;
     }
 
-    // 直接控制执行器：根据 pump/led/fan/buzzer/sg90_angle/capture 字段立刻动作一次
+    // 直接控制执行器：根据 pump/led/fan/buzzer/sg90_angle/capture/keyframe 字段立刻动作一次
     // 例如：{"control":{"pump":1}} / {"control":{"led":0}} / {"control":{"fan":60}} / {"control":{"buzzer":1}}
 
     // pump: 0/1 -> 关/开
@@ -310,21 +313,20 @@ void ApplyCommandJson(const std::string &jsonRaw)
         }
     }
 
+    // keyframe: 非 0 时立即上报一帧完整数据（订阅方开启死区过滤后中途加入/丢了增量时使用）
+    if (GetNumberField(json, "keyframe", &v)) {
+        if (v != 0.0) {
+            mqttc::RequestSensorKeyframe();
+        }
+    }
+
     cJSON_Delete(root);
 }
 
-void OnMqttMessage(void * /*ctx*/, const char *topic, const void *data, size_t size)
+// 只注册在控制主题上，不再逐条比较主题；在分发器工作线程中调用，驱动执行器时不阻塞 MQTT I/O
+void OnMqttMessage(const char * /*topic*/, size_t /*topicLen*/, const void *data, size_t size)
 {
-    if (!topic || !data || size == 0) return;
-
-    std::string currentTopic;
-    {
-        std::lock_guard<std::mutex> lock(g_mutex);
-        currentTopic = g_cmdTopic;
-    }
-    if (!currentTopic.empty() && currentTopic != topic) {
-        return;
-    }
+    if (!data || size == 0) return;
 
     std::string json(static_cast<const char *>(data), size);
     ApplyCommandJson(json);
@@ -335,10 +337,12 @@ std::thread g_thread;
 void ControlLoop()
 {
     mqttc::MqttCClient &mqtt = mqttc::GetMqttClient();
-    mqtt.setMessageCallback(OnMqttMessage, nullptr);
 
+    mqttc::HandlerId handlerId = 0;
+    std::string handlerTopic;
     bool subscribed = false;
     bool lastEnabled = false;
+    uint64_t lastSeq = 0;
 
     while (g_running.load()) {
         // 尝试准备命令主题
@@ -364,7 +368,20 @@ void ControlLoop()
             }
         }
 
-        // MQTT pump + 订阅（不额外起线程）
+        // 控制主题变化（SetCommandTopic）时换注册处理函数，旧主题随最后一个处理函数一起退订
+        if (cmdTopic != handlerTopic) {
+            if (handlerId != 0) {
+                mqtt.removeMessageHandler(handlerId);
+                handlerId = 0;
+            }
+            if (!cmdTopic.empty()) {
+                handlerId = mqtt.addMessageHandler(cmdTopic, OnMqttMessage, mqttc::HandlerExecutor::WORKER);
+            }
+            handlerTopic = cmdTopic;
+            subscribed = false;
+        }
+
+        // 订阅控制主题；MQTT 收发由客户端自己的 I/O 线程驱动，这里不再 pump
         if (mqtt.isConnected()) {
             if (!subscribed) {
                 std::string err;
@@ -372,13 +389,19 @@ void ControlLoop()
                     subscribed = mqtt.subscribe(cmdTopic, 0, &err);
                 }
             }
-            (void)mqtt.syncOnce(nullptr);
         } else {
             subscribed = false;
         }
 
+        // 传感器读数：一次取整帧快照，保证同一周期内的读数来自同一帧
+        sensor::SensorSnapshot snap;
+        sensor::GetSnapshot(snap);
+
+        // 仅在有新帧（或刚启用）且数据未过期时执行阈值控制：
+        // 重复帧不再重复驱动执行器；数据过期（通信中断）时保持执行器现状，避免按旧值/0 值误动作。
         const bool enabled = g_enabled.load();
-        if (enabled) {
+        const bool runControl = enabled && sensor::IsFresh(snap) && (snap.seq != lastSeq || !lastEnabled);
+        if (runControl) {
             AutoControlThresholds t;
             {
                 std::lock_guard<std::mutex> lock(g_mutex);
@@ -387,16 +410,20 @@ void ControlLoop()
 
             const bool isDay = IsDaytime();
 
-            // 传感器读数
-            const double soil = static_cast<double>(sensor::GetDataByKey("SoilHumi"));
-            const double temp = static_cast<double>(sensor::GetDataByKey("Temp"));
-            const double co2 = static_cast<double>(sensor::GetDataByKey("CO_2"));
-            const double light = static_cast<double>(sensor::GetDataByKey("Light"));
-            const double ph = static_cast<double>(sensor::GetDataByKey("pH"));
-            const double ec = static_cast<double>(sensor::GetDataByKey("EC"));
-            const double n = static_cast<double>(sensor::GetDataByKey("N"));
-            const double p = static_cast<double>(sensor::GetDataByKey("P"));
-            const double k = static_cast<double>(sensor::GetDataByKey("K"));
+            const double soil = static_cast<double>(snap.Get(sensor::SensorId::SOIL_HUMI));
+            const double temp = static_cast<double>(snap.Get(sensor::SensorId::TEMP));
+            const double co2 = static_cast<double>(snap.Get(sensor::SensorId::CO2));
+            double light = static_cast<double>(snap.Get(sensor::SensorId::LIGHT));
+            // 光照取最近窗口均值：云层遮挡等瞬时波动不再导致补光灯/遮阳板反复动作
+            sensor::HistoryStats lightStats;
+            if (sensor::QueryHistory(sensor::SensorId::LIGHT, kLightSmoothWindowMs, lightStats)) {
+                light = static_cast<double>(lightStats.mean);
+            }
+            const double ph = static_cast<double>(snap.Get(sensor::SensorId::PH));
+            const double ec = static_cast<double>(snap.Get(sensor::SensorId::EC));
+            const double n = static_cast<double>(snap.Get(sensor::SensorId::N));
+            const double p = static_cast<double>(snap.Get(sensor::SensorId::P));
+            const double k = static_cast<double>(snap.Get(sensor::SensorId::K));
 
             // 使用静态光照阈值（已撤销自适应调整）
 
@@ -505,9 +532,19 @@ void ControlLoop()
             }
         }
 
-        lastEnabled = enabled;
+        if (runControl) {
+            lastSeq = snap.seq;
+            lastEnabled = true;
+        } else if (!enabled) {
+            lastEnabled = false;
+        }
+
+        // 等待下一帧到达（最多一个控制周期，保证 MQTT pump 仍周期执行）
+        (void)sensor::WaitForFrame(snap.seq, AUTO_CONTROL_PERIOD_MS);
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(AUTO_CONTROL_PERIOD_MS));
+    if (handlerId != 0) {
+        mqtt.removeMessageHandler(handlerId);
     }
 }
 
@@ -5,10 +5,16 @@
 namespace camera_module {
 
 using transmit_fn_t = void (*)(const char* buf, int len, unsigned char type);
+using chunk_send_fn_t = void (*)(const uint8_t* buf, int len);
 
 constexpr unsigned char CAMERA_END = 0x01; // 相机帧结束标记
 
 void set_transmit(transmit_fn_t fn);
+// 设置后照片按分块协议发送（app/inc/camera_chunk.h，每块一个 datagram，按 NACK 选择性重传）；
+// 未设置时整张照片交给 transmit，作为一个 CAMERA_END 帧发送
+void set_chunk_sender(chunk_send_fn_t fn);
+// 命令端口收到的网关回复（ACK / NACK）交给这里，由发送照片的任务处理
+void handle_chunk_reply(const uint8_t* buf, int len);
 void init();
 
 // 供命令分发直接调用（签名与现有 handlers 兼容）
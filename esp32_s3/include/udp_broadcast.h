@@ -17,6 +17,10 @@ void begin(const char *ssid, const char *password, uint16_t port);
 // type: 预留参数，目前未在实现中使用
 void send(const char *buf, int len, uint8_t type);
 
+// 发送一个 datagram 给最近一次发来命令的对端（即网关），端口同 begin 的 port；
+// 还没收到过命令时退回广播。单播在 Wi-Fi 链路层有确认与重传，广播没有
+void send_to_peer(const char *buf, int len);
+
 // 启动 UDP 接收（命令接收端口）
 void begin_rx(uint16_t port);
 
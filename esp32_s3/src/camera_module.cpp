@@ -8,32 +8,155 @@
 #include <Arduino.h>
 #include <cstring>
 
+#include "camera_chunk.h" // 与网关共用（app/inc），见 platformio.ini
+#include "crc32.h"
+
 namespace camera_module {
 
 static transmit_fn_t g_transmit = nullptr;
+static chunk_send_fn_t g_chunk_send = nullptr;
 static bool g_camera_inited = false;
 static SemaphoreHandle_t g_camera_mutex = nullptr;
 
+// 网关回复：命令接收任务写入，发送照片的任务读取
+struct ChunkReply {
+  uint16_t frameId;
+  uint8_t type;
+  uint8_t missing[camera_chunk::kMaxChunks / 8];
+};
+
+static QueueHandle_t g_reply_queue = nullptr;
+static uint16_t g_frame_id = 0;
+
+static const int kChunkRounds = 8;           // 首轮 + 重传/探测轮数上限
+static const int kChunkReplyTimeoutMs = 300; // 每轮等待网关回复的时间
+static const int kChunkBurst = 8;            // 每发这么多块让出一次 CPU，避免 Wi-Fi 发送缓冲耗尽
+
 static void ensure_camera_mutex() {
   if (!g_camera_mutex) {
     g_camera_mutex = xSemaphoreCreateMutex();
   }
+  if (!g_reply_queue) {
+    g_reply_queue = xQueueCreate(4, sizeof(ChunkReply));
+  }
 }
 
 void set_transmit(transmit_fn_t fn) {
   g_transmit = fn;
 }
 
+void set_chunk_sender(chunk_send_fn_t fn) {
+  g_chunk_send = fn;
+}
+
+void handle_chunk_reply(const uint8_t* buf, int len) {
+  camera_chunk::Header h;
+  const uint8_t* payload = nullptr;
+  size_t payloadLen = 0;
+  if (!g_reply_queue || len <= 0 || !camera_chunk::Parse(buf, (size_t)len, h, payload, payloadLen)) {
+    return;
+  }
+  if (h.type != camera_chunk::TYPE_ACK && h.type != camera_chunk::TYPE_NACK) {
+    return;
+  }
+  ChunkReply reply;
+  reply.frameId = h.frameId;
+  reply.type = h.type;
+  memcpy(reply.missing, payload, payloadLen);
+  xQueueSend(g_reply_queue, &reply, 0);
+}
+
+// 发送 missing 中置位的分块；最后一块带 FLAG_POLL 要求网关回复
+static void send_chunks(const camera_chunk::Header& frame, const uint8_t* data, const uint8_t* missing,
+                        uint8_t* dgram) {
+  int last = -1;
+  for (int i = frame.chunkCount - 1; i >= 0; i--) {
+    if (camera_chunk::BitTest(missing, (uint16_t)i)) {
+      last = i;
+      break;
+    }
+  }
+  int sent = 0;
+  for (int i = 0; i <= last; i++) {
+    if (!camera_chunk::BitTest(missing, (uint16_t)i)) {
+      continue;
+    }
+    const uint16_t index = (uint16_t)i;
+    const uint8_t flags = i == last ? camera_chunk::FLAG_POLL : 0;
+    const size_t hdr = camera_chunk::WriteHeader(dgram, frame, camera_chunk::TYPE_DATA, flags, index);
+    const size_t len = camera_chunk::ChunkLen(frame, index);
+    memcpy(dgram + hdr, data + (size_t)index * frame.chunkSize, len);
+    g_chunk_send(dgram, (int)(hdr + len));
+    if (++sent % kChunkBurst == 0) {
+      vTaskDelay(1);
+    }
+  }
+}
+
+// 分块发送一张照片，按网关 NACK 选择性重传；收到 ACK 返回 true
+static bool send_photo_chunked(const uint8_t* data, size_t len) {
+  static uint8_t dgram[camera_chunk::kMaxDatagram];
+  static uint8_t missing[camera_chunk::kMaxChunks / 8];
+
+  if (len == 0 || len > (size_t)camera_chunk::kMaxChunks * camera_chunk::kChunkSize) {
+    Serial.printf("Photo too large for chunked transfer: %u bytes\n", (unsigned)len);
+    return false;
+  }
+  camera_chunk::Header frame = {};
+  frame.frameId = ++g_frame_id;
+  frame.chunkSize = camera_chunk::kChunkSize;
+  frame.frameLen = (uint32_t)len;
+  frame.chunkCount = camera_chunk::ChunkCountFor(frame.frameLen, frame.chunkSize);
+  frame.frameCrc = crc32::Compute(data, len);
+
+  const size_t bitmapLen = camera_chunk::BitmapBytes(frame.chunkCount);
+  memset(missing, 0, sizeof(missing));
+  for (uint16_t i = 0; i < frame.chunkCount; i++) {
+    camera_chunk::BitSet(missing, i);
+  }
+  xQueueReset(g_reply_queue);
+
+  for (int round = 0; round < kChunkRounds; round++) {
+    send_chunks(frame, data, missing, dgram);
+
+    ChunkReply reply;
+    bool replied = false;
+    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(kChunkReplyTimeoutMs);
+    while (!replied) {
+      const TickType_t now = xTaskGetTickCount();
+      if ((int32_t)(deadline - now) <= 0 || xQueueReceive(g_reply_queue, &reply, deadline - now) != pdTRUE) {
+        break;
+      }
+      replied = reply.frameId == frame.frameId; // 忽略上一张照片的迟到回复
+    }
+
+    if (!replied) {
+      // 带 POLL 的分块或回复丢失：下一轮只补发最后一块作为探测，网关据此回复当前缺失位图
+      memset(missing, 0, bitmapLen);
+      camera_chunk::BitSet(missing, (uint16_t)(frame.chunkCount - 1));
+      continue;
+    }
+    if (reply.type == camera_chunk::TYPE_ACK) {
+      Serial.printf("Photo %u sent: %u bytes, %u chunks, %d round(s)\n", frame.frameId, (unsigned)len,
+                    frame.chunkCount, round + 1);
+      return true;
+    }
+    memcpy(missing, reply.missing, bitmapLen);
+  }
+  Serial.printf("Photo %u not acknowledged after %d rounds\n", frame.frameId, kChunkRounds);
+  return false;
+}
+
 static void send_photo_task(void* pvParameters) {
   (void)pvParameters;
 
-  if (!g_transmit) {
+  if (!g_transmit && !g_chunk_send) {
     vTaskDelete(nullptr);
     return;
   }
 
   ensure_camera_mutex();
-  if (!g_camera_mutex) {
+  if (!g_camera_mutex || !g_reply_queue) {
     vTaskDelete(nullptr);
     return;
   }
@@ -108,7 +231,12 @@ static void send_photo_task(void* pvParameters) {
     return;
   }
 
-  g_transmit(reinterpret_cast<const char*>(fb->buf), static_cast<int>(fb->len), CAMERA_END);
+  if (g_chunk_send) {
+    // 重传期间一直持有帧缓冲，结束后再归还
+    send_photo_chunked(fb->buf, fb->len);
+  } else {
+    g_transmit(reinterpret_cast<const char*>(fb->buf), static_cast<int>(fb->len), CAMERA_END);
+  }
 
   esp_camera_fb_return(fb);
 
@@ -5,9 +5,12 @@
 #include <driver/uart.h>
 #include <DHT.h>
 
+#include "camera_chunk.h"
 #include "camera_module.h"
 #include "dht_module.h"
+#include "frame_codec.h" // 与网关共用（app/inc）
 #include "jw01_module.h"
+#include "sensor_frame.h" // 与网关共用（app/inc），见 platformio.ini
 #include "soil_module.h"
 #include "udp_broadcast.h"
 
@@ -32,11 +35,30 @@ using namespace std;
 #define SOIL_RS485_BAUD 4800
 #define SOIL_RS485_ADDR 0x01
 
-#define FRAME_HEAD 0xFE
 #define FRAME_END 0xFF
-#define ESC 0x7E
 #define CAMERA_END 0x01 //相机
 
+// 1：传感器数据改回旧的文本帧（仅用于对接尚未升级的网关）
+#define SENSOR_FRAME_TEXT 0
+// 串口波特率协商（网关 serial_set_baudrate）：应答按 FE 帧经 Serial 发回
+#define SERIAL_DEFAULT_BAUD 115200
+#define SERIAL_BAUD_CONFIRM_MS 5000 // 切换后这么久收不到 PING 则退回原速率
+// RTS/CTS 引脚（按实际接线修改）；-1 表示未接，带 RTSCTS 的切换请求会被拒绝
+#define SERIAL_RTS_PIN (-1)
+#define SERIAL_CTS_PIN (-1)
+
+// 1：传感器帧除 UDP 外同时经 Serial 发出，网关多路径模式（DataChannel::MULTIPATH）两路去重合并；
+// 照片帧只走 UDP（串口带宽不够）
+#define SENSOR_FRAME_SERIAL_MIRROR 1
+
+// 推送订阅：网关 "SUBSCRIBE <periodMs> <leaseMs>" 后按周期自主发帧，租约到期未续订则停发
+#define STREAM_MIN_PERIOD_MS 50     // 最高 20Hz
+#define STREAM_MAX_PERIOD_MS 600000
+#define STREAM_MAX_LEASE_MS 120000
+
+// 1：照片改回整帧发送（一个 CAMERA_END 帧、依赖 IP 分片），仅用于对接尚未升级的网关
+#define CAMERA_FRAME_LEGACY 0
+
 // WiFi & UDP 配置（请根据实际情况修改）
 const char *WIFI_SSID = "werrrrttt";
 const char *WIFI_PASSWORD = "13719623327aa";
@@ -51,57 +73,106 @@ SemaphoreHandle_t serialMutex = NULL;
 
 Adafruit_NeoPixel pixels(PIX_NUM, PIN_PIXS, NEO_GRB + NEO_KHZ800);
 
-static uint8_t CalcChecksum(const char *buf, int len)
-{
-  uint8_t sum = 0;
-  for (int i = 0; i < len; i++) {
-    sum = (uint8_t)(sum + (uint8_t)buf[i]);
-  }
-  return sum;
-}
-
-static inline void AppendEscapedByte(uint8_t *frame, int &pos, uint8_t value)
-{
-  if (value == ESC || value == FRAME_END || value == FRAME_HEAD || value == CAMERA_END) {
-    frame[pos++] = ESC;
-  }
-  frame[pos++] = value;
-}
-
-// 保留原有帧格式(FRAME_HEAD/ESC/END)，并同时通过串口和 UDP 广播发送
+// 保留原有帧格式(FRAME_HEAD/ESC/END)，编码见 app/inc/frame_codec.h，通过 UDP 广播发送（传感器帧另经 Serial 镜像，见 SENSOR_FRAME_SERIAL_MIRROR）
 void transmitData(const char *buf, int len,unsigned char type){
   // 帧格式：HEAD + escaped(payload + checksum) + type
-  // 最坏情况 payload+checksum 每字节都需要转义：2*(len+1)，再加 HEAD 和 type
-  const int maxLen = ((len + 1) * 2) + 2;
+  const size_t maxLen = frame_codec::EncodedBound((size_t)len);
   uint8_t *frame = (uint8_t *)pvPortMalloc(maxLen);
   if (frame == NULL) {
     return;
   }
-  int pos = 0;
-  const uint8_t checksum = CalcChecksum(buf, len);
+  const size_t pos = frame_codec::Encode((const uint8_t *)buf, (size_t)len, (uint8_t)type, frame, maxLen);
 
   if(xSemaphoreTake(serialMutex, portMAX_DELAY) == pdTRUE){
-    // 帧头
-    frame[pos++] = FRAME_HEAD;
-
-    // 数据 + 转义
-    for(int i = 0; i < len; i++) {
-      uint8_t temp = (uint8_t)buf[i];
-      AppendEscapedByte(frame, pos, temp);
+    // 不做应用层分包：一次发出整个帧（UDP/IP 层可能会自动分片）
+    udp_broadcast::send((const char *)frame, (int)pos, type);
+#if SENSOR_FRAME_SERIAL_MIRROR
+    if (type == FRAME_END) {
+      Serial.write(frame, pos);
     }
+#endif
+    Serial.printf("Transmitted frame: %d bytes (type: 0x%02X)\n", (int)pos, type);
+  }
+  xSemaphoreGive(serialMutex);
+  vPortFree(frame);
+}
 
-    // 校验和也参与转义
-    AppendEscapedByte(frame, pos, checksum);
+static uint32_t g_serialBaud = SERIAL_DEFAULT_BAUD;
+static bool g_serialFlow = false;
+static uint32_t g_serialPrevBaud = SERIAL_DEFAULT_BAUD;
+static bool g_serialPrevFlow = false;
+static bool g_baudPending = false; // 已切换、等待网关在新速率下 PING 确认
+static unsigned long g_baudSwitchMs = 0;
+
+// 控制应答（BAUDOK/BAUDERR/PONG）按 FE 帧经 Serial 发回网关
+static void serialSendFrame(const char *text) {
+  uint8_t frame[64];
+  const size_t n = frame_codec::Encode((const uint8_t *)text, strlen(text), FRAME_END, frame, sizeof(frame));
+  if (n == 0) {
+    return;
+  }
+  if (xSemaphoreTake(serialMutex, portMAX_DELAY) == pdTRUE) {
+    Serial.write(frame, n);
+    Serial.flush(); // 等应答发完，之后才能切换速率
+    xSemaphoreGive(serialMutex);
+  }
+}
 
-    // 结束/类型字节（例如 FRAME_END 或 CAMERA_END）
-    frame[pos++] = (uint8_t)type;
+static void applySerialLine(uint32_t baud, bool rtscts) {
+  Serial.updateBaudRate(baud);
+  if (rtscts) {
+    Serial.setPins(-1, -1, SERIAL_CTS_PIN, SERIAL_RTS_PIN);
+    Serial.setHwFlowCtrlMode((uint8_t)UART_HW_FLOWCTRL_CTS_RTS, 64);
+  } else {
+    Serial.setHwFlowCtrlMode((uint8_t)UART_HW_FLOWCTRL_DISABLE, 64);
+  }
+  g_serialBaud = baud;
+  g_serialFlow = rtscts;
+}
 
-    // 不做应用层分包：一次发出整个帧（UDP/IP 层可能会自动分片）
-    udp_broadcast::send((const char *)frame, pos, type);
-    Serial.printf("Transmitted frame: %d bytes (type: 0x%02X)\n", pos, type);
+// "SETBAUD <baud>[ RTSCTS]"：先按旧速率应答，再切换；等网关 PING 确认
+void set_baud_command(const char *command) {
+  long baud = 0;
+  char opt[16] = {0};
+  const int n = sscanf(command, "SETBAUD %ld %15s", &baud, opt);
+  const bool rtscts = n == 2 && strcmp(opt, "RTSCTS") == 0;
+  char reply[32];
+  if (n < 1 || baud < 9600 || baud > 5000000 || (rtscts && (SERIAL_RTS_PIN < 0 || SERIAL_CTS_PIN < 0))) {
+    snprintf(reply, sizeof(reply), "BAUDERR %ld", baud);
+    serialSendFrame(reply);
+    return;
+  }
+  snprintf(reply, sizeof(reply), "BAUDOK %ld", baud);
+  serialSendFrame(reply);
+
+  g_serialPrevBaud = g_serialBaud;
+  g_serialPrevFlow = g_serialFlow;
+  applySerialLine((uint32_t)baud, rtscts);
+  g_baudPending = true;
+  g_baudSwitchMs = millis();
+}
+
+// 网关在新速率下的确认
+void ping_command(const char *command) {
+  (void)command;
+  g_baudPending = false;
+  serialSendFrame("PONG");
+}
+
+// 切换后一直收不到 PING（网关没跟上或线路在新速率下不通）：退回原速率
+static void checkBaudConfirm() {
+  if (g_baudPending && millis() - g_baudSwitchMs > SERIAL_BAUD_CONFIRM_MS) {
+    applySerialLine(g_serialPrevBaud, g_serialPrevFlow);
+    g_baudPending = false;
+  }
+}
+
+// 相机分块：每块一个 datagram，单播给网关（未知时广播）；与 transmitData 共用锁保护 UDP 对象
+void transmitChunk(const uint8_t *buf, int len) {
+  if (xSemaphoreTake(serialMutex, portMAX_DELAY) == pdTRUE) {
+    udp_broadcast::send_to_peer((const char *)buf, len);
+    xSemaphoreGive(serialMutex);
   }
-  xSemaphoreGive(serialMutex);
-  vPortFree(frame);
 }
 
 // void controlGPIO(const char* command) {
@@ -127,14 +198,20 @@ struct CommandHandler {
 };
 
 void send_sensor_data_once(const char *command);
+void subscribe_command(const char *command);
+void unsubscribe_command(const char *command);
 
 const CommandHandler handlers[] = {
   // {"GPIO", controlGPIO},
   // {"PWM",  controlPWM},
   // {"ADC",  readADC},
   {"GET_DATA",send_sensor_data_once},
+  {"SUBSCRIBE",subscribe_command},
+  {"UNSUBSCRIBE",unsubscribe_command},
   {"CAPTURE",camera_module::capture_command},
-  {"SETFRAMESIZE",camera_module::set_frame_size_command}
+  {"SETFRAMESIZE",camera_module::set_frame_size_command},
+  {"SETBAUD",set_baud_command},
+  {"PING",ping_command}
 };
 
 void showPixelColor(uint32_t c) {
@@ -185,15 +262,21 @@ void processCommands() {
 void processCommandshandler(void *pvParameters) {
   while (true) {
     processCommands();
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    checkBaudConfirm();
+    // 100ms 轮询：波特率协商的应答要及时，不能等一整秒
+    vTaskDelay(100 / portTICK_PERIOD_MS);
   }
 }
 
-// UDP 命令接收任务：监听 9001 端口并将命令送入 cmdQueue
+// UDP 命令接收任务：监听 9001 端口并将命令送入 cmdQueue；网关的相机分块回复直接交给 camera_module
 void udpReceiveTask(void *pvParameters) {
   char buf[256];
   while (true) {
     int len = udp_broadcast::receive(buf, sizeof(buf) - 1);
+    if (len > 0 && (uint8_t)buf[0] == camera_chunk::kMagic) {
+      camera_module::handle_chunk_reply((const uint8_t *)buf, len);
+      continue; // 重传期间尽快取下一个回复
+    }
     if (len > 0) {
       buf[len] = '\0';
       char *temp = (char *)pvPortMalloc(len + 1);
@@ -202,45 +285,155 @@ void udpReceiveTask(void *pvParameters) {
         xQueueSend(cmdQueue, &temp, portMAX_DELAY);
       }
     }
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    // 命令仍由 processCommandshandler 每秒处理；这里轮询得更勤，NACK 才能及时送达
+    vTaskDelay(20 / portTICK_PERIOD_MS);
   }
 }
 
+// 传感器值顺序，与网关 sensor::SensorId 一致
+enum SensorSlot {
+  SLOT_HUMI = 0, SLOT_TEMP, SLOT_CH2O, SLOT_TVOC, SLOT_CO2,
+  SLOT_SOIL_HUMI, SLOT_SOIL_TEMP, SLOT_EC, SLOT_PH, SLOT_N,
+  SLOT_P, SLOT_K, SLOT_SALT, SLOT_TDS, SLOT_LIGHT,
+  SLOT_COUNT
+};
+
+static uint32_t g_sensorFrameSeq = 0;
+// GET_DATA（命令任务）与推送流（sensorStreamTask）都会采集发送：串行化传感器读取与帧序号
+static SemaphoreHandle_t sensorMutex = NULL;
+
+static void send_sensor_data_locked();
+
 void send_sensor_data_once(const char *command) {
   (void)command;
+  if (xSemaphoreTake(sensorMutex, portMAX_DELAY) == pdTRUE) {
+    send_sensor_data_locked();
+    xSemaphoreGive(sensorMutex);
+  }
+}
+
+static void send_sensor_data_locked() {
   dht_module::DhtData dht = {0};
   jw01_module::Jw01Data jw01 = {0};
   soil_module::SoilData soil = {0};
-  char buffer[240];
   dht_module::read(dht);
   jw01_module::get(jw01);
   soil_module::get(soil);
   int rawLight = analogRead(LIGHT_SENSOR_PIN);
   float light = (rawLight / 4095.0f) * 100.0f; // 转换为百分比 0~100
+
+  float values[SLOT_COUNT] = {
+    dht.humidity, dht.temperature,
+    jw01.ch2o, jw01.tvoc, jw01.co2,
+    soil.moisture, soil.temperature, soil.ec, soil.ph, soil.n,
+    soil.p, soil.k, soil.salt, soil.tds,
+    light,
+  };
+
+#if SENSOR_FRAME_TEXT
+  char buffer[240];
   snprintf(buffer,
              sizeof(buffer),
              "Humi:%.3f;Temp:%.3f;CH2O:%.3f;TVOC:%.3f;CO_2:%.3f;SoilHumi:%.1f;SoilTemp:%.1f;EC:%.0f;pH:%.1f;N:%.0f;P:%.0f;K:%.0f;Salt:%.0f;TDS:%.0f;Light:%.1f;",
-             dht.humidity,
-             dht.temperature,
-             jw01.ch2o,
-             jw01.tvoc,
-             jw01.co2,
-             soil.moisture,
-             soil.temperature,
-             soil.ec,
-             soil.ph,
-             soil.n,
-             soil.p,
-             soil.k,
-             soil.salt,
-             soil.tds,
-             light);
+             values[SLOT_HUMI], values[SLOT_TEMP], values[SLOT_CH2O], values[SLOT_TVOC], values[SLOT_CO2],
+             values[SLOT_SOIL_HUMI], values[SLOT_SOIL_TEMP], values[SLOT_EC], values[SLOT_PH], values[SLOT_N],
+             values[SLOT_P], values[SLOT_K], values[SLOT_SALT], values[SLOT_TDS], values[SLOT_LIGHT]);
   transmitData(buffer, strlen(buffer), FRAME_END);
+#else
+  // 二进制帧：16 字节头 + 15 个 float = 76 字节（文本约 200 字节），读取失败的传感器不置有效位
+  uint32_t presentMask = 1u << SLOT_LIGHT;
+  if (dht.valid) {
+    presentMask |= (1u << SLOT_HUMI) | (1u << SLOT_TEMP);
+  }
+  if (jw01.valid) {
+    presentMask |= (1u << SLOT_CH2O) | (1u << SLOT_TVOC) | (1u << SLOT_CO2);
+  }
+  if (soil.valid) {
+    for (int i = SLOT_SOIL_HUMI; i <= SLOT_TDS; i++) {
+      presentMask |= 1u << i;
+    }
+  }
+
+  uint8_t buffer[sizeof(sensor_frame::Header) + SLOT_COUNT * sizeof(float)];
+  const size_t len = sensor_frame::Encode(buffer, sizeof(buffer), ++g_sensorFrameSeq, (uint32_t)millis(),
+                                          presentMask, values, SLOT_COUNT);
+  transmitData((const char *)buffer, (int)len, FRAME_END);
+#endif
+}
+
+static volatile uint32_t g_streamPeriodMs = 0; // 0：未订阅
+static volatile uint32_t g_streamLeaseEnd = 0;  // millis()，到期未续订则停发
+static volatile bool g_streamRestart = false;   // 周期变了：立即发一帧并按新周期重新计时
+
+// "SUBSCRIBE <periodMs> <leaseMs>"：开始/续订推送；周期与当前相同时只延长租约
+void subscribe_command(const char *command) {
+  unsigned long period = 0;
+  unsigned long lease = 0;
+  if (sscanf(command, "SUBSCRIBE %lu %lu", &period, &lease) != 2 || period == 0 || lease == 0) {
+    return;
+  }
+  if (period < STREAM_MIN_PERIOD_MS) {
+    period = STREAM_MIN_PERIOD_MS;
+  } else if (period > STREAM_MAX_PERIOD_MS) {
+    period = STREAM_MAX_PERIOD_MS;
+  }
+  if (lease > STREAM_MAX_LEASE_MS) {
+    lease = STREAM_MAX_LEASE_MS;
+  }
+  g_streamLeaseEnd = (uint32_t)millis() + (uint32_t)lease;
+  if (g_streamPeriodMs != (uint32_t)period) {
+    g_streamPeriodMs = (uint32_t)period;
+    g_streamRestart = true;
+  }
+}
+
+void unsubscribe_command(const char *command) {
+  (void)command;
+  g_streamPeriodMs = 0;
+}
+
+// 推送任务：订阅有效期内按周期采集发送，最多睡 100ms 以便及时响应改频/退订
+void sensorStreamTask(void *pvParameters) {
+  (void)pvParameters;
+  uint32_t nextMs = 0;
+  bool running = false;
+  while (true) {
+    const uint32_t period = g_streamPeriodMs;
+    const uint32_t now = (uint32_t)millis();
+    if (period == 0 || (int32_t)(now - g_streamLeaseEnd) >= 0) {
+      if (period != 0) {
+        g_streamPeriodMs = 0; // 租约过期：网关已不再续订
+      }
+      running = false;
+      vTaskDelay(100 / portTICK_PERIOD_MS);
+      continue;
+    }
+    if (!running || g_streamRestart) {
+      g_streamRestart = false;
+      running = true;
+      nextMs = now;
+    }
+    if ((int32_t)(now - nextMs) >= 0) {
+      send_sensor_data_once(NULL);
+      nextMs += period;
+      if ((int32_t)((uint32_t)millis() - nextMs) > 0) {
+        nextMs = (uint32_t)millis() + period; // 采集比周期还慢：不追赶，按当前时刻重新排
+      }
+    }
+    uint32_t waitMs = nextMs - (uint32_t)millis();
+    if ((int32_t)waitMs < 1) {
+      waitMs = 1;
+    } else if (waitMs > 100) {
+      waitMs = 100;
+    }
+    vTaskDelay(pdMS_TO_TICKS(waitMs));
+  }
 }
 
 void setup() {
   serialMutex = xSemaphoreCreateMutex();
-  Serial.begin(115200);
+  sensorMutex = xSemaphoreCreateMutex();
+  Serial.begin(SERIAL_DEFAULT_BAUD);
   pixels.begin();
   pixels.setBrightness(8);
   showPixelColor(0x0);
@@ -251,6 +444,9 @@ void setup() {
   udp_broadcast::begin_rx(UDP_CMD_PORT);
 
   camera_module::set_transmit(transmitData);
+#if !CAMERA_FRAME_LEGACY
+  camera_module::set_chunk_sender(transmitChunk);
+#endif
   dht_module::init(DHTPIN, DHTTYPE);
   Serial.onReceive(onSerialData, true);
   jw01_module::init(Serial1, RXD_PIN);
@@ -263,6 +459,7 @@ void setup() {
                     1000);
   xTaskCreate(processCommandshandler, "processCommandshandler", 4096, NULL, 1, NULL);
   xTaskCreate(udpReceiveTask, "udpReceiveTask", 4096, NULL, 1, NULL);
+  xTaskCreate(sensorStreamTask, "sensorStreamTask", 4096, NULL, 1, NULL);
 }
 
 void loop() {
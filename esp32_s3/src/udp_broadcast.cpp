@@ -8,6 +8,8 @@ static IPAddress g_broadcastIp(255, 255, 255, 255); // 简单起见，直接使
 
 static WiFiUDP udp_rx;
 static uint16_t g_rx_port = 0;
+static IPAddress g_peerIp;
+static bool g_hasPeer = false;
 
 void begin(const char *ssid, const char *password, uint16_t port) {
   g_port = port;
@@ -42,6 +44,16 @@ void send(const char *buf, int len, uint8_t type) {
   udp.endPacket();
 }
 
+void send_to_peer(const char *buf, int len) {
+  if (WiFi.status() != WL_CONNECTED || g_port == 0) {
+    return;
+  }
+
+  udp.beginPacket(g_hasPeer ? g_peerIp : g_broadcastIp, g_port);
+  udp.write(reinterpret_cast<const uint8_t *>(buf), len);
+  udp.endPacket();
+}
+
 void begin_rx(uint16_t port) {
   g_rx_port = port;
   udp_rx.begin(g_rx_port);
@@ -62,6 +74,10 @@ int receive(char *buf, int maxLen) {
   }
 
   int len = udp_rx.read(reinterpret_cast<uint8_t *>(buf), packetSize);
+  if (len > 0) {
+    g_peerIp = udp_rx.remoteIP();
+    g_hasPeer = true;
+  }
   return len;
 }
 
@@ -26,6 +26,15 @@ extern "C" {
 
 int uart_init(int fd, int uartBaud);
 
+// 设置任意波特率（如 921600、1500000、2000000）：标准速率用 cfsetspeed，其余用 termios2/BOTHER
+int uart_set_baudrate(int fd, int baud);
+
+// 读回当前生效的输出波特率，失败返回 ERR
+int uart_get_baudrate(int fd);
+
+// 硬件流控 RTS/CTS：rtscts 非 0 打开，0 关闭（uart_init 默认关闭）
+int uart_set_flow_control(int fd, int rtscts);
+
 #ifdef __cplusplus
 }
 #endif
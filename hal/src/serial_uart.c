@@ -16,9 +16,34 @@
 #include <termios.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
 #include "serial_uart.h"
 
-// 转换波特率
+/*
+ * 非标准波特率通过内核的 termios2 接口设置（c_cflag 置 BOTHER，速率直接写在 c_ispeed/c_ospeed）。
+ * <asm/termbits.h> 与 libc 的 <termios.h> 定义冲突，这里按内核布局自行声明（x86/ARM/AArch64 通用）。
+ */
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+#define UART_KERNEL_NCCS 19
+
+struct uart_termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[UART_KERNEL_NCCS];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+
+#define UART_TCGETS2 _IOR('T', 0x2A, struct uart_termios2)
+#define UART_TCSETS2 _IOW('T', 0x2B, struct uart_termios2)
+
+// 转换波特率：标准速率返回对应的 Bxxx，其余返回 B0（由 termios2 设置）
 speed_t conver_baudrate(int baudrate)
 {
     switch (baudrate) {
@@ -28,32 +53,110 @@ speed_t conver_baudrate(int baudrate)
             return B19200;
         case 38400L:
             return B38400;
+        case 57600L:
+            return B57600;
         case 115200L:
             return B115200;
+        case 230400L:
+            return B230400;
+#ifdef B460800
+        case 460800L:
+            return B460800;
+#endif
+#ifdef B921600
+        case 921600L:
+            return B921600;
+#endif
+#ifdef B1000000
+        case 1000000L:
+            return B1000000;
+#endif
+#ifdef B1152000
         case 1152000L:
             return B1152000;
+#endif
+#ifdef B1500000
+        case 1500000L:
+            return B1500000;
+#endif
+#ifdef B2000000
+        case 2000000L:
+            return B2000000;
+#endif
+#ifdef B3000000
+        case 3000000L:
+            return B3000000;
+#endif
         default:
-            return 1152000L;
+            return B0;
     }
 }
 
-void set_baud(int fd, int baud)
+// 设置任意波特率：标准速率走 cfsetispeed/cfsetospeed，其余走 termios2 + BOTHER
+static int set_baud(int fd, int baud)
 {
-    int ret = ERR;
-    struct termios opt;
+    const speed_t speed = conver_baudrate(baud);
 
-    tcgetattr(fd, &opt); // tcgetattr用来获取终端参数，将从终端获得的信息fd，保存到opt结构体中
     tcflush(fd, TCIOFLUSH); // 刷清缓冲区
-    cfsetispeed(&opt, baud);
-    cfsetospeed(&opt, baud);
+    if (speed != B0) {
+        struct termios opt;
+        if (tcgetattr(fd, &opt) != 0) { // tcgetattr用来获取终端参数，将从终端获得的信息fd，保存到opt结构体中
+            perror("tcgetattr fd");
+            return ERR;
+        }
+        cfsetispeed(&opt, speed);
+        cfsetospeed(&opt, speed);
+        if (tcsetattr(fd, TCSANOW, &opt) == ERR) { // 设置终端参数到opt中，使之立即生效
+            perror("tcsetattr fd");
+            return ERR;
+        }
+    } else {
+        struct uart_termios2 opt2;
+        if (baud <= 0 || ioctl(fd, UART_TCGETS2, &opt2) != 0) {
+            perror("TCGETS2 fd");
+            return ERR;
+        }
+        opt2.c_cflag &= ~(tcflag_t)CBAUD;
+        opt2.c_cflag |= BOTHER;
+        opt2.c_ispeed = (speed_t)baud;
+        opt2.c_ospeed = (speed_t)baud;
+        if (ioctl(fd, UART_TCSETS2, &opt2) != 0) {
+            perror("TCSETS2 fd");
+            return ERR;
+        }
+    }
+    tcflush(fd, TCIOFLUSH); // 刷清缓冲区
+    return OK;
+}
 
-    ret = tcsetattr(fd, TCSANOW, &opt); // 设置终端参数到opt中，使之立即生效
-    if (ret == ERR) {
-        perror("tcsetattr fd");
-        exit(0);
+int uart_set_baudrate(int fd, int baud)
+{
+    return set_baud(fd, baud);
+}
+
+int uart_get_baudrate(int fd)
+{
+    struct uart_termios2 opt2;
+    if (ioctl(fd, UART_TCGETS2, &opt2) != 0) {
+        return ERR;
     }
+    return (int)opt2.c_ospeed;
+}
 
-    tcflush(fd, TCIOFLUSH); // 刷清缓冲区
+int uart_set_flow_control(int fd, int rtscts)
+{
+    struct termios options;
+    if (tcgetattr(fd, &options) != 0) {
+        perror("tcgetattr fail\n");
+        return ERR;
+    }
+    // 请求发送和清除发送（RTS/CTS）：高波特率下由硬件暂停对端，避免接收 FIFO 溢出
+    if (rtscts) {
+        options.c_cflag |= CRTSCTS;
+    } else {
+        options.c_cflag &= ~CRTSCTS;
+    }
+    return tcsetattr(fd, TCSANOW, &options) == 0 ? OK : ERR;
 }
 
 // 设置数据位
@@ -181,11 +284,14 @@ int set_params(int fd, int databits, int stopbits, int parity)
 // 设置波特率
 int uart_init(int fd, int uartBaud)
 {
-    set_baud(fd, conver_baudrate(uartBaud));
-    // uart param /
+    // uart param /（先设数据位等参数，再设波特率：非标准速率经 termios2 设置，避免被 tcsetattr 覆盖）
     if (set_params(fd, 8L, 1, 'n')) {
         perror("set uart parameters fail\n");
         return ERR;
     }
+    if (set_baud(fd, uartBaud) != OK) {
+        perror("set uart baudrate fail\n");
+        return ERR;
+    }
     return OK;
 }
\ No newline at end of file
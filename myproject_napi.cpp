@@ -35,6 +35,7 @@
 
 #include "auto_control.h"
 #include "mqtt_payload_builder.h"
+#include "sensor_log.h"
 
 static napi_value initAllModules(napi_env env, napi_callback_info info)
 {
@@ -65,6 +66,9 @@ static napi_value initAllModules(napi_env env, napi_callback_info info)
     recordFail(INIT_FAIL_FAN, initMotorControl());
     recordFail(INIT_FAIL_BUZZER, BuzzerInit());
 
+    // 传感器持久化日志须先于数据通道启动，保证首帧即落盘；失败（如存储不可写）不影响其余功能
+    (void)sensor::SensorLogStart();
+
     // 串口用于相机/控制命令，传感器数据改为 WiFi UDP 通道
     init_uart();
     init_wifi_udp_receiver();
@@ -95,7 +99,10 @@ static napi_value register_myproject_apis(napi_env env, napi_value exports)
     RegisterFanApis(env, exports);
     RegisterBuzzerApis(env, exports);
     // RegisterSerialApis(env, exports);
+    RegisterSerialPortApis(env, exports);
     RegisterUdpApis(env, exports);
+    RegisterSensorSnapshotApis(env, exports);
+    RegisterSensorHistoryApis(env, exports);
     RegisterLlamaApis(env, exports);
     RegisterMqttApis(env, exports);
     RegisterControlApis(env, exports);
@@ -83,12 +83,6 @@ extern "C" void NotifyImageCapturedFromNative(const char* path)
         return;
     }
 
-    std::string json;
-    std::string err;
-    if (!mqttc::BuildSensorPayloadJson(true, json, &err)) {
-        return;
-    }
-
     std::string prefix = mqttc::GetMqttTopicPrefix();
     if (prefix.empty()) {
         prefix = "ciallo_ohos";
@@ -97,9 +91,31 @@ extern "C" void NotifyImageCapturedFromNative(const char* path)
     if (deviceId.empty()) {
         deviceId = "unknown";
     }
-    const std::string topic = prefix + "/" + deviceId + "/sensors";
+    const std::string base = prefix + "/" + deviceId;
+
+    // 只入队不等待，接收线程不被网络阻塞；图片格式与 publishMqtt(haveImage=true) 一致
+    const mqttc::PayloadCodec codec = mqttc::GetMqttPayloadCodec(mqttc::PayloadTopic::SENSORS);
+    std::string payload;
+    std::string err;
     std::string pubErr;
-    (void)client.publish(topic, json.data(), json.size(), 0, false, &pubErr);
+    if (codec == mqttc::PayloadCodec::JSON && mqttc::GetMqttImageInlineBase64()) {
+        if (!mqttc::BuildSensorPayloadJson(true, payload, &err)) {
+            return;
+        }
+    } else {
+        sensor::SensorSnapshot snap;
+        sensor::GetSnapshot(snap);
+        mqttc::ImagePayload image;
+        if (!mqttc::LoadLatestImagePayload(image, &err) ||
+            !mqttc::BuildSensorPayload(codec, snap, &image, payload, &err)) {
+            return;
+        }
+        const image::ImageRef jpeg = image.jpeg;
+        (void)client.publishAsync(base + "/image", mqttc::PublishPayload::FromShared(jpeg, jpeg->data(), jpeg->size()),
+                                  0, false, nullptr, &pubErr);
+    }
+    (void)client.publishAsync(mqttc::PayloadCodecTopic(base + "/sensors", codec),
+                              mqttc::PublishPayload::FromBuffer(std::move(payload)), 0, false, nullptr, &pubErr);
 }
 
 napi_value ImageCaptureOn(napi_env env, napi_callback_info info)
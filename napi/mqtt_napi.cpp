@@ -5,8 +5,11 @@
 #include <ctime>
 #include <cstdio>
 #include <cstring>
+#include <atomic>
 #include <mutex>
 
+#include <sys/stat.h>
+
 #include "napi/native_api.h"
 #include "napi/native_common.h"
 #include "napi/native_node_api.h"
@@ -15,6 +18,11 @@
 #include "mqtt_global.h"
 
 #include "mqtt_payload_builder.h"
+#include "myserial.h" // PHOTO_PATH
+#include "sensor_batch.h"
+#include "sensor_deadband.h"
+#include "sensor_log.h"
+#include "auto_control.h"
 
 
 static mqttc::MqttCClient &g_mqttClient = mqttc::GetMqttClient();
@@ -24,6 +32,9 @@ namespace {
 std::mutex g_discoveryMu;
 std::string g_lastAnnouncedPrefix;
 
+// 最近一次成功上报的传感器帧序号：同一帧不重复上报
+std::atomic<uint64_t> g_lastPublishedSeq{0};
+
 static std::string SanitizeTopicSegment(const std::string &in)
 {
     std::string out;
@@ -43,6 +54,30 @@ static std::string SanitizeTopicSegment(const std::string &in)
     return out;
 }
 
+// 待发布的图片：内存中的最新图片直接引用；重启后尚未收到新图时只读 mmap PHOTO_PATH，
+// 不再整份读进内存，CRC 与分辨率也从映射上算
+static std::shared_ptr<const mqttc::PublishPayload> LoadImageForPublish(mqttc::ImagePayload &out,
+                                                                        std::string *errMsg)
+{
+    out = mqttc::ImagePayload();
+    out.jpeg = image::GetLatestImage(&out.seq, &out.captureMs);
+    if (out.jpeg) {
+        const image::ImageRef jpeg = out.jpeg;
+        mqttc::DescribeImageBytes(jpeg->data(), jpeg->size(), out);
+        return mqttc::PublishPayload::FromShared(jpeg, jpeg->data(), jpeg->size());
+    }
+    auto file = mqttc::PublishPayload::FromFile(PHOTO_PATH, errMsg);
+    if (!file) {
+        return nullptr;
+    }
+    struct stat st;
+    if (stat(PHOTO_PATH, &st) == 0) {
+        out.captureMs = static_cast<int64_t>(st.st_mtime) * 1000;
+    }
+    mqttc::DescribeImageBytes(file->data(), file->size(), out);
+    return file;
+}
+
 static std::string EnsureDeviceId()
 {
     std::string id = mqttc::GetMqttPayloadDeviceId();
@@ -74,6 +109,93 @@ static void PublishDiscoveryRetainedBestEffort()
     (void)g_mqttClient.publishDiscoveryAnnounceRetained(prefix, deviceId, "unionpi", &err);
 }
 
+// 日志补传：补传线程逐条回调，发布到 <prefix>/<deviceId>/sensors/history（QoS1），
+// 返回 false（未连接/发布失败）时补传线程稍后重试同一条记录
+static bool PublishReplayRecord(const sensor::SensorLogRecord &rec)
+{
+    if (!g_mqttClient.isConnected()) {
+        return false;
+    }
+    const mqttc::PayloadCodec codec = mqttc::GetMqttPayloadCodec(mqttc::PayloadTopic::HISTORY);
+    std::string payload;
+    if (!mqttc::BuildSensorHistoryPayload(codec, rec, payload)) {
+        return true; // 无法序列化的记录跳过，避免卡住补传
+    }
+    const std::string topic = mqttc::PayloadCodecTopic(
+        mqttc::GetMqttTopicPrefix() + "/" + EnsureDeviceId() + "/sensors/history", codec);
+    return g_mqttClient.publish(topic, payload.data(), payload.size(), 1, false, nullptr);
+}
+
+static void InstallReplayPublisherOnce()
+{
+    static std::once_flag once;
+    std::call_once(once, [] { sensor::SetSensorLogReplayPublisher(PublishReplayRecord); });
+}
+
+// 订阅方请求关键帧（控制主题 {"control":{"keyframe":1}}）：立即发一帧完整数据到 sensors 主题。
+// 在 I/O 线程的消息回调中调用，只入队不等待
+static void PublishSensorKeyframe()
+{
+    if (!g_mqttClient.isConnected()) {
+        return; // 强制标记已置位，下次上报即为关键帧
+    }
+    sensor::SensorSnapshot snap;
+    sensor::GetSnapshot(snap);
+    (void)mqttc::NextSensorUpdate(snap, control::GetAutoControlAlarm(), sensor::MonotonicMs());
+
+    const mqttc::PayloadCodec codec = mqttc::GetMqttPayloadCodec(mqttc::PayloadTopic::SENSORS);
+    std::string payload;
+    if (!mqttc::BuildSensorPayload(codec, snap, nullptr, payload)) {
+        mqttc::ForceSensorKeyframe();
+        return;
+    }
+    const std::string topic = mqttc::PayloadCodecTopic(
+        mqttc::GetMqttTopicPrefix() + "/" + EnsureDeviceId() + "/sensors", codec);
+    const bool queued = g_mqttClient.publishAsync(topic, mqttc::PublishPayload::FromBuffer(std::move(payload)), 0,
+        false, [](bool ok, const std::string &) {
+            if (!ok) {
+                mqttc::ForceSensorKeyframe();
+            }
+        });
+    if (!queued) {
+        mqttc::ForceSensorKeyframe();
+    }
+}
+
+static void InstallKeyframePublisherOnce()
+{
+    static std::once_flag once;
+    std::call_once(once, [] { mqttc::SetSensorKeyframePublisher(PublishSensorKeyframe); });
+}
+
+// 批量上报（setMqttBatch）：批次线程每攒满一批调用一次，发布到 <prefix>/<deviceId>/sensors/batch（QoS1）。
+// 成败同样记入持久化日志，断线期间的帧恢复后经 sensors/history 补传
+static void PublishSensorBatch(const sensor::SensorBatch &batch)
+{
+    if (!g_mqttClient.isConnected()) {
+        sensor::SensorLogNoteUpload(false);
+        return;
+    }
+    const mqttc::PayloadCodec codec = mqttc::GetMqttPayloadCodec(mqttc::PayloadTopic::SENSORS);
+    std::string payload;
+    if (!mqttc::BuildSensorBatchPayload(codec, batch, control::GetAutoControlAlarm(), payload)) {
+        return;
+    }
+    const std::string topic = mqttc::PayloadCodecTopic(
+        mqttc::GetMqttTopicPrefix() + "/" + EnsureDeviceId() + "/sensors/batch", codec);
+    const bool queued = g_mqttClient.publishAsync(topic, mqttc::PublishPayload::FromBuffer(std::move(payload)), 1,
+        false, [](bool ok, const std::string &) { sensor::SensorLogNoteUpload(ok); });
+    if (!queued) {
+        sensor::SensorLogNoteUpload(false);
+    }
+}
+
+static void InstallBatchPublisherOnce()
+{
+    static std::once_flag once;
+    std::call_once(once, [] { sensor::SetSensorBatchPublisher(PublishSensorBatch); });
+}
+
 } // namespace
 
 static napi_value configMqtt(napi_env env, napi_callback_info info)
@@ -165,11 +287,40 @@ struct MqttAsyncContext {
 
     // publish args
     std::string topic;
+    std::string imageTopic;
     std::string payload;
     int qos = 0;
     bool isImage = false;
+
+    // publish：已入队时结果由 I/O 线程的完成回调经 tsfn 带回 JS 线程；
+    // Complete 与 CallJs 各持一份引用，后结束的一方释放 ctx
+    bool pending = false;
+    napi_threadsafe_function tsfn = nullptr;
+    std::atomic<int> refs{2};
 };
 
+static void ReleasePublishContext(MqttAsyncContext *ctx)
+{
+    if (ctx->refs.fetch_sub(1) == 1) {
+        delete ctx;
+    }
+}
+
+static void ResolveBoolPromise(napi_env env, MqttAsyncContext *ctx)
+{
+    if (ctx->success) {
+        napi_value result;
+        NAPI_CALL_RETURN_VOID(env, napi_get_boolean(env, true, &result));
+        NAPI_CALL_RETURN_VOID(env, napi_resolve_deferred(env, ctx->deferred, result));
+    } else {
+        napi_value error;
+        napi_value msg;
+        NAPI_CALL_RETURN_VOID(env, napi_create_string_utf8(env, ctx->error.c_str(), ctx->error.size(), &msg));
+        NAPI_CALL_RETURN_VOID(env, napi_create_error(env, nullptr, msg, &error));
+        NAPI_CALL_RETURN_VOID(env, napi_reject_deferred(env, ctx->deferred, error));
+    }
+}
+
 static void ConnectExecute(napi_env env, void *data)
 {
     (void)env;
@@ -190,6 +341,9 @@ static void ConnectExecute(napi_env env, void *data)
         std::lock_guard<std::mutex> lock(g_discoveryMu);
         g_lastAnnouncedPrefix = mqttc::GetMqttTopicPrefix();
     }
+    InstallReplayPublisherOnce();
+    InstallKeyframePublisherOnce();
+    InstallBatchPublisherOnce();
 }
 
 static void PublishExecute(napi_env env, void *data)
@@ -197,22 +351,130 @@ static void PublishExecute(napi_env env, void *data)
     (void)env;
     auto *ctx = static_cast<MqttAsyncContext *>(data);
 
+    // 批量模式下每一帧都已经在 sensors/batch 里发出，单帧上报只剩带图片的
+    if (!ctx->isImage && sensor::IsSensorBatchEnabled()) {
+        ctx->success = true;
+        return;
+    }
+
+    sensor::SensorSnapshot snap;
+    sensor::GetSnapshot(snap);
+    // 非图片上报：若与上次成功上报的是同一帧（ESP32 未送来新数据），直接跳过
+    if (!ctx->isImage && snap.seq != 0 && snap.seq == g_lastPublishedSeq.load()) {
+        ctx->success = true;
+        return;
+    }
+
+    // 编码按主题配置：CBOR 发布到 <topic>/cbor
+    const mqttc::PayloadCodec codec = mqttc::GetMqttPayloadCodec(mqttc::PayloadTopic::SENSORS);
+    std::string topic = mqttc::PayloadCodecTopic(ctx->topic, codec);
+
+    // 死区过滤（setMqttDeadband）：变化都在死区内则不发，只有部分通道变化时发到 sensors/delta；
+    // 带图片的上报总是完整帧
+    const int alarm = control::GetAutoControlAlarm();
+    if (ctx->isImage) {
+        mqttc::ForceSensorKeyframe();
+    }
+    const mqttc::SensorUpdate update = mqttc::NextSensorUpdate(snap, alarm, sensor::MonotonicMs());
+    if (update.kind == mqttc::SensorUpdateKind::NONE) {
+        g_lastPublishedSeq.store(snap.seq);
+        ctx->success = true;
+        return;
+    }
+
     std::string buildErr;
-    // haveImage=true: 将图片(Base64)作为 JSON 的可选字段一并发送
-    if (!mqttc::BuildSensorPayloadJson(ctx->isImage, ctx->payload, &buildErr)) {
+    bool built;
+    if (update.kind == mqttc::SensorUpdateKind::DELTA) {
+        topic = mqttc::PayloadCodecTopic(ctx->topic + "/delta", codec);
+        built = mqttc::BuildSensorDeltaPayload(codec, snap, update, alarm, ctx->payload, &buildErr);
+    } else if (ctx->isImage && (codec == mqttc::PayloadCodec::CBOR || !mqttc::GetMqttImageInlineBase64())) {
+        // haveImage=true：JPEG 原样发布到 image 主题（直接引用内存中的图片，不拷贝），
+        // sensors 负载只带 imageMeta（大小、CRC-32、拍摄时间、分辨率）；CBOR 不支持内嵌图片
+        mqttc::ImagePayload image;
+        auto imagePayload = LoadImageForPublish(image, &buildErr);
+        built = imagePayload != nullptr && mqttc::BuildSensorPayload(codec, snap, &image, ctx->payload, &buildErr);
+        if (built) {
+            // 图片先入队：同一连接、同一 QoS 按序送达，订阅方收到 imageMeta 时图片已先到
+            std::string imgErr;
+            if (!g_mqttClient.publishAsync(ctx->imageTopic, std::move(imagePayload), ctx->qos, false, nullptr,
+                                           &imgErr)) {
+                mqttc::ForceSensorKeyframe();
+                ctx->success = false;
+                ctx->error = imgErr.empty() ? "publish image failed" : imgErr;
+                return;
+            }
+        }
+    } else if (ctx->isImage) {
+        // 兼容旧格式（setMqttImageInline(true)）：图片 Base64 后作为 JSON 的可选字段 image 一并发送
+        built = mqttc::BuildSensorPayloadJson(snap, true, ctx->payload, &buildErr);
+    } else {
+        built = mqttc::BuildSensorPayload(codec, snap, nullptr, ctx->payload, &buildErr);
+    }
+    if (!built) {
+        mqttc::ForceSensorKeyframe();
         ctx->success = false;
         ctx->error = buildErr.empty() ? "build sensor payload failed" : buildErr;
         return;
     }
 
+    // 入队即返回，不占用 worker 线程等待 broker；QoS1 在 PUBACK 到达时完成
+    const uint64_t seq = snap.seq;
     std::string err;
-    ctx->success = g_mqttClient.publish(ctx->topic, ctx->payload.data(), ctx->payload.size(), ctx->qos, false, &err);
-    if (!ctx->success) {
-        ctx->error = err.empty() ? g_mqttClient.getLastError() : err;
-        if (ctx->error.empty()) {
-            ctx->error = "publish failed";
-        }
+    ctx->pending = true;
+    // 负载移交给客户端，带图片的大报文由 I/O 线程直接写 socket，不再整份拷贝
+    auto payload = mqttc::PublishPayload::FromBuffer(std::move(ctx->payload));
+    const bool queued = g_mqttClient.publishAsync(topic, std::move(payload), ctx->qos, false,
+        [ctx, seq](bool ok, const std::string &error) {
+            // 上报成败交给持久化日志：断线期间的记录在恢复后经 sensors/history 补传
+            sensor::SensorLogNoteUpload(ok);
+            if (ok) {
+                g_lastPublishedSeq.store(seq);
+            } else {
+                mqttc::ForceSensorKeyframe(); // 订阅方可能没收到这一帧：下次从完整帧重新开始
+            }
+            ctx->success = ok;
+            if (!ok) {
+                ctx->error = error.empty() ? "publish failed" : error;
+            }
+            if (napi_call_threadsafe_function(ctx->tsfn, ctx, napi_tsfn_nonblocking) != napi_ok) {
+                ReleasePublishContext(ctx); // JS 环境已销毁，promise 无从结算
+            }
+        },
+        &err);
+    if (!queued) {
+        ctx->pending = false;
+        mqttc::ForceSensorKeyframe();
+        sensor::SensorLogNoteUpload(false);
+        ctx->success = false;
+        ctx->error = err.empty() ? "publish failed" : err;
+    }
+}
+
+static void PublishCallJs(napi_env env, napi_value jsCb, void *context, void *data)
+{
+    (void)jsCb;
+    (void)context;
+    auto *ctx = static_cast<MqttAsyncContext *>(data);
+    if (env != nullptr) {
+        ResolveBoolPromise(env, ctx);
     }
+    napi_release_threadsafe_function(ctx->tsfn, napi_tsfn_release);
+    ReleasePublishContext(ctx);
+}
+
+static void PublishComplete(napi_env env, napi_status status, void *data)
+{
+    (void)status;
+    auto *ctx = static_cast<MqttAsyncContext *>(data);
+    napi_delete_async_work(env, ctx->work);
+    if (ctx->pending) {
+        ReleasePublishContext(ctx);
+        return;
+    }
+    // 跳过、构建失败或入队失败：此处直接结算，完成回调不会再来
+    ResolveBoolPromise(env, ctx);
+    napi_release_threadsafe_function(ctx->tsfn, napi_tsfn_release);
+    delete ctx;
 }
 
 static void BoolPromiseComplete(napi_env env, napi_status status, void *data)
@@ -220,17 +482,7 @@ static void BoolPromiseComplete(napi_env env, napi_status status, void *data)
     (void)status;
     auto *ctx = static_cast<MqttAsyncContext *>(data);
 
-    if (ctx->success) {
-        napi_value result;
-        NAPI_CALL_RETURN_VOID(env, napi_get_boolean(env, true, &result));
-        NAPI_CALL_RETURN_VOID(env, napi_resolve_deferred(env, ctx->deferred, result));
-    } else {
-        napi_value error;
-        napi_value msg;
-        NAPI_CALL_RETURN_VOID(env, napi_create_string_utf8(env, ctx->error.c_str(), ctx->error.size(), &msg));
-        NAPI_CALL_RETURN_VOID(env, napi_create_error(env, nullptr, msg, &error));
-        NAPI_CALL_RETURN_VOID(env, napi_reject_deferred(env, ctx->deferred, error));
-    }
+    ResolveBoolPromise(env, ctx);
 
     NAPI_CALL_RETURN_VOID(env, napi_delete_async_work(env, ctx->work));
     delete ctx;
@@ -354,6 +606,7 @@ static napi_value publishMqtt(napi_env env, napi_callback_info info)
         }
 
         ctx->topic = prefix + "/" + deviceId + "/sensors";
+        ctx->imageTopic = prefix + "/" + deviceId + "/image";
     }
     ctx->qos = qos;
     ctx->isImage = haveImage;
@@ -363,14 +616,302 @@ static napi_value publishMqtt(napi_env env, napi_callback_info info)
     napi_value resource_name;
     NAPI_CALL(env, napi_create_string_utf8(env, "PublishMqtt", NAPI_AUTO_LENGTH, &resource_name));
 
+    NAPI_CALL(env, napi_create_threadsafe_function(env, nullptr, nullptr, resource_name, 0, 1,
+        nullptr, nullptr, nullptr, PublishCallJs, &ctx->tsfn));
+
     NAPI_CALL(env, napi_create_async_work(env, nullptr, resource_name,
-        PublishExecute, BoolPromiseComplete,
+        PublishExecute, PublishComplete,
         ctx, &ctx->work));
 
     NAPI_CALL(env, napi_queue_async_work(env, ctx->work));
     return promise;
 }
 
+// setMqttReconnect(enabled, minDelayMs, maxDelayMs) -> boolean
+static napi_value setMqttReconnect(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 3;
+    napi_value args[3];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    bool ok = argc >= 3;
+    bool enabled = false;
+    int32_t minDelayMs = 0;
+    int32_t maxDelayMs = 0;
+    ok = ok && napi_get_value_bool(env, args[0], &enabled) == napi_ok;
+    ok = ok && napi_get_value_int32(env, args[1], &minDelayMs) == napi_ok;
+    ok = ok && napi_get_value_int32(env, args[2], &maxDelayMs) == napi_ok;
+    ok = ok && minDelayMs > 0 && maxDelayMs >= minDelayMs;
+    if (ok) {
+        g_mqttClient.setReconnectPolicy(enabled, minDelayMs, maxDelayMs);
+    }
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+// setMqttOfflineQueue(capacity, dropOldest, drainPerSec) -> boolean
+static napi_value setMqttOfflineQueue(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 3;
+    napi_value args[3];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    bool ok = argc >= 3;
+    int32_t capacity = 0;
+    bool dropOldest = true;
+    double drainPerSec = 0;
+    ok = ok && napi_get_value_int32(env, args[0], &capacity) == napi_ok;
+    ok = ok && napi_get_value_bool(env, args[1], &dropOldest) == napi_ok;
+    ok = ok && napi_get_value_double(env, args[2], &drainPerSec) == napi_ok;
+    ok = ok && capacity > 0;
+    if (ok) {
+        g_mqttClient.setOutboundQueuePolicy(static_cast<size_t>(capacity),
+            dropOldest ? mqttc::MqttCClient::DropPolicy::DROP_OLDEST : mqttc::MqttCClient::DropPolicy::DROP_NEWEST,
+            drainPerSec);
+    }
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+// setMqttMaxReceiveSize(maxBytes) -> boolean
+static napi_value setMqttMaxReceiveSize(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 1;
+    napi_value args[1];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    bool ok = argc >= 1;
+    int64_t maxBytes = 0;
+    ok = ok && napi_get_value_int64(env, args[0], &maxBytes) == napi_ok;
+    ok = ok && maxBytes > 0;
+    if (ok) {
+        g_mqttClient.setMaxReceiveSize(static_cast<size_t>(maxBytes));
+    }
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+// setMqttImageInline(inlineBase64) -> boolean
+static napi_value setMqttImageInline(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 1;
+    napi_value args[1];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    bool inlineBase64 = false;
+    const bool ok = argc >= 1 && napi_get_value_bool(env, args[0], &inlineBase64) == napi_ok;
+    if (ok) {
+        mqttc::SetMqttImageInlineBase64(inlineBase64);
+    }
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+// setMqttPayloadCodec(topic: 'sensors' | 'history', codec: 'json' | 'cbor') -> boolean
+static napi_value setMqttPayloadCodec(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 2;
+    napi_value args[2];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    char topicBuf[16] = {0};
+    char codecBuf[16] = {0};
+    size_t len = 0;
+    bool ok = argc >= 2;
+    ok = ok && napi_get_value_string_utf8(env, args[0], topicBuf, sizeof(topicBuf), &len) == napi_ok;
+    ok = ok && napi_get_value_string_utf8(env, args[1], codecBuf, sizeof(codecBuf), &len) == napi_ok;
+
+    const std::string topicStr(topicBuf);
+    const std::string codecStr(codecBuf);
+    ok = ok && (topicStr == "sensors" || topicStr == "history") && (codecStr == "json" || codecStr == "cbor");
+    if (ok) {
+        mqttc::SetMqttPayloadCodec(topicStr == "history" ? mqttc::PayloadTopic::HISTORY : mqttc::PayloadTopic::SENSORS,
+                                   codecStr == "cbor" ? mqttc::PayloadCodec::CBOR : mqttc::PayloadCodec::JSON);
+    }
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+// setMqttDeadband(enabled, keyframeIntervalSec) -> boolean
+static napi_value setMqttDeadband(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 2;
+    napi_value args[2];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    bool enabled = false;
+    int32_t keyframeIntervalSec = 0;
+    bool ok = argc >= 1 && napi_get_value_bool(env, args[0], &enabled) == napi_ok;
+    if (ok && argc >= 2) {
+        ok = napi_get_value_int32(env, args[1], &keyframeIntervalSec) == napi_ok && keyframeIntervalSec >= 0;
+    }
+    if (ok) {
+        mqttc::SetSensorDeadbandEnabled(enabled, keyframeIntervalSec);
+    }
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+// setMqttDeadbandChannel(key, absolute, relative) -> boolean，key 为数据键名，例如 "SoilHumi"
+static napi_value setMqttDeadbandChannel(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 3;
+    napi_value args[3];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    char key[64] = {0};
+    size_t keyLen = 0;
+    double absolute = 0;
+    double relative = 0;
+    sensor::SensorId id;
+    bool ok = argc >= 3;
+    ok = ok && napi_get_value_string_utf8(env, args[0], key, sizeof(key) - 1, &keyLen) == napi_ok;
+    ok = ok && napi_get_value_double(env, args[1], &absolute) == napi_ok;
+    ok = ok && napi_get_value_double(env, args[2], &relative) == napi_ok;
+    ok = ok && sensor::FindSensorId(key, &id);
+    ok = ok && mqttc::SetSensorDeadband(id, static_cast<float>(absolute), static_cast<float>(relative));
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+static napi_value getMqttDeadbandStats(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    const mqttc::SensorDeadbandStats stats = mqttc::GetSensorDeadbandStats();
+    napi_value result;
+    napi_value value;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.keyframes), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "keyframes", value));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.deltas), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "deltas", value));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.suppressed), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "suppressed", value));
+    return result;
+}
+
+// setMqttBatch(enabled, windowMs, maxSamples, maxLatencyMs) -> boolean
+static napi_value setMqttBatch(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 4;
+    napi_value args[4];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    sensor::SensorBatchPolicy policy = sensor::GetSensorBatchPolicy();
+    int32_t windowMs = policy.windowMs;
+    int32_t maxSamples = static_cast<int32_t>(policy.maxSamples);
+    int32_t maxLatencyMs = policy.maxLatencyMs;
+    bool ok = argc >= 4;
+    ok = ok && napi_get_value_bool(env, args[0], &policy.enabled) == napi_ok;
+    ok = ok && napi_get_value_int32(env, args[1], &windowMs) == napi_ok;
+    ok = ok && napi_get_value_int32(env, args[2], &maxSamples) == napi_ok;
+    ok = ok && napi_get_value_int32(env, args[3], &maxLatencyMs) == napi_ok;
+    ok = ok && maxSamples > 0;
+    if (ok) {
+        policy.windowMs = windowMs;
+        policy.maxSamples = static_cast<size_t>(maxSamples);
+        policy.maxLatencyMs = maxLatencyMs;
+        ok = sensor::SetSensorBatchPolicy(policy);
+    }
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+static napi_value getMqttBatchStats(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    const sensor::SensorBatchStats stats = sensor::GetSensorBatchStats();
+    napi_value result;
+    napi_value value;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.batches), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "batches", value));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.samples), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "samples", value));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.dropped), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "dropped", value));
+    return result;
+}
+
+static napi_value getMqttQueueStats(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    const mqttc::MqttCClient::QueueStats stats = g_mqttClient.getQueueStats();
+    napi_value result;
+    napi_value value;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, napi_create_uint32(env, static_cast<uint32_t>(stats.queued), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "queued", value));
+    NAPI_CALL(env, napi_create_uint32(env, static_cast<uint32_t>(stats.inFlight), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "inFlight", value));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.dropped), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "dropped", value));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.reconnects), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "reconnects", value));
+    return result;
+}
+
+// setMqttTls(caFile, certFile, keyFile, verifyPeer, sessionResumption, serverName?) -> boolean
+// 只对 mqtts:// 的 brokerUrl 生效，下次 connectMqtt（或自动重连）时使用；不用的证书路径传空串
+static napi_value setMqttTls(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 6;
+    napi_value args[6];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    char caFile[256] = {0};
+    char certFile[256] = {0};
+    char keyFile[256] = {0};
+    char serverName[256] = {0};
+    size_t len = 0;
+    mqttc::TlsOptions options;
+    bool ok = argc >= 5;
+    ok = ok && napi_get_value_string_utf8(env, args[0], caFile, sizeof(caFile) - 1, &len) == napi_ok;
+    ok = ok && napi_get_value_string_utf8(env, args[1], certFile, sizeof(certFile) - 1, &len) == napi_ok;
+    ok = ok && napi_get_value_string_utf8(env, args[2], keyFile, sizeof(keyFile) - 1, &len) == napi_ok;
+    ok = ok && napi_get_value_bool(env, args[3], &options.verifyPeer) == napi_ok;
+    ok = ok && napi_get_value_bool(env, args[4], &options.sessionResumption) == napi_ok;
+    if (ok && argc >= 6) {
+        ok = napi_get_value_string_utf8(env, args[5], serverName, sizeof(serverName) - 1, &len) == napi_ok;
+    }
+    if (ok) {
+        options.caFile = caFile;
+        options.certFile = certFile;
+        options.keyFile = keyFile;
+        options.serverName = serverName;
+        g_mqttClient.setTlsOptions(options);
+    }
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+static napi_value getMqttTlsStats(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    const mqttc::MqttCClient::TlsStats stats = g_mqttClient.getTlsStats();
+    napi_value result;
+    napi_value value;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.handshakes), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "handshakes", value));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.resumed), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "resumed", value));
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.lastHandshakeMs), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "lastHandshakeMs", value));
+    NAPI_CALL(env, napi_get_boolean(env, stats.lastResumed, &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "lastResumed", value));
+    return result;
+}
+
 napi_value RegisterMqttApis(napi_env env, napi_value exports)
 {
     napi_property_descriptor desc[] = {
@@ -379,6 +920,19 @@ napi_value RegisterMqttApis(napi_env env, napi_value exports)
         DECLARE_NAPI_FUNCTION("disconnectMqtt", disconnectMqtt),
         DECLARE_NAPI_FUNCTION("isMqttConnected", isMqttConnected),
         DECLARE_NAPI_FUNCTION("publishMqtt", publishMqtt),
+        DECLARE_NAPI_FUNCTION("setMqttReconnect", setMqttReconnect),
+        DECLARE_NAPI_FUNCTION("setMqttOfflineQueue", setMqttOfflineQueue),
+        DECLARE_NAPI_FUNCTION("getMqttQueueStats", getMqttQueueStats),
+        DECLARE_NAPI_FUNCTION("setMqttMaxReceiveSize", setMqttMaxReceiveSize),
+        DECLARE_NAPI_FUNCTION("setMqttTls", setMqttTls),
+        DECLARE_NAPI_FUNCTION("getMqttTlsStats", getMqttTlsStats),
+        DECLARE_NAPI_FUNCTION("setMqttImageInline", setMqttImageInline),
+        DECLARE_NAPI_FUNCTION("setMqttPayloadCodec", setMqttPayloadCodec),
+        DECLARE_NAPI_FUNCTION("setMqttDeadband", setMqttDeadband),
+        DECLARE_NAPI_FUNCTION("setMqttDeadbandChannel", setMqttDeadbandChannel),
+        DECLARE_NAPI_FUNCTION("getMqttDeadbandStats", getMqttDeadbandStats),
+        DECLARE_NAPI_FUNCTION("setMqttBatch", setMqttBatch),
+        DECLARE_NAPI_FUNCTION("getMqttBatchStats", getMqttBatchStats),
     };
 
     NAPI_CALL(env, napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc));
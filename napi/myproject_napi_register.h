@@ -25,11 +25,14 @@ napi_value RegisterLedApis(napi_env env, napi_value exports);
 napi_value RegisterLightSensorApis(napi_env env, napi_value exports);
 napi_value RegisterPumpApis(napi_env env, napi_value exports);
 napi_value RegisterSerialApis(napi_env env, napi_value exports);
+napi_value RegisterSerialPortApis(napi_env env, napi_value exports);
 napi_value RegisterSg90Apis(napi_env env, napi_value exports);
 napi_value RegisterSoilMoistureApis(napi_env env, napi_value exports);
 napi_value RegisterLlamaApis(napi_env env, napi_value exports);
 napi_value RegisterMqttApis(napi_env env, napi_value exports);
 napi_value RegisterControlApis(napi_env env, napi_value exports);
 napi_value RegisterUdpApis(napi_env env, napi_value exports);
+napi_value RegisterSensorHistoryApis(napi_env env, napi_value exports);
+napi_value RegisterSensorSnapshotApis(napi_env env, napi_value exports);
 
 #endif
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "napi/native_api.h"
+#include "napi/native_common.h"
+#include "napi/native_node_api.h"
+
+#include "sensor_data_provider.h"
+#include "sensor_history.h"
+
+namespace {
+
+// 解析 (key, windowSec) 公共参数
+bool ParseKeyAndWindow(napi_env env, napi_value *args, size_t argc, sensor::SensorId *id, int64_t *windowMs)
+{
+    if (argc < 2) {
+        return false;
+    }
+    char key[64] = {0};
+    size_t keyLen = 0;
+    if (napi_get_value_string_utf8(env, args[0], key, sizeof(key) - 1, &keyLen) != napi_ok) {
+        return false;
+    }
+    double windowSec = 0;
+    if (napi_get_value_double(env, args[1], &windowSec) != napi_ok || windowSec <= 0) {
+        return false;
+    }
+    *windowMs = static_cast<int64_t>(windowSec * 1000.0);
+    return sensor::FindSensorId(key, id);
+}
+
+// 单调时钟 -> 墙上时间（epoch ms），便于前端直接作图
+double ToEpochMs(int64_t monotonicMs, int64_t nowMonoMs, int64_t nowEpochMs)
+{
+    return static_cast<double>(nowEpochMs - (nowMonoMs - monotonicMs));
+}
+
+template <typename T>
+napi_value CreateTypedArray(napi_env env, napi_typedarray_type type, size_t count, T **data)
+{
+    napi_value buffer;
+    napi_value array;
+    void *raw = nullptr;
+    if (napi_create_arraybuffer(env, count * sizeof(T), &raw, &buffer) != napi_ok) {
+        return nullptr;
+    }
+    if (napi_create_typedarray(env, type, count, buffer, 0, &array) != napi_ok) {
+        return nullptr;
+    }
+    *data = static_cast<T *>(raw);
+    return array;
+}
+
+} // namespace
+
+/**
+ * @brief 查询某个传感器在最近 windowSec 秒内的 min/max/mean/last
+ *
+ * getSensorStats(key, windowSec) -> { min, max, mean, last, count } | null
+ */
+static napi_value getSensorStats(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 2;
+    napi_value args[2];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    sensor::SensorId id;
+    int64_t windowMs = 0;
+    sensor::HistoryStats stats;
+    if (!ParseKeyAndWindow(env, args, argc, &id, &windowMs) || !sensor::QueryHistory(id, windowMs, stats)) {
+        NAPI_CALL(env, napi_get_null(env, &result));
+        return result;
+    }
+
+    NAPI_CALL(env, napi_create_object(env, &result));
+    napi_value v;
+    NAPI_CALL(env, napi_create_double(env, stats.min, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, "min", v));
+    NAPI_CALL(env, napi_create_double(env, stats.max, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, "max", v));
+    NAPI_CALL(env, napi_create_double(env, stats.mean, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, "mean", v));
+    NAPI_CALL(env, napi_create_double(env, stats.last, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, "last", v));
+    NAPI_CALL(env, napi_create_uint32(env, stats.count, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, "count", v));
+    return result;
+}
+
+/**
+ * @brief 导出某个传感器在某一分辨率层级上的历史序列（typed array，按时间升序）
+ *
+ * getSensorHistory(key, windowSec, tier?) ->
+ *   { timestamps: Float64Array(epoch ms), mean: Float32Array, min: Float32Array, max: Float32Array } | null
+ * tier: 0=原始帧, 1=1 分钟, 2=15 分钟（默认 1）
+ */
+static napi_value getSensorHistory(napi_env env, napi_callback_info info)
+{
+    napi_value result;
+    size_t argc = 3;
+    napi_value args[3];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    sensor::SensorId id;
+    int64_t windowMs = 0;
+    if (!ParseKeyAndWindow(env, args, argc, &id, &windowMs)) {
+        NAPI_CALL(env, napi_get_null(env, &result));
+        return result;
+    }
+
+    int32_t tier = static_cast<int32_t>(sensor::HistoryTier::MINUTE);
+    if (argc >= 3) {
+        napi_valuetype t;
+        NAPI_CALL(env, napi_typeof(env, args[2], &t));
+        if (t == napi_number) {
+            NAPI_CALL(env, napi_get_value_int32(env, args[2], &tier));
+        }
+    }
+    if (tier < 0 || tier >= static_cast<int32_t>(sensor::kHistoryTierCount)) {
+        NAPI_CALL(env, napi_get_null(env, &result));
+        return result;
+    }
+
+    std::vector<sensor::HistoryPoint> points;
+    const size_t n = sensor::ReadHistorySeries(id, static_cast<sensor::HistoryTier>(tier), windowMs, points);
+
+    const int64_t nowMono = sensor::MonotonicMs();
+    const int64_t nowEpoch = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    double *ts = nullptr;
+    float *mean = nullptr;
+    float *minV = nullptr;
+    float *maxV = nullptr;
+    napi_value tsArr = CreateTypedArray(env, napi_float64_array, n, &ts);
+    napi_value meanArr = CreateTypedArray(env, napi_float32_array, n, &mean);
+    napi_value minArr = CreateTypedArray(env, napi_float32_array, n, &minV);
+    napi_value maxArr = CreateTypedArray(env, napi_float32_array, n, &maxV);
+    if (tsArr == nullptr || meanArr == nullptr || minArr == nullptr || maxArr == nullptr) {
+        NAPI_CALL(env, napi_get_null(env, &result));
+        return result;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        ts[i] = ToEpochMs(points[i].timestampMs, nowMono, nowEpoch);
+        mean[i] = points[i].mean;
+        minV[i] = points[i].min;
+        maxV[i] = points[i].max;
+    }
+
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, napi_set_named_property(env, result, "timestamps", tsArr));
+    NAPI_CALL(env, napi_set_named_property(env, result, "mean", meanArr));
+    NAPI_CALL(env, napi_set_named_property(env, result, "min", minArr));
+    NAPI_CALL(env, napi_set_named_property(env, result, "max", maxArr));
+    return result;
+}
+
+napi_value RegisterSensorHistoryApis(napi_env env, napi_value exports)
+{
+    napi_property_descriptor desc[] = {
+        DECLARE_NAPI_FUNCTION("getSensorStats", getSensorStats),
+        DECLARE_NAPI_FUNCTION("getSensorHistory", getSensorHistory),
+    };
+    NAPI_CALL(env, napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc));
+    return exports;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2022 Unionman Technology Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "napi/native_api.h"
+#include "napi/native_common.h"
+#include "napi/native_node_api.h"
+
+#include "sensor_data_provider.h"
+
+/**
+ * @brief 一次取出所有传感器通道（同一帧），返回 { Humi, Temp, ..., Light } 对象
+ * 
+ * @param env Node-API 环境
+ * @param info 回调信息
+ * @return napi_value 返回以帧键名为属性的对象
+ */
+static napi_value getAllSensorData(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    sensor::SensorSnapshot snap;
+    sensor::GetSnapshot(snap);
+
+    napi_value result;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    for (size_t i = 0; i < sensor::kSensorCount; i++) {
+        napi_value value;
+        NAPI_CALL(env, napi_create_double(env, snap.values[i], &value));
+        NAPI_CALL(env, napi_set_named_property(env, result,
+            sensor::SensorKeyName(static_cast<sensor::SensorId>(i)), value));
+    }
+
+    // 帧元信息：seq=0 表示尚未收到任何帧；ageMs 为帧到达至今的毫秒数；validMask 按 SensorId 置位
+    napi_value meta;
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(snap.seq), &meta));
+    NAPI_CALL(env, napi_set_named_property(env, result, "seq", meta));
+    const double ageMs = snap.seq != 0 ? static_cast<double>(sensor::MonotonicMs() - snap.timestampMs) : -1.0;
+    NAPI_CALL(env, napi_create_double(env, ageMs, &meta));
+    NAPI_CALL(env, napi_set_named_property(env, result, "ageMs", meta));
+    NAPI_CALL(env, napi_create_uint32(env, snap.validMask, &meta));
+    NAPI_CALL(env, napi_set_named_property(env, result, "validMask", meta));
+    // 二进制帧的固件序号（文本帧为 0）与按序号缺口累计的丢帧数
+    NAPI_CALL(env, napi_create_uint32(env, snap.deviceSeq, &meta));
+    NAPI_CALL(env, napi_set_named_property(env, result, "deviceSeq", meta));
+    const sensor::FrameStats stats = sensor::GetFrameStats(sensor::GetDataChannel());
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(stats.lostFrames), &meta));
+    NAPI_CALL(env, napi_set_named_property(env, result, "lostFrames", meta));
+    return result;
+}
+
+// 与通道无关：串口、UDP、多路径都写入同一份快照，只注册一次
+napi_value RegisterSensorSnapshotApis(napi_env env, napi_value exports)
+{
+    napi_property_descriptor desc[] = {
+        DECLARE_NAPI_FUNCTION("getAllSensorData", getAllSensorData),
+    };
+    NAPI_CALL(env, napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc));
+    return exports;
+}
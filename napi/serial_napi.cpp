@@ -68,6 +68,148 @@ static napi_value getDataByKey(napi_env env, napi_callback_info info)
     return result;
 }
 
+static napi_value getSerialRxStats(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    SerialRxStats stats;
+    memset(&stats, 0, sizeof(stats));
+    serial_get_rx_stats(&stats);
+
+    napi_value result;
+    napi_value value;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    const struct {
+        const char *name;
+        uint64_t value;
+    } fields[] = {
+        {"bytes", stats.bytes},
+        {"reads", stats.reads},
+        {"sensorFrames", stats.sensorFrames},
+        {"imageFrames", stats.imageFrames},
+        {"checksumErrors", stats.checksumErrors},
+        {"oversizeFrames", stats.oversizeFrames},
+    };
+    for (const auto &field : fields) {
+        NAPI_CALL(env, napi_create_double(env, static_cast<double>(field.value), &value));
+        NAPI_CALL(env, napi_set_named_property(env, result, field.name, value));
+    }
+    return result;
+}
+
+static napi_value getSerialTxStats(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    SerialTxStats stats;
+    memset(&stats, 0, sizeof(stats));
+    serial_get_tx_stats(&stats);
+
+    napi_value result;
+    napi_value value;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    const struct {
+        const char *name;
+        uint64_t value;
+    } fields[] = {
+        {"writes", stats.writes},
+        {"bytes", stats.bytes},
+        {"syscalls", stats.syscalls},
+        {"dropped", stats.dropped},
+    };
+    for (const auto &field : fields) {
+        NAPI_CALL(env, napi_create_double(env, static_cast<double>(field.value), &value));
+        NAPI_CALL(env, napi_set_named_property(env, result, field.name, value));
+    }
+    return result;
+}
+
+static napi_value setSerialHexDump(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1];
+    bool enable = false;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+    if (argc >= 1) {
+        NAPI_CALL(env, napi_get_value_bool(env, args[0], &enable));
+    }
+    serial_set_hex_dump(enable);
+    return nullptr;
+}
+
+struct SerialBaudContext {
+    napi_async_work work;
+    napi_deferred deferred;
+    int baud = 0;
+    bool rtscts = false;
+    bool success = false;
+};
+
+static void SetBaudExecute(napi_env env, void *data)
+{
+    (void)env;
+    auto *ctx = static_cast<SerialBaudContext *>(data);
+    // 协商要等固件应答与 PING 确认，可能阻塞数秒，放在工作线程
+    ctx->success = serial_set_baudrate(ctx->baud, ctx->rtscts) == 0;
+}
+
+static void SetBaudComplete(napi_env env, napi_status status, void *data)
+{
+    (void)status;
+    auto *ctx = static_cast<SerialBaudContext *>(data);
+    napi_value result;
+    NAPI_CALL_RETURN_VOID(env, napi_get_boolean(env, ctx->success, &result));
+    NAPI_CALL_RETURN_VOID(env, napi_resolve_deferred(env, ctx->deferred, result));
+    NAPI_CALL_RETURN_VOID(env, napi_delete_async_work(env, ctx->work));
+    delete ctx;
+}
+
+// setSerialBaudrate(baud: number, rtscts?: boolean): Promise<boolean>
+static napi_value setSerialBaudrate(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value args[2];
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    auto *ctx = new SerialBaudContext();
+    if (argc >= 1) {
+        NAPI_CALL(env, napi_get_value_int32(env, args[0], &ctx->baud));
+    }
+    if (argc >= 2) {
+        NAPI_CALL(env, napi_get_value_bool(env, args[1], &ctx->rtscts));
+    }
+
+    napi_value promise;
+    NAPI_CALL(env, napi_create_promise(env, &ctx->deferred, &promise));
+    napi_value resource_name;
+    NAPI_CALL(env, napi_create_string_utf8(env, "SetSerialBaudrate", NAPI_AUTO_LENGTH, &resource_name));
+    NAPI_CALL(env, napi_create_async_work(env, nullptr, resource_name,
+        SetBaudExecute, SetBaudComplete,
+        ctx, &ctx->work));
+    NAPI_CALL(env, napi_queue_async_work(env, ctx->work));
+    return promise;
+}
+
+static napi_value getSerialBaudrate(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    napi_value result;
+    NAPI_CALL(env, napi_create_int32(env, serial_get_baudrate(), &result));
+    return result;
+}
+
+// 串口本身的诊断与速率接口，与数据通道选择无关：UDP 为默认通道时串口读线程同样在运行
+napi_value RegisterSerialPortApis(napi_env env, napi_value exports)
+{
+    napi_property_descriptor desc[] = {
+        DECLARE_NAPI_FUNCTION("getSerialRxStats", getSerialRxStats),
+        DECLARE_NAPI_FUNCTION("getSerialTxStats", getSerialTxStats),
+        DECLARE_NAPI_FUNCTION("setSerialHexDump", setSerialHexDump),
+        DECLARE_NAPI_FUNCTION("setSerialBaudrate", setSerialBaudrate),
+        DECLARE_NAPI_FUNCTION("getSerialBaudrate", getSerialBaudrate),
+    };
+    NAPI_CALL(env, napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc));
+    return exports;
+}
+
 napi_value RegisterSerialApis(napi_env env, napi_value exports)
 {
     sensor::SetDataChannel(sensor::DataChannel::SERIAL);
@@ -79,5 +221,5 @@ napi_value RegisterSerialApis(napi_env env, napi_value exports)
         DECLARE_NAPI_FUNCTION("offImageCaptured", offImageCaptured),
     };
     NAPI_CALL(env, napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc));
-    return exports;
+    return RegisterSerialPortApis(env, exports);
 }
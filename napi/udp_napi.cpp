@@ -20,7 +20,9 @@
 #include "napi/native_node_api.h"
 
 #include "image_capture_callback_manager.h"
+#include "image_store.h"
 #include "sensor_data_provider.h"
+#include "wifi_udp_receiver.h"
 
 namespace {
 const char *kCaptureCmd = "CAPTURE";
@@ -73,6 +75,273 @@ static napi_value getDataByKey(napi_env env, napi_callback_info info)
     return result;
 }
 
+/**
+ * @brief 列出所有在线的 ESP32 节点及其最新一帧
+ *
+ * @param env Node-API 环境
+ * @param info 回调信息
+ * @return napi_value 返回节点对象数组
+ */
+static napi_value getUdpNodes(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    std::vector<WifiUdpNode> nodes;
+    wifi_get_nodes(nodes);
+    const int64_t now = sensor::MonotonicMs();
+
+    napi_value result;
+    NAPI_CALL(env, napi_create_array_with_length(env, nodes.size(), &result));
+    for (size_t n = 0; n < nodes.size(); n++) {
+        const WifiUdpNode &node = nodes[n];
+        napi_value obj;
+        napi_value value;
+        NAPI_CALL(env, napi_create_object(env, &obj));
+
+        NAPI_CALL(env, napi_create_string_utf8(env, node.address.c_str(), node.address.size(), &value));
+        NAPI_CALL(env, napi_set_named_property(env, obj, "address", value));
+        NAPI_CALL(env, napi_get_boolean(env, node.primary, &value));
+        NAPI_CALL(env, napi_set_named_property(env, obj, "primary", value));
+        NAPI_CALL(env, napi_create_double(env, static_cast<double>(now - node.lastSeenMs), &value));
+        NAPI_CALL(env, napi_set_named_property(env, obj, "ageMs", value));
+        NAPI_CALL(env, napi_create_double(env, static_cast<double>(node.frames), &value));
+        NAPI_CALL(env, napi_set_named_property(env, obj, "frames", value));
+        NAPI_CALL(env, napi_create_double(env, static_cast<double>(node.lostFrames), &value));
+        NAPI_CALL(env, napi_set_named_property(env, obj, "lostFrames", value));
+        NAPI_CALL(env, napi_create_uint32(env, node.latest.deviceSeq, &value));
+        NAPI_CALL(env, napi_set_named_property(env, obj, "deviceSeq", value));
+        NAPI_CALL(env, napi_create_uint32(env, node.latest.validMask, &value));
+        NAPI_CALL(env, napi_set_named_property(env, obj, "validMask", value));
+
+        // 传感器值与 getAllSensorData 相同，以帧键名为属性
+        napi_value data;
+        NAPI_CALL(env, napi_create_object(env, &data));
+        for (size_t i = 0; i < sensor::kSensorCount; i++) {
+            NAPI_CALL(env, napi_create_double(env, node.latest.values[i], &value));
+            NAPI_CALL(env, napi_set_named_property(env, data,
+                sensor::SensorKeyName(static_cast<sensor::SensorId>(i)), value));
+        }
+        NAPI_CALL(env, napi_set_named_property(env, obj, "data", data));
+
+        NAPI_CALL(env, napi_set_element(env, result, static_cast<uint32_t>(n), obj));
+    }
+    return result;
+}
+
+/**
+ * @brief 读取 UDP 接收路径统计（收包数、字节数、内核丢包、队列溢出等）
+ *
+ * @param env Node-API 环境
+ * @param info 回调信息
+ * @return napi_value 返回统计对象
+ */
+static napi_value getUdpRxStats(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    wifi_udp_rx_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    wifi_get_rx_stats(&stats);
+
+    napi_value result;
+    napi_value value;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    const struct {
+        const char *name;
+        uint64_t value;
+    } fields[] = {
+        {"datagrams", stats.datagrams},
+        {"bytes", stats.bytes},
+        {"batches", stats.batches},
+        {"kernelDrops", stats.kernelDrops},
+        {"ringOverflows", stats.ringOverflows},
+        {"truncated", stats.truncated},
+        {"chunkImages", stats.chunkImages},
+        {"chunkNacks", stats.chunkNacks},
+        {"chunkDuplicates", stats.chunkDuplicates},
+        {"chunkCrcErrors", stats.chunkCrcErrors},
+        {"chunkAbandoned", stats.chunkAbandoned},
+    };
+    for (const auto &field : fields) {
+        NAPI_CALL(env, napi_create_double(env, static_cast<double>(field.value), &value));
+        NAPI_CALL(env, napi_set_named_property(env, result, field.name, value));
+    }
+    NAPI_CALL(env, napi_create_int32(env, stats.rcvbufBytes, &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "rcvbufBytes", value));
+    return result;
+}
+
+/**
+ * @brief 取得内存中的最新照片（JPEG），无需再读取 PHOTO_PATH
+ *
+ * @param env Node-API 环境
+ * @param info 回调信息
+ * @return napi_value 返回 ArrayBuffer；尚未收到照片时返回 null
+ */
+static napi_value getLatestImage(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    napi_value result;
+    image::ImageRef latest = image::GetLatestImage();
+    if (!latest) {
+        NAPI_CALL(env, napi_get_null(env, &result));
+        return result;
+    }
+    // 拷贝一份给 JS：ArrayBuffer 可写，不能直接引用共享的图片缓冲
+    void *data = nullptr;
+    NAPI_CALL(env, napi_create_arraybuffer(env, latest->size(), &data, &result));
+    if (!latest->empty()) {
+        memcpy(data, latest->data(), latest->size());
+    }
+    return result;
+}
+
+static const char *ChannelName(sensor::DataChannel channel)
+{
+    switch (channel) {
+        case sensor::DataChannel::SERIAL:
+            return "serial";
+        case sensor::DataChannel::MULTIPATH:
+            return "multipath";
+        default:
+            return "udp";
+    }
+}
+
+/**
+ * @brief 切换传感器数据通道："serial" / "udp" / "multipath"（串口与 UDP 同时接收、去重合并）
+ *
+ * @param env Node-API 环境
+ * @param info 回调信息，参数为通道名
+ * @return napi_value 返回是否切换成功（未知通道名返回 false）
+ */
+static napi_value setDataChannel(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1];
+    char name[16] = {0};
+    size_t len = 0;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+    bool ok = false;
+    if (argc >= 1 && napi_get_value_string_utf8(env, args[0], name, sizeof(name), &len) == napi_ok) {
+        const sensor::DataChannel channels[] = {
+            sensor::DataChannel::SERIAL, sensor::DataChannel::UDP, sensor::DataChannel::MULTIPATH,
+        };
+        for (sensor::DataChannel channel : channels) {
+            if (strcmp(name, ChannelName(channel)) == 0) {
+                sensor::SetDataChannel(channel);
+                ok = true;
+                break;
+            }
+        }
+    }
+    napi_value result;
+    NAPI_CALL(env, napi_get_boolean(env, ok, &result));
+    return result;
+}
+
+/**
+ * @brief 读取当前数据通道名
+ *
+ * @param env Node-API 环境
+ * @param info 回调信息
+ * @return napi_value 返回 "serial" / "udp" / "multipath"
+ */
+static napi_value getDataChannel(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    const char *name = ChannelName(sensor::GetDataChannel());
+    napi_value result;
+    NAPI_CALL(env, napi_create_string_utf8(env, name, strlen(name), &result));
+    return result;
+}
+
+/**
+ * @brief 设置推送频率（Hz）：ESP32 按该频率自主推送传感器帧，运行中可随时调整；
+ *        <= 0 暂停推送
+ *
+ * @param env Node-API 环境
+ * @param info 回调信息，参数为频率
+ * @return napi_value 返回实际生效的频率（限制在 0.01~20Hz；参数无效时为当前频率）
+ */
+static napi_value setTelemetryRate(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1];
+    double hz = 0.0;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+    // 参数无效时不改频率，返回当前值
+    double applied = sensor::GetTelemetryRate();
+    if (argc >= 1 && napi_get_value_double(env, args[0], &hz) == napi_ok) {
+        applied = sensor::SetTelemetryRate(hz);
+    }
+    napi_value result;
+    NAPI_CALL(env, napi_create_double(env, applied, &result));
+    return result;
+}
+
+static napi_value getTelemetryRate(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    napi_value result;
+    NAPI_CALL(env, napi_create_double(env, sensor::GetTelemetryRate(), &result));
+    return result;
+}
+
+static napi_status SetPathStats(napi_env env, napi_value result, const char *name, sensor::DataChannel path)
+{
+    const sensor::PathStats stats = sensor::GetPathStats(path);
+    const double ageMs = stats.lastArrivalMs != 0 ? static_cast<double>(sensor::MonotonicMs() - stats.lastArrivalMs)
+                                                  : -1.0;
+    napi_value obj;
+    napi_value value;
+    napi_status status = napi_create_object(env, &obj);
+    const struct {
+        const char *name;
+        double value;
+    } fields[] = {
+        {"frames", static_cast<double>(stats.frames)},
+        {"firstArrivals", static_cast<double>(stats.firstArrivals)},
+        {"lateCopies", static_cast<double>(stats.lateCopies)},
+        {"missed", static_cast<double>(stats.missed)},
+        {"deliveryRatio", stats.deliveryRatio},
+        {"lagMs", stats.lagMs},
+        {"ageMs", ageMs},
+    };
+    for (const auto &field : fields) {
+        if (status == napi_ok) {
+            status = napi_create_double(env, field.value, &value);
+        }
+        if (status == napi_ok) {
+            status = napi_set_named_property(env, obj, field.name, value);
+        }
+    }
+    if (status == napi_ok) {
+        status = napi_set_named_property(env, result, name, obj);
+    }
+    return status;
+}
+
+/**
+ * @brief 读取多路径统计：两条物理路径各自的送达率、落后延迟、先到/重复/丢失帧数，
+ *        以及当前命令走哪条路径
+ *
+ * @param env Node-API 环境
+ * @param info 回调信息
+ * @return napi_value 返回 { serial, udp, commandPath }
+ */
+static napi_value getPathStats(napi_env env, napi_callback_info info)
+{
+    (void)info;
+    napi_value result;
+    napi_value value;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, SetPathStats(env, result, "serial", sensor::DataChannel::SERIAL));
+    NAPI_CALL(env, SetPathStats(env, result, "udp", sensor::DataChannel::UDP));
+    const char *path = ChannelName(sensor::GetCommandPath());
+    NAPI_CALL(env, napi_create_string_utf8(env, path, strlen(path), &value));
+    NAPI_CALL(env, napi_set_named_property(env, result, "commandPath", value));
+    return result;
+}
+
 /**
  * @brief 注册图片捕获回调函数
  * 
@@ -111,6 +380,14 @@ napi_value RegisterUdpApis(napi_env env, napi_value exports)
     napi_property_descriptor desc[] = {
         DECLARE_NAPI_FUNCTION("sendCapture", sendCapture),
         DECLARE_NAPI_FUNCTION("getDataByKey", getDataByKey),
+        DECLARE_NAPI_FUNCTION("getUdpNodes", getUdpNodes),
+        DECLARE_NAPI_FUNCTION("getUdpRxStats", getUdpRxStats),
+        DECLARE_NAPI_FUNCTION("getLatestImage", getLatestImage),
+        DECLARE_NAPI_FUNCTION("setDataChannel", setDataChannel),
+        DECLARE_NAPI_FUNCTION("getDataChannel", getDataChannel),
+        DECLARE_NAPI_FUNCTION("getPathStats", getPathStats),
+        DECLARE_NAPI_FUNCTION("setTelemetryRate", setTelemetryRate),
+        DECLARE_NAPI_FUNCTION("getTelemetryRate", getTelemetryRate),
         DECLARE_NAPI_FUNCTION("onImageCaptured", onImageCaptured),
         DECLARE_NAPI_FUNCTION("offImageCaptured", offImageCaptured),
     };
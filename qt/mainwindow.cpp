@@ -4,6 +4,7 @@
 #include <QTimer>      // 添加 QTimer 头文件
 #include <QMessageBox> // 添加 QMessageBox 头文件
 #include <QDateTime>
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QPen>
@@ -13,6 +14,146 @@
 #include <QSpinBox>
 #include <QDoubleSpinBox>
 #include <QScrollArea>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCborArray>
+
+// CRC-32（IEEE 802.3），与设备端 imageMeta.crc32 一致
+static quint32 Crc32(const QByteArray &data)
+{
+    static quint32 table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (quint32 i = 0; i < 256; i++) {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1u) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    quint32 crc = 0xFFFFFFFFu;
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    for (int i = 0; i < data.size(); i++) {
+        crc = table[(crc ^ p[i]) & 0xFFu] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// CBOR 负载中 sensors 数组的字段顺序，与设备端 mqtt_payload_builder 的 kSensorFields 一致
+static const char *const kSensorFieldNames[] = {
+    "soilMoisture", "lightLevel", "temperature", "humidity", "formaldehyde", "tvoc", "co2",
+    "soilTemperature", "ec", "ph", "nitrogen", "phosphorus", "potassium", "salt", "tds",
+};
+
+// 把设备端的 CBOR 传感器负载（整数键，见 mqtt_payload_builder.h）还原成与 JSON 负载相同的结构，
+// 之后的解析与显示共用一套代码；格式错误时返回空对象。
+// 增量负载（sensors/delta/cbor）的键 3 是 {字段序号: 值} 映射，只含变化的字段
+static QJsonObject DecodeSensorCbor(const QByteArray &message)
+{
+    QCborParserError error;
+    const QCborValue root = QCborValue::fromCbor(message, &error);
+    if (error.error != QCborError::NoError || !root.isMap()) {
+        return QJsonObject();
+    }
+    const QCborMap map = root.toMap();
+
+    QJsonObject obj;
+    obj["deviceId"] = map.value(0).toString();
+    const qint64 timestampMs = map.value(1).toInteger();
+    obj["timestamp"] = QDateTime::fromMSecsSinceEpoch(timestampMs, Qt::UTC).toString(Qt::ISODate);
+    obj["timestampMs"] = static_cast<double>(timestampMs);
+    if (map.contains(2)) {
+        obj["seq"] = static_cast<double>(map.value(2).toInteger());
+    }
+
+    QJsonObject sensors;
+    const int fieldCount = static_cast<int>(sizeof(kSensorFieldNames) / sizeof(kSensorFieldNames[0]));
+    if (map.value(3).isMap()) {
+        const QCborMap changed = map.value(3).toMap();
+        for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+            const qint64 i = it.key().toInteger(-1);
+            if (i >= 0 && i < fieldCount) {
+                sensors[kSensorFieldNames[i]] = it.value().toDouble();
+            }
+        }
+        obj["delta"] = true;
+    } else {
+        const QCborArray values = map.value(3).toArray();
+        for (int i = 0; i < values.size() && i < fieldCount; i++) {
+            sensors[kSensorFieldNames[i]] = values.at(i).toDouble();
+        }
+    }
+    if (map.contains(4)) {
+        sensors["alarm"] = static_cast<int>(map.value(4).toInteger());
+    }
+    obj["sensors"] = sensors;
+
+    if (map.contains(5)) {
+        obj["recordId"] = static_cast<double>(map.value(5).toInteger());
+    }
+    if (map.contains(6)) {
+        obj["replay"] = map.value(6).toBool();
+    }
+    if (map.contains(7)) {
+        const QCborMap meta = map.value(7).toMap();
+        QJsonObject imageMeta;
+        imageMeta["format"] = QStringLiteral("jpeg");
+        imageMeta["size"] = static_cast<double>(meta.value(0).toInteger());
+        imageMeta["crc32"] = QString("%1").arg(static_cast<quint32>(meta.value(1).toInteger()), 8, 16, QLatin1Char('0'));
+        imageMeta["captureMs"] = static_cast<double>(meta.value(2).toInteger());
+        imageMeta["width"] = static_cast<int>(meta.value(3).toInteger());
+        imageMeta["height"] = static_cast<int>(meta.value(4).toInteger());
+        imageMeta["seq"] = static_cast<double>(meta.value(5).toInteger());
+        obj["imageMeta"] = imageMeta;
+    }
+    return obj;
+}
+
+// CBOR 批量负载（sensors/batch/cbor）还原成与 JSON 批量负载相同的列式结构：
+// 键 1 baseMs、3 各通道的值数组（sensors 数组顺序，整批都没有的通道为空数组）、8 offsetsMs
+static QJsonObject DecodeSensorBatchCbor(const QByteArray &message)
+{
+    QCborParserError error;
+    const QCborValue root = QCborValue::fromCbor(message, &error);
+    if (error.error != QCborError::NoError || !root.isMap()) {
+        return QJsonObject();
+    }
+    const QCborMap map = root.toMap();
+
+    QJsonObject obj;
+    obj["deviceId"] = map.value(0).toString();
+    const qint64 baseMs = map.value(1).toInteger();
+    obj["baseMs"] = static_cast<double>(baseMs);
+    obj["timestamp"] = QDateTime::fromMSecsSinceEpoch(baseMs, Qt::UTC).toString(Qt::ISODate);
+    obj["seq"] = static_cast<double>(map.value(2).toInteger());
+    obj["alarm"] = static_cast<int>(map.value(4).toInteger());
+
+    QJsonArray offsets;
+    for (const QCborValue &offset : map.value(8).toArray()) {
+        offsets.append(static_cast<double>(offset.toInteger()));
+    }
+    obj["offsetsMs"] = offsets;
+    obj["count"] = offsets.size();
+
+    QJsonObject sensors;
+    const QCborArray columns = map.value(3).toArray();
+    const int fieldCount = static_cast<int>(sizeof(kSensorFieldNames) / sizeof(kSensorFieldNames[0]));
+    for (int i = 0; i < columns.size() && i < fieldCount; i++) {
+        const QCborArray column = columns.at(i).toArray();
+        if (column.isEmpty()) {
+            continue;
+        }
+        QJsonArray values;
+        for (const QCborValue &v : column) {
+            values.append(v.isNull() ? QJsonValue() : QJsonValue(v.toDouble()));
+        }
+        sensors[kSensorFieldNames[i]] = values;
+    }
+    obj["sensors"] = sensors;
+    return obj;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -373,6 +514,44 @@ void MainWindow::setupImagePage()
 
     scrollArea->setWidget(imageLabel);
     imageLayout->addWidget(scrollArea);
+
+    // 图片信息：分辨率、大小、拍摄时间（来自 sensors JSON 的 imageMeta）
+    imageInfoLabel = new QLabel(imagePage);
+    imageInfoLabel->setAlignment(Qt::AlignCenter);
+    imageLayout->addWidget(imageInfoLabel);
+}
+
+void MainWindow::showImage(const QByteArray &jpeg)
+{
+    QImage image;
+    int maxWidth = imageLabel->width() - 40;
+    if (image.loadFromData(jpeg, "JPG") || image.loadFromData(jpeg)) {
+        if (image.width() > maxWidth) {
+            image = image.scaledToWidth(maxWidth, Qt::SmoothTransformation);
+        }
+        imageLabel->setPixmap(QPixmap::fromImage(image));
+    } else {
+        qDebug() << "图像解码失败：无法加载" << jpeg.size() << "字节的图像数据";
+    }
+}
+
+void MainWindow::checkImageMeta(const QJsonObject &meta)
+{
+    const int size = meta.value("size").toInt(-1);
+    bool crcOk = false;
+    const quint32 crc = meta.value("crc32").toString().toUInt(&crcOk, 16);
+    if (lastImageSize < 0 || size != lastImageSize || !crcOk || crc != lastImageCrc) {
+        // 图片与元数据经同一连接按序到达，正常情况下此时图片已收到；不一致说明丢了一张或订阅晚于图片
+        qDebug() << "imageMeta 与最近收到的图片不一致: size" << size << "vs" << lastImageSize;
+        return;
+    }
+
+    const QDateTime captured = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(meta.value("captureMs").toDouble()));
+    imageInfoLabel->setText(QString("%1×%2 · %3 KB · 拍摄于 %4")
+                                .arg(meta.value("width").toInt())
+                                .arg(meta.value("height").toInt())
+                                .arg(size / 1024.0, 0, 'f', 1)
+                                .arg(captured.toString("yyyy-MM-dd HH:mm:ss")));
 }
 
 void MainWindow::setupAutoControlPage()
@@ -701,6 +880,7 @@ void MainWindow::showMqttConfigDialog()
 void MainWindow::connectMQTT()
 {
     ensureMqttDisconnected();
+    resetSensorState();
 
     mqttClient = new QMqttClient(this);
     mqttClient->setHostname(mqttBrokerAddress);
@@ -846,9 +1026,13 @@ void MainWindow::onMQTTMessageReceived(const QByteArray &message, const QMqttTop
             return;
         }
 
+        if (deviceId != currentDeviceId) {
+            resetSensorState();
+        }
         currentDeviceId = deviceId;
         mqttDataTopic = QStringLiteral("%1/%2/sensors").arg(mqttTopicPrefix, deviceId);
         mqttControlTopic = QStringLiteral("%1/%2/control").arg(mqttTopicPrefix, deviceId);
+        mqttImageTopic = QStringLiteral("%1/%2/image").arg(mqttTopicPrefix, deviceId);
 
         // discovery 可能先于数据到达：提前显示 deviceId
         labelDeviceId->setText(QString("<b>🔌 设备ID:</b><br><span style='font-size:16px;'>%1</span>").arg(deviceId));
@@ -860,20 +1044,88 @@ void MainWindow::onMQTTMessageReceived(const QByteArray &message, const QMqttTop
             } else {
                 qDebug() << "成功订阅推导数据主题:" << mqttDataTopic;
             }
+            // 设备可切换为 CBOR 编码，发布到 <sensors>/cbor
+            if (!mqttClient->subscribe(QMqttTopicFilter(mqttDataTopic + QStringLiteral("/cbor")))) {
+                qDebug() << "订阅 CBOR 数据主题失败:" << mqttDataTopic + QStringLiteral("/cbor");
+            }
+            // 批量上报：<sensors>/batch 与 <sensors>/batch/cbor
+            const QString batchTopic = mqttDataTopic + QStringLiteral("/batch");
+            if (!mqttClient->subscribe(QMqttTopicFilter(batchTopic)) ||
+                !mqttClient->subscribe(QMqttTopicFilter(batchTopic + QStringLiteral("/cbor")))) {
+                qDebug() << "订阅批量数据主题失败:" << batchTopic;
+            }
+            // 死区过滤开启后的增量帧：<sensors>/delta 与 <sensors>/delta/cbor
+            const QString deltaTopic = mqttDataTopic + QStringLiteral("/delta");
+            if (!mqttClient->subscribe(QMqttTopicFilter(deltaTopic)) ||
+                !mqttClient->subscribe(QMqttTopicFilter(deltaTopic + QStringLiteral("/cbor")))) {
+                qDebug() << "订阅增量数据主题失败:" << deltaTopic;
+            }
+            // 二进制图片主题：负载即 JPEG 原始字节
+            if (!mqttClient->subscribe(QMqttTopicFilter(mqttImageTopic))) {
+                qDebug() << "订阅图片主题失败:" << mqttImageTopic;
+            }
         }
         return;
     }
 
-    if (topicStr == mqttDataTopic) {
+    if (topicStr == mqttImageTopic) {
+        lastImageSize = message.size();
+        lastImageCrc = Crc32(message);
+        showImage(message);
+        return;
+    }
+
+    const QString deltaTopic = mqttDataTopic + QStringLiteral("/delta");
+    const bool deltaData = !mqttDataTopic.isEmpty() &&
+                           (topicStr == deltaTopic || topicStr == deltaTopic + QStringLiteral("/cbor"));
+    const QString batchTopic = mqttDataTopic + QStringLiteral("/batch");
+    const bool batchData = !mqttDataTopic.isEmpty() &&
+                           (topicStr == batchTopic || topicStr == batchTopic + QStringLiteral("/cbor"));
+    const bool cborData = !mqttDataTopic.isEmpty() && topicStr.endsWith(QStringLiteral("/cbor")) &&
+                          (topicStr == mqttDataTopic + QStringLiteral("/cbor") || deltaData || batchData);
+    if (topicStr == mqttDataTopic || cborData || deltaData || batchData) {
         // 处理传感器数据
         try {
-            QJsonDocument doc = QJsonDocument::fromJson(message);
-            if (doc.isNull() || !doc.isObject()) {
-                qDebug() << "JSON解析失败";
-                return;
+            QJsonObject obj;
+            if (cborData) {
+                obj = batchData ? DecodeSensorBatchCbor(message) : DecodeSensorCbor(message);
+                if (obj.isEmpty()) {
+                    qDebug() << "CBOR解析失败";
+                    return;
+                }
+            } else {
+                QJsonDocument doc = QJsonDocument::fromJson(message);
+                if (doc.isNull() || !doc.isObject()) {
+                    qDebug() << "JSON解析失败";
+                    return;
+                }
+                obj = doc.object();
             }
 
-            QJsonObject obj = doc.object();
+            // 批量负载：整批一次画进图表，标签显示每个通道在批内最后一个有效值
+            if (batchData) {
+                const QJsonArray offsets = obj["offsetsMs"].toArray();
+                if (offsets.isEmpty() || !obj["sensors"].isObject()) {
+                    qDebug() << "批量数据格式错误";
+                    return;
+                }
+                appendChartBatch(obj);
+
+                const QJsonObject columns = obj["sensors"].toObject();
+                for (auto it = columns.constBegin(); it != columns.constEnd(); ++it) {
+                    const QJsonArray column = it.value().toArray();
+                    for (int i = column.size() - 1; i >= 0; i--) {
+                        if (!column.at(i).isNull()) {
+                            currentSensors[it.key()] = column.at(i);
+                            break;
+                        }
+                    }
+                }
+                currentSensors["alarm"] = obj["alarm"].toInt();
+                const qint64 lastMs = static_cast<qint64>(obj["baseMs"].toDouble() + offsets.last().toDouble());
+                obj["timestamp"] = QDateTime::fromMSecsSinceEpoch(lastMs, Qt::UTC).toString(Qt::ISODate);
+                obj["sensors"] = currentSensors;
+            }
 
             // 提取顶层属性（UI 展示用；topic 绑定以 discovery 为准）
             QString deviceId = obj["deviceId"].toString();
@@ -887,6 +1139,21 @@ void MainWindow::onMQTTMessageReceived(const QByteArray &message, const QMqttTop
             
             // 获取sensors对象
             QJsonObject sensors = obj["sensors"].toObject();
+
+            // 增量帧只带变化的字段：合并到当前状态；还没有完整帧时先向设备要一帧
+            if (deltaData) {
+                if (!haveKeyframe) {
+                    requestSensorKeyframe();
+                    return;
+                }
+                for (auto it = sensors.constBegin(); it != sensors.constEnd(); ++it) {
+                    currentSensors[it.key()] = it.value();
+                }
+                sensors = currentSensors;
+            } else {
+                currentSensors = sensors;
+                haveKeyframe = true;
+            }
             
             // 从 sensors 对象中提取数据（环境 + 土壤/养分）
             int soilMoisture = sensors["soilMoisture"].toInt();
@@ -908,21 +1175,11 @@ void MainWindow::onMQTTMessageReceived(const QByteArray &message, const QMqttTop
 
             int alarm = sensors.contains("alarm") ? sensors["alarm"].toInt() : 0;
 
-            // 可选：同一条 JSON 中携带 Base64 图片
-            if (obj.contains("image") && obj["image"].isString()) {
-                const QByteArray imageBase64 = obj["image"].toString().toUtf8();
-                const QByteArray imageData = QByteArray::fromBase64(imageBase64);
-
-                QImage image;
-                int maxWidth = imageLabel->width() - 40;
-                if (image.loadFromData(imageData)) {
-                    if (image.width() > maxWidth) {
-                        image = image.scaledToWidth(maxWidth, Qt::SmoothTransformation);
-                    }
-                    imageLabel->setPixmap(QPixmap::fromImage(image));
-                } else {
-                    qDebug() << "图像解码失败：无法从 JSON.image 的 Base64 数据加载图像";
-                }
+            // 图片：新格式 JPEG 走 image 主题，这里只有 imageMeta；旧格式在同一条 JSON 中携带 Base64
+            if (obj.contains("imageMeta") && obj["imageMeta"].isObject()) {
+                checkImageMeta(obj["imageMeta"].toObject());
+            } else if (obj.contains("image") && obj["image"].isString()) {
+                showImage(QByteArray::fromBase64(obj["image"].toString().toUtf8()));
             }
 
             // 更新UI
@@ -948,15 +1205,44 @@ void MainWindow::onMQTTMessageReceived(const QByteArray &message, const QMqttTop
                 labelPh->setText(labelPh->text() + QString("<br><span style='color:red;'>⚠ 报警: 养分/酸碱超出阈值</span>"));
             }
 
-            // 更新图表
-            QDateTime dateTime = QDateTime::fromString(timestamp, Qt::ISODate);
-            updateCharts(dateTime, temperature, humidity, soilMoisture, lightLevel, formaldehyde, tvoc, co2);
+            // 更新图表（批量负载已在上面整批画入）
+            if (!batchData) {
+                QDateTime dateTime = QDateTime::fromString(timestamp, Qt::ISODate);
+                updateCharts(dateTime, temperature, humidity, soilMoisture, lightLevel, formaldehyde, tvoc, co2);
+            }
         } catch (...) {
             qDebug() << "处理传感器数据时出错";
         }
     }
 }
 
+// 向设备请求一帧完整数据（{"control":{"keyframe":1}}），不弹窗，5 秒内最多一次
+void MainWindow::requestSensorKeyframe()
+{
+    if (!mqttClient || mqttClient->state() != QMqttClient::Connected || mqttControlTopic.isEmpty()) {
+        return;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    if (lastKeyframeRequest.isValid() && lastKeyframeRequest.msecsTo(now) < 5000) {
+        return;
+    }
+    lastKeyframeRequest = now;
+
+    QJsonObject control;
+    control["keyframe"] = 1;
+    QJsonObject obj;
+    obj["control"] = control;
+    mqttClient->publish(mqttControlTopic, QJsonDocument(obj).toJson(QJsonDocument::Compact), 0, false);
+}
+
+// 换设备或重连后增量帧的基准失效，等下一帧完整数据
+void MainWindow::resetSensorState()
+{
+    currentSensors = QJsonObject();
+    haveKeyframe = false;
+    lastKeyframeRequest = QDateTime();
+}
+
 void MainWindow::updateCharts(const QDateTime &timestamp, double temperature, int humidity, int soilMoisture,
                              int lightLevel, double formaldehyde, double tvoc, int co2)
 {
@@ -1009,6 +1295,55 @@ void MainWindow::updateCharts(const QDateTime &timestamp, double temperature, in
         }
     }
 
+    updateChartAxes();
+}
+
+// 批量负载（sensors/batch）：每条曲线把整批点一次 append，整批只触发一次重绘
+void MainWindow::appendChartBatch(const QJsonObject &batch)
+{
+    const qint64 baseMs = static_cast<qint64>(batch["baseMs"].toDouble());
+    const QJsonArray offsets = batch["offsetsMs"].toArray();
+    const QJsonObject columns = batch["sensors"].toObject();
+
+    const struct {
+        const char *field;
+        QLineSeries *series;
+    } charts[] = {
+        {"temperature", temperatureSeries},
+        {"humidity", humiditySeries},
+        {"soilMoisture", soilMoistureSeries},
+        {"lightLevel", lightLevelSeries},
+        {"co2", co2Series},
+        {"tvoc", tvocSeries},
+        {"formaldehyde", formaldehydeSeries},
+    };
+    for (const auto &chart : charts) {
+        const QJsonArray column = columns[chart.field].toArray();
+        QList<QPointF> points;
+        points.reserve(column.size());
+        for (int i = 0; i < column.size() && i < offsets.size(); i++) {
+            if (!column.at(i).isNull()) {
+                points.append(QPointF(baseMs + static_cast<qint64>(offsets.at(i).toDouble()), column.at(i).toDouble()));
+            }
+        }
+        chart.series->append(points);
+        if (chart.series->count() > MAX_DATA_POINTS) {
+            chart.series->removePoints(0, chart.series->count() - MAX_DATA_POINTS);
+        }
+    }
+
+    for (const QJsonValue &offset : offsets) {
+        timeQueue.enqueue(QDateTime::fromMSecsSinceEpoch(baseMs + static_cast<qint64>(offset.toDouble())));
+    }
+    while (timeQueue.size() > MAX_DATA_POINTS) {
+        timeQueue.dequeue();
+    }
+
+    updateChartAxes();
+}
+
+void MainWindow::updateChartAxes()
+{
     // 更新所有图表的X轴范围
     if (!timeQueue.isEmpty()) {
         QDateTime newest = timeQueue.last();
@@ -49,8 +49,12 @@ private:
     void setupChartPage();
     void setupImagePage();
     void setupTopToolbar();
+    void appendChartBatch(const QJsonObject &batch);
+    void updateChartAxes();
     void updateCharts(const QDateTime &timestamp, double temperature, int humidity, int soilMoisture,
                      int lightLevel, double /*formaldehyde*/, double /*tvoc*/, int /*co2*/);
+    void showImage(const QByteArray &jpeg);
+    void checkImageMeta(const QJsonObject &meta);
 
 private:
     Ui::MainWindow *ui;
@@ -79,6 +83,7 @@ private:
     QLabel *labelSalt;
     QLabel *labelTds;
     QLabel *imageLabel;
+    QLabel *imageInfoLabel = nullptr;
     QWidget *topToolbar = nullptr;
     QLabel *mqttStatusLabel = nullptr;
     
@@ -119,8 +124,18 @@ private:
     int mqttBrokerPort;
     QString mqttDataTopic;
     QString mqttControlTopic;   // 自动控制命令下发 topic
+    QString mqttImageTopic;     // 二进制 JPEG topic：<prefix>/<deviceId>/image
     QString currentDeviceId;    // 最近一次收到的数据中的 deviceId
 
+    // 最近一次从 image topic 收到的图片，用于与 sensors JSON 中的 imageMeta 核对
+    int lastImageSize = -1;
+    quint32 lastImageCrc = 0;
+
+    // 设备开启死区过滤后 sensors/delta 只带变化的字段：合并到最近的完整帧上再显示
+    QJsonObject currentSensors;
+    bool haveKeyframe = false;
+    QDateTime lastKeyframeRequest; // 向设备请求完整帧的时间，限制请求频率
+
     QString mqttDiscoveryFilter; // 固定发现主题过滤器，例如 sys/discovery/announce/#
     QString mqttTopicPrefix;     // topic 前缀/命名空间，例如 ciallo_ohos
 
@@ -156,6 +171,8 @@ private:
     void publishAutoControlCommand();
     void publishModeObject(const QJsonObject &mode, const QString &successMessage);
     void publishControlObject(const QJsonObject &control, const QString &successMessage);
+    void requestSensorKeyframe();
+    void resetSensorState();
 
     // 手动执行器控制
     void publishPumpOn();
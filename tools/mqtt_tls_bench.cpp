@@ -0,0 +1,104 @@
+/*
+ * mqtts:// 完整握手与会话复用的对比测量（MqttCClient + mqtt_transport），在普通 Linux 上运行：
+ *
+ *   sh tools/mqtt_tls_certs.sh /tmp/mqtt_tls
+ *   python3 tools/mqtt_tls_broker.py /tmp/mqtt_tls ec 18883 13 0 &
+ *   gcc -O2 -c -DMQTTC_PAL_FILE=mqtt_transport_pal.h -Iapp/inc -Ithird_party/MQTT-C/include third_party/MQTT-C/src/mqtt.c -o /tmp/mqtt.o && gcc -O2 -c -DMQTTC_PAL_FILE=mqtt_transport_pal.h -Iapp/inc -Ithird_party/MQTT-C/include third_party/MQTT-C/src/mqtt_pal.c -o /tmp/mqtt_pal.o && gcc -O2 -c -Ithird_party/cJSON/include third_party/cJSON/src/cJSON.c -o /tmp/cJSON.o && g++ -std=c++14 -O2 -DMQTTC_PAL_FILE=mqtt_transport_pal.h -Iapp/inc -Ithird_party/MQTT-C/include -Ithird_party/cJSON/include tools/mqtt_tls_bench.cpp app/src/mqttc_client.cpp app/src/mqtt_transport.cpp app/src/mqtt_topic_router.cpp /tmp/mqtt.o /tmp/mqtt_pal.o /tmp/cJSON.o -lssl -lcrypto -lpthread -o /tmp/mqtt_tls_bench
+ *   /tmp/mqtt_tls_bench /tmp/mqtt_tls ec mqtts://localhost:18883 40 0
+ *
+ * 参数：证书目录、证书类型（ec|rsa，与 broker 一致）、brokerUrl、重连次数、是否双向认证（与 broker 一致）。
+ * 先关闭再开启 sessionResumption 各做 N 次 connect → QoS1 publish → disconnect，输出：
+ * connect() 返回耗时与握手耗时的中位数（第一次连接不计），复用次数，以及每轮客户端 CPU 时间。
+ */
+
+#include "mqttc_client.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+double Median(std::vector<double> v)
+{
+    if (v.empty()) {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+double CpuMs()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 6) {
+        std::printf("usage: %s <certDir> <ec|rsa> <brokerUrl> <reconnects> <mtls 0|1>\n", argv[0]);
+        return 1;
+    }
+    const std::string dir = argv[1];
+    const std::string kind = argv[2];
+    const int rounds = std::max(std::atoi(argv[4]), 2);
+    const bool mtls = std::atoi(argv[5]) != 0;
+
+    mqttc::MqttCClient client;
+    client.configure(argv[3], "tls_bench", "", "");
+    mqttc::TlsOptions options;
+    options.caFile = dir + "/" + kind + "-ca.pem";
+    if (mtls) {
+        options.certFile = dir + "/" + kind + "-cli.pem";
+        options.keyFile = dir + "/" + kind + "-cli.key";
+    }
+
+    for (int resume = 0; resume < 2; resume++) {
+        options.sessionResumption = resume != 0;
+        client.setTlsOptions(options); // 同时丢弃上一轮缓存的会话
+        const mqttc::MqttCClient::TlsStats before = client.getTlsStats();
+
+        std::vector<double> connectMs;
+        std::vector<double> handshakeMs;
+        const double cpuStart = CpuMs();
+        for (int i = 0; i < rounds; i++) {
+            std::string err;
+            const auto start = std::chrono::steady_clock::now();
+            if (!client.connect(&err)) {
+                std::printf("connect failed: %s\n", err.c_str());
+                return 1;
+            }
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (i > 0) {
+                connectMs.push_back(ms);
+                handshakeMs.push_back(static_cast<double>(client.getTlsStats().lastHandshakeMs));
+            }
+            // 等到 PUBACK：TLS 1.3 的会话票据在握手之后下发，保证下一次连接前已经收到
+            if (!client.publish("bench/tls", "x", 1, 1, false, &err)) {
+                std::printf("publish failed: %s\n", err.c_str());
+                return 1;
+            }
+            client.disconnect();
+        }
+        const double cpuPerRound = (CpuMs() - cpuStart) / rounds;
+
+        const mqttc::MqttCClient::TlsStats stats = client.getTlsStats();
+        std::printf("%s%s resumption=%d: resumed %llu/%llu, connect() median %.2f ms, handshake median %.0f ms, "
+                    "client CPU %.2f ms/round\n",
+                    kind.c_str(), mtls ? "+mTLS" : "", resume,
+                    static_cast<unsigned long long>(stats.resumed - before.resumed),
+                    static_cast<unsigned long long>(stats.handshakes - before.handshakes), Median(connectMs),
+                    Median(handshakeMs), cpuPerRound);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""tools/mqtt_tls_bench.cpp 用的最小 MQTT 3.1.1 broker（TLS），只应答 CONNECT/PUBLISH/SUBSCRIBE/PINGREQ。
+
+    python3 tools/mqtt_tls_broker.py <certDir> <ec|rsa> <port> <12|13> <mtls 0|1>
+
+证书由 tools/mqtt_tls_certs.sh 生成；12 限制为 TLS 1.2，13 允许 TLS 1.3。
+"""
+import socket
+import ssl
+import struct
+import sys
+import threading
+
+cert_dir, kind, port, version, mtls = sys.argv[1], sys.argv[2], int(sys.argv[3]), sys.argv[4], sys.argv[5] == '1'
+
+ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+ctx.load_cert_chain(f'{cert_dir}/{kind}-srv.pem', f'{cert_dir}/{kind}-srv.key')
+if version == '12':
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+if mtls:
+    ctx.verify_mode = ssl.CERT_REQUIRED
+    ctx.load_verify_locations(f'{cert_dir}/{kind}-ca.pem')
+
+
+def read_exact(s, n):
+    data = b''
+    while len(data) < n:
+        chunk = s.recv(n - len(data))
+        if not chunk:
+            raise EOFError
+        data += chunk
+    return data
+
+
+def serve(s):
+    try:
+        while True:
+            header = read_exact(s, 1)[0]
+            length, mult = 0, 1
+            while True:
+                digit = read_exact(s, 1)[0]
+                length += (digit & 127) * mult
+                mult *= 128
+                if not digit & 128:
+                    break
+            body = read_exact(s, length)
+            kind_ = header >> 4
+            if kind_ == 1:    # CONNECT -> CONNACK
+                s.sendall(b'\x20\x02\x00\x00')
+            elif kind_ == 3:  # PUBLISH -> PUBACK（QoS1/2 时）
+                topic_len = struct.unpack('>H', body[:2])[0]
+                if (header >> 1) & 3:
+                    pid = body[2 + topic_len:4 + topic_len]
+                    s.sendall(b'\x40\x02' + pid)
+            elif kind_ == 8:  # SUBSCRIBE -> SUBACK
+                s.sendall(b'\x90\x03' + body[:2] + b'\x00')
+            elif kind_ == 12:  # PINGREQ -> PINGRESP
+                s.sendall(b'\xd0\x00')
+            elif kind_ == 14:  # DISCONNECT
+                break
+    except (EOFError, ConnectionError, ssl.SSLError, OSError):
+        pass
+    try:
+        s.close()
+    except OSError:
+        pass
+
+
+listener = socket.socket()
+listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+listener.bind(('127.0.0.1', port))
+listener.listen(16)
+print('ready', flush=True)
+while True:
+    conn, _ = listener.accept()
+    # 与客户端一样关闭 Nagle，否则握手末尾的小报文会等延迟 ACK（约 40ms），掩盖握手本身的差别
+    conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    try:
+        tls = ctx.wrap_socket(conn, server_side=True)
+    except (ssl.SSLError, OSError) as e:
+        print('handshake failed:', e, flush=True)
+        conn.close()
+        continue
+    threading.Thread(target=serve, args=(tls,), daemon=True).start()
@@ -0,0 +1,24 @@
+#!/bin/sh
+# 为 tools/mqtt_tls_bench.cpp 生成测试证书：ECDSA P-256 与 RSA 2048 各一套 CA、broker 证书
+# （SAN 为 localhost 与 127.0.0.1）和客户端证书（双向认证用）。
+#   sh tools/mqtt_tls_certs.sh /tmp/mqtt_tls
+set -e
+dir=${1:-/tmp/mqtt_tls}
+mkdir -p "$dir"
+cd "$dir"
+printf "subjectAltName=DNS:localhost,IP:127.0.0.1\n" > san.cnf
+for kind in ec rsa; do
+    if [ $kind = ec ]; then
+        key="-newkey ec -pkeyopt ec_paramgen_curve:P-256"
+    else
+        key="-newkey rsa:2048"
+    fi
+    openssl req -x509 $key -nodes -keyout $kind-ca.key -out $kind-ca.pem -days 30 -subj "/CN=test-ca-$kind" 2>/dev/null
+    openssl req $key -nodes -keyout $kind-srv.key -out $kind-srv.csr -subj "/CN=localhost" 2>/dev/null
+    openssl x509 -req -in $kind-srv.csr -CA $kind-ca.pem -CAkey $kind-ca.key -CAcreateserial \
+        -out $kind-srv.pem -days 30 -extfile san.cnf 2>/dev/null
+    openssl req $key -nodes -keyout $kind-cli.key -out $kind-cli.csr -subj "/CN=device" 2>/dev/null
+    openssl x509 -req -in $kind-cli.csr -CA $kind-ca.pem -CAkey $kind-ca.key -CAcreateserial \
+        -out $kind-cli.pem -days 30 2>/dev/null
+done
+echo "certificates in $dir"
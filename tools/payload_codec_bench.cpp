@@ -0,0 +1,170 @@
+/*
+ * MQTT 负载编码 JSON / CBOR 对比（mqtt_payload_builder），在普通 Linux 上单独编译运行：
+ *
+ *   g++ -std=c++14 -O2 -Iapp/inc -Ihal/inc -Idrivers/inc -Icontrol/inc -Ithird_party/cJSON/include tools/payload_codec_bench.cpp app/src/mqtt_payload_builder.cpp third_party/cJSON/src/cJSON.c -lpthread -o /tmp/payload_codec_bench && /tmp/payload_codec_bench
+ *
+ * 输入为一帧 15 路传感器数据，输出：
+ * 1. 实时（sensors）与补传（sensors/history）负载的字节数
+ * 2. 每条消息的编码耗时（BuildSensorPayload）
+ * 3. 每条消息的解码耗时：JSON 用 cJSON_Parse 并取一个字段；CBOR 用下面的最小遍历器读出全部数值，
+ *    相当于订阅方不建树、直接按整数键取值的解码方式
+ */
+
+#include "cJSON.h"
+#include "mqtt_payload_builder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// 链接 mqtt_payload_builder 所需、与本基准无关的符号
+namespace control {
+int GetAutoControlAlarm()
+{
+    return 0;
+}
+} // namespace control
+
+namespace image {
+ImageRef GetLatestImage(uint64_t *seq, int64_t *captureMs)
+{
+    (void)seq;
+    (void)captureMs;
+    return nullptr;
+}
+} // namespace image
+
+namespace sensor {
+void GetSnapshot(SensorSnapshot &out)
+{
+    (void)out;
+}
+} // namespace sensor
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int kRounds = 200000;
+
+uint64_t ReadUint(const uint8_t *p, size_t &i, int info)
+{
+    if (info < 24) {
+        return static_cast<uint64_t>(info);
+    }
+    const int bytes = 1 << (info - 24); // 24..27 -> 1/2/4/8 字节
+    uint64_t v = 0;
+    for (int k = 0; k < bytes; k++) {
+        v = (v << 8) | p[i++];
+    }
+    return v;
+}
+
+// 遍历一个 CBOR 数据项，把其中的整数与 float32 累加到 sum；返回下一个数据项的位置
+size_t WalkCbor(const uint8_t *p, size_t i, double &sum)
+{
+    const uint8_t initial = p[i++];
+    const int major = initial >> 5;
+    const int info = initial & 0x1f;
+    if (major == 7) {
+        if (info == 26) {
+            uint32_t bits = 0;
+            for (int k = 0; k < 4; k++) {
+                bits = (bits << 8) | p[i++];
+            }
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            sum += f;
+        }
+        return i;
+    }
+    const uint64_t v = ReadUint(p, i, info);
+    switch (major) {
+        case 0:
+            sum += static_cast<double>(v);
+            return i;
+        case 1:
+            sum -= static_cast<double>(v) + 1;
+            return i;
+        case 2:
+        case 3:
+            return i + v;
+        case 4:
+            for (uint64_t k = 0; k < v; k++) {
+                i = WalkCbor(p, i, sum);
+            }
+            return i;
+        case 5:
+            for (uint64_t k = 0; k < 2 * v; k++) {
+                i = WalkCbor(p, i, sum);
+            }
+            return i;
+        default:
+            return i;
+    }
+}
+
+double MicrosPerRound(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kRounds;
+}
+
+} // namespace
+
+int main()
+{
+    mqttc::SetMqttPayloadDeviceId("unionpi_7f3a2c");
+    const float values[] = {62.4f, 23.7f, 0.03f, 0.21f, 612, 38.2f, 21.4f, 1.23f,
+                            6.82f, 41.7f, 18.3f, 102.6f, 230.5f, 412.9f, 55.3f};
+
+    sensor::SensorSnapshot snap;
+    std::memcpy(snap.values, values, sizeof(values));
+    snap.seq = 123456;
+    sensor::SensorLogRecord rec{};
+    std::memcpy(rec.values, values, sizeof(values));
+    rec.id = 987654;
+    rec.wallMs = 1790000000123;
+
+    std::string json;
+    std::string cbor;
+    std::string historyJson;
+    std::string historyCbor;
+    mqttc::BuildSensorPayload(mqttc::PayloadCodec::JSON, snap, nullptr, json);
+    mqttc::BuildSensorPayload(mqttc::PayloadCodec::CBOR, snap, nullptr, cbor);
+    mqttc::BuildSensorHistoryPayload(mqttc::PayloadCodec::JSON, rec, historyJson);
+    mqttc::BuildSensorHistoryPayload(mqttc::PayloadCodec::CBOR, rec, historyCbor);
+    std::printf("bytes: sensors json %zu / cbor %zu, history json %zu / cbor %zu\n", json.size(), cbor.size(),
+                historyJson.size(), historyCbor.size());
+
+    const mqttc::PayloadCodec codecs[] = {mqttc::PayloadCodec::JSON, mqttc::PayloadCodec::CBOR};
+    for (mqttc::PayloadCodec codec : codecs) {
+        std::string out;
+        size_t total = 0;
+        const auto start = Clock::now();
+        for (int i = 0; i < kRounds; i++) {
+            snap.seq = static_cast<uint64_t>(i);
+            mqttc::BuildSensorPayload(codec, snap, nullptr, out);
+            total += out.size();
+        }
+        std::printf("encode %s: %.2f us/msg (%zu bytes total)\n", codec == mqttc::PayloadCodec::CBOR ? "cbor" : "json",
+                    MicrosPerRound(start), total);
+    }
+
+    double sum = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < kRounds; i++) {
+        cJSON *root = cJSON_Parse(json.c_str());
+        const cJSON *co2 = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "sensors"), "co2");
+        sum += co2 ? co2->valuedouble : 0;
+        cJSON_Delete(root);
+    }
+    std::printf("decode json (cJSON): %.2f us/msg\n", MicrosPerRound(start));
+
+    start = Clock::now();
+    for (int i = 0; i < kRounds; i++) {
+        WalkCbor(reinterpret_cast<const uint8_t *>(cbor.data()), 0, sum);
+    }
+    std::printf("decode cbor (walk): %.2f us/msg\n", MicrosPerRound(start));
+    return sum == 0 ? 1 : 0;
+}
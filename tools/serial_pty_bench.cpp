@@ -0,0 +1,243 @@
+/*
+ * 串口波特率切换与收帧路径的 pty 测试，不需要开发板，在普通 Linux 上运行：
+ *
+ *   g++ -std=c++14 -O2 -DUART_TTL_NAME='"/tmp/serial_pty_bench.tty"' -Iapp/inc -Ihal/inc -Idrivers/inc -Icontrol/inc -Ithird_party/cJSON/include tools/serial_pty_bench.cpp hal/src/serial_uart.c app/src/myserial.cpp app/src/image_store.cpp app/src/sensor_data_provider.cpp app/src/sensor_history.cpp app/src/sensor_log.cpp app/src/sensor_batch.cpp -lpthread -o /tmp/serial_pty_bench && /tmp/serial_pty_bench
+ *
+ * UART_TTL_NAME 把 myserial 的设备路径换成指向 pty 从端的符号链接，主端由本程序扮演 ESP32 固件：
+ * 1. HAL：uart_set_baudrate/uart_get_baudrate 设置并读回标准与非标准速率（termios2/BOTHER）
+ * 2. 协商：serial_set_baudrate 切到 921600、2M；固件拒绝 RTSCTS、不回 PONG 时回退到原速率
+ * 3. 吞吐：1MB 随机字节按相机帧编码写入主端，到 image_store 出现完整照片为止的软件路径 MB/s
+ * pty 不模拟线路速率，第 3 项只衡量读线程与解码的开销。
+ */
+
+#ifndef UART_TTL_NAME
+#error "build with -DUART_TTL_NAME=... (see the command above)"
+#endif
+
+#include "frame_codec.h"
+#include "image_store.h"
+#include "myserial.h"
+#include "serial_uart.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 链接 myserial 所需、与本测试无关的符号
+extern "C" void NotifyImageCapturedFromNative(const char *path)
+{
+    (void)path;
+}
+
+extern "C" int wifi_send_broadcast(const char *buf, int len)
+{
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+namespace {
+
+int g_master = -1;
+std::atomic<bool> g_answerPing{true};
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int OpenPty(std::string &slaveName)
+{
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        return -1;
+    }
+    slaveName = ptsname(master);
+    struct termios tio;
+    tcgetattr(master, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(master, TCSANOW, &tio);
+    return master;
+}
+
+// 固件回复按传感器帧（FF）编码
+void Reply(const char *text)
+{
+    uint8_t frame[64];
+    const size_t n = frame_codec::Encode(reinterpret_cast<const uint8_t *>(text), std::strlen(text),
+                                         frame_codec::kFrameEnd, frame, sizeof(frame));
+    (void)write(g_master, frame, n);
+}
+
+// 固件侧：应答 SETBAUD（未接流控引脚，拒绝 RTSCTS）与 PING
+void FirmwareLoop()
+{
+    std::string pending;
+    char buf[256];
+    for (;;) {
+        const ssize_t n = read(g_master, buf, sizeof(buf));
+        if (n <= 0) {
+            continue;
+        }
+        pending.append(buf, static_cast<size_t>(n));
+        for (;;) {
+            const size_t setbaud = pending.find("SETBAUD");
+            const size_t ping = pending.find("PING");
+            if (setbaud == std::string::npos && ping == std::string::npos) {
+                break;
+            }
+            if (setbaud != std::string::npos && (ping == std::string::npos || setbaud < ping)) {
+                long baud = 0;
+                char option[16] = {0};
+                const bool rtscts = std::sscanf(pending.c_str() + setbaud, "SETBAUD %ld %15[A-Z]", &baud, option) == 2;
+                char reply[32];
+                std::snprintf(reply, sizeof(reply), rtscts ? "BAUDERR %ld" : "BAUDOK %ld", baud);
+                Reply(reply);
+                pending.erase(0, setbaud + 7);
+            } else {
+                if (g_answerPing.load()) {
+                    Reply("PONG");
+                }
+                pending.erase(0, ping + 4);
+            }
+        }
+        if (pending.size() > 64) {
+            pending.erase(0, pending.size() - 16);
+        }
+    }
+}
+
+// 只动 /tmp 下的路径，且只删本程序留下的指向 pty 的符号链接，不会误删真实串口设备节点
+bool IsOwnLink(const char *path, const std::string &target)
+{
+    struct stat st;
+    if (lstat(path, &st) != 0 || !S_ISLNK(st.st_mode)) {
+        return false;
+    }
+    char buf[256];
+    const ssize_t n = readlink(path, buf, sizeof(buf) - 1);
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+    return target.empty() ? std::strncmp(buf, "/dev/pts/", 9) == 0 : target == buf;
+}
+
+bool PrepareLink(const char *path, const std::string &slave)
+{
+    if (std::strncmp(path, "/tmp/", 5) != 0 || std::strstr(path, "/..") != nullptr) {
+        std::printf("refusing to run: UART_TTL_NAME (%s) must be under /tmp/\n", path);
+        return false;
+    }
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        // 上次运行留下的链接可以替换，其他文件一律不碰
+        if (!IsOwnLink(path, "")) {
+            std::printf("refusing to run: %s exists and is not a pty symlink\n", path);
+            return false;
+        }
+        unlink(path);
+    }
+    if (symlink(slave.c_str(), path) != 0) {
+        std::printf("symlink %s failed\n", path);
+        return false;
+    }
+    return true;
+}
+
+void TestHal()
+{
+    std::string name;
+    const int master = OpenPty(name);
+    const int fd = open(name.c_str(), O_RDWR | O_NOCTTY);
+    uart_init(fd, 115200);
+    const int rates[] = {921600, 1500000, 2000000, 250000, 3000000};
+    for (int rate : rates) {
+        const int rc = uart_set_baudrate(fd, rate);
+        std::printf("hal: set %7d rc=%d read back %d\n", rate, rc, uart_get_baudrate(fd));
+    }
+    close(fd);
+    close(master);
+}
+
+void Negotiate(const char *name, int baud, bool rtscts)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const int rc = serial_set_baudrate(baud, rtscts);
+    std::printf("negotiate: %-24s rc=%d now=%d (%.0f ms)\n", name, rc, serial_get_baudrate(), MsSince(start));
+}
+
+void TestThroughput()
+{
+    std::vector<uint8_t> image(1 << 20);
+    for (uint8_t &c : image) {
+        c = static_cast<uint8_t>(rand());
+    }
+    std::vector<uint8_t> encoded(frame_codec::EncodedBound(image.size()));
+    const size_t n = frame_codec::Encode(image.data(), image.size(), frame_codec::kCameraEnd, encoded.data(),
+                                         encoded.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t off = 0; off < n;) {
+        const ssize_t w = write(g_master, encoded.data() + off, std::min<size_t>(65536, n - off));
+        if (w > 0) {
+            off += static_cast<size_t>(w);
+        }
+    }
+    for (;;) {
+        const image::ImageRef latest = image::GetLatestImage();
+        if (latest && latest->size() == image.size()) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    const double ms = MsSince(start);
+    std::printf("throughput: %zu wire bytes in %.1f ms = %.1f MB/s (line time at 115200 %.1f s, at 2M %.1f s)\n", n,
+                ms, n / ms / 1e3, n * 10 / 115200.0, n * 10 / 2e6);
+}
+
+} // namespace
+
+int main()
+{
+    setvbuf(stdout, nullptr, _IONBF, 0);
+    TestHal();
+
+    std::string slave;
+    g_master = OpenPty(slave);
+    if (g_master < 0) {
+        std::printf("no pty available\n");
+        return 1;
+    }
+    if (!PrepareLink(UART_TTL_NAME, slave)) {
+        return 1;
+    }
+    init_uart();
+    std::thread(FirmwareLoop).detach();
+
+    Negotiate("921600", 921600, false);
+    Negotiate("2000000", 2000000, false);
+    Negotiate("1500000 rtscts (reject)", 1500000, true);
+    g_answerPing.store(false);
+    Negotiate("3000000 (no PONG)", 3000000, false);
+    g_answerPing.store(true);
+
+    TestThroughput();
+
+    if (IsOwnLink(UART_TTL_NAME, slave)) {
+        unlink(UART_TTL_NAME);
+    }
+    // 读线程不会退出，直接结束进程
+    _exit(0);
+}